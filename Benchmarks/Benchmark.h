@@ -0,0 +1,136 @@
+#ifndef _BENCHMARK_
+#define _BENCHMARK_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+// Helpers shared by the benchmark programs under Benchmarks/.  Each program is its own xmake
+// target, not built by default: `xmake build <Name>Bench && xmake run <Name>Bench`.
+namespace Bench
+{
+using Clock = std::chrono::steady_clock;
+
+inline const void* volatile EscapeSink{nullptr};
+
+// Keeps the compiler from proving a result unused and dropping the work that produced it.
+inline void Escape(const void* pointer)
+{
+    EscapeSink = pointer;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+// Runs body repetitions times and returns the fastest run, in seconds.  The fastest run is the
+// one least disturbed by the rest of the system.
+template <typename Body>
+double BestSeconds(std::uint32_t repetitions, Body&& body)
+{
+    auto best{(std::chrono::duration<double>::max)()};
+    for (std::uint32_t i{0}; i < repetitions; ++i)
+    {
+        auto begin{Clock::now()};
+        body();
+        best = std::min<std::chrono::duration<double>>(best, Clock::now() - begin);
+    }
+    return best.count();
+}
+
+inline double GigabytesPerSecond(std::uint64_t bytes, double seconds)
+{
+    return static_cast<double>(bytes) / seconds / 1.0e9;
+}
+
+enum class MemoryKind
+{
+    // Ordinary cached pages.
+    Cached,
+    // Write-combined pages, as a mapped upload heap is.  Windows maps them with
+    // PAGE_WRITECOMBINE; elsewhere user space cannot, so the memory is cached but much larger
+    // than the last-level cache and touched in order, which at least keeps every write a miss.
+    WriteCombined,
+};
+
+// Page-aligned memory of one kind, zeroed and faulted in so first-touch costs stay out of the
+// timings.
+class Memory
+{
+public:
+    Memory(std::size_t byteSize, MemoryKind kind) : mByteSize{byteSize}, mKind{kind}
+    {
+#if defined(_WIN32)
+        DWORD protect{static_cast<DWORD>(kind == MemoryKind::WriteCombined ? PAGE_READWRITE | PAGE_WRITECOMBINE
+                                                                           : PAGE_READWRITE)};
+        mData = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, byteSize, MEM_COMMIT | MEM_RESERVE, protect));
+#else
+        mData = static_cast<std::uint8_t*>(std::aligned_alloc(4096, (byteSize + 4095) & ~std::size_t{4095}));
+#endif
+        if (mData == nullptr)
+        {
+            throw std::bad_alloc{};
+        }
+        std::memset(mData, 0, byteSize);
+    }
+
+    Memory(const Memory& rhs) = delete;
+    Memory& operator=(const Memory& rhs) = delete;
+
+    ~Memory()
+    {
+#if defined(_WIN32)
+        VirtualFree(mData, 0, MEM_RELEASE);
+#else
+        std::free(mData);
+#endif
+    }
+
+    [[nodiscard]] std::uint8_t* Data() const
+    {
+        return mData;
+    }
+
+    [[nodiscard]] std::size_t ByteSize() const
+    {
+        return mByteSize;
+    }
+
+    [[nodiscard]] const char* Description() const
+    {
+#if defined(_WIN32)
+        return mKind == MemoryKind::WriteCombined ? "write-combined" : "cached";
+#else
+        return mKind == MemoryKind::WriteCombined ? "cold cached (no WC in user space)" : "cached";
+#endif
+    }
+
+private:
+    std::uint8_t* mData{nullptr};
+    std::size_t mByteSize{0};
+    MemoryKind mKind{MemoryKind::Cached};
+};
+
+// Large enough to spill any last-level cache, so the stand-in for write-combined memory stays cold.
+constexpr std::size_t ColdMemoryByteSize{512ULL * 1024 * 1024};
+
+// Bytes to allocate for a target that is written usedByteSize bytes at a time, round-robin.
+inline std::size_t TargetByteSize(std::size_t usedByteSize, MemoryKind kind)
+{
+#if defined(_WIN32)
+    static_cast<void>(kind);
+    return usedByteSize;
+#else
+    return kind == MemoryKind::WriteCombined ? std::max<std::size_t>(usedByteSize, ColdMemoryByteSize) : usedByteSize;
+#endif
+}
+} // namespace Bench
+
+#endif // _BENCHMARK_
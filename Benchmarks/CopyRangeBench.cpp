@@ -0,0 +1,109 @@
+// memcpy against D3DUtils::StreamCopy, the non-temporal copy behind UploadBuffer::CopyRange.
+//
+// Each case copies a batch of elements into upload memory the way CopyRange does: constant-buffer
+// elements one per 256-byte slot, other elements as one contiguous run, with a single fence at
+// the end of the batch.  Both copies run into cached and write-combined memory.
+#include "../Shared/StreamCopy.h"
+#include "Benchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+constexpr std::uint32_t Repetitions{20};
+constexpr std::size_t ConstantBufferElementByteSize{256};
+// Bytes written per batch, whatever the element size.
+constexpr std::size_t BatchPayloadByteSize{4 * 1024 * 1024};
+
+enum class Pattern
+{
+    // One copy per element into 256-byte constant buffer slots.
+    ConstantSlots,
+    // One copy per element, back to back, as CopyData into a structured buffer.
+    PackedElements,
+    // One copy of the whole batch, as CopyRange into a structured buffer.
+    PackedBatch,
+};
+
+constexpr const char* PatternNames[]{"cbuffer", "elements", "batch"};
+
+enum class Copier
+{
+    Memcpy,
+    Stream,
+};
+
+void Copy(Copier copier, std::uint8_t* dst, const std::uint8_t* src, std::size_t byteSize)
+{
+    if (copier == Copier::Stream)
+    {
+        D3DUtils::StreamCopy(dst, src, byteSize);
+    }
+    else
+    {
+        std::memcpy(dst, src, byteSize);
+    }
+}
+
+double Run(std::size_t elementSize, Pattern pattern, Copier copier, Bench::MemoryKind kind)
+{
+    auto count{BatchPayloadByteSize / elementSize};
+    auto stride{pattern == Pattern::ConstantSlots
+                    ? (elementSize + ConstantBufferElementByteSize - 1) & ~(ConstantBufferElementByteSize - 1)
+                    : elementSize};
+    std::vector<std::uint8_t> source(count * elementSize, 0x5A);
+
+    auto batchBytes{count * stride};
+    Bench::Memory upload{Bench::TargetByteSize(batchBytes * 3, kind), kind};
+    auto slotCount{upload.ByteSize() / batchBytes};
+
+    std::size_t slot{0};
+    auto seconds{Bench::BestSeconds(Repetitions, [&] {
+        auto* dst{upload.Data() + slot * batchBytes};
+        const auto* src{source.data()};
+        if (pattern == Pattern::PackedBatch)
+        {
+            Copy(copier, dst, src, count * elementSize);
+        }
+        else
+        {
+            for (std::size_t i{0}; i < count; ++i)
+            {
+                Copy(copier, dst + i * stride, src + i * elementSize, elementSize);
+            }
+        }
+        if (copier == Copier::Stream)
+        {
+            D3DUtils::StreamCopyFence();
+        }
+        slot = (slot + 1) % slotCount;
+    })};
+    Bench::Escape(upload.Data());
+    return Bench::GigabytesPerSecond(count * elementSize, seconds);
+}
+} // namespace
+
+int main()
+{
+    for (auto kind : {Bench::MemoryKind::Cached, Bench::MemoryKind::WriteCombined})
+    {
+        std::printf("%s memory, GB/s of element data\n", Bench::Memory{4096, kind}.Description());
+        std::printf("%-8s %8s  %8s %8s\n", "pattern", "element", "memcpy", "stream");
+        for (auto pattern : {Pattern::ConstantSlots, Pattern::PackedElements, Pattern::PackedBatch})
+        {
+            for (std::size_t elementSize : {32U, 48U, 64U, 96U, 128U, 192U, 256U, 4096U})
+            {
+                std::printf("%-8s %6zu B  %8.2f %8.2f\n",
+                            PatternNames[static_cast<int>(pattern)],
+                            elementSize,
+                            Run(elementSize, pattern, Copier::Memcpy, kind),
+                            Run(elementSize, pattern, Copier::Stream, kind));
+            }
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+// std::ifstream against Files::AsyncFileIO for loading whole files.
+//
+// Two sets of files with the same total size are read completely into memory:
+//   - many small files, as shaders, materials and small textures load;
+//   - a few large files, each read as a batch of chunk-sized requests, as a streamed mesh or
+//     texture loads.
+// The ifstream case opens and reads one file after the other.  The AsyncFileIO cases open every
+// file, submit all the reads as one batch and wait, once on the thread pool and once on the native
+// backend where the OS provides it.  The files are read once before timing, so the numbers are for
+// a warm file cache: they measure the per-request overhead and how much of it overlaps, not the
+// disk.
+#include "../Shared/AsyncFileIO.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr std::uint32_t Repetitions{10};
+constexpr std::size_t TotalByteSize{64 * 1024 * 1024};
+constexpr std::size_t ChunkByteSize{1024 * 1024};
+
+struct FileSet
+{
+    const char* Name{nullptr};
+    std::vector<std::filesystem::path> Paths{};
+    std::size_t FileByteSize{0};
+};
+
+FileSet WriteFiles(const std::filesystem::path& directory, const char* name, std::size_t fileCount)
+{
+    FileSet set{name, {}, TotalByteSize / fileCount};
+    std::vector<char> contents(set.FileByteSize);
+    for (std::size_t i{0}; i < contents.size(); ++i)
+    {
+        contents[i] = static_cast<char>(i * 31 + 7);
+    }
+
+    for (std::size_t file{0}; file < fileCount; ++file)
+    {
+        auto path{directory / (std::string{name} + std::to_string(file) + ".bin")};
+        std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+        fout.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!fout.flush())
+        {
+            throw std::runtime_error("Cannot write " + path.u8string());
+        }
+        set.Paths.push_back(path);
+    }
+    return set;
+}
+
+void ReadWithStreams(const FileSet& set, std::vector<std::vector<char>>& buffers)
+{
+    for (std::size_t file{0}; file < set.Paths.size(); ++file)
+    {
+        std::ifstream fin(set.Paths[file], std::ios::binary);
+        fin.read(buffers[file].data(), static_cast<std::streamsize>(buffers[file].size()));
+        Bench::Escape(buffers[file].data());
+    }
+}
+
+void ReadWithAsyncIO(Files::AsyncFileIO& io, const FileSet& set, std::vector<std::vector<char>>& buffers)
+{
+    std::vector<Files::FileId> files{};
+    std::vector<Files::ReadRequest> requests{};
+    for (std::size_t file{0}; file < set.Paths.size(); ++file)
+    {
+        auto id{io.Open(set.Paths[file].wstring())};
+        files.push_back(id);
+        for (std::size_t offset{0}; offset < set.FileByteSize; offset += ChunkByteSize)
+        {
+            auto byteSize{std::min<std::size_t>(ChunkByteSize, set.FileByteSize - offset)};
+            requests.push_back(Files::ReadRequest{id, offset, buffers[file].data() + offset, byteSize, {}});
+        }
+    }
+
+    io.Submit(std::move(requests));
+    io.WaitIdle();
+    for (auto file : files)
+    {
+        io.Close(file);
+    }
+    Bench::Escape(buffers.data());
+}
+
+void Report(const char* set, const char* reader, double seconds)
+{
+    std::printf("%-6s %-22s %10.3f ms %8.2f GB/s\n",
+                set,
+                reader,
+                seconds * 1.0e3,
+                Bench::GigabytesPerSecond(TotalByteSize, seconds));
+}
+} // namespace
+
+int main()
+{
+    auto directory{std::filesystem::temp_directory_path() / "FileReadBench"};
+    std::filesystem::create_directories(directory);
+
+    std::vector<FileSet> sets{};
+    sets.push_back(WriteFiles(directory, "small", 1024));
+    sets.push_back(WriteFiles(directory, "large", 4));
+
+    Files::AsyncFileIO threadPool{Files::IOBackend::ThreadPool};
+    Files::AsyncFileIO native{Files::IOBackend::Auto};
+
+    std::printf("%zu MiB per set, AsyncFileIO reads of at most %zu KiB\n", TotalByteSize >> 20, ChunkByteSize >> 10);
+    std::printf("%-6s %-22s %13s %13s\n", "files", "reader", "time", "throughput");
+    for (const auto& set : sets)
+    {
+        std::vector<std::vector<char>> buffers(set.Paths.size(), std::vector<char>(set.FileByteSize));
+        ReadWithStreams(set, buffers);
+
+        Report(set.Name, "std::ifstream", Bench::BestSeconds(Repetitions, [&] { ReadWithStreams(set, buffers); }));
+        Report(set.Name, "AsyncFileIO thread pool", Bench::BestSeconds(Repetitions, [&] {
+                   ReadWithAsyncIO(threadPool, set, buffers);
+               }));
+        if (native.IsNative())
+        {
+            Report(set.Name, "AsyncFileIO native", Bench::BestSeconds(Repetitions, [&] {
+                       ReadWithAsyncIO(native, set, buffers);
+                   }));
+        }
+    }
+
+    std::error_code error{};
+    std::filesystem::remove_all(directory, error);
+    return 0;
+}
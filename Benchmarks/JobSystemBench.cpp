@@ -0,0 +1,156 @@
+// Scaling of Jobs::JobSystem with the number of worker threads.
+//
+// Two workloads run serially and then on 2, 4, 8, ... threads, up to one per hardware thread:
+//   - parallel-for: ParallelFor over items of fixed arithmetic work, the data-parallel case;
+//   - nested: a binary tree of small jobs where every job waits on its two children, the
+//     fork-join case, where workers mostly steal from each other's queues and wait inside jobs.
+// Reported per count: threads taking part (workers plus the calling thread), time, speed-up over
+// the same work run serially on the calling thread, and parallel efficiency.
+#include "../Shared/JobSystem.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr std::uint32_t Repetitions{10};
+
+constexpr std::size_t ItemCount{1 << 16};
+constexpr std::size_t GrainSize{256};
+constexpr int WorkPerItem{200};
+
+constexpr int TreeDepth{15};
+constexpr int WorkPerNode{50};
+
+float ItemWork(std::size_t item, int rounds)
+{
+    auto value{static_cast<float>(item) * 1.0e-3F};
+    for (int i{0}; i < rounds; ++i)
+    {
+        value = std::sqrt(value * value + 1.0F);
+    }
+    return value;
+}
+
+void Tree(Jobs::JobSystem* system, int depth, std::atomic<int>& leafCount)
+{
+    auto value{ItemWork(static_cast<std::size_t>(depth), WorkPerNode)};
+    Bench::Escape(&value);
+    if (depth > 0)
+    {
+        if (system != nullptr)
+        {
+            Jobs::JobCounter children{};
+            system->Run([system, depth, &leafCount]() { Tree(system, depth - 1, leafCount); }, &children);
+            system->Run([system, depth, &leafCount]() { Tree(system, depth - 1, leafCount); }, &children);
+            system->Wait(children);
+        }
+        else
+        {
+            Tree(nullptr, depth - 1, leafCount);
+            Tree(nullptr, depth - 1, leafCount);
+        }
+    }
+    else
+    {
+        leafCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+double ParallelForSeconds(Jobs::JobSystem* system)
+{
+    std::vector<float> results(ItemCount);
+    auto body{[&results](std::size_t begin, std::size_t end) {
+        for (auto i{begin}; i < end; ++i)
+        {
+            results[i] = ItemWork(i, WorkPerItem);
+        }
+    }};
+
+    auto seconds{Bench::BestSeconds(Repetitions, [&] {
+        if (system != nullptr)
+        {
+            system->ParallelFor(ItemCount, GrainSize, body);
+        }
+        else
+        {
+            body(0, ItemCount);
+        }
+    })};
+    Bench::Escape(results.data());
+    return seconds;
+}
+
+double NestedSeconds(Jobs::JobSystem* system)
+{
+    std::atomic<int> leafCount{0};
+    auto seconds{Bench::BestSeconds(Repetitions, [&] {
+        if (system != nullptr)
+        {
+            Jobs::JobCounter root{};
+            system->Run([system, &leafCount]() { Tree(system, TreeDepth, leafCount); }, &root);
+            system->Wait(root);
+        }
+        else
+        {
+            Tree(nullptr, TreeDepth, leafCount);
+        }
+    })};
+    Bench::Escape(&leafCount);
+    return seconds;
+}
+
+void Report(const char* workload, unsigned threadCount, double seconds, double serialSeconds)
+{
+    auto speedUp{serialSeconds / seconds};
+    std::printf("%-13s %7u %10.3f ms %8.2fx %9.0f%%\n",
+                workload,
+                threadCount,
+                seconds * 1.0e3,
+                speedUp,
+                100.0 * speedUp / threadCount);
+}
+} // namespace
+
+int main()
+{
+    auto hardwareThreads{std::max<unsigned>(1U, std::thread::hardware_concurrency())};
+    std::printf("%u hardware threads; %d tree jobs, %zu items in ranges of %zu\n",
+                hardwareThreads,
+                (1 << (TreeDepth + 1)) - 1,
+                ItemCount,
+                GrainSize);
+    std::printf("%-13s %7s %13s %9s %10s\n", "workload", "threads", "time", "speed-up", "efficiency");
+
+    auto serialParallelFor{ParallelForSeconds(nullptr)};
+    auto serialNested{NestedSeconds(nullptr)};
+    Report("parallel-for", 1, serialParallelFor, serialParallelFor);
+    Report("nested", 1, serialNested, serialNested);
+
+    // The calling thread takes part in both workloads, so workerCount workers make workerCount + 1
+    // threads.  The largest count fills the hardware; on a single-core machine the only count
+    // oversubscribes it and shows the scheduler's overhead instead.
+    std::vector<unsigned> workerCounts{1};
+    for (unsigned count{3}; count < hardwareThreads; count = count * 2 + 1)
+    {
+        workerCounts.push_back(count);
+    }
+    if (workerCounts.back() != hardwareThreads - 1 && hardwareThreads > 1)
+    {
+        workerCounts.push_back(hardwareThreads - 1);
+    }
+
+    for (auto workerCount : workerCounts)
+    {
+        Jobs::JobSystem system{workerCount};
+        Report("parallel-for", workerCount + 1, ParallelForSeconds(&system), serialParallelFor);
+        Report("nested", workerCount + 1, NestedSeconds(&system), serialNested);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Per-object upload cost of the padded constant-buffer layout against the packed structured-buffer
+// layout Chapter_7 uses (Shared/PackedObjectData.h).
+//
+// Every frame writes each object's world matrix into the frame's slot of an upload buffer, the
+// way UploadBuffer::CopyData does: a transposed 4x4 matrix into a 256-byte constant buffer element,
+// or a 3x4 affine matrix into a 48-byte ObjectData element.  Reported per layout: upload-heap bytes
+// per frame slot, bytes written per frame, and the CPU time and bandwidth of the writes, in cached
+// and write-combined memory.
+//
+// This measures the CPU write side only.  What the GPU pays to read either layout needs timestamps
+// on real hardware; Chapter_7's "Opaque" GPU profiler scope shows it.
+#include "Benchmark.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+constexpr std::uint32_t FramesInFlight{3};
+constexpr std::uint32_t Repetitions{20};
+constexpr std::size_t ConstantBufferElementByteSize{256};
+
+// Mirror the D3DUtils layouts, which need DirectXMath and so do not build everywhere.
+struct Matrix
+{
+    float M[4][4];
+};
+
+struct ObjectConstants
+{
+    float World[4][4];
+};
+
+struct ObjectData
+{
+    float World[3][4];
+};
+
+static_assert(sizeof(ObjectConstants) == 64 && sizeof(ObjectData) == 48, "Layouts must match the shaders.");
+
+struct Layout
+{
+    const char* Name;
+    std::size_t Stride;
+    std::size_t WrittenSize;
+    // Transposes world and writes it to dst, as the app's packing code does.
+    void (*Write)(const Matrix& world, std::uint8_t* dst);
+};
+
+void WriteConstants(const Matrix& world, std::uint8_t* dst)
+{
+    ObjectConstants constants{};
+    for (int row{0}; row < 4; ++row)
+    {
+        for (int column{0}; column < 4; ++column)
+        {
+            constants.World[row][column] = world.M[column][row];
+        }
+    }
+    std::memcpy(dst, &constants, sizeof(constants));
+}
+
+void WritePacked(const Matrix& world, std::uint8_t* dst)
+{
+    // The transposed matrix's last row is (0, 0, 0, 1) for an affine transform; it is dropped.
+    ObjectData data{};
+    for (int row{0}; row < 3; ++row)
+    {
+        for (int column{0}; column < 4; ++column)
+        {
+            data.World[row][column] = world.M[column][row];
+        }
+    }
+    std::memcpy(dst, &data, sizeof(data));
+}
+
+constexpr std::array<Layout, 2> Layouts{{
+    {"constant buffer", ConstantBufferElementByteSize, sizeof(ObjectConstants), WriteConstants},
+    {"packed 3x4", sizeof(ObjectData), sizeof(ObjectData), WritePacked},
+}};
+
+void Run(std::uint32_t objectCount, const Layout& layout, Bench::MemoryKind kind)
+{
+    std::vector<Matrix> worlds(objectCount);
+    for (std::uint32_t i{0}; i < objectCount; ++i)
+    {
+        auto& world{worlds[i].M};
+        world[0][0] = world[1][1] = world[2][2] = world[3][3] = 1.0F;
+        world[3][0] = static_cast<float>(i);
+    }
+
+    auto frameBytes{layout.Stride * objectCount};
+    Bench::Memory upload{Bench::TargetByteSize(frameBytes * FramesInFlight, kind), kind};
+    auto slotCount{upload.ByteSize() / frameBytes};
+
+    std::size_t slot{0};
+    auto seconds{Bench::BestSeconds(Repetitions, [&] {
+        auto* frame{upload.Data() + slot * frameBytes};
+        for (std::uint32_t i{0}; i < objectCount; ++i)
+        {
+            layout.Write(worlds[i], frame + i * layout.Stride);
+        }
+        slot = (slot + 1) % slotCount;
+    })};
+    Bench::Escape(upload.Data());
+
+    auto writtenBytes{layout.WrittenSize * objectCount};
+    std::printf("%7u objects  %-16s %-34s slot %9zu B  written %8zu B  %6.1f ns/object  %6.2f GB/s\n",
+                objectCount,
+                layout.Name,
+                upload.Description(),
+                frameBytes,
+                writtenBytes,
+                seconds * 1.0e9 / objectCount,
+                Bench::GigabytesPerSecond(writtenBytes, seconds));
+}
+} // namespace
+
+int main()
+{
+    for (auto kind : {Bench::MemoryKind::Cached, Bench::MemoryKind::WriteCombined})
+    {
+        for (std::uint32_t objectCount : {1000U, 10000U, 100000U})
+        {
+            for (const auto& layout : Layouts)
+            {
+                Run(objectCount, layout, kind);
+            }
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include "../Shared/PerfHud.h"
 #include "D3DApp.h"
 #include "DirectXTK12/SimpleMath.h"
 #include "imgui.h"
@@ -45,6 +46,8 @@ public:
 
 private:
     void OnResize() override;
+    void OnFramesInFlightChanged() override;
+    [[nodiscard]] bool CanChangeFramesInFlight() const override;
     void Update(const Timer& gt) override;
     void Draw(const Timer& gt) override;
 
@@ -68,7 +71,6 @@ private:
 
     std::unique_ptr<UploadBuffer<ObjectConstants>> mObjectCB{};
 
-    static const int gNumFrameResources{3};
     std::vector<std::unique_ptr<FrameResource>> mFrameResources{};
     FrameResource* mCurrFrameResource{};
     UINT mCurrFrameResourceIndex{};
@@ -126,6 +128,7 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance,
 BoxApp::BoxApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
     mMainWndCaption = L"Box App with imgui";
+    SetPerfHudVisible(true);
 }
 
 BoxApp::~BoxApp() = default;
@@ -145,7 +148,7 @@ bool BoxApp::Initialize()
     ImGui::StyleColorsDark();
     ImGui_ImplWin32_Init(mhMainWnd);
     ImGui_ImplDX12_Init(md3dDevice.Get(),
-                        3,
+                        static_cast<int>(MaxFramesInFlight),
                         DXGI_FORMAT_R8G8B8A8_UNORM,
                         mImguiSrvHeap.Get(),
                         mImguiSrvHeap.Get()->GetCPUDescriptorHandleForHeapStart(),
@@ -164,6 +167,8 @@ bool BoxApp::Initialize()
     ThrowIfFailed(mCommandList->Close());
     const std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+    // The copies out of the uploaders are in the list just submitted, before the next Signal.
+    mBoxGeo->DisposeUploaders(mDeferredReleases, mCurrentFence + 1);
 
     FlushCommandQueue();
 
@@ -178,24 +183,30 @@ void BoxApp::OnResize()
     XMStoreFloat4x4(&mProj, proj);
 }
 
+bool BoxApp::CanChangeFramesInFlight() const
+{
+    return true;
+}
+
+void BoxApp::OnFramesInFlightChanged()
+{
+    // D3DApp has flushed; the old frame resources and their views are idle.
+    mFrameResources.clear();
+    mCurrFrameResource = nullptr;
+    mCurrFrameResourceIndex = 0;
+
+    BuildCbvSrvUavDescriptorHeap();
+    BuildFrameResources();
+    BuildCbvSrvUavViews();
+}
+
 void BoxApp::Update(const Timer& gt)
 {
-    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
+    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % mFramesInFlight;
     mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
 
     // If the current frame resource isn't ready to use, wait until it is ready.
-    if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle{CreateEventEx(nullptr, FALSE, FALSE, EVENT_ALL_ACCESS)};
-        if (eventHandle == nullptr)
-        {
-            std::string message{"Failed to create event: " + std::to_string(GetLastError())};
-            throw std::runtime_error{message};
-        }
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    mCurrFrameResource->CpuWaitTime = mFenceWaiter.Wait(*mGfxFence, mCurrFrameResource->Fence).WaitTime;
 
     // Update camera.
     float x{mRadius * sinf(mPhi) * cosf(mTheta)};
@@ -306,8 +317,21 @@ void BoxApp::Draw(const Timer& gt)
                     ImGui::GetIO().Framerate);
         ImGui::End();
     }
+    if (IsPerfHudVisible())
+    {
+        bool isOpen{true};
+        Profiling::DrawPerfHud(mPerfMonitor, nullptr, &isOpen);
+        SetPerfHudVisible(isOpen);
+    }
     mCommandList->SetDescriptorHeaps(1, mImguiSrvHeap.GetAddressOf());
     ImGui::Render();
+
+    auto& counters{mPerfMonitor.Counters()};
+    counters.DrawCalls += 1;
+    counters.Triangles += mBoxGeo->DrawArgs["box"].IndexCount / 3;
+    counters.VisibleItems += 1;
+    counters.TotalItems += 1;
+    Profiling::CountImGuiDrawData(*ImGui::GetDrawData(), counters);
     ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
 
     ThrowIfFailed(mCommandList->Close());
@@ -316,7 +340,7 @@ void BoxApp::Draw(const Timer& gt)
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
 
     ThrowIfFailed(mSwapChain->Present(0, 0));
-    mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+    mCurrBackBuffer = (mCurrBackBuffer + 1) % mSwapChainBufferCount;
 
     mCurrFrameResource->Fence = ++mCurrentFence;
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
@@ -365,7 +389,7 @@ void BoxApp::BuildCbvSrvUavDescriptorHeap()
     const auto objCount{1};
 
     D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc{};
-    cbvHeapDesc.NumDescriptors = objCount * gNumFrameResources;
+    cbvHeapDesc.NumDescriptors = objCount * mFramesInFlight;
     cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     cbvHeapDesc.NodeMask = 0;
@@ -377,7 +401,7 @@ void BoxApp::BuildCbvSrvUavViews()
     UINT objCBByteSize{CalcConstantBufferByteSize(sizeof(ObjectConstants))};
     const auto objCount{1};
 
-    for (UINT frameIndex{0}; frameIndex < gNumFrameResources; ++frameIndex)
+    for (UINT frameIndex{0}; frameIndex < mFramesInFlight; ++frameIndex)
     {
         auto* objectCB{mFrameResources[frameIndex]->ObjectCB->Resource()};
 
@@ -506,7 +530,7 @@ void BoxApp::BuildBoxGeometry()
 
 void BoxApp::BuildFrameResources()
 {
-    for (size_t i{0}; i < gNumFrameResources; ++i)
+    for (size_t i{0}; i < mFramesInFlight; ++i)
     {
         mFrameResources.emplace_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1, 0));
     }
@@ -99,7 +99,7 @@ void InitDirect3DApp::Draw(const Timer& t)
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdsList.size()), cmdsList.data());
 
     ThrowIfFailed(mSwapChain->Present(0, 0));
-    mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+    mCurrBackBuffer = (mCurrBackBuffer + 1) % mSwapChainBufferCount;
 
     FlushCommandQueue();
 }
@@ -135,6 +135,8 @@ bool BoxApp::Initialize()
     ThrowIfFailed(mCommandList->Close());
     std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+    // The copies out of the uploaders are in the list just submitted, before the next Signal.
+    mBoxGeo->DisposeUploaders(mDeferredReleases, mCurrentFence + 1);
 
     FlushCommandQueue();
 
@@ -216,7 +218,7 @@ void BoxApp::Draw(const Timer& gt)
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
 
     ThrowIfFailed(mSwapChain->Present(0, 0));
-    mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+    mCurrBackBuffer = (mCurrBackBuffer + 1) % mSwapChainBufferCount;
 
     FlushCommandQueue();
 }
@@ -4,9 +4,17 @@
 // Transforms and colors geometry.
 //***************************************************************************************
 
+struct ObjectData
+{
+    // Affine world matrix with the constant (0, 0, 0, 1) column dropped.
+    row_major float3x4 World;
+};
+
+StructuredBuffer<ObjectData> gObjects : register(t0);
+
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
+    uint gObjectIndex;
 };
 
 cbuffer cbPass : register(b1)
@@ -44,7 +52,7 @@ VertexOut VS(VertexIn vin)
     VertexOut vout;
 
     // Transform to homogeneous clip space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = float4(mul(gObjects[gObjectIndex].World, float4(vin.PosL, 1.0f)), 1.0f);
     vout.PosH = mul(posW, gViewProj);
 
     // Just pass vertex color into the pixel shader.
@@ -1,5 +1,12 @@
+#include "../Shared/FileWatcher.h"
 #include "../Shared/GeometryGenerator.h"
+#include "../Shared/GfxD3D12.h"
+#include "../Shared/PackedObjectData.h"
+#include "../Shared/PipelineCache.h"
 #include "../Shared/PlatformHelpers.h"
+#include "../Shared/Profiler.h"
+#include "../Shared/RenderGraph.h"
+#include "../Shared/ShaderPermutations.h"
 #include "D3DApp.h"
 #include "DirectXTK12/SimpleMath.h"
 #include "directx/d3dx12.h"
@@ -10,6 +17,7 @@
 #include <algorithm>
 #include <array>
 #include <d3d12.h>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -21,17 +29,30 @@ using namespace DirectX::SimpleMath;
 using namespace D3DUtils;
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+// The build names the source shader directory so that edits there are compiled and picked up
+// without a rebuild; the copy next to the executable is used when it is not named or not there.
+std::wstring ShaderDirectory()
+{
+#if defined(SHADER_SOURCE_DIR)
+    std::wstring source{L"" SHADER_SOURCE_DIR};
+    std::error_code error{};
+    if (std::filesystem::is_directory(source, error))
+    {
+        return source;
+    }
+#endif
+    return ExecutableRelativePath(L"Shaders");
+}
+} // namespace
+
 struct Vertex
 {
     XMFLOAT3 Pos{};
     XMFLOAT4 Color{};
 };
 
-struct ObjectConstants
-{
-    XMFLOAT4X4 World{SimpleMath::Matrix::Identity};
-};
-
 struct PassConstants
 {
     DirectX::XMFLOAT4X4 View{SimpleMath::Matrix::Identity};
@@ -52,7 +73,7 @@ struct PassConstants
 
 class ShapesApp : public D3DApp
 {
-    using FrameResource = FrameResource<ObjectConstants, PassConstants>;
+    using FrameResource = FrameResource<ObjectData, PassConstants>;
     using MeshGeometry = MeshGeometry<1>;
 
     struct RenderItem
@@ -60,7 +81,7 @@ class ShapesApp : public D3DApp
         RenderItem() = default;
         XMFLOAT4X4 World{Matrix::Identity};
 
-        int NumFramesDirty{gNumFrameResources};
+        int NumFramesDirty{MaxFramesInFlight};
         UINT ObjCBIndex{0xffffffff};
         MeshGeometry* Geo{nullptr};
 
@@ -81,6 +102,8 @@ public:
 
 private:
     void OnResize() override;
+    void OnFramesInFlightChanged() override;
+    [[nodiscard]] bool CanChangeFramesInFlight() const override;
     void Update(const Timer& gt) override;
     void Draw(const Timer& gt) override;
 
@@ -88,12 +111,15 @@ private:
     void OnMouseUp(WPARAM btnState, int x, int y) override;
     void OnMouseMove(WPARAM btnState, int x, int y) override;
 
-    void UpdateObjectCBs(const Timer& gt);
+    void UpdateObjectData(const Timer& gt);
     void UpdateMainPassCB(const Timer& gt);
     void OnKeyboardInput(const Timer& gt);
     void UpdateCamera(const Timer& gt);
+    void UpdateShaders();
 
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+    void SetOpaquePassState(ID3D12GraphicsCommandList* cmdList);
+    void RecordOpaqueChunk(UINT chunk, UINT chunkCount, ID3D12PipelineState* pso);
+    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, RenderItem* const* first, RenderItem* const* last);
 
     void CreateCbvDescriptorHeaps();
     void BuildConstantBufferViews();
@@ -102,25 +128,62 @@ private:
     void BuildShapeGeometry();
     void BuildRenderItems();
     void BuildPSOs();
+    void CreatePSOs(bool reload);
     void BuildFrameResources();
 
+    void LogObjectDataFootprint();
+
     // Fields
     ComPtr<ID3D12RootSignature> mRootSignature{};
-    ComPtr<ID3D12DescriptorHeap> mCbvSrvUavHeap{};
+    std::uint64_t mRootSignatureHash{0};
+    // Pass CBVs live in the staging heap; each frame copies the one it binds into the ring.
+    static constexpr UINT StagingCbvCapacity{256};
+    static constexpr UINT DynamicCbvCapacity{1024};
+    std::unique_ptr<StagingDescriptorHeap> mCbvStagingHeap{};
+    std::unique_ptr<DynamicDescriptorHeap> mCbvHeap{};
+    D3D12_GPU_DESCRIPTOR_HANDLE mPassCbvTable{};
 
     std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries{};
-    std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders{};
-    std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs{};
 
-    static const UINT gNumFrameResources{3};
+    // Compiled as jobs; later runs load them from the shader cache.
+    Gfx::ShaderPermutations mShaderPermutations{DefaultShaderCache(), mJobSystem};
+    Gfx::ShaderId mStandardVS{};
+    Gfx::ShaderId mOpaquePS{};
+    // Edits to the shaders in use are recompiled in the background and swapped in between frames.
+    const std::wstring mShaderDirectory{ShaderDirectory()};
+    std::unique_ptr<Files::FileWatcher> mShaderWatcher{};
+
+    // Compiled pipelines are kept next to the executable between runs.
+    const std::wstring mPipelineLibraryFile{ExecutableRelativePath(L"Chapter_7.pipelines")};
+    std::unique_ptr<Gfx::D3D12PipelineLibrary> mPipelineLibrary{};
+    std::unique_ptr<Gfx::PipelineCache> mPipelineCache{};
+    // Whether background PSOs were being created last frame; the library is saved when they finish.
+    bool mPipelinesPending{false};
+    Gfx::PipelineId mOpaquePso{Gfx::InvalidPipelineId};
+    Gfx::PipelineId mOpaqueWireframePso{Gfx::InvalidPipelineId};
+    // Built from reloaded shaders; they replace the PSOs above together once both are ready.
+    Gfx::PipelineId mReloadedOpaquePso{Gfx::InvalidPipelineId};
+    Gfx::PipelineId mReloadedOpaqueWireframePso{Gfx::InvalidPipelineId};
+
+    // Opaque items are recorded in contiguous chunks, one command list per chunk, as jobs on up to
+    // mRecordThreadCount threads.  Chunks smaller than MinItemsPerChunk are not worth a job.
+    static constexpr UINT MaxRecordThreads{8};
+    static constexpr size_t MinItemsPerChunk{8};
+    UINT mRecordThreadCount{1};
+
+    // Rebuilt every frame; owns the back buffer and depth transitions.
+    Gfx::RenderGraph mFrameGraph{};
+
     std::vector<std::unique_ptr<FrameResource>> mFrameResources{};
     FrameResource* mCurrFrameResource{};
     UINT mCurrFrameResourceIndex{};
+    // First of the mFramesInFlight pass CBVs in the staging heap.
     UINT mPassCbvOffset{};
 
     PassConstants mMainPassCB{};
 
     std::vector<std::unique_ptr<RenderItem>> mAllRitems{};
+    std::vector<ObjectData> mObjectDataStaging{};
     std::vector<RenderItem*> mOpaqueRitems{};
     std::vector<RenderItem*> mTransparentRitems{};
 
@@ -169,9 +232,18 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 ShapesApp::ShapesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
     mMainWndCaption = L"Shapes App";
+
+    mRecordThreadCount = std::clamp(mJobSystem.WorkerCount() + 1, 1U, MaxRecordThreads);
 }
 
-ShapesApp::~ShapesApp() = default;
+ShapesApp::~ShapesApp()
+{
+    // Save skips the write when nothing changed; pipelines still being created are left out.
+    if (mPipelineCache != nullptr)
+    {
+        mPipelineCache->Save(mPipelineLibraryFile);
+    }
+}
 
 bool ShapesApp::Initialize()
 {
@@ -181,6 +253,7 @@ bool ShapesApp::Initialize()
     }
 
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
+    mCommandListStates.Reset();
 
     BuildRootSignature();
     BuildShadersAndInputLayout();
@@ -191,11 +264,15 @@ bool ShapesApp::Initialize()
     BuildConstantBufferViews();
     BuildPSOs();
 
-    ThrowIfFailed(mCommandList->Close());
-    std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
-    mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+    LogObjectDataFootprint();
 
-    FlushCommandQueue();
+    // All geometry goes up as one batch on the copy queue.  Nothing on the graphics queue runs
+    // before it has landed, and the CPU does not wait for it.
+    mCopyQueue->InsertWait(*mGfxCommandQueue, mCopyQueue->Submit());
+
+    mCommandListStates.FlushBarriers(*mGfxCommandList);
+    ThrowIfFailed(mCommandList->Close());
+    ExecuteTracked(mCommandList.Get(), mCommandListStates);
 
     return true;
 }
@@ -208,52 +285,96 @@ void ShapesApp::OnResize()
     XMStoreFloat4x4(&mProj, proj);
 }
 
+bool ShapesApp::CanChangeFramesInFlight() const
+{
+    return true;
+}
+
+void ShapesApp::OnFramesInFlightChanged()
+{
+    // D3DApp has flushed, so the old frame resources and their pass CBVs are idle.
+    mCbvStagingHeap->Free(mPassCbvOffset, static_cast<UINT>(mFrameResources.size()), mCurrentFence);
+    mCbvStagingHeap->ReleaseCompleted(mCurrentFence);
+    mFrameResources.clear();
+    mCurrFrameResource = nullptr;
+    mCurrFrameResourceIndex = 0;
+
+    BuildFrameResources();
+    mPassCbvOffset = mCbvStagingHeap->Allocate(mFramesInFlight);
+    BuildConstantBufferViews();
+
+    // Every new frame resource needs the object data written once.
+    for (auto& e : mAllRitems)
+    {
+        e->NumFramesDirty = static_cast<int>(mFramesInFlight);
+    }
+
+    LogObjectDataFootprint();
+}
+
 void ShapesApp::Update(const Timer& gt)
 {
     OnKeyboardInput(gt);
     UpdateCamera(gt);
+    UpdateShaders();
 
-    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
+    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % mFramesInFlight;
     mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
 
-    if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+    mCurrFrameResource->CpuWaitTime = mFenceWaiter.Wait(*mGfxFence, mCurrFrameResource->Fence).WaitTime;
+
+    auto completedFence{mFence->GetCompletedValue()};
+    mCbvHeap->ReleaseCompleted(completedFence);
+    mCbvStagingHeap->ReleaseCompleted(completedFence);
+
+    // Save once a batch of background PSOs is in, and again at shutdown for anything created since.
+    // A failed save only costs a recompile on the next launch.
+    auto pipelinesPending{mPipelineCache->Stats().Pending != 0};
+    if (mPipelinesPending && !pipelinesPending)
     {
-        HANDLE eventHandle{CreateEventEx(nullptr, FALSE, FALSE, EVENT_ALL_ACCESS)};
-        if (eventHandle == nullptr)
-        {
-            std::string message{"Failed to create event: " + std::to_string(GetLastError())};
-            throw std::runtime_error{message};
-        }
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+        mPipelineCache->Save(mPipelineLibraryFile);
     }
+    mPipelinesPending = pipelinesPending;
 
-    UpdateObjectCBs(gt);
+    UpdateObjectData(gt);
     UpdateMainPassCB(gt);
 }
 
-void ShapesApp::UpdateObjectCBs(const Timer& gt)
+void ShapesApp::UpdateObjectData(const Timer& gt)
 {
-    auto* currObjectCB{mCurrFrameResource->ObjectCB.get()};
+    PROFILE_ZONE("UpdateObjectData");
+
+    // Pack the dirty objects into CPU memory first, then stream the dirty range into the mapped
+    // buffer in one batch instead of scattering partial writes over write-combined memory.
+    // Clean objects inside the range still hold their current data in the staging copy.
+    UINT firstDirty{UINT_MAX};
+    UINT lastDirty{0};
     for (auto& e : mAllRitems)
     {
         if (e->NumFramesDirty > 0)
         {
             XMMATRIX world{XMLoadFloat4x4(&e->World)};
+            PackObjectData(world, mObjectDataStaging[e->ObjCBIndex]);
 
-            ObjectConstants objConstants;
-            XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-
-            currObjectCB->CopyData(static_cast<int>(e->ObjCBIndex), objConstants);
+            firstDirty = std::min<UINT>(firstDirty, e->ObjCBIndex);
+            lastDirty = std::max<UINT>(lastDirty, e->ObjCBIndex);
 
             --e->NumFramesDirty;
         }
     }
+
+    if (firstDirty <= lastDirty)
+    {
+        mCurrFrameResource->ObjectCB->CopyRange(static_cast<int>(firstDirty),
+                                                &mObjectDataStaging[firstDirty],
+                                                lastDirty - firstDirty + 1);
+    }
 }
 
 void ShapesApp::UpdateMainPassCB(const Timer& gt)
 {
+    PROFILE_ZONE("UpdateMainPassCB");
+
     XMMATRIX view{XMLoadFloat4x4(&mView)};
     XMMATRIX proj{XMLoadFloat4x4(&mProj)};
     XMMATRIX viewProj{XMMatrixMultiply(view, proj)};
@@ -286,58 +407,119 @@ void ShapesApp::Draw(const Timer& gt)
     auto& cmdListAlloc{mCurrFrameResource->CmdListAlloc};
     ThrowIfFailed(cmdListAlloc->Reset());
 
-    if (mIsWireframe)
+    // Null while neither the PSO nor its fallback is ready; the opaque items are skipped then.
+    auto* pso{Gfx::ToD3D12PipelineState(mPipelineCache->Resolve(mIsWireframe ? mOpaqueWireframePso : mOpaquePso))};
+
+    // Build this frame's descriptor tables before any recording thread binds them.
+    mPassCbvTable = mCbvHeap->CopyTable(*mCbvStagingHeap, mPassCbvOffset + mCurrFrameResourceIndex, 1);
+
+    // Clear, then draw the opaque items.  The graph places the back buffer transitions.
+    mFrameGraph.Reset();
+    auto backBuffer{mFrameGraph.Import("BackBuffer",
+                                       Gfx::ToHandle(CurrentBackBuffer()),
+                                       Gfx::States::Present,
+                                       Gfx::States::Present)};
+    auto depthStencil{mFrameGraph.Import("DepthStencil",
+                                         Gfx::ToHandle(mDepthStencilBuffer.Get()),
+                                         Gfx::States::DepthWrite,
+                                         Gfx::States::DepthWrite)};
+    auto writeTargets{[backBuffer, depthStencil](Gfx::RenderGraph::PassBuilder& pass)
     {
-        ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque_wireframe"].Get()));
-    }
-    else
+        pass.Write(backBuffer, Gfx::States::RenderTarget);
+        pass.Write(depthStencil, Gfx::States::DepthWrite);
+    }};
+
+    mFrameGraph.AddPass("Clear", writeTargets, [this](Gfx::ICommandList& cmdList)
+    {
+        cmdList.ClearRenderTargetView(CurrentBackBufferView().ptr, Colors::LightSteelBlue.f);
+        cmdList.ClearDepthStencilView(DepthStencilView().ptr,
+                                      D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+                                      1.0F,
+                                      0);
+    });
+    // Recorded below on the chunk lists.
+    mFrameGraph.AddPass("Opaque", writeTargets);
+    mFrameGraph.Compile();
+
+    // The main list runs the clear pass; the opaque items follow in chunk lists.  The opaque
+    // pass's own barriers go at the end of the main list, which is the same point in the queue.
+    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), pso));
+
+    // The frame and opaque scopes span lists: they end on the present list, which runs last.
+    mGpuProfiler->BeginFrame();
+    auto frameScope{mGpuProfiler->BeginScope(*mGfxCommandList, "Frame")};
+
+    mFrameGraph.RecordBarriers(0, *mGfxCommandList);
     {
-        ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+        GPU_PROFILE_SCOPE(*mGpuProfiler, *mGfxCommandList, "Clear");
+        mFrameGraph.ExecutePass(0, *mGfxCommandList);
     }
+    mFrameGraph.RecordBarriers(1, *mGfxCommandList);
+    auto opaqueScope{mGpuProfiler->BeginScope(*mGfxCommandList, "Opaque")};
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    auto barrier{CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-                                                      D3D12_RESOURCE_STATE_PRESENT,
-                                                      D3D12_RESOURCE_STATE_RENDER_TARGET)};
-    mCommandList->ResourceBarrier(1, &barrier);
-
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
-    mCommandList
-        ->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0F, 0, 0, nullptr);
-
-    auto backBufferView{CurrentBackBufferView()};
-    auto depthStencilView{DepthStencilView()};
-    mCommandList->OMSetRenderTargets(1, &backBufferView, TRUE, &depthStencilView);
-
-    const std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps{mCbvSrvUavHeap.Get()};
-    mCommandList->SetDescriptorHeaps(static_cast<UINT>(descriptorHeaps.size()), descriptorHeaps.data());
-
-    mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-    auto passCbvIndex{mPassCbvOffset + mCurrFrameResourceIndex};
-    auto passCbvHandle{CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart())};
-    passCbvHandle.Offset(static_cast<INT>(passCbvIndex), mCbvSrvUavDescriptorSize);
-    mCommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
+    ThrowIfFailed(mCommandList->Close());
 
-    DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+    // Record the chunks as jobs, one chunk per job; the calling thread takes part.  ParallelFor
+    // rethrows any exception thrown while recording.
+    auto chunkCount{pso != nullptr ? static_cast<UINT>(std::clamp<size_t>(
+                                         (mOpaqueRitems.size() + MinItemsPerChunk - 1) / MinItemsPerChunk,
+                                         1,
+                                         mRecordThreadCount))
+                                   : 0U};
 
-    barrier = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-                                                   D3D12_RESOURCE_STATE_RENDER_TARGET,
-                                                   D3D12_RESOURCE_STATE_PRESENT);
-    mCommandList->ResourceBarrier(1, &barrier);
+    mJobSystem.ParallelFor(chunkCount, 1, [this, chunkCount, pso](size_t begin, size_t end)
+    {
+        for (auto chunk{begin}; chunk < end; ++chunk)
+        {
+            RecordOpaqueChunk(static_cast<UINT>(chunk), chunkCount, pso);
+        }
+    });
 
-    ThrowIfFailed(mCommandList->Close());
+    // Filled here rather than while recording, which runs on the job threads.
+    auto& counters{mPerfMonitor.Counters()};
+    counters.TotalItems += static_cast<std::uint32_t>(mOpaqueRitems.size());
+    if (pso != nullptr)
+    {
+        for (const auto* ri : mOpaqueRitems)
+        {
+            counters.Triangles += ri->IndexCount / 3;
+        }
+        counters.DrawCalls += static_cast<std::uint32_t>(mOpaqueRitems.size());
+        counters.VisibleItems += static_cast<std::uint32_t>(mOpaqueRitems.size());
+    }
+    counters.DescriptorsUsed = mCbvHeap->Allocator().UsedCount();
+    counters.DescriptorCapacity = mCbvHeap->Allocator().Capacity();
+
+    // The last list of the pool returns the imported resources to their final states for present.
+    auto* recordLists{mCurrFrameResource->RecordLists.get()};
+    auto* presentList{recordLists->Begin(mRecordThreadCount, nullptr)};
+    Gfx::D3D12CommandList gfxPresentList{presentList};
+    mGpuProfiler->EndScope(gfxPresentList, opaqueScope);
+    mFrameGraph.RecordFinalBarriers(gfxPresentList);
+    mGpuProfiler->EndScope(gfxPresentList, frameScope);
+    mGpuProfiler->EndFrame(gfxPresentList, mCurrentFence + 1);
+    ThrowIfFailed(presentList->Close());
+
+    // Submit everything in order with one call.
+    std::array<ID3D12CommandList*, MaxRecordThreads + 2> cmdLists{};
+    UINT cmdListCount{0};
+    cmdLists[cmdListCount++] = mCommandList.Get();
+    for (UINT chunk{0}; chunk < chunkCount; ++chunk)
+    {
+        cmdLists[cmdListCount++] = recordLists->List(chunk);
+    }
+    cmdLists[cmdListCount++] = presentList;
 
-    std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
-    mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+    // Uploads queued since the last frame go out now; only the work from here on waits for them.
+    mCopyQueue->InsertWait(*mGfxCommandQueue, mCopyQueue->Submit());
+    mCommandQueue->ExecuteCommandLists(cmdListCount, cmdLists.data());
 
     ThrowIfFailed(mSwapChain->Present(0, 0));
-    mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+    mCurrBackBuffer = (mCurrBackBuffer + 1) % mSwapChainBufferCount;
 
     mCurrFrameResource->Fence = ++mCurrentFence;
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+    mCbvHeap->FinishFrame(mCurrentFence);
 }
 
 void ShapesApp::OnKeyboardInput(const Timer& gt)
@@ -361,20 +543,109 @@ void ShapesApp::UpdateCamera(const Timer& gt)
     XMStoreFloat4x4(&mView, view);
 }
 
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void ShapesApp::UpdateShaders()
 {
-    for (auto* ri : ritems)
+    if (mReloadedOpaquePso != Gfx::InvalidPipelineId)
     {
-        cmdList->IASetVertexBuffers(0, 1, ri->Geo->VertexBufferView());
+        auto opaqueState{mPipelineCache->State(mReloadedOpaquePso)};
+        auto opaqueWireframeState{mPipelineCache->State(mReloadedOpaqueWireframePso)};
+        if (opaqueState == Gfx::PipelineState::Pending || opaqueWireframeState == Gfx::PipelineState::Pending)
+        {
+            return;
+        }
+
+        if (opaqueState == Gfx::PipelineState::Ready && opaqueWireframeState == Gfx::PipelineState::Ready)
+        {
+            mOpaquePso = mReloadedOpaquePso;
+            mOpaqueWireframePso = mReloadedOpaqueWireframePso;
+        }
+        else
+        {
+            ::OutputDebugStringA("Reloaded shaders do not make a valid pipeline; keeping the previous PSOs.\n");
+        }
+        mReloadedOpaquePso = Gfx::InvalidPipelineId;
+        mReloadedOpaqueWireframePso = Gfx::InvalidPipelineId;
+    }
+
+    auto changed{mShaderWatcher->TakeChanges()};
+    if (!changed.empty())
+    {
+        mShaderPermutations.Reload(changed);
+    }
+
+    // Swapping bytecode frees the old one, so wait until no pipeline is being created from it.
+    if (mPipelineCache->Stats().Pending != 0)
+    {
+        return;
+    }
+
+    bool reloaded{false};
+    for (const auto& reload : mShaderPermutations.ApplyReloads())
+    {
+        if (!reload.Error.empty())
+        {
+            // The permutation keeps its previous bytecode.
+            ::OutputDebugStringA(reload.Error.c_str());
+            continue;
+        }
+        reloaded = true;
+    }
+    if (reloaded)
+    {
+        CreatePSOs(true);
+    }
+}
+
+void ShapesApp::SetOpaquePassState(ID3D12GraphicsCommandList* cmdList)
+{
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
+
+    auto backBufferView{CurrentBackBufferView()};
+    auto depthStencilView{DepthStencilView()};
+    cmdList->OMSetRenderTargets(1, &backBufferView, TRUE, &depthStencilView);
+
+    const std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps{mCbvHeap->Heap()};
+    cmdList->SetDescriptorHeaps(static_cast<UINT>(descriptorHeaps.size()), descriptorHeaps.data());
+
+    cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+
+    cmdList->SetGraphicsRootDescriptorTable(1, mPassCbvTable);
+
+    // All objects of this frame live in one structured buffer; each draw only sets its index.
+    cmdList->SetGraphicsRootShaderResourceView(2, mCurrFrameResource->ObjectCB->Resource()->GetGPUVirtualAddress());
+}
+
+void ShapesApp::RecordOpaqueChunk(UINT chunk, UINT chunkCount, ID3D12PipelineState* pso)
+{
+    PROFILE_ZONE("RecordOpaqueChunk");
+
+    // Command lists do not inherit state, so every chunk sets up the pass before drawing.
+    auto* cmdList{mCurrFrameResource->RecordLists->Begin(chunk, pso)};
+    SetOpaquePassState(cmdList);
+
+    size_t itemCount{mOpaqueRitems.size()};
+    auto* items{mOpaqueRitems.data()};
+    DrawRenderItems(cmdList, items + itemCount * chunk / chunkCount, items + itemCount * (chunk + 1) / chunkCount);
+
+    ThrowIfFailed(cmdList->Close());
+}
+
+void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, RenderItem* const* first, RenderItem* const* last)
+{
+    PROFILE_ZONE("DrawRenderItems");
+
+    for (auto* const* it{first}; it != last; ++it)
+    {
+        auto* ri{*it};
+
+        // The views were filled in BuildShapeGeometry; recording threads only read them.
+        cmdList->IASetVertexBuffers(0, 1, ri->Geo->VertexBufferViews.data());
         auto ibv{ri->Geo->IndexBufferView()};
         cmdList->IASetIndexBuffer(&ibv);
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-        UINT cbvIndex{mCurrFrameResourceIndex * static_cast<UINT>(mAllRitems.size()) + ri->ObjCBIndex};
-        auto cbvHandle{CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart())};
-        cbvHandle.Offset(static_cast<int>(cbvIndex), mCbvSrvUavDescriptorSize);
-
-        cmdList->SetGraphicsRootDescriptorTable(0, cbvHandle);
+        cmdList->SetGraphicsRoot32BitConstant(0, ri->ObjCBIndex, 0);
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
 }
@@ -419,41 +690,16 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y)
 
 void ShapesApp::BuildConstantBufferViews()
 {
-    UINT objCBByteSize{CalcConstantBufferByteSize(sizeof(ObjectConstants))};
-    UINT objCount{static_cast<UINT>(mOpaqueRitems.size())};
-
-    for (UINT frameIndex{0}; frameIndex < gNumFrameResources; ++frameIndex)
-    {
-        auto* objectCB{mFrameResources[frameIndex]->ObjectCB->Resource()};
-
-        for (UINT i{0}; i < objCount; ++i)
-        {
-            D3D12_GPU_VIRTUAL_ADDRESS cbAddress{objectCB->GetGPUVirtualAddress()};
-            cbAddress += static_cast<unsigned long long>(i) * objCBByteSize;
-
-            UINT heapIndex{frameIndex * objCount + i};
-            auto handle{CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart())};
-            handle.Offset(static_cast<int>(heapIndex), mCbvSrvUavDescriptorSize);
-
-            D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
-            cbvDesc.BufferLocation = cbAddress;
-            cbvDesc.SizeInBytes = objCBByteSize;
-
-            md3dDevice->CreateConstantBufferView(&cbvDesc, handle);
-        }
-    }
-
+    // Per-object data is bound as a root SRV, so only the pass constants need views.
     UINT passCBByteSize{CalcConstantBufferByteSize(sizeof(PassConstants))};
 
-    for (UINT frameIndex{0}; frameIndex < gNumFrameResources; ++frameIndex)
+    for (UINT frameIndex{0}; frameIndex < mFramesInFlight; ++frameIndex)
     {
         auto* passCB{mFrameResources[frameIndex]->PassCB->Resource()};
 
         D3D12_GPU_VIRTUAL_ADDRESS cbAddress{passCB->GetGPUVirtualAddress()};
 
-        auto heapIndex{mPassCbvOffset + frameIndex};
-        auto handle{CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart())};
-        handle.Offset(static_cast<INT>(heapIndex), mCbvSrvUavDescriptorSize);
+        auto handle{mCbvStagingHeap->CpuHandle(mPassCbvOffset + frameIndex)};
 
         D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
         cbvDesc.BufferLocation = cbAddress;
@@ -465,32 +711,30 @@ void ShapesApp::BuildConstantBufferViews()
 
 void ShapesApp::CreateCbvDescriptorHeaps()
 {
-    auto objCount{static_cast<UINT>(mAllRitems.size())};
-    UINT numDesciptor{(objCount + 1) * gNumFrameResources};
-
-    mPassCbvOffset = objCount * gNumFrameResources;
-
-    D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc{};
-    cbvHeapDesc.NumDescriptors = numDesciptor;
-    cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    cbvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&mCbvSrvUavHeap)));
+    // Sized for what may be live at once, not for a fixed scene: objects added later only take
+    // staging slots, and the shader-visible ring is refilled every frame.
+    mCbvStagingHeap
+        = std::make_unique<StagingDescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, StagingCbvCapacity);
+    mCbvHeap
+        = std::make_unique<DynamicDescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, DynamicCbvCapacity);
+
+    mPassCbvOffset = mCbvStagingHeap->Allocate(mFramesInFlight);
 }
 
 void ShapesApp::BuildRootSignature()
 {
-    CD3DX12_DESCRIPTOR_RANGE cbvTable0{};
-    cbvTable0.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
     CD3DX12_DESCRIPTOR_RANGE cbvTable1{};
     cbvTable1.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1);
 
-    std::array<CD3DX12_ROOT_PARAMETER, 2> slotRootParameter{};
+    std::array<CD3DX12_ROOT_PARAMETER, 3> slotRootParameter{};
 
-    slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable0);
+    // Object index into the packed object buffer.
+    slotRootParameter[0].InitAsConstants(1, 0);
     slotRootParameter[1].InitAsDescriptorTable(1, &cbvTable1);
+    // Packed per-object data of the current frame resource.
+    slotRootParameter[2].InitAsShaderResourceView(0);
 
-    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2,
+    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(static_cast<UINT>(slotRootParameter.size()),
                                             slotRootParameter.data(),
                                             0,
                                             nullptr,
@@ -512,12 +756,16 @@ void ShapesApp::BuildRootSignature()
                                                   serializedRootSig->GetBufferPointer(),
                                                   serializedRootSig->GetBufferSize(),
                                                   IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+    mRootSignatureHash = Gfx::HashBytes(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 }
 
 void ShapesApp::BuildShadersAndInputLayout()
 {
-    mShaders["standardVS"] = CompileShader(L"Shaders\\Chapter_7.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["opaquePS"] = CompileShader(L"Shaders\\Chapter_7.hlsl", nullptr, "PS", "ps_5_1");
+    const auto shaderFile{mShaderDirectory + L"\\Chapter_7.hlsl"};
+    mStandardVS = mShaderPermutations.Declare({shaderFile, "VS", "vs_5_1", ShaderCompileFlags(), {}});
+    mOpaquePS = mShaderPermutations.Declare({shaderFile, "PS", "ps_5_1", ShaderCompileFlags(), {}});
+    mShaderPermutations.CompileAll();
+    mShaderWatcher = std::make_unique<Files::FileWatcher>(std::vector<std::wstring>{mShaderDirectory});
 
     mInputLayout = {
         {"POSITION", 0,    DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -624,17 +872,25 @@ void ShapesApp::BuildShapeGeometry()
     ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
     CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-    geo->VertexBufferGPU[0]
-        = CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader[0]);
-
-    geo->IndexBufferGPU
-        = CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+    // Both live in one buffer shared with other small buffers, rather than in two committed
+    // resources that would each take at least 64 KiB.
+    auto vb{mHeapAllocator->AllocateBuffer(D3D12_HEAP_TYPE_DEFAULT, vbByteSize)};
+    auto ib{mHeapAllocator->AllocateBuffer(D3D12_HEAP_TYPE_DEFAULT, ibByteSize)};
+    mCopyQueue->Uploads().Upload(Gfx::ToHandle(vb.Resource), vb.Offset, vertices.data(), vbByteSize);
+    mCopyQueue->Uploads().Upload(Gfx::ToHandle(ib.Resource), ib.Offset, indices.data(), ibByteSize);
+    geo->VertexBufferGPU[0] = vb.Resource;
+    geo->VertexBufferOffset[0] = vb.Offset;
+    geo->IndexBufferGPU = ib.Resource;
+    geo->IndexBufferOffset = ib.Offset;
 
     geo->VertexByteStride[0] = sizeof(Vertex);
     geo->VertexBufferByteSize[0] = vbByteSize;
     geo->IndexFormat = DXGI_FORMAT_R16_UINT;
     geo->IndexBufferByteSize = ibByteSize;
 
+    // Fill the cached vertex buffer views once, before any recording thread reads them.
+    static_cast<void>(geo->VertexBufferView());
+
     geo->DrawArgs["box"] = boxSubmesh;
     geo->DrawArgs["grid"] = gridSubmesh;
     geo->DrawArgs["sphere"] = sphereSubmesh;
@@ -644,6 +900,15 @@ void ShapesApp::BuildShapeGeometry()
 }
 
 void ShapesApp::BuildPSOs()
+{
+    mPipelineLibrary
+        = std::make_unique<Gfx::D3D12PipelineLibrary>(md3dDevice, Gfx::ReadPipelineLibraryFile(mPipelineLibraryFile));
+    mPipelineCache = std::make_unique<Gfx::PipelineCache>(*mPipelineLibrary, &mJobSystem);
+
+    CreatePSOs(false);
+}
+
+void ShapesApp::CreatePSOs(bool reload)
 {
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc{};
 
@@ -653,10 +918,10 @@ void ShapesApp::BuildPSOs()
     ZeroMemory(&opaquePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
     opaquePsoDesc.InputLayout = {mInputLayout.data(), (UINT)mInputLayout.size()};
     opaquePsoDesc.pRootSignature = mRootSignature.Get();
-    opaquePsoDesc.VS
-        = {reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), mShaders["standardVS"]->GetBufferSize()};
-    opaquePsoDesc.PS
-        = {reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()), mShaders["opaquePS"]->GetBufferSize()};
+    auto standardVS{mShaderPermutations.Get(mShaderPermutations.Permutation(mStandardVS, {}))};
+    auto opaquePS{mShaderPermutations.Get(mShaderPermutations.Permutation(mOpaquePS, {}))};
+    opaquePsoDesc.VS = {standardVS.Data, standardVS.ByteSize};
+    opaquePsoDesc.PS = {opaquePS.Data, opaquePS.ByteSize};
     opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     opaquePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
     opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -668,7 +933,6 @@ void ShapesApp::BuildPSOs()
     opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
     opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
     opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
 
     //
     // PSO for opaque wireframe objects.
@@ -676,16 +940,51 @@ void ShapesApp::BuildPSOs()
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaqueWireframePsoDesc = opaquePsoDesc;
     opaqueWireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaqueWireframePsoDesc, IID_PPV_ARGS(&mPSOs["opaque_wireframe"])));
+
+    if (reload)
+    {
+        // The current PSOs stay bound until UpdateShaders sees both of these ready.
+        mReloadedOpaquePso = mPipelineCache->GetOrCreateAsync(Gfx::ToGraphicsPipelineDesc(opaquePsoDesc, mRootSignatureHash));
+        mReloadedOpaqueWireframePso
+            = mPipelineCache->GetOrCreateAsync(Gfx::ToGraphicsPipelineDesc(opaqueWireframePsoDesc, mRootSignatureHash));
+        return;
+    }
+
+    mOpaquePso = mPipelineCache->GetOrCreate(Gfx::ToGraphicsPipelineDesc(opaquePsoDesc, mRootSignatureHash));
+    // Created in the background; until it is ready, wireframe mode draws with the opaque PSO.
+    mOpaqueWireframePso = mPipelineCache->GetOrCreateAsync(
+        Gfx::ToGraphicsPipelineDesc(opaqueWireframePsoDesc, mRootSignatureHash), mOpaquePso);
 }
 
 void ShapesApp::BuildFrameResources()
 {
-    for (size_t i{0}; i < gNumFrameResources; ++i)
+    for (size_t i{0}; i < mFramesInFlight; ++i)
     {
-        mFrameResources.emplace_back(
-            std::make_unique<FrameResource>(md3dDevice.Get(), 1, static_cast<UINT>(mAllRitems.size())));
+        // One list per recording thread plus one for the final present transition.
+        mFrameResources.emplace_back(std::make_unique<FrameResource>(md3dDevice.Get(),
+                                                                     1,
+                                                                     static_cast<UINT>(mAllRitems.size()),
+                                                                     false,
+                                                                     mRecordThreadCount + 1));
+        mFrameResources.back()->SetInFlightGuard(mFence.Get());
     }
+
+    mObjectDataStaging.resize(mAllRitems.size());
+}
+
+void ShapesApp::LogObjectDataFootprint()
+{
+    // Compare the upload-heap memory (and per-frame write bandwidth when every object is dirty)
+    // of the packed object buffer against the 256-byte padded constant buffer layout it replaces.
+    auto objCount{static_cast<UINT64>(mAllRitems.size())};
+    auto perFrame{CalcObjectDataFootprint(objCount, 1, sizeof(XMFLOAT4X4))};
+    auto total{CalcObjectDataFootprint(objCount, mFramesInFlight, sizeof(XMFLOAT4X4))};
+
+    std::wstring text{L"***Object data: " + std::to_wstring(objCount) + L" objects, "
+                      + std::to_wstring(total.ConstantBufferBytes) + L" -> " + std::to_wstring(total.PackedBytes)
+                      + L" upload bytes, " + std::to_wstring(perFrame.ConstantBufferBytes) + L" -> "
+                      + std::to_wstring(perFrame.PackedBytes) + L" bytes written per frame\n"};
+    OutputDebugString(text.c_str());
 }
 
 void ShapesApp::BuildRenderItems()
@@ -3,7 +3,11 @@
 #include "../Shared/PlatformHelpers.h"
 #include "directx/d3dx12.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <stdexcept>
 #include <string>
@@ -81,11 +85,71 @@ void D3DApp::Set4xMsaaState(bool value)
     }
 }
 
+int D3DApp::GetSwapChainBufferCount() const
+{
+    return mSwapChainBufferCount;
+}
+
+void D3DApp::SetSwapChainBufferCount(int count)
+{
+    assert(count >= 2 && count <= MaxSwapChainBufferCount);
+
+    if (mSwapChainBufferCount != count)
+    {
+        mSwapChainBufferCount = count;
+
+        // OnResize flushes and resizes the swap chain to the new count.
+        if (mSwapChain)
+        {
+            OnResize();
+            mFrameLatency.SetSetting(LatencySetting());
+        }
+    }
+}
+
+UINT D3DApp::GetFramesInFlight() const
+{
+    return mFramesInFlight;
+}
+
+void D3DApp::SetFramesInFlight(UINT count)
+{
+    assert(count >= 1 && count <= MaxFramesInFlight);
+
+    if (mFramesInFlight != count)
+    {
+        mFramesInFlight = count;
+
+        if (mSwapChain)
+        {
+            FlushCommandQueue();
+            OnFramesInFlightChanged();
+            mFrameLatency.SetSetting(LatencySetting());
+        }
+    }
+}
+
+const Gfx::FrameTimeStats& D3DApp::FrameTimes() const
+{
+    return mFrameTimes;
+}
+
+bool D3DApp::IsPerfHudVisible() const
+{
+    return mPerfMonitor.IsEnabled();
+}
+
+void D3DApp::SetPerfHudVisible(bool visible)
+{
+    mPerfMonitor.SetEnabled(visible);
+}
+
 WPARAM D3DApp::Run()
 {
     MSG msg{nullptr};
 
     mTimer.Reset();
+    Profiling::SetThreadName("Main");
 
     while (msg.message != WM_QUIT)
     {
@@ -102,9 +166,35 @@ WPARAM D3DApp::Run()
 
             if (!mAppPaused)
             {
+                PROFILE_FRAME();
+                mFrameTimes.Record(mTimer.DeltaTime());
                 CalculateFrameStats();
-                Update(mTimer);
-                Draw(mTimer);
+                auto completedFence{mFence->GetCompletedValue()};
+                mDeferredReleases.ReleaseCompleted(completedFence);
+                mGpuProfiler->Collect(completedFence);
+                mFrameLatency.Update(completedFence);
+
+                // Update samples input; Draw ends with Present and the frame's Signal.
+                auto waitTime{mFenceWaiter.Stats().TotalWaitTime};
+                mFrameLatency.BeginFrame();
+                {
+                    PROFILE_ZONE("Update");
+                    Update(mTimer);
+                }
+                {
+                    PROFILE_ZONE("Draw");
+                    Draw(mTimer);
+                }
+                auto fenceStall{mFenceWaiter.Stats().TotalWaitTime - waitTime};
+                mFrameLatency.AddFenceStall(fenceStall);
+                mFrameLatency.EndFrame(mCurrentFence);
+
+                auto& counters{mPerfMonitor.Counters()};
+                counters.UploadUsedBytes = mCopyQueue->Uploads().RingUsedBytes();
+                counters.UploadCapacityBytes = mCopyQueue->Uploads().RingByteSize();
+                mPerfMonitor.EndFrame(Profiling::PerfFrame{static_cast<float>(mTimer.DeltaTime() * 1000.0),
+                                                           static_cast<float>(mGpuProfiler->Latest().TotalMs),
+                                                           std::chrono::duration<float, std::milli>{fenceStall}.count()});
             }
             else
             {
@@ -130,6 +220,7 @@ bool D3DApp::Initialize()
 
     // Do the initial resize code.
     OnResize();
+    mFrameLatency.SetSetting(LatencySetting());
 
     return true;
 }
@@ -137,7 +228,7 @@ bool D3DApp::Initialize()
 void D3DApp::CreateRtvAndDsvDescriptorHeaps()
 {
     D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc{};
-    rtvHeapDesc.NumDescriptors = SwapChainBufferCount;
+    rtvHeapDesc.NumDescriptors = MaxSwapChainBufferCount;
     rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     rtvHeapDesc.NodeMask = 0;
@@ -160,17 +251,20 @@ void D3DApp::OnResize()
     // Flush before changing any resources.
     FlushCommandQueue();
 
-    ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
-
     // Release the previous resources we will be recreating.
     for (auto& i : mSwapChainBuffer)
     {
         i.Reset();
     }
+    if (mDepthStencilBuffer)
+    {
+        mResourceStates.Unregister(Gfx::ToHandle(mDepthStencilBuffer.Get()));
+    }
     mDepthStencilBuffer.Reset();
+    mHeapAllocator->Free(mDepthStencilAllocation);
 
     // Resize the swap chain.
-    ThrowIfFailed(mSwapChain->ResizeBuffers(SwapChainBufferCount,
+    ThrowIfFailed(mSwapChain->ResizeBuffers(mSwapChainBufferCount,
                                             mClientWidth,
                                             mClientHeight,
                                             mBackBufferFormat,
@@ -179,7 +273,7 @@ void D3DApp::OnResize()
     mCurrBackBuffer = 0;
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
-    for (UINT i = 0; i < SwapChainBufferCount; ++i)
+    for (UINT i = 0; i < static_cast<UINT>(mSwapChainBufferCount); ++i)
     {
         ThrowIfFailed(mSwapChain->GetBuffer(i, IID_PPV_ARGS(&mSwapChainBuffer[i])));
         md3dDevice->CreateRenderTargetView(mSwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
@@ -207,17 +301,18 @@ void D3DApp::OnResize()
     depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
     depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-    CD3DX12_HEAP_PROPERTIES defaultHeapProperty{D3D12_HEAP_TYPE_DEFAULT};
     D3D12_CLEAR_VALUE optClear{};
     optClear.Format = mDepthStencilFormat;
     optClear.DepthStencil.Depth = 1.0F;
     optClear.DepthStencil.Stencil = 0;
-    ThrowIfFailed(md3dDevice->CreateCommittedResource(&defaultHeapProperty,
-                                                      D3D12_HEAP_FLAG_NONE,
-                                                      &depthStencilDesc,
-                                                      D3D12_RESOURCE_STATE_COMMON,
-                                                      &optClear,
-                                                      IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+    mDepthStencilBuffer = mHeapAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT,
+                                                         depthStencilDesc,
+                                                         D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                                         &optClear,
+                                                         mDepthStencilAllocation);
+    // Created directly in the state it is used in, so no transition is needed.  Being placed, its
+    // contents start undefined; it is cleared every frame before it is tested against.
+    mResourceStates.Register(Gfx::ToHandle(mDepthStencilBuffer.Get()), Gfx::States::DepthWrite, 1, false);
 
     // Create descriptor to mip level 0 of entire resource using the format of the resource.
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
@@ -227,20 +322,6 @@ void D3DApp::OnResize()
     dsvDesc.Texture2D.MipSlice = 0;
     md3dDevice->CreateDepthStencilView(mDepthStencilBuffer.Get(), &dsvDesc, DepthStencilView());
 
-    CD3DX12_RESOURCE_BARRIER barrierPreRtv{CD3DX12_RESOURCE_BARRIER::Transition(mDepthStencilBuffer.Get(),
-                                                                                D3D12_RESOURCE_STATE_COMMON,
-                                                                                D3D12_RESOURCE_STATE_DEPTH_WRITE)};
-    // Transition the resource from its initial state to be used as a depth buffer.
-    mCommandList->ResourceBarrier(1, &barrierPreRtv);
-
-    // Execute the resize commands.
-    ThrowIfFailed(mCommandList->Close());
-    std::array<ID3D12CommandList*, 1> cmdsLists{mCommandList.Get()};
-    mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdsLists.size()), cmdsLists.data());
-
-    // Wait until resize is complete.
-    FlushCommandQueue();
-
     // Update the viewport transform to cover the client area.
     mScreenViewport.TopLeftX = 0;
     mScreenViewport.TopLeftY = 0;
@@ -383,6 +464,29 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         {
             Set4xMsaaState(!m4xMsaaState);
         }
+        else if ((int)wParam == VK_F3 && CanChangeFramesInFlight())
+        {
+            SetFramesInFlight(mFramesInFlight % MaxFramesInFlight + 1);
+        }
+        else if ((int)wParam == VK_F4)
+        {
+            SetSwapChainBufferCount(mSwapChainBufferCount == MaxSwapChainBufferCount ? 2 : mSwapChainBufferCount + 1);
+        }
+        else if ((int)wParam == VK_F5)
+        {
+            if (Profiling::IsCapturing())
+            {
+                Profiling::StopCapture();
+            }
+            else
+            {
+                Profiling::StartCapture(mTraceFilename);
+            }
+        }
+        else if ((int)wParam == VK_F6)
+        {
+            SetPerfHudVisible(!IsPerfHudVisible());
+        }
         return 0;
     }
 
@@ -467,6 +571,10 @@ bool D3DApp::InitDirect3D()
 
     ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
 
+    mGfxDevice = std::make_unique<Gfx::D3D12Device>(md3dDevice);
+    mGfxFence = std::make_unique<Gfx::D3D12Fence>(mFence);
+    mHeapAllocator = std::make_unique<Gfx::D3D12HeapAllocator>(md3dDevice, &mResourceStates);
+
     mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
     mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -517,6 +625,22 @@ void D3DApp::CreateCommandObjects()
     // to the command list we will Reset it, and it needs to be closed before
     // calling Reset.
     mCommandList->Close();
+
+    mGfxCommandQueue = std::make_unique<Gfx::D3D12CommandQueue>(mCommandQueue);
+    mGfxCommandList = std::make_unique<Gfx::D3D12CommandList>(mCommandList);
+
+    ThrowIfFailed(
+        md3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(mFixupCmdListAlloc.GetAddressOf())));
+    ThrowIfFailed(md3dDevice->CreateCommandList(0,
+                                                D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                mFixupCmdListAlloc.Get(),
+                                                nullptr,
+                                                IID_PPV_ARGS(mFixupCmdList.GetAddressOf())));
+    mFixupCmdList->Close();
+    mGfxFixupCmdList = std::make_unique<Gfx::D3D12CommandList>(mFixupCmdList);
+
+    mCopyQueue = std::make_unique<Gfx::CopyQueue>(*mGfxDevice, mResourceStates, CopyRingByteSize);
+    mGpuProfiler = std::make_unique<Gfx::GpuProfiler>(*mGfxDevice, *mGfxCommandQueue, MaxFramesInFlight + 1);
 }
 
 void D3DApp::CreateSwapChain()
@@ -535,7 +659,7 @@ void D3DApp::CreateSwapChain()
     sd.SampleDesc.Count = m4xMsaaState ? 4 : 1;
     sd.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
     sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    sd.BufferCount = SwapChainBufferCount;
+    sd.BufferCount = mSwapChainBufferCount;
     sd.OutputWindow = mhMainWnd;
     sd.Windowed = TRUE;
     sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
@@ -547,6 +671,8 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
+    PROFILE_ZONE("FlushCommandQueue");
+
     // Advance the fence value to mark commands up to this fence point.
     ++mCurrentFence;
 
@@ -555,22 +681,57 @@ void D3DApp::FlushCommandQueue()
     // processing all the commands prior to this Signal().
     ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
 
-    // Wait until the GPU has completed commands up to this fence point.
-    if (mFence->GetCompletedValue() < mCurrentFence)
+    // Wait until the GPU has completed commands up to this fence point, and the copy queue has
+    // finished every upload submitted to it.
+    std::array<Gfx::FenceWaitTarget, 2> targets{Gfx::FenceWaitTarget{mGfxFence.get(), mCurrentFence}};
+    std::uint32_t targetCount{1};
+    if (mCopyQueue)
+    {
+        targets[targetCount++] = Gfx::FenceWaitTarget{&mCopyQueue->Uploads().Fence(), mCopyQueue->Submit().FenceValue};
+    }
+    mFenceWaiter.WaitAll(targets.data(), targetCount);
+
+    mDeferredReleases.ReleaseCompleted(mCurrentFence);
+    if (mGpuProfiler)
+    {
+        mGpuProfiler->Collect(mCurrentFence);
+    }
+}
+
+void D3DApp::DeferRelease(ComPtr<ID3D12Resource>& resource)
+{
+    D3DUtils::DeferRelease(mDeferredReleases, resource, mCurrentFence + 1);
+}
+
+void D3DApp::ExecuteTracked(ID3D12GraphicsCommandList* cmdList, const Gfx::ResourceStateTracker& tracker)
+{
+    mFixupBarriers.clear();
+    mResourceStates.Submit(tracker, mFixupBarriers);
+
+    std::array<ID3D12CommandList*, 2> cmdLists{};
+    UINT cmdListCount{0};
+    if (!mFixupBarriers.empty())
     {
-        HANDLE eventHandle{CreateEventEx(nullptr, nullptr, FALSE, EVENT_ALL_ACCESS)};
-        if (eventHandle == nullptr)
+        // The fixup allocator is reused; fixups are rare enough to just wait for the last one.
+        if (mFence->GetCompletedValue() < mFixupFence)
         {
-            std::string message{"Failed to create event: " + std::to_string(GetLastError())};
-            throw std::runtime_error{message};
+            FlushCommandQueue();
         }
 
-        // Fire event when GPU hits current fence.
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
+        ThrowIfFailed(mFixupCmdListAlloc->Reset());
+        ThrowIfFailed(mFixupCmdList->Reset(mFixupCmdListAlloc.Get(), nullptr));
+        mGfxFixupCmdList->ResourceBarrier(static_cast<UINT>(mFixupBarriers.size()), mFixupBarriers.data());
+        ThrowIfFailed(mFixupCmdList->Close());
+        cmdLists[cmdListCount++] = mFixupCmdList.Get();
+    }
+
+    cmdLists[cmdListCount++] = cmdList;
+    mCommandQueue->ExecuteCommandLists(cmdListCount, cmdLists.data());
 
-        // Wait until the GPU hits current fence event is fired.
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+    if (!mFixupBarriers.empty())
+    {
+        mFixupFence = ++mCurrentFence;
+        ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mFixupFence));
     }
 }
 
@@ -591,34 +752,65 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView() const
 
 void D3DApp::CalculateFrameStats()
 {
-    // Code computes the average frames per second, and also the
-    // average time it takes to render one frame.  These stats
-    // are appended to the window caption bar.
-
-    static int frameCnt{0};
-    static float timeElapsed{0.0F};
+    // Code computes the frames per second and the distribution of
+    // the time it takes to render one frame over the last second.
+    // These stats are appended to the window caption bar.
 
-    ++frameCnt;
-
-    // Compute averages over one second period.
-    if ((mTimer.TotalTime() - timeElapsed) >= 1.0F)
+    if ((mTimer.TotalTime() - mCaptionTime) >= 1.0F)
     {
-        float fps{static_cast<float>(frameCnt)}; // fps = frameCnt / 1
-        float mspf{1000.0F / fps};
+        auto frameCount{mFrameTimes.FrameCount()};
+        auto frames{static_cast<std::uint32_t>(std::min<std::uint64_t>(frameCount - mCaptionFrameCount, UINT32_MAX))};
+        auto summary{mFrameTimes.Summarize(frames)};
+        mCaptionFrameCount = frameCount;
+
+        float fps{static_cast<float>(frames)}; // fps = frames / 1
 
         std::wstring fpsStr{std::to_wstring(fps)};
-        std::wstring mspfStr{std::to_wstring(mspf)};
+        std::wstring mspfStr{std::to_wstring(summary.MeanMs)};
+
+        // Time the CPU spent blocked on the GPU: close to mspf when GPU-bound, near 0 when CPU-bound.
+        auto waitTime{mFenceWaiter.Stats().TotalWaitTime - mCaptionWaitTime};
+        mCaptionWaitTime = mFenceWaiter.Stats().TotalWaitTime;
+        std::wstring waitStr{std::to_wstring(std::chrono::duration<float, std::milli>{waitTime}.count() / fps)};
 
-        std::wstring windowText{mMainWndCaption + L"    fps: " + fpsStr + L"   mspf: " + mspfStr};
+        std::wstring windowText{mMainWndCaption + L"    fps: " + fpsStr + L"   mspf: " + mspfStr + L"   p50/p99/max: "
+                                + std::to_wstring(summary.P50Ms) + L"/" + std::to_wstring(summary.P99Ms) + L"/"
+                                + std::to_wstring(summary.MaxMs) + L"   wait: " + waitStr};
+
+        // Average over everything run with the current setting.
+        const auto& latency{mFrameLatency.Stats()};
+        if (latency.GpuDoneCount > 0)
+        {
+            auto latencyMs{std::chrono::duration<float, std::milli>{latency.InputToGpuDone}.count()
+                           / static_cast<float>(latency.GpuDoneCount)};
+            windowText += L"   frames: " + std::to_wstring(mFramesInFlight) + L"/" + std::to_wstring(mSwapChainBufferCount)
+                          + L"   latency: " + std::to_wstring(latencyMs);
+        }
+        if (mDeferredReleases.Stats().QueuedCount > 0)
+        {
+            windowText += L"   pending release: " + std::to_wstring(mDeferredReleases.Stats().QueuedBytes / 1024) + L" KiB";
+        }
+        if (Profiling::IsCapturing())
+        {
+            windowText += L"   capturing: " + std::to_wstring(Profiling::Stats().WrittenCount) + L" zones";
+        }
+        if (!mGpuProfiler->Latest().Scopes.empty())
+        {
+            windowText += L"   gpu: " + std::to_wstring(mGpuProfiler->Latest().TotalMs);
+        }
 
         SetWindowText(mhMainWnd, windowText.c_str());
 
         // Reset for next average.
-        frameCnt = 0;
-        timeElapsed += 1.0F;
+        mCaptionTime += 1.0F;
     }
 }
 
+Gfx::FrameLatencySetting D3DApp::LatencySetting() const
+{
+    return Gfx::FrameLatencySetting{mFramesInFlight, static_cast<std::uint32_t>(mSwapChainBufferCount)};
+}
+
 void D3DApp::LogAdapters()
 {
     UINT i{0};
@@ -6,13 +6,29 @@
 #include <crtdbg.h>
 #endif
 
+#include "../Shared/CopyQueue.h"
+#include "../Shared/DeferredRelease.h"
+#include "../Shared/FenceWaiter.h"
+#include "../Shared/FrameLatency.h"
+#include "../Shared/FrameTimeStats.h"
+#include "../Shared/GfxD3D12.h"
+#include "../Shared/GpuProfiler.h"
+#include "../Shared/HeapAllocator.h"
+#include "../Shared/JobSystem.h"
+#include "../Shared/PerfMonitor.h"
+#include "../Shared/Profiler.h"
+#include "../Shared/ResourceStateTracker.h"
 #include "../Shared/Timer.h"
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <d3d12.h>
 #include <debugapi.h>
 #include <dxgi1_4.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include <wrl.h>
 
 // Link necessary d3d12 libraries.
@@ -39,6 +55,21 @@ public:
     [[nodiscard]] bool Get4xMsaaState() const;
     void Set4xMsaaState(bool value);
 
+    // Both can change while running; call them before Initialize or once it has returned.  More
+    // frames in flight and back buffers buy throughput, fewer cut latency.
+    [[nodiscard]] int GetSwapChainBufferCount() const;
+    void SetSwapChainBufferCount(int count);
+    [[nodiscard]] UINT GetFramesInFlight() const;
+    void SetFramesInFlight(UINT count);
+
+    // Durations of the latest frames; safe to summarize from any thread.
+    [[nodiscard]] const Gfx::FrameTimeStats& FrameTimes() const;
+
+    // F6 toggles it.  The frame loop fills mPerfMonitor either way, but CPU zones are timed only
+    // while the HUD is visible.  Apps linking ImGui draw it with Profiling::DrawPerfHud.
+    [[nodiscard]] bool IsPerfHudVisible() const;
+    void SetPerfHudVisible(bool visible);
+
     WPARAM Run();
 
     virtual bool Initialize();
@@ -47,6 +78,17 @@ public:
 protected:
     virtual void CreateRtvAndDsvDescriptorHeaps();
     virtual void OnResize();
+    // The queue has been flushed and mFramesInFlight holds the new count; apps with frame
+    // resources rebuild them here.
+    virtual void OnFramesInFlightChanged()
+    {
+    }
+    // Apps that rebuild their frame resources in OnFramesInFlightChanged return true; F3 does
+    // nothing in the others.
+    [[nodiscard]] virtual bool CanChangeFramesInFlight() const
+    {
+        return false;
+    }
     virtual void Update(const Timer& gt) = 0;
     virtual void Draw(const Timer& gt) = 0;
 
@@ -71,11 +113,20 @@ protected:
 
     void FlushCommandQueue();
 
+    // Releases resource once the GPU is done with the work submitted so far and the work recorded
+    // for the next Signal of mCurrentFence, and resets it.
+    void DeferRelease(Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+    // Executes a closed list recorded with tracker, preceded by the transitions that bring the
+    // resources it uses from their committed states into the states it expects.
+    void ExecuteTracked(ID3D12GraphicsCommandList* cmdList, const Gfx::ResourceStateTracker& tracker);
+
     [[nodiscard]] ID3D12Resource* CurrentBackBuffer() const;
     [[nodiscard]] D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
     [[nodiscard]] D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
 
     void CalculateFrameStats();
+    [[nodiscard]] Gfx::FrameLatencySetting LatencySetting() const;
 
     void LogAdapters();
     void LogAdapterOutputs(const Microsoft::WRL::ComPtr<IDXGIAdapter>& adapter);
@@ -98,6 +149,19 @@ protected:
 
     // Used to keep track of the "delta-time" and game time.
     Timer mTimer{};
+    // Every unpaused frame's delta-time, for the percentiles shown in the caption.
+    Gfx::FrameTimeStats mFrameTimes{};
+    // Game time, frame count and fence wait time when the caption was last updated.
+    float mCaptionTime{0.0F};
+    std::uint64_t mCaptionFrameCount{0};
+    std::chrono::nanoseconds mCaptionWaitTime{0};
+    // Data for the performance HUD.  Draw adds its draw calls, triangles, items and descriptors to
+    // Counters(); the frame loop adds the rest and ends the frame after Draw.
+    Profiling::PerfMonitor mPerfMonitor{};
+
+    // Worker pool for fanning Update/Draw work out across cores.  It is created on the thread that
+    // runs the app loop, which owns a queue of its own and helps run jobs while it waits.
+    Jobs::JobSystem mJobSystem{};
 
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory{};
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain{};
@@ -105,15 +169,61 @@ protected:
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence{};
     UINT64 mCurrentFence = 0;
+    // CPU waits on mFence and the copy queue's fence, on pooled events.  Its stats tell how much
+    // of each frame the CPU spends waiting for the GPU.
+    Gfx::FenceWaiter mFenceWaiter{};
+    // Input-to-present and input-to-GPU-done latency and fence stalls, per frames-in-flight and
+    // back buffer setting.
+    Gfx::FrameLatencyTracker mFrameLatency{};
 
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue{};
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc{};
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList{};
 
-    static const int SwapChainBufferCount{2};
+    // Backend-neutral views of the objects above, for subsystems written against the Gfx interfaces
+    // so they can also run on the null backend.
+    std::unique_ptr<Gfx::D3D12Device> mGfxDevice{};
+    std::unique_ptr<Gfx::D3D12Fence> mGfxFence{};
+    std::unique_ptr<Gfx::D3D12CommandQueue> mGfxCommandQueue{};
+    std::unique_ptr<Gfx::D3D12CommandList> mGfxCommandList{};
+
+    // Committed states of tracked resources, and the tracker for mCommandList.  Entry-state fixups
+    // go on their own small list, which is rarely needed.
+    Gfx::ResourceStateRegistry mResourceStates{};
+    Gfx::ResourceStateTracker mCommandListStates{mResourceStates};
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mFixupCmdListAlloc{};
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mFixupCmdList{};
+    std::unique_ptr<Gfx::D3D12CommandList> mGfxFixupCmdList{};
+    std::vector<Gfx::Barrier> mFixupBarriers{};
+    UINT64 mFixupFence{0};
+
+    // Uploads run on a COPY queue of their own, on their own fence timeline.  Frames wait for the
+    // batches they use on the GPU through mCopyQueue->InsertWait, so uploads overlap rendering.
+    static constexpr std::uint64_t CopyRingByteSize{4 * 1024 * 1024};
+    std::unique_ptr<Gfx::CopyQueue> mCopyQueue{};
+
+    // GPU time of the scopes apps mark on mCommandQueue's lists.  A slot more than the most frames
+    // that can be in flight, so every frame is timed; collected every frame.
+    std::unique_ptr<Gfx::GpuProfiler> mGpuProfiler{};
+
+    // Placed resources and suballocated buffers, in large heaps instead of one committed
+    // resource each.  Declared before everything placed in it, so it is destroyed after.
+    std::unique_ptr<Gfx::D3D12HeapAllocator> mHeapAllocator{};
+
+    // Resources the GPU may still be using, on mFence's timeline.  Drained every frame and by
+    // FlushCommandQueue, so nothing has to flush just to free memory.
+    Gfx::DeferredReleaseQueue mDeferredReleases{};
+
+    // F3 cycles the frames in flight where the app supports it, F4 the back buffers.  The flip
+    // model needs at least two.
+    static constexpr int MaxSwapChainBufferCount{4};
+    static constexpr UINT MaxFramesInFlight{4};
+    int mSwapChainBufferCount{2};
+    UINT mFramesInFlight{3};
     int mCurrBackBuffer{};
-    std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, SwapChainBufferCount> mSwapChainBuffer{};
+    std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, MaxSwapChainBufferCount> mSwapChainBuffer{};
     Microsoft::WRL::ComPtr<ID3D12Resource> mDepthStencilBuffer{};
+    Gfx::HeapAllocation mDepthStencilAllocation{};
 
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvHeap{};
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mDsvHeap{};
@@ -133,6 +243,8 @@ protected:
     DXGI_FORMAT mDepthStencilFormat{DXGI_FORMAT_D24_UNORM_S8_UINT};
     int mClientWidth{800};
     int mClientHeight{600};
+    // F5 starts a CPU profiler capture into this file and stops it.
+    std::wstring mTraceFilename{L"trace.json"};
 };
 
 #endif // _D3DAPP_
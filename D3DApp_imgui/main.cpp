@@ -1,3 +1,4 @@
+#include "../Shared/PerfHud.h"
 #include "../Shared/PlatformHelpers.h"
 #include "D3DApp.h"
 #include "DirectXTK12/SimpleMath.h"
@@ -115,6 +116,7 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 BoxApp::BoxApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
     mMainWndCaption = L"Box App with imgui";
+    SetPerfHudVisible(true);
 }
 
 BoxApp::~BoxApp() = default;
@@ -134,7 +136,7 @@ bool BoxApp::Initialize()
     ImGui::StyleColorsDark();
     ImGui_ImplWin32_Init(mhMainWnd);
     ImGui_ImplDX12_Init(md3dDevice.Get(),
-                        3,
+                        static_cast<int>(MaxFramesInFlight),
                         DXGI_FORMAT_R8G8B8A8_UNORM,
                         mImguiSrvHeap.Get(),
                         mImguiSrvHeap.Get()->GetCPUDescriptorHandleForHeapStart(),
@@ -152,6 +154,8 @@ bool BoxApp::Initialize()
     ThrowIfFailed(mCommandList->Close());
     const std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+    // The copies out of the uploaders are in the list just submitted, before the next Signal.
+    mBoxGeo->DisposeUploaders(mDeferredReleases, mCurrentFence + 1);
 
     FlushCommandQueue();
 
@@ -193,6 +197,7 @@ void BoxApp::Draw(const Timer& gt)
     ThrowIfFailed(mDirectCmdListAlloc->Reset());
 
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), mPSO.Get()));
+    mGpuProfiler->BeginFrame();
 
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
@@ -202,9 +207,11 @@ void BoxApp::Draw(const Timer& gt)
                                                       D3D12_RESOURCE_STATE_RENDER_TARGET)};
     mCommandList->ResourceBarrier(1, &barrier);
 
+    auto clearScope{mGpuProfiler->BeginScope(*mGfxCommandList, "Clear")};
     mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
     mCommandList
         ->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0F, 0, 0, nullptr);
+    mGpuProfiler->EndScope(*mGfxCommandList, clearScope);
 
     auto currBackBuffer = CurrentBackBufferView();
     auto currDepthStencil = DepthStencilView();
@@ -220,7 +227,9 @@ void BoxApp::Draw(const Timer& gt)
     mCommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     mCommandList->SetGraphicsRootDescriptorTable(0, mCbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart());
+    auto boxScope{mGpuProfiler->BeginScope(*mGfxCommandList, "Box")};
     mCommandList->DrawIndexedInstanced(mBoxGeo->DrawArgs["box"].IndexCount, 1, 0, 0, 0);
+    mGpuProfiler->EndScope(*mGfxCommandList, boxScope);
 
     barrier = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
                                                    D3D12_RESOURCE_STATE_RENDER_TARGET,
@@ -267,17 +276,34 @@ void BoxApp::Draw(const Timer& gt)
                     ImGui::GetIO().Framerate);
         ImGui::End();
     }
+    if (IsPerfHudVisible())
+    {
+        bool isOpen{true};
+        Profiling::DrawPerfHud(mPerfMonitor, &mGpuProfiler->Latest(), &isOpen);
+        SetPerfHudVisible(isOpen);
+    }
     mCommandList->SetDescriptorHeaps(1, mImguiSrvHeap.GetAddressOf());
     ImGui::Render();
+
+    auto& counters{mPerfMonitor.Counters()};
+    counters.DrawCalls += 1;
+    counters.Triangles += mBoxGeo->DrawArgs["box"].IndexCount / 3;
+    counters.VisibleItems += 1;
+    counters.TotalItems += 1;
+    Profiling::CountImGuiDrawData(*ImGui::GetDrawData(), counters);
+    auto imguiScope{mGpuProfiler->BeginScope(*mGfxCommandList, "ImGui")};
     ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
+    mGpuProfiler->EndScope(*mGfxCommandList, imguiScope);
 
+    // FlushCommandQueue below signals the next fence value.
+    mGpuProfiler->EndFrame(*mGfxCommandList, mCurrentFence + 1);
     ThrowIfFailed(mCommandList->Close());
 
     std::array<ID3D12CommandList*, 1> cmdLists{mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
 
     ThrowIfFailed(mSwapChain->Present(0, 0));
-    mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+    mCurrBackBuffer = (mCurrBackBuffer + 1) % mSwapChainBufferCount;
 
     FlushCommandQueue();
 }
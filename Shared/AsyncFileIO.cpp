@@ -0,0 +1,863 @@
+#include "AsyncFileIO.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#error "AsyncFileIO has no implementation for this platform."
+#endif
+
+using namespace Files;
+
+namespace
+{
+constexpr std::intptr_t InvalidFile{-1};
+
+// Larger reads are split; both ReadFile and io_uring take 32-bit lengths.
+constexpr std::size_t MaxReadSize{std::size_t{1} << 30};
+} // namespace
+
+struct AsyncFileIO::Operation
+{
+#if defined(_WIN32)
+    OVERLAPPED Overlapped{};
+#elif defined(__linux__)
+    iovec Vector{};
+#endif
+    std::intptr_t File{InvalidFile};
+    std::uint64_t Offset{0};
+    std::uint8_t* Buffer{nullptr};
+    std::size_t ByteSize{0};
+    // Bytes read so far; a read that comes back short is reissued for the rest.
+    std::size_t Done{0};
+    std::function<void(const ReadResult&)> OnComplete{};
+
+    [[nodiscard]] std::size_t NextReadSize() const
+    {
+        return std::min<std::size_t>(ByteSize - Done, MaxReadSize);
+    }
+};
+
+class AsyncFileIO::Backend
+{
+public:
+    explicit Backend(AsyncFileIO& owner) : mOwner{owner}
+    {
+    }
+    Backend(const Backend& rhs) = delete;
+    Backend& operator=(const Backend& rhs) = delete;
+    virtual ~Backend() = default;
+
+    // Takes ownership of the operations; each ends in AsyncFileIO::Finish.
+    virtual void Submit(std::vector<Operation*>& operations) = 0;
+    [[nodiscard]] virtual bool IsNative() const = 0;
+    // Called for every opened file before its first read.
+    virtual void Attach(std::intptr_t file)
+    {
+        static_cast<void>(file);
+    }
+
+protected:
+    AsyncFileIO& mOwner;
+};
+
+namespace
+{
+#if defined(_WIN32)
+
+HANDLE ToHandle(std::intptr_t file)
+{
+    return reinterpret_cast<HANDLE>(file);
+}
+
+std::runtime_error IOError(const std::string& what)
+{
+    return std::runtime_error{what + ": " + std::to_string(GetLastError())};
+}
+
+// Blocking read at offset on a handle opened without FILE_FLAG_OVERLAPPED.
+std::uint32_t ReadAt(std::intptr_t file, void* buffer, std::size_t size, std::uint64_t offset, std::size_t& byteCount)
+{
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD count{0};
+    if (!ReadFile(ToHandle(file), buffer, static_cast<DWORD>(size), &count, &overlapped))
+    {
+        auto error{GetLastError()};
+        if (error != ERROR_HANDLE_EOF)
+        {
+            return error;
+        }
+    }
+    byteCount = count;
+    return 0;
+}
+
+#elif defined(__linux__)
+
+std::runtime_error IOError(const std::string& what)
+{
+    return std::runtime_error{what + ": " + std::strerror(errno)};
+}
+
+std::uint32_t ReadAt(std::intptr_t file, void* buffer, std::size_t size, std::uint64_t offset, std::size_t& byteCount)
+{
+    for (;;)
+    {
+        auto count{pread(static_cast<int>(file), buffer, size, static_cast<off_t>(offset))};
+        if (count >= 0)
+        {
+            byteCount = static_cast<std::size_t>(count);
+            return 0;
+        }
+        if (errno != EINTR)
+        {
+            return static_cast<std::uint32_t>(errno);
+        }
+    }
+}
+
+// glibc has no wrappers for the io_uring calls.
+int SetupRing(unsigned entries, io_uring_params& params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int EnterRing(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+#endif
+} // namespace
+
+// Blocking reads on a pool of threads; each thread has one read in flight.
+class AsyncFileIO::ThreadPoolBackend : public Backend
+{
+public:
+    ThreadPoolBackend(AsyncFileIO& owner, unsigned threadCount) : Backend{owner}
+    {
+        for (unsigned i{0}; i < threadCount; ++i)
+        {
+            mThreads.emplace_back([this] { Run(); });
+        }
+    }
+
+    ~ThreadPoolBackend() override
+    {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mStopping = true;
+        }
+        mWake.notify_all();
+
+        for (auto& thread : mThreads)
+        {
+            thread.join();
+        }
+    }
+
+    void Submit(std::vector<Operation*>& operations) override
+    {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mQueue.insert(mQueue.end(), operations.begin(), operations.end());
+        }
+        mWake.notify_all();
+    }
+
+    [[nodiscard]] bool IsNative() const override
+    {
+        return false;
+    }
+
+private:
+    void Run()
+    {
+        for (;;)
+        {
+            Operation* operation{nullptr};
+            {
+                std::unique_lock<std::mutex> lock{mMutex};
+                mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+                if (mQueue.empty())
+                {
+                    return;
+                }
+                operation = mQueue.front();
+                mQueue.pop_front();
+            }
+
+            std::uint32_t error{0};
+            while (operation->Done < operation->ByteSize)
+            {
+                std::size_t count{0};
+                error = ReadAt(operation->File,
+                               operation->Buffer + operation->Done,
+                               operation->NextReadSize(),
+                               operation->Offset + operation->Done,
+                               count);
+                if (error != 0 || count == 0)
+                {
+                    break;
+                }
+                operation->Done += count;
+            }
+            mOwner.Finish(operation, error);
+        }
+    }
+
+    std::mutex mMutex{};
+    std::condition_variable mWake{};
+    std::deque<Operation*> mQueue{};
+    bool mStopping{false};
+    std::vector<std::thread> mThreads{};
+};
+
+#if defined(_WIN32)
+
+// Overlapped reads completing on an I/O completion port served by one thread.
+class AsyncFileIO::NativeBackend : public Backend
+{
+public:
+    NativeBackend(AsyncFileIO& owner, unsigned queueDepth) : Backend{owner}
+    {
+        // The completion port queues any number of reads.
+        static_cast<void>(queueDepth);
+
+        mPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (mPort == nullptr)
+        {
+            throw IOError("Failed to create I/O completion port");
+        }
+        mCompleter = std::thread{[this] { Run(); }};
+    }
+
+    ~NativeBackend() override
+    {
+        PostQueuedCompletionStatus(mPort, 0, StopKey, nullptr);
+        mCompleter.join();
+        CloseHandle(mPort);
+    }
+
+    void Submit(std::vector<Operation*>& operations) override
+    {
+        for (auto* operation : operations)
+        {
+            Issue(operation);
+        }
+    }
+
+    [[nodiscard]] bool IsNative() const override
+    {
+        return true;
+    }
+
+    void Attach(std::intptr_t file) override
+    {
+        if (CreateIoCompletionPort(ToHandle(file), mPort, 0, 0) == nullptr)
+        {
+            throw IOError("Failed to attach file to I/O completion port");
+        }
+    }
+
+private:
+    static constexpr ULONG_PTR StopKey{1};
+
+    void Issue(Operation* operation)
+    {
+        auto offset{operation->Offset + operation->Done};
+        operation->Overlapped = OVERLAPPED{};
+        operation->Overlapped.Offset = static_cast<DWORD>(offset);
+        operation->Overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        // Reads that complete at once still queue a completion packet; only failures do not.
+        if (!ReadFile(ToHandle(operation->File),
+                      operation->Buffer + operation->Done,
+                      static_cast<DWORD>(operation->NextReadSize()),
+                      nullptr,
+                      &operation->Overlapped))
+        {
+            auto error{GetLastError()};
+            if (error != ERROR_IO_PENDING)
+            {
+                mOwner.Finish(operation, error == ERROR_HANDLE_EOF ? 0 : error);
+            }
+        }
+    }
+
+    void Run()
+    {
+        for (;;)
+        {
+            DWORD byteCount{0};
+            ULONG_PTR key{0};
+            OVERLAPPED* overlapped{nullptr};
+            auto succeeded{GetQueuedCompletionStatus(mPort, &byteCount, &key, &overlapped, INFINITE)};
+            if (overlapped == nullptr)
+            {
+                if (key == StopKey)
+                {
+                    return;
+                }
+                continue;
+            }
+
+            auto* operation{CONTAINING_RECORD(overlapped, Operation, Overlapped)};
+            if (!succeeded)
+            {
+                auto error{GetLastError()};
+                mOwner.Finish(operation, error == ERROR_HANDLE_EOF ? 0 : error);
+                continue;
+            }
+
+            operation->Done += byteCount;
+            if (byteCount == 0 || operation->Done == operation->ByteSize)
+            {
+                mOwner.Finish(operation, 0);
+            }
+            else
+            {
+                Issue(operation);
+            }
+        }
+    }
+
+    HANDLE mPort{nullptr};
+    std::thread mCompleter{};
+};
+
+#elif defined(__linux__)
+
+// io_uring driven through the raw system calls.  Submitting threads fill the submission ring under
+// a lock; one thread waits for completions and reissues short reads.
+class AsyncFileIO::NativeBackend : public Backend
+{
+public:
+    NativeBackend(AsyncFileIO& owner, unsigned queueDepth) : Backend{owner}
+    {
+        io_uring_params params{};
+        mRing = SetupRing(std::max<unsigned>(queueDepth, 1U), params);
+        if (mRing < 0)
+        {
+            throw IOError("io_uring is unavailable");
+        }
+
+        mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        mSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (mSingleMap)
+        {
+            mSqRingSize = mCqRingSize = std::max<std::size_t>(mSqRingSize, mCqRingSize);
+        }
+        mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        auto mapRing{[this](std::size_t size, off_t offset) {
+            return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, offset);
+        }};
+        mSqRing = mapRing(mSqRingSize, IORING_OFF_SQ_RING);
+        mCqRing = mSingleMap ? mSqRing : mapRing(mCqRingSize, IORING_OFF_CQ_RING);
+        auto* sqes{mapRing(mSqesSize, IORING_OFF_SQES)};
+        if (mSqRing == MAP_FAILED || mCqRing == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            auto error{IOError("Failed to map io_uring")};
+            mSqes = sqes != MAP_FAILED ? static_cast<io_uring_sqe*>(sqes) : nullptr;
+            Close();
+            throw error;
+        }
+        mSqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq{static_cast<std::uint8_t*>(mSqRing)};
+        mSqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        mSqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mSqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq{static_cast<std::uint8_t*>(mCqRing)};
+        mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        mCqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // The completion ring holds twice as many entries, so it cannot overflow.
+        mCapacity = params.sq_entries;
+
+        mCompleter = std::thread{[this] { Run(); }};
+    }
+
+    ~NativeBackend() override
+    {
+        {
+            // Nothing is in flight any more; a no-op without an operation stops the completer.
+            std::lock_guard<std::mutex> lock{mMutex};
+            auto tail{*mSqTail};
+            auto index{tail & mSqMask};
+            mSqes[index] = io_uring_sqe{};
+            mSqes[index].opcode = IORING_OP_NOP;
+            mSqes[index].user_data = 0;
+            mSqArray[index] = index;
+            __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+            SubmitQueued(1);
+        }
+        mCompleter.join();
+        Close();
+    }
+
+    void Submit(std::vector<Operation*>& operations) override
+    {
+        std::uint32_t error{0};
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            error = mError;
+            if (error == 0)
+            {
+                mBacklog.insert(mBacklog.end(), operations.begin(), operations.end());
+                Flush();
+            }
+        }
+
+        // The completer has stopped; fail the reads here, outside the lock.
+        if (error != 0)
+        {
+            for (auto* operation : operations)
+            {
+                mOwner.Finish(operation, error);
+            }
+        }
+    }
+
+    [[nodiscard]] bool IsNative() const override
+    {
+        return true;
+    }
+
+private:
+    // Moves operations from the backlog into the submission ring while there is room.  Called with
+    // mMutex held.
+    void Flush()
+    {
+        auto tail{*mSqTail};
+        unsigned added{0};
+        while (!mBacklog.empty() && mInFlight < mCapacity)
+        {
+            auto* operation{mBacklog.front()};
+            mBacklog.pop_front();
+
+            operation->Vector = iovec{operation->Buffer + operation->Done, operation->NextReadSize()};
+
+            // READV rather than READ, which needs a 5.6 kernel.
+            auto index{tail & mSqMask};
+            auto& sqe{mSqes[index]};
+            sqe = io_uring_sqe{};
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = static_cast<int>(operation->File);
+            sqe.addr = reinterpret_cast<std::uint64_t>(&operation->Vector);
+            sqe.len = 1;
+            sqe.off = operation->Offset + operation->Done;
+            sqe.user_data = reinterpret_cast<std::uint64_t>(operation);
+            mSqArray[index] = index;
+
+            ++tail;
+            ++added;
+            ++mInFlight;
+            mSubmitted.insert(operation);
+        }
+
+        if (added > 0)
+        {
+            __atomic_store_n(mSqTail, tail, __ATOMIC_RELEASE);
+            SubmitQueued(added);
+        }
+    }
+
+    void SubmitQueued(unsigned count)
+    {
+        while (count > 0)
+        {
+            auto submitted{EnterRing(mRing, count, 0, 0)};
+            if (submitted < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                // The entries stay in the ring and go out with the next submission.
+                return;
+            }
+            count -= static_cast<unsigned>(submitted);
+        }
+    }
+
+    void Run()
+    {
+        std::vector<std::pair<Operation*, std::uint32_t>> finished{};
+        for (;;)
+        {
+            std::uint32_t error{0};
+            if (EnterRing(mRing, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            {
+                error = static_cast<std::uint32_t>(errno);
+            }
+
+            bool stop{false};
+            {
+                // The lock orders the submitter's writes to the operations before the reads here.
+                std::lock_guard<std::mutex> lock{mMutex};
+                auto completed{Reap(finished, stop)};
+                mInFlight -= completed;
+                if (error != 0)
+                {
+                    // The ring cannot be waited on any more: fail what is left, and every later
+                    // submission, with the error rather than spin on it.
+                    Abandon(error, finished);
+                    stop = true;
+                }
+                else if (completed > 0)
+                {
+                    Flush();
+                }
+            }
+
+            // Outside the lock; callbacks may submit more reads.
+            for (const auto& [operation, error] : finished)
+            {
+                mOwner.Finish(operation, error);
+            }
+            finished.clear();
+
+            if (stop)
+            {
+                return;
+            }
+        }
+    }
+
+    // Takes the completions off the ring.  Short reads go back to the front of the backlog.  Called
+    // with mMutex held; returns how many reads left the ring.
+    unsigned Reap(std::vector<std::pair<Operation*, std::uint32_t>>& finished, bool& stop)
+    {
+        unsigned completed{0};
+        auto head{*mCqHead};
+        auto tail{__atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)};
+        for (; head != tail; ++head)
+        {
+            const auto& cqe{mCqes[head & mCqMask]};
+            auto* operation{reinterpret_cast<Operation*>(cqe.user_data)};
+            if (operation == nullptr)
+            {
+                stop = true;
+                continue;
+            }
+
+            ++completed;
+            mSubmitted.erase(operation);
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+                mBacklog.push_front(operation);
+            }
+            else if (cqe.res < 0)
+            {
+                finished.emplace_back(operation, static_cast<std::uint32_t>(-cqe.res));
+            }
+            else
+            {
+                operation->Done += static_cast<std::size_t>(cqe.res);
+                if (cqe.res == 0 || operation->Done == operation->ByteSize)
+                {
+                    finished.emplace_back(operation, 0);
+                }
+                else
+                {
+                    mBacklog.push_front(operation);
+                }
+            }
+        }
+        __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+        return completed;
+    }
+
+    // Fails every read in the ring or the backlog with error.  Called with mMutex held.
+    void Abandon(std::uint32_t error, std::vector<std::pair<Operation*, std::uint32_t>>& finished)
+    {
+        mError = error;
+        for (auto* operation : mSubmitted)
+        {
+            finished.emplace_back(operation, error);
+        }
+        for (auto* operation : mBacklog)
+        {
+            finished.emplace_back(operation, error);
+        }
+        mSubmitted.clear();
+        mBacklog.clear();
+        mInFlight = 0;
+    }
+
+    void Close()
+    {
+        if (mSqes != nullptr)
+        {
+            munmap(mSqes, mSqesSize);
+        }
+        if (mCqRing != MAP_FAILED && !mSingleMap)
+        {
+            munmap(mCqRing, mCqRingSize);
+        }
+        if (mSqRing != MAP_FAILED)
+        {
+            munmap(mSqRing, mSqRingSize);
+        }
+        close(mRing);
+    }
+
+    int mRing{-1};
+    bool mSingleMap{false};
+    void* mSqRing{MAP_FAILED};
+    void* mCqRing{MAP_FAILED};
+    std::size_t mSqRingSize{0};
+    std::size_t mCqRingSize{0};
+    std::size_t mSqesSize{0};
+
+    unsigned* mSqHead{nullptr};
+    unsigned* mSqTail{nullptr};
+    unsigned mSqMask{0};
+    unsigned* mSqArray{nullptr};
+    io_uring_sqe* mSqes{nullptr};
+
+    unsigned* mCqHead{nullptr};
+    unsigned* mCqTail{nullptr};
+    unsigned mCqMask{0};
+    io_uring_cqe* mCqes{nullptr};
+
+    std::mutex mMutex{};
+    std::deque<Operation*> mBacklog{};
+    // The operations in the ring, failed together if waiting on it fails.
+    std::unordered_set<Operation*> mSubmitted{};
+    unsigned mInFlight{0};
+    unsigned mCapacity{0};
+    // Set once waiting on the ring has failed; later submissions fail with it.
+    std::uint32_t mError{0};
+
+    std::thread mCompleter{};
+};
+
+#endif
+
+AsyncFileIO::AsyncFileIO(IOBackend backend, unsigned threadCount, unsigned queueDepth)
+{
+    if (backend != IOBackend::ThreadPool)
+    {
+        try
+        {
+            mBackend = std::make_unique<NativeBackend>(*this, queueDepth);
+        }
+        catch (const std::runtime_error&)
+        {
+            if (backend == IOBackend::Native)
+            {
+                throw;
+            }
+        }
+    }
+
+    if (mBackend == nullptr)
+    {
+        mBackend = std::make_unique<ThreadPoolBackend>(*this, std::max<unsigned>(threadCount, 1U));
+    }
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+    WaitIdle();
+    mBackend.reset();
+
+    for (FileId file{0}; file < mFiles.size(); ++file)
+    {
+        if (mFiles[file] != InvalidFile)
+        {
+            Close(file);
+        }
+    }
+}
+
+FileId AsyncFileIO::Open(const std::wstring& filename)
+{
+    std::filesystem::path path{filename};
+#if defined(_WIN32)
+    DWORD flags{FILE_ATTRIBUTE_NORMAL};
+    if (mBackend->IsNative())
+    {
+        flags |= FILE_FLAG_OVERLAPPED;
+    }
+    auto handle{CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr)};
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        throw IOError("Cannot open " + path.u8string());
+    }
+    auto file{reinterpret_cast<std::intptr_t>(handle)};
+#elif defined(__linux__)
+    auto descriptor{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (descriptor < 0)
+    {
+        throw IOError("Cannot open " + path.u8string());
+    }
+    auto file{static_cast<std::intptr_t>(descriptor)};
+#endif
+
+    std::lock_guard<std::mutex> lock{mFilesMutex};
+    FileId id{static_cast<FileId>(mFiles.size())};
+    if (!mFreeFiles.empty())
+    {
+        id = mFreeFiles.back();
+        mFreeFiles.pop_back();
+        mFiles[id] = file;
+    }
+    else
+    {
+        mFiles.push_back(file);
+    }
+
+    try
+    {
+        mBackend->Attach(file);
+    }
+    catch (...)
+    {
+        mFiles[id] = InvalidFile;
+        mFreeFiles.push_back(id);
+#if defined(_WIN32)
+        CloseHandle(handle);
+#endif
+        throw;
+    }
+    return id;
+}
+
+std::uint64_t AsyncFileIO::FileSize(FileId file) const
+{
+    std::lock_guard<std::mutex> lock{mFilesMutex};
+    assert(file < mFiles.size() && mFiles[file] != InvalidFile);
+
+#if defined(_WIN32)
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(ToHandle(mFiles[file]), &size))
+    {
+        throw IOError("Cannot query file size");
+    }
+    return static_cast<std::uint64_t>(size.QuadPart);
+#elif defined(__linux__)
+    struct stat status{};
+    if (fstat(static_cast<int>(mFiles[file]), &status) != 0)
+    {
+        throw IOError("Cannot query file size");
+    }
+    return static_cast<std::uint64_t>(status.st_size);
+#endif
+}
+
+void AsyncFileIO::Close(FileId file)
+{
+    std::lock_guard<std::mutex> lock{mFilesMutex};
+    assert(file < mFiles.size() && mFiles[file] != InvalidFile);
+
+#if defined(_WIN32)
+    CloseHandle(ToHandle(mFiles[file]));
+#elif defined(__linux__)
+    close(static_cast<int>(mFiles[file]));
+#endif
+    mFiles[file] = InvalidFile;
+    mFreeFiles.push_back(file);
+}
+
+void AsyncFileIO::Submit(std::vector<ReadRequest> requests)
+{
+    if (requests.empty())
+    {
+        return;
+    }
+
+    std::vector<Operation*> operations{};
+    operations.reserve(requests.size());
+    {
+        std::lock_guard<std::mutex> lock{mFilesMutex};
+        for (auto& request : requests)
+        {
+            assert(request.File < mFiles.size() && mFiles[request.File] != InvalidFile);
+
+            auto operation{std::make_unique<Operation>()};
+            operation->File = mFiles[request.File];
+            operation->Offset = request.Offset;
+            operation->Buffer = static_cast<std::uint8_t*>(request.Buffer);
+            operation->ByteSize = request.ByteSize;
+            operation->OnComplete = std::move(request.OnComplete);
+            operations.push_back(operation.release());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mIdleMutex};
+        mInFlight += operations.size();
+    }
+    mBackend->Submit(operations);
+}
+
+std::future<ReadResult> AsyncFileIO::Read(ReadRequest request)
+{
+    auto promise{std::make_shared<std::promise<ReadResult>>()};
+    auto result{promise->get_future()};
+    request.OnComplete = [promise](const ReadResult& read) { promise->set_value(read); };
+
+    std::vector<ReadRequest> requests{};
+    requests.push_back(std::move(request));
+    Submit(std::move(requests));
+    return result;
+}
+
+void AsyncFileIO::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock{mIdleMutex};
+    mIdle.wait(lock, [this] { return mInFlight == 0; });
+}
+
+bool AsyncFileIO::IsNative() const
+{
+    return mBackend->IsNative();
+}
+
+void AsyncFileIO::Finish(Operation* operation, std::uint32_t error)
+{
+    {
+        std::unique_ptr<Operation> finished{operation};
+        if (finished->OnComplete)
+        {
+            finished->OnComplete(ReadResult{finished->Done, error});
+        }
+    }
+
+    // Only after the callback, so WaitIdle also covers reads it submits.
+    std::lock_guard<std::mutex> lock{mIdleMutex};
+    if (--mInFlight == 0)
+    {
+        mIdle.notify_all();
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef _ASYNCFILEIO_
+#define _ASYNCFILEIO_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Asynchronous positional reads into caller-provided buffers.
+//
+// Reads are submitted in batches and complete in any order on an I/O thread, which calls each
+// request's callback.  The native backends keep many reads in flight from a single completion
+// thread: io_uring on Linux, overlapped reads on a completion port on Windows.  Where io_uring is
+// unavailable (old kernels, or disabled by a seccomp profile) a pool of threads issues blocking
+// reads instead.
+//
+// Open, Close, Submit and WaitIdle may be called from any thread, including from callbacks.
+namespace Files
+{
+using FileId = std::uint32_t;
+
+enum class IOBackend : std::uint32_t
+{
+    // The native backend when the OS provides it, else the thread pool.
+    Auto,
+    ThreadPool,
+    Native,
+};
+
+struct ReadResult
+{
+    // Short of the requested size only at the end of the file.
+    std::size_t ByteCount{0};
+    // 0 on success, else errno or the Windows error code.
+    std::uint32_t Error{0};
+};
+
+struct ReadRequest
+{
+    FileId File{0};
+    std::uint64_t Offset{0};
+    // Must stay valid until the request completes.
+    void* Buffer{nullptr};
+    std::size_t ByteSize{0};
+    // Runs once on an I/O thread; keep it short, it holds up other completions.  Must not throw.
+    std::function<void(const ReadResult&)> OnComplete{};
+};
+
+class AsyncFileIO
+{
+public:
+    // threadCount sizes the thread pool; queueDepth bounds the reads io_uring has in flight.
+    // Throws std::runtime_error when backend is Native and the OS does not provide it.
+    explicit AsyncFileIO(IOBackend backend = IOBackend::Auto, unsigned threadCount = 4, unsigned queueDepth = 64);
+    AsyncFileIO(const AsyncFileIO& rhs) = delete;
+    AsyncFileIO& operator=(const AsyncFileIO& rhs) = delete;
+    // Waits for every submitted read.
+    ~AsyncFileIO();
+
+    // Throws std::runtime_error when the file cannot be opened.
+    FileId Open(const std::wstring& filename);
+    [[nodiscard]] std::uint64_t FileSize(FileId file) const;
+    // The file must have no reads in flight.
+    void Close(FileId file);
+
+    void Submit(std::vector<ReadRequest> requests);
+    // A single read completed through a future; request.OnComplete is replaced.
+    [[nodiscard]] std::future<ReadResult> Read(ReadRequest request);
+    // Blocks until every read submitted so far, and every callback, has finished.
+    void WaitIdle();
+
+    [[nodiscard]] bool IsNative() const;
+
+private:
+    struct Operation;
+    class Backend;
+    class ThreadPoolBackend;
+    class NativeBackend;
+
+    void Finish(Operation* operation, std::uint32_t error);
+
+    std::unique_ptr<Backend> mBackend{};
+
+    mutable std::mutex mFilesMutex{};
+    // Native handles or descriptors, indexed by FileId; closed slots are reused.
+    std::vector<std::intptr_t> mFiles{};
+    std::vector<FileId> mFreeFiles{};
+
+    std::mutex mIdleMutex{};
+    std::condition_variable mIdle{};
+    std::uint64_t mInFlight{0};
+};
+} // namespace Files
+
+#endif // _ASYNCFILEIO_
@@ -0,0 +1,225 @@
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr bool IsPowerOfTwo(std::uint64_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+std::uint32_t Log2(std::uint64_t value)
+{
+    std::uint32_t log{0};
+    while (value > 1)
+    {
+        value >>= 1;
+        ++log;
+    }
+    return log;
+}
+} // namespace
+
+BuddyAllocator::BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize) :
+    mCapacity{capacity},
+    mMinBlockSize{minBlockSize}
+{
+    assert(IsPowerOfTwo(capacity) && IsPowerOfTwo(minBlockSize) && capacity >= minBlockSize);
+
+    mMaxOrder = Log2(capacity / minBlockSize);
+    mFreeBlocks.resize(mMaxOrder + 1);
+    mFreeBlocks[mMaxOrder].insert(0);
+}
+
+std::uint64_t BuddyAllocator::Allocate(std::uint64_t byteSize, std::uint64_t alignment)
+{
+    assert(byteSize > 0 && (alignment == 0 || IsPowerOfTwo(alignment)));
+
+    auto order{OrderFor(byteSize, alignment)};
+    if (order > mMaxOrder)
+    {
+        return InvalidHeapOffset;
+    }
+    return Take(order, byteSize);
+}
+
+void BuddyAllocator::Free(std::uint64_t offset)
+{
+    auto allocation{mAllocations.find(offset)};
+    assert(allocation != mAllocations.end() && "Freeing an offset that is not allocated.");
+
+    auto order{allocation->second.Order};
+    --mStats.AllocationCount;
+    mStats.UsedBytes -= OrderSize(order);
+    mStats.RequestedBytes -= allocation->second.RequestedBytes;
+    mAllocations.erase(allocation);
+
+    // Merge with the buddy for as long as it is free too.
+    while (order < mMaxOrder)
+    {
+        auto buddy{offset ^ OrderSize(order)};
+        auto& free{mFreeBlocks[order]};
+        auto found{free.find(buddy)};
+        if (found == free.end())
+        {
+            break;
+        }
+
+        free.erase(found);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    mFreeBlocks[order].insert(offset);
+}
+
+std::vector<HeapMove> BuddyAllocator::PlanMoves(std::uint32_t maxMoves)
+{
+    std::vector<HeapMove> moves{};
+    std::set<std::uint64_t> destinations{};
+
+    for (auto allocation{mAllocations.rbegin()}; allocation != mAllocations.rend() && moves.size() < maxMoves;
+         ++allocation)
+    {
+        auto [offset, info]{*allocation};
+        if (destinations.count(offset) > 0)
+        {
+            continue;
+        }
+
+        // The lowest free block below the allocation that it fits in.  Its own buddy is no use:
+        // moving there leaves the parent block just as used.
+        auto buddy{offset ^ OrderSize(info.Order)};
+        auto bestOrder{mMaxOrder + 1};
+        auto bestOffset{offset};
+        for (auto order{info.Order}; order <= mMaxOrder; ++order)
+        {
+            for (auto candidate : mFreeBlocks[order])
+            {
+                if (candidate >= bestOffset)
+                {
+                    break;
+                }
+                if (order == info.Order && candidate == buddy)
+                {
+                    continue;
+                }
+                bestOrder = order;
+                bestOffset = candidate;
+                break;
+            }
+        }
+        if (bestOrder > mMaxOrder)
+        {
+            continue;
+        }
+
+        mFreeBlocks[bestOrder].erase(bestOffset);
+        auto to{Split(bestOffset, bestOrder, info.Order)};
+        mAllocations[to] = Allocation{info.Order, info.RequestedBytes};
+        ++mStats.AllocationCount;
+        mStats.UsedBytes += OrderSize(info.Order);
+        mStats.RequestedBytes += info.RequestedBytes;
+
+        destinations.insert(to);
+        moves.push_back(HeapMove{offset, to, info.RequestedBytes});
+    }
+    return moves;
+}
+
+std::uint64_t BuddyAllocator::Capacity() const
+{
+    return mCapacity;
+}
+
+std::uint64_t BuddyAllocator::MinBlockSize() const
+{
+    return mMinBlockSize;
+}
+
+std::uint64_t BuddyAllocator::BlockSize(std::uint64_t offset) const
+{
+    auto allocation{mAllocations.find(offset)};
+    assert(allocation != mAllocations.end());
+    return OrderSize(allocation->second.Order);
+}
+
+std::uint64_t BuddyAllocator::LargestFreeBlock() const
+{
+    for (auto order{mMaxOrder + 1}; order-- > 0;)
+    {
+        if (!mFreeBlocks[order].empty())
+        {
+            return OrderSize(order);
+        }
+    }
+    return 0;
+}
+
+bool BuddyAllocator::IsEmpty() const
+{
+    return mAllocations.empty();
+}
+
+const BuddyAllocatorStats& BuddyAllocator::Stats() const
+{
+    return mStats;
+}
+
+std::uint32_t BuddyAllocator::OrderFor(std::uint64_t byteSize, std::uint64_t alignment) const
+{
+    auto size{std::max({byteSize, alignment, mMinBlockSize})};
+    if (size > mCapacity)
+    {
+        return mMaxOrder + 1;
+    }
+
+    std::uint32_t order{0};
+    while (OrderSize(order) < size)
+    {
+        ++order;
+    }
+    return order;
+}
+
+std::uint64_t BuddyAllocator::OrderSize(std::uint32_t order) const
+{
+    return mMinBlockSize << order;
+}
+
+std::uint64_t BuddyAllocator::Split(std::uint64_t offset, std::uint32_t from, std::uint32_t order)
+{
+    // Keep the lower half, free the upper one, until the block has the requested size.
+    while (from > order)
+    {
+        --from;
+        mFreeBlocks[from].insert(offset + OrderSize(from));
+    }
+    return offset;
+}
+
+std::uint64_t BuddyAllocator::Take(std::uint32_t order, std::uint64_t requestedBytes)
+{
+    auto from{order};
+    while (from <= mMaxOrder && mFreeBlocks[from].empty())
+    {
+        ++from;
+    }
+    if (from > mMaxOrder)
+    {
+        return InvalidHeapOffset;
+    }
+
+    auto offset{*mFreeBlocks[from].begin()};
+    mFreeBlocks[from].erase(mFreeBlocks[from].begin());
+    Split(offset, from, order);
+
+    mAllocations[offset] = Allocation{order, requestedBytes};
+    ++mStats.AllocationCount;
+    mStats.UsedBytes += OrderSize(order);
+    mStats.RequestedBytes += requestedBytes;
+    return offset;
+}
@@ -0,0 +1,86 @@
+#ifndef _BUDDYALLOCATOR_
+#define _BUDDYALLOCATOR_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+// Offset allocation for a fixed-size range of GPU memory, independent of any graphics API.  The
+// D3D12 heaps built on it live in HeapAllocator.h.
+//
+// Not thread-safe.
+namespace Gfx
+{
+constexpr std::uint64_t InvalidHeapOffset{0xffffffffffffffff};
+
+struct BuddyAllocatorStats
+{
+    std::uint32_t AllocationCount{0};
+    // Sum of the blocks handed out; the gap to RequestedBytes is lost to rounding.
+    std::uint64_t UsedBytes{0};
+    std::uint64_t RequestedBytes{0};
+};
+
+// A relocation planned by PlanMoves.  Both blocks are allocated until the caller frees From.
+struct HeapMove
+{
+    std::uint64_t From{InvalidHeapOffset};
+    std::uint64_t To{InvalidHeapOffset};
+    std::uint64_t ByteSize{0};
+};
+
+// Binary buddy allocator.  Requests are rounded up to a power-of-two block of at least the
+// minimum block size, and every block starts at a multiple of its size, so any alignment up to the
+// rounded size comes for free.  Freed blocks merge with their free buddy, recursively.  Requests
+// take the smallest free block that fits, lowest offset first, which keeps the low end dense.
+class BuddyAllocator
+{
+public:
+    // Both sizes must be powers of two, capacity at least minBlockSize.
+    BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize);
+
+    // Returns InvalidHeapOffset when no free block is large enough.  alignment must be a power of
+    // two, or 0 for none.
+    [[nodiscard]] std::uint64_t Allocate(std::uint64_t byteSize, std::uint64_t alignment = 0);
+    void Free(std::uint64_t offset);
+
+    // Defragmentation hook.  Plans up to maxMoves relocations of allocations, highest first, into
+    // free blocks at lower offsets, and allocates their destinations.  The caller copies each
+    // allocation and then frees From, which lets the upper part of the range merge back into
+    // large blocks, or empty out entirely.
+    [[nodiscard]] std::vector<HeapMove> PlanMoves(std::uint32_t maxMoves);
+
+    [[nodiscard]] std::uint64_t Capacity() const;
+    [[nodiscard]] std::uint64_t MinBlockSize() const;
+    // Size of the block allocated at offset.
+    [[nodiscard]] std::uint64_t BlockSize(std::uint64_t offset) const;
+    [[nodiscard]] std::uint64_t LargestFreeBlock() const;
+    [[nodiscard]] bool IsEmpty() const;
+    [[nodiscard]] const BuddyAllocatorStats& Stats() const;
+
+private:
+    struct Allocation
+    {
+        std::uint32_t Order{0};
+        std::uint64_t RequestedBytes{0};
+    };
+
+    [[nodiscard]] std::uint32_t OrderFor(std::uint64_t byteSize, std::uint64_t alignment) const;
+    [[nodiscard]] std::uint64_t OrderSize(std::uint32_t order) const;
+    // Splits the free block at offset, of order from, down to order; returns offset.
+    std::uint64_t Split(std::uint64_t offset, std::uint32_t from, std::uint32_t order);
+    std::uint64_t Take(std::uint32_t order, std::uint64_t requestedBytes);
+
+    std::uint64_t mCapacity{0};
+    std::uint64_t mMinBlockSize{0};
+    std::uint32_t mMaxOrder{0};
+
+    // Free block offsets by order; order 0 is mMinBlockSize.
+    std::vector<std::set<std::uint64_t>> mFreeBlocks{};
+    std::map<std::uint64_t, Allocation> mAllocations{};
+    BuddyAllocatorStats mStats{};
+};
+} // namespace Gfx
+
+#endif // _BUDDYALLOCATOR_
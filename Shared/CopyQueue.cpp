@@ -0,0 +1,57 @@
+#include "CopyQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+using namespace Gfx;
+
+CopyQueue::CopyQueue(IDevice& device, ResourceStateRegistry& registry, std::uint64_t ringByteSize) :
+    mQueue{device.CreateCommandQueue(QueueType::Copy)},
+    mUploads{device, *mQueue, registry, ringByteSize}
+{
+}
+
+UploadBatcher& CopyQueue::Uploads()
+{
+    return mUploads;
+}
+
+UploadTicket CopyQueue::Submit()
+{
+    return mUploads.Submit();
+}
+
+void CopyQueue::InsertWait(ICommandQueue& queue, UploadTicket ticket)
+{
+    assert(&queue != mQueue.get() && "The copy queue executes its batches in order already.");
+
+    auto waited{std::find_if(mWaitedValues.begin(), mWaitedValues.end(), [&queue](const auto& entry) {
+        return entry.first == &queue;
+    })};
+    if (waited == mWaitedValues.end())
+    {
+        mWaitedValues.emplace_back(&queue, 0);
+        waited = std::prev(mWaitedValues.end());
+    }
+
+    if (ticket.FenceValue <= waited->second || mUploads.IsComplete(ticket))
+    {
+        ++mStats.SkippedWaits;
+        return;
+    }
+
+    queue.Wait(&mUploads.Fence(), ticket.FenceValue);
+    waited->second = ticket.FenceValue;
+    ++mStats.InsertedWaits;
+}
+
+ICommandQueue& CopyQueue::Queue() const
+{
+    return *mQueue;
+}
+
+const CopyQueueStats& CopyQueue::Stats() const
+{
+    return mStats;
+}
@@ -0,0 +1,60 @@
+#ifndef _COPYQUEUE_
+#define _COPYQUEUE_
+
+#include "GfxBackend.h"
+#include "ResourceStateTracker.h"
+#include "UploadBatcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A COPY queue with its own upload batcher, so uploads run alongside rendering instead of on the
+// graphics queue.  The batcher brings the command allocators, the list and the fence timeline.
+//
+// Consumers synchronize on the GPU: InsertWait makes a queue hold later work until a ticket's
+// copies have executed, so the CPU never waits for uploads to start rendering with them.  Waits
+// for tickets that already completed, or that the queue already waits for, are dropped.
+//
+// Not thread-safe.
+namespace Gfx
+{
+struct CopyQueueStats
+{
+    std::uint32_t InsertedWaits{0};
+    std::uint32_t SkippedWaits{0};
+};
+
+class CopyQueue
+{
+public:
+    CopyQueue(IDevice& device,
+              ResourceStateRegistry& registry,
+              std::uint64_t ringByteSize = UploadBatcher::DefaultRingByteSize);
+    CopyQueue(const CopyQueue& rhs) = delete;
+    CopyQueue& operator=(const CopyQueue& rhs) = delete;
+    // Waits for the submitted uploads.
+    ~CopyQueue() = default;
+
+    // Uploads queued here execute on the copy queue once submitted.
+    [[nodiscard]] UploadBatcher& Uploads();
+    UploadTicket Submit();
+
+    // Work submitted to queue after this call does not start before ticket has executed.
+    void InsertWait(ICommandQueue& queue, UploadTicket ticket);
+
+    [[nodiscard]] ICommandQueue& Queue() const;
+    [[nodiscard]] const CopyQueueStats& Stats() const;
+
+private:
+    std::unique_ptr<ICommandQueue> mQueue{};
+    UploadBatcher mUploads;
+
+    // Highest ticket each consumer queue has been made to wait for.
+    std::vector<std::pair<const ICommandQueue*, std::uint64_t>> mWaitedValues{};
+    CopyQueueStats mStats{};
+};
+} // namespace Gfx
+
+#endif // _COPYQUEUE_
@@ -0,0 +1,62 @@
+#include "DeferredRelease.h"
+
+#include <cassert>
+#include <utility>
+
+using namespace Gfx;
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+    ReleaseAll();
+}
+
+void DeferredReleaseQueue::Enqueue(std::uint64_t fenceValue, std::uint64_t byteSize, ReleaseFunction release)
+{
+    assert(release && (mEntries.empty() || mEntries.back().FenceValue <= fenceValue));
+
+    mEntries.push_back(Entry{fenceValue, byteSize, std::move(release)});
+    ++mStats.QueuedCount;
+    mStats.QueuedBytes += byteSize;
+}
+
+void DeferredReleaseQueue::Enqueue(std::uint64_t fenceValue, std::uint64_t byteSize, IDevice& device, ResourceHandle resource)
+{
+    Enqueue(fenceValue, byteSize, [&device, resource]() { device.ReleaseResource(resource); });
+}
+
+std::uint32_t DeferredReleaseQueue::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+    std::uint32_t released{0};
+    while (!mEntries.empty() && mEntries.front().FenceValue <= completedFenceValue)
+    {
+        ReleaseFront();
+        ++released;
+    }
+    return released;
+}
+
+void DeferredReleaseQueue::ReleaseAll()
+{
+    while (!mEntries.empty())
+    {
+        ReleaseFront();
+    }
+}
+
+const DeferredReleaseStats& DeferredReleaseQueue::Stats() const
+{
+    return mStats;
+}
+
+void DeferredReleaseQueue::ReleaseFront()
+{
+    // Dequeued before it runs, so a release that throws is not run again.
+    auto entry{std::move(mEntries.front())};
+    mEntries.pop_front();
+
+    --mStats.QueuedCount;
+    mStats.QueuedBytes -= entry.ByteSize;
+    ++mStats.ReleasedCount;
+    mStats.ReleasedBytes += entry.ByteSize;
+    entry.Release();
+}
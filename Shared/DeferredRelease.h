@@ -0,0 +1,65 @@
+#ifndef _DEFERREDRELEASE_
+#define _DEFERREDRELEASE_
+
+#include "GfxBackend.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Destruction of GPU objects that in-flight work may still use, deferred until the fence value
+// that work signals has completed, without flushing the queue.  Independent of any graphics API;
+// D3D12 resources are enqueued through D3DUtils::DeferRelease in PlatformHelpers.h.
+//
+// Not thread-safe.
+namespace Gfx
+{
+struct DeferredReleaseStats
+{
+    std::uint32_t QueuedCount{0};
+    std::uint64_t QueuedBytes{0};
+    std::uint64_t ReleasedCount{0};
+    std::uint64_t ReleasedBytes{0};
+};
+
+// One queue per fence timeline.  Entries are released in bulk, in the order they were enqueued,
+// by the first ReleaseCompleted whose completed value reaches theirs.
+class DeferredReleaseQueue
+{
+public:
+    using ReleaseFunction = std::function<void()>;
+
+    DeferredReleaseQueue() = default;
+    DeferredReleaseQueue(const DeferredReleaseQueue& rhs) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue& rhs) = delete;
+    // Releases whatever is still queued; the GPU must be idle by then.
+    ~DeferredReleaseQueue();
+
+    // release runs once fenceValue has completed.  byteSize only feeds the stats.  Fence values
+    // must not decrease from one call to the next.
+    void Enqueue(std::uint64_t fenceValue, std::uint64_t byteSize, ReleaseFunction release);
+    // Hands resource back to device.ReleaseResource; device must outlive the entry.
+    void Enqueue(std::uint64_t fenceValue, std::uint64_t byteSize, IDevice& device, ResourceHandle resource);
+
+    // Returns how many entries were released.
+    std::uint32_t ReleaseCompleted(std::uint64_t completedFenceValue);
+    void ReleaseAll();
+
+    [[nodiscard]] const DeferredReleaseStats& Stats() const;
+
+private:
+    struct Entry
+    {
+        std::uint64_t FenceValue{0};
+        std::uint64_t ByteSize{0};
+        ReleaseFunction Release{};
+    };
+
+    void ReleaseFront();
+
+    std::deque<Entry> mEntries{};
+    DeferredReleaseStats mStats{};
+};
+} // namespace Gfx
+
+#endif // _DEFERREDRELEASE_
@@ -0,0 +1,176 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Gfx;
+
+DescriptorFreeList::DescriptorFreeList(std::uint32_t capacity) : mCapacity{capacity}, mFreeCount{capacity}
+{
+    if (capacity > 0)
+    {
+        mFreeRanges.push_back(Range{0, capacity});
+    }
+}
+
+std::uint32_t DescriptorFreeList::Allocate(std::uint32_t count)
+{
+    assert(count > 0);
+
+    auto range{std::find_if(mFreeRanges.begin(), mFreeRanges.end(), [count](const Range& free) {
+        return free.Count >= count;
+    })};
+    if (range == mFreeRanges.end())
+    {
+        return InvalidDescriptorIndex;
+    }
+
+    auto offset{range->Offset};
+    if (range->Count == count)
+    {
+        mFreeRanges.erase(range);
+    }
+    else
+    {
+        range->Offset += count;
+        range->Count -= count;
+    }
+
+    mFreeCount -= count;
+    return offset;
+}
+
+void DescriptorFreeList::Free(std::uint32_t offset, std::uint32_t count)
+{
+    assert(count > 0 && offset + count <= mCapacity);
+
+    auto next{std::lower_bound(mFreeRanges.begin(), mFreeRanges.end(), offset, [](const Range& free, std::uint32_t value) {
+        return free.Offset < value;
+    })};
+    assert((next == mFreeRanges.end() || offset + count <= next->Offset) && "Freeing a range twice.");
+
+    auto mergesWithPrevious{next != mFreeRanges.begin() && std::prev(next)->Offset + std::prev(next)->Count == offset};
+    auto mergesWithNext{next != mFreeRanges.end() && offset + count == next->Offset};
+
+    if (mergesWithPrevious && mergesWithNext)
+    {
+        std::prev(next)->Count += count + next->Count;
+        mFreeRanges.erase(next);
+    }
+    else if (mergesWithPrevious)
+    {
+        std::prev(next)->Count += count;
+    }
+    else if (mergesWithNext)
+    {
+        next->Offset = offset;
+        next->Count += count;
+    }
+    else
+    {
+        mFreeRanges.insert(next, Range{offset, count});
+    }
+
+    mFreeCount += count;
+}
+
+void DescriptorFreeList::FreeAfter(std::uint32_t offset, std::uint32_t count, std::uint64_t fenceValue)
+{
+    assert(mRetiring.empty() || mRetiring.back().FenceValue <= fenceValue);
+    mRetiring.push_back(RetiringRange{Range{offset, count}, fenceValue});
+}
+
+void DescriptorFreeList::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+    while (!mRetiring.empty() && mRetiring.front().FenceValue <= completedFenceValue)
+    {
+        Free(mRetiring.front().Descriptors.Offset, mRetiring.front().Descriptors.Count);
+        mRetiring.pop_front();
+    }
+}
+
+std::uint32_t DescriptorFreeList::Capacity() const
+{
+    return mCapacity;
+}
+
+std::uint32_t DescriptorFreeList::FreeCount() const
+{
+    return mFreeCount;
+}
+
+std::uint32_t DescriptorFreeList::LargestFreeRange() const
+{
+    std::uint32_t largest{0};
+    for (const auto& range : mFreeRanges)
+    {
+        largest = std::max(largest, range.Count);
+    }
+    return largest;
+}
+
+std::uint32_t DescriptorFreeList::RetiringCount() const
+{
+    std::uint32_t count{0};
+    for (const auto& retiring : mRetiring)
+    {
+        count += retiring.Descriptors.Count;
+    }
+    return count;
+}
+
+DescriptorRing::DescriptorRing(std::uint32_t capacity) : mCapacity{capacity}
+{
+}
+
+std::uint32_t DescriptorRing::Allocate(std::uint32_t count)
+{
+    assert(count > 0);
+    if (count > mCapacity)
+    {
+        return InvalidDescriptorIndex;
+    }
+
+    // Skip the tail when the range would straddle the end of the heap.
+    std::uint32_t skipped{mHead + count > mCapacity ? mCapacity - mHead : 0};
+    if (mUsed + skipped + count > mCapacity)
+    {
+        return InvalidDescriptorIndex;
+    }
+
+    auto offset{skipped > 0 ? 0 : mHead};
+    mHead = (offset + count) % mCapacity;
+    mUsed += skipped + count;
+    mOpenFrameCount += skipped + count;
+    return offset;
+}
+
+void DescriptorRing::FinishFrame(std::uint64_t fenceValue)
+{
+    assert(mFrames.empty() || mFrames.back().FenceValue <= fenceValue);
+
+    if (mOpenFrameCount > 0)
+    {
+        mFrames.push_back(Frame{mOpenFrameCount, fenceValue});
+        mOpenFrameCount = 0;
+    }
+}
+
+void DescriptorRing::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+    while (!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue)
+    {
+        mUsed -= mFrames.front().Count;
+        mFrames.pop_front();
+    }
+}
+
+std::uint32_t DescriptorRing::Capacity() const
+{
+    return mCapacity;
+}
+
+std::uint32_t DescriptorRing::UsedCount() const
+{
+    return mUsed;
+}
@@ -0,0 +1,90 @@
+#ifndef _DESCRIPTORALLOCATOR_
+#define _DESCRIPTORALLOCATOR_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Index allocation for descriptor heaps, independent of any graphics API.  Offsets are descriptor
+// indices into a heap of fixed capacity; the D3D12 heaps built on these live in PlatformHelpers.h.
+//
+// Neither class is thread-safe.
+namespace Gfx
+{
+constexpr std::uint32_t InvalidDescriptorIndex{0xffffffff};
+
+// Contiguous ranges from a fixed-size heap, first fit.  Free ranges are kept sorted by offset and
+// merged with their neighbours, so freed space is reusable by larger requests.  Ranges still
+// referenced by in-flight GPU work are freed with FreeAfter and come back in ReleaseCompleted.
+class DescriptorFreeList
+{
+public:
+    explicit DescriptorFreeList(std::uint32_t capacity);
+
+    // Returns InvalidDescriptorIndex when no free range is large enough.
+    [[nodiscard]] std::uint32_t Allocate(std::uint32_t count);
+    void Free(std::uint32_t offset, std::uint32_t count);
+
+    // Fence values must not decrease from one call to the next.
+    void FreeAfter(std::uint32_t offset, std::uint32_t count, std::uint64_t fenceValue);
+    void ReleaseCompleted(std::uint64_t completedFenceValue);
+
+    [[nodiscard]] std::uint32_t Capacity() const;
+    [[nodiscard]] std::uint32_t FreeCount() const;
+    [[nodiscard]] std::uint32_t LargestFreeRange() const;
+    [[nodiscard]] std::uint32_t RetiringCount() const;
+
+private:
+    struct Range
+    {
+        std::uint32_t Offset{0};
+        std::uint32_t Count{0};
+    };
+
+    struct RetiringRange
+    {
+        Range Descriptors{};
+        std::uint64_t FenceValue{0};
+    };
+
+    std::uint32_t mCapacity{0};
+    std::uint32_t mFreeCount{0};
+    std::vector<Range> mFreeRanges{};
+    std::deque<RetiringRange> mRetiring{};
+};
+
+// Per-frame ring.  Every allocation is contiguous: a request that does not fit before the end of
+// the heap skips the remaining tail and starts over at 0.  Everything allocated between two
+// FinishFrame calls is retired at once when that frame's fence value completes.
+class DescriptorRing
+{
+public:
+    explicit DescriptorRing(std::uint32_t capacity);
+
+    // Returns InvalidDescriptorIndex when the ring is full of in-flight frames.
+    [[nodiscard]] std::uint32_t Allocate(std::uint32_t count);
+
+    // Closes the current frame; its allocations retire once fenceValue completes.
+    void FinishFrame(std::uint64_t fenceValue);
+    void ReleaseCompleted(std::uint64_t completedFenceValue);
+
+    [[nodiscard]] std::uint32_t Capacity() const;
+    // Includes skipped tails and the open frame.
+    [[nodiscard]] std::uint32_t UsedCount() const;
+
+private:
+    struct Frame
+    {
+        std::uint32_t Count{0};
+        std::uint64_t FenceValue{0};
+    };
+
+    std::uint32_t mCapacity{0};
+    std::uint32_t mHead{0};
+    std::uint32_t mUsed{0};
+    std::uint32_t mOpenFrameCount{0};
+    std::deque<Frame> mFrames{};
+};
+} // namespace Gfx
+
+#endif // _DESCRIPTORALLOCATOR_
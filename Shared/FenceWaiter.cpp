@@ -0,0 +1,264 @@
+#include "FenceWaiter.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace Gfx;
+
+namespace
+{
+void* CreateWaitEvent()
+{
+#if defined(_WIN32)
+    HANDLE event{CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS)};
+    if (event == nullptr)
+    {
+        throw std::runtime_error{"Failed to create event: " + std::to_string(GetLastError())};
+    }
+    return event;
+#else
+    return nullptr;
+#endif
+}
+
+void ResetWaitEvent(void* event)
+{
+#if defined(_WIN32)
+    ResetEvent(static_cast<HANDLE>(event));
+#else
+    static_cast<void>(event);
+#endif
+}
+
+void CloseWaitEvent(void* event)
+{
+#if defined(_WIN32)
+    CloseHandle(static_cast<HANDLE>(event));
+#else
+    static_cast<void>(event);
+#endif
+}
+
+// Returns false when the timeout passed first.
+bool WaitForEvents(const std::vector<void*>& events, std::chrono::milliseconds timeout)
+{
+#if defined(_WIN32)
+    auto milliseconds{timeout == InfiniteWait
+                          ? INFINITE
+                          : static_cast<DWORD>(std::min<std::chrono::milliseconds::rep>(timeout.count(), INFINITE - 1))};
+    auto result{WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), TRUE, milliseconds)};
+    if (result == WAIT_FAILED)
+    {
+        throw std::runtime_error{"Failed to wait for fence events: " + std::to_string(GetLastError())};
+    }
+    return result != WAIT_TIMEOUT;
+#else
+    static_cast<void>(events);
+    static_cast<void>(timeout);
+    return true;
+#endif
+}
+} // namespace
+
+FenceWaiter::FenceWaiter(FenceWaitPolicy policy) : mPolicy{policy}
+{
+}
+
+FenceWaiter::~FenceWaiter()
+{
+    for (auto* event : mEvents)
+    {
+        CloseWaitEvent(event);
+    }
+}
+
+FenceWaitResult FenceWaiter::Wait(IFence& fence, std::uint64_t value)
+{
+    return Wait(fence, value, mPolicy);
+}
+
+FenceWaitResult FenceWaiter::Wait(IFence& fence, std::uint64_t value, const FenceWaitPolicy& policy)
+{
+    FenceWaitTarget target{&fence, value};
+    return WaitAll(&target, 1, policy);
+}
+
+FenceWaitResult FenceWaiter::WaitAll(const FenceWaitTarget* targets, std::uint32_t count)
+{
+    return WaitAll(targets, count, mPolicy);
+}
+
+FenceWaitResult FenceWaiter::WaitAll(const FenceWaitTarget* targets, std::uint32_t count, const FenceWaitPolicy& policy)
+{
+    FenceWaitResult result{};
+    if (IsCompleted(targets, count))
+    {
+        result.Completed = true;
+        return result;
+    }
+
+    PROFILE_ZONE("FenceWait");
+    ++mStats.WaitCount;
+    auto start{Clock::now()};
+
+    auto spinTime{policy.SpinTime};
+    if (policy.Timeout != InfiniteWait)
+    {
+        auto timeout{std::chrono::duration_cast<std::chrono::microseconds>(policy.Timeout)};
+        spinTime = std::min<std::chrono::microseconds>(spinTime, timeout);
+    }
+    do
+    {
+        if (IsCompleted(targets, count))
+        {
+            result.Completed = true;
+            break;
+        }
+        std::this_thread::yield();
+    } while (Clock::now() - start < spinTime);
+
+    if (result.Completed)
+    {
+        ++mStats.SpinCompletions;
+    }
+    else
+    {
+        result.Blocked = true;
+        ++mStats.BlockedWaits;
+        result.Completed = Block(targets, count, policy.Timeout, start);
+        if (!result.Completed)
+        {
+            ++mStats.TimedOutWaits;
+        }
+    }
+
+    result.WaitTime = Clock::now() - start;
+    mStats.TotalWaitTime += result.WaitTime;
+    return result;
+}
+
+const FenceWaitPolicy& FenceWaiter::Policy() const
+{
+    return mPolicy;
+}
+
+void FenceWaiter::SetPolicy(const FenceWaitPolicy& policy)
+{
+    mPolicy = policy;
+}
+
+const FenceWaiterStats& FenceWaiter::Stats() const
+{
+    return mStats;
+}
+
+bool FenceWaiter::IsCompleted(const FenceWaitTarget* targets, std::uint32_t count)
+{
+    return std::all_of(targets, targets + count, [](const FenceWaitTarget& target) {
+        return target.Fence->GetCompletedValue() >= target.Value;
+    });
+}
+
+bool FenceWaiter::Block(const FenceWaitTarget* targets,
+                        std::uint32_t count,
+                        std::chrono::milliseconds timeout,
+                        Clock::time_point start)
+{
+    assert(count <= MaxWaitCount);
+
+    while (true)
+    {
+        // One event per pending fence, so a single wait covers them all.
+        auto isPolling{false};
+        for (std::uint32_t i{0}; i < count; ++i)
+        {
+            const auto& target{targets[i]};
+            if (target.Fence->GetCompletedValue() >= target.Value)
+            {
+                continue;
+            }
+
+            auto* event{AcquireEvent()};
+            mArmedEvents.push_back(event);
+            if (event == nullptr || !target.Fence->SetEventOnCompletion(target.Value, event))
+            {
+                isPolling = true;
+            }
+        }
+        if (mArmedEvents.empty())
+        {
+            return true;
+        }
+
+        auto remaining{InfiniteWait};
+        if (timeout != InfiniteWait)
+        {
+            auto elapsed{std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start)};
+            if (elapsed >= timeout)
+            {
+                ReleaseArmedEvents();
+                return IsCompleted(targets, count);
+            }
+            remaining = timeout - elapsed;
+        }
+
+        auto isSignaled{true};
+        if (isPolling)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            isSignaled = WaitForEvents(mArmedEvents, remaining);
+        }
+        ReleaseArmedEvents();
+
+        if (!isSignaled)
+        {
+            return IsCompleted(targets, count);
+        }
+        // Every fence has completed, unless a signal left over from an earlier timed-out wait
+        // woke this one early; the next pass finds out.
+    }
+}
+
+void* FenceWaiter::AcquireEvent()
+{
+    if (mFreeEvents.empty())
+    {
+        auto* event{CreateWaitEvent()};
+        if (event != nullptr)
+        {
+            mEvents.push_back(event);
+            ++mStats.EventCount;
+        }
+        return event;
+    }
+
+    auto* event{mFreeEvents.back()};
+    mFreeEvents.pop_back();
+    // A fence that an earlier, timed-out wait armed it on may have signaled it since.
+    ResetWaitEvent(event);
+    return event;
+}
+
+void FenceWaiter::ReleaseArmedEvents()
+{
+    for (auto* event : mArmedEvents)
+    {
+        if (event != nullptr)
+        {
+            mFreeEvents.push_back(event);
+        }
+    }
+    mArmedEvents.clear();
+}
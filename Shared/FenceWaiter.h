@@ -0,0 +1,93 @@
+#ifndef _FENCEWAITER_
+#define _FENCEWAITER_
+
+#include "GfxBackend.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// CPU waits for fences.  A wait first polls for a short while, which catches fences about to
+// complete without a trip through the kernel, then blocks on OS events taken from a pool, so no
+// event is created or destroyed per wait.  Fences whose backend cannot signal an event (the null
+// backend) are polled for the whole wait.
+//
+// Not thread-safe; each thread that waits needs a waiter of its own.
+namespace Gfx
+{
+constexpr std::chrono::milliseconds InfiniteWait{(std::chrono::milliseconds::max)()};
+
+struct FenceWaitPolicy
+{
+    // How long to poll before blocking.
+    std::chrono::microseconds SpinTime{20};
+    std::chrono::milliseconds Timeout{InfiniteWait};
+};
+
+struct FenceWaitTarget
+{
+    IFence* Fence{nullptr};
+    std::uint64_t Value{0};
+};
+
+struct FenceWaitResult
+{
+    // False when the timeout passed first.
+    bool Completed{false};
+    bool Blocked{false};
+    std::chrono::nanoseconds WaitTime{0};
+};
+
+struct FenceWaiterStats
+{
+    // Waits that found a fence still pending; waits on completed fences return at once.
+    std::uint64_t WaitCount{0};
+    std::uint64_t SpinCompletions{0};
+    std::uint64_t BlockedWaits{0};
+    std::uint64_t TimedOutWaits{0};
+    std::uint32_t EventCount{0};
+    std::chrono::nanoseconds TotalWaitTime{0};
+};
+
+class FenceWaiter
+{
+public:
+    // The most fences one WaitAll can block on.
+    static constexpr std::uint32_t MaxWaitCount{64};
+
+    explicit FenceWaiter(FenceWaitPolicy policy = {});
+    FenceWaiter(const FenceWaiter& rhs) = delete;
+    FenceWaiter& operator=(const FenceWaiter& rhs) = delete;
+    ~FenceWaiter();
+
+    FenceWaitResult Wait(IFence& fence, std::uint64_t value);
+    FenceWaitResult Wait(IFence& fence, std::uint64_t value, const FenceWaitPolicy& policy);
+    // Waits until every target has completed, e.g. the fences of several queues.
+    FenceWaitResult WaitAll(const FenceWaitTarget* targets, std::uint32_t count);
+    FenceWaitResult WaitAll(const FenceWaitTarget* targets, std::uint32_t count, const FenceWaitPolicy& policy);
+
+    [[nodiscard]] const FenceWaitPolicy& Policy() const;
+    void SetPolicy(const FenceWaitPolicy& policy);
+    [[nodiscard]] const FenceWaiterStats& Stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    [[nodiscard]] static bool IsCompleted(const FenceWaitTarget* targets, std::uint32_t count);
+    // Blocks until every target completes or the timeout measured from start passes.
+    bool Block(const FenceWaitTarget* targets, std::uint32_t count, std::chrono::milliseconds timeout, Clock::time_point start);
+
+    // Null where the platform has no events.
+    void* AcquireEvent();
+    void ReleaseArmedEvents();
+
+    FenceWaitPolicy mPolicy{};
+    FenceWaiterStats mStats{};
+
+    std::vector<void*> mEvents{};
+    std::vector<void*> mFreeEvents{};
+    std::vector<void*> mArmedEvents{};
+};
+} // namespace Gfx
+
+#endif // _FENCEWAITER_
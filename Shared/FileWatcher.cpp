@@ -0,0 +1,409 @@
+#include "FileWatcher.h"
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#error "FileWatcher has no notifier for this platform."
+#endif
+
+using namespace Files;
+
+namespace
+{
+// Used when the notifier lost events: everything in the directory may have changed.
+void AddDirectoryFiles(const std::filesystem::path& directory, std::vector<std::filesystem::path>& changed)
+{
+    std::error_code error{};
+    for (std::filesystem::directory_iterator it{directory, error}, end{}; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error))
+        {
+            changed.push_back(it->path().lexically_normal());
+        }
+    }
+}
+} // namespace
+
+#if defined(_WIN32)
+
+class FileWatcher::Notifier
+{
+public:
+    explicit Notifier(const std::vector<std::wstring>& directories)
+    {
+        assert(directories.size() < MAXIMUM_WAIT_OBJECTS && "Too many directories for one notifier.");
+
+        mStop = CreateEventExW(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
+        if (mStop == nullptr)
+        {
+            throw std::runtime_error{"Failed to create event: " + std::to_string(GetLastError())};
+        }
+
+        for (const auto& name : directories)
+        {
+            auto& directory{mDirectories.emplace_back()};
+            directory.Path = std::filesystem::path{name};
+            directory.Handle = CreateFileW(directory.Path.c_str(),
+                                           FILE_LIST_DIRECTORY,
+                                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                           nullptr,
+                                           OPEN_EXISTING,
+                                           FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                           nullptr);
+            directory.Overlapped.hEvent = CreateEventExW(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
+            if (directory.Handle == INVALID_HANDLE_VALUE || directory.Overlapped.hEvent == nullptr || !Issue(directory))
+            {
+                std::string message{"Cannot watch " + directory.Path.u8string() + ": " + std::to_string(GetLastError())};
+                Close();
+                throw std::runtime_error{message};
+            }
+        }
+    }
+
+    Notifier(const Notifier& rhs) = delete;
+    Notifier& operator=(const Notifier& rhs) = delete;
+
+    ~Notifier()
+    {
+        Close();
+    }
+
+    // Blocks until files changed or Stop was called.  Returns false once stopped.
+    bool Wait(std::vector<std::filesystem::path>& changed)
+    {
+        std::vector<HANDLE> events{mStop};
+        for (const auto& directory : mDirectories)
+        {
+            events.push_back(directory.Overlapped.hEvent);
+        }
+
+        while (changed.empty())
+        {
+            auto result{WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, INFINITE)};
+            if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + events.size())
+            {
+                return false;
+            }
+
+            auto& directory{mDirectories[result - WAIT_OBJECT_0 - 1]};
+            directory.Pending = false;
+            DWORD byteCount{0};
+            if (!GetOverlappedResult(directory.Handle, &directory.Overlapped, &byteCount, FALSE))
+            {
+                // Whatever the read had collected is lost; treat it like an overflow and re-arm.
+                Log(L"reading changes failed", directory, GetLastError());
+                byteCount = 0;
+            }
+
+            if (byteCount == 0)
+            {
+                // The buffer overflowed and the changes were dropped.
+                AddDirectoryFiles(directory.Path, changed);
+            }
+            else
+            {
+                AddChanges(directory, changed);
+            }
+
+            // The other directories stay watched; this one's event stays reset and never fires again.
+            if (!Issue(directory))
+            {
+                Log(L"no longer watched", directory, GetLastError());
+            }
+        }
+        return true;
+    }
+
+    void Stop()
+    {
+        SetEvent(mStop);
+    }
+
+private:
+    struct Directory
+    {
+        std::filesystem::path Path{};
+        HANDLE Handle{INVALID_HANDLE_VALUE};
+        OVERLAPPED Overlapped{};
+        bool Pending{false};
+        // FILE_NOTIFY_INFORMATION records are DWORD aligned.
+        std::vector<DWORD> Buffer = std::vector<DWORD>(16 * 1024);
+    };
+
+    static bool Issue(Directory& directory)
+    {
+        ResetEvent(directory.Overlapped.hEvent);
+        directory.Pending = ReadDirectoryChangesW(directory.Handle,
+                                                  directory.Buffer.data(),
+                                                  static_cast<DWORD>(directory.Buffer.size() * sizeof(DWORD)),
+                                                  FALSE,
+                                                  FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                                  nullptr,
+                                                  &directory.Overlapped,
+                                                  nullptr)
+                            != FALSE;
+        return directory.Pending;
+    }
+
+    static void Log(const wchar_t* what, const Directory& directory, DWORD error)
+    {
+        auto message{L"FileWatcher: " + directory.Path.wstring() + L": " + what + L" (error " + std::to_wstring(error)
+                     + L")\n"};
+        OutputDebugStringW(message.c_str());
+    }
+
+    static void AddChanges(const Directory& directory, std::vector<std::filesystem::path>& changed)
+    {
+        const auto* record{reinterpret_cast<const std::uint8_t*>(directory.Buffer.data())};
+        for (;;)
+        {
+            const auto* info{reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record)};
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED
+                || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+            {
+                std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+                changed.push_back((directory.Path / name).lexically_normal());
+            }
+
+            if (info->NextEntryOffset == 0)
+            {
+                break;
+            }
+            record += info->NextEntryOffset;
+        }
+    }
+
+    void Close()
+    {
+        for (auto& directory : mDirectories)
+        {
+            if (directory.Pending)
+            {
+                // The read writes into Buffer until it is cancelled.
+                DWORD byteCount{0};
+                CancelIoEx(directory.Handle, &directory.Overlapped);
+                GetOverlappedResult(directory.Handle, &directory.Overlapped, &byteCount, TRUE);
+            }
+            if (directory.Handle != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(directory.Handle);
+            }
+            if (directory.Overlapped.hEvent != nullptr)
+            {
+                CloseHandle(directory.Overlapped.hEvent);
+            }
+        }
+        mDirectories.clear();
+
+        if (mStop != nullptr)
+        {
+            CloseHandle(mStop);
+            mStop = nullptr;
+        }
+    }
+
+    HANDLE mStop{nullptr};
+    // Pending reads point into the elements; they must not move.
+    std::deque<Directory> mDirectories{};
+};
+
+#elif defined(__linux__)
+
+class FileWatcher::Notifier
+{
+public:
+    explicit Notifier(const std::vector<std::wstring>& directories)
+    {
+        mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        mStop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mInotify < 0 || mStop < 0)
+        {
+            std::string message{std::string{"Cannot create inotify instance: "} + std::strerror(errno)};
+            Close();
+            throw std::runtime_error{message};
+        }
+
+        for (const auto& name : directories)
+        {
+            std::filesystem::path path{name};
+            auto watch{inotify_add_watch(mInotify, path.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_ONLYDIR)};
+            if (watch < 0)
+            {
+                std::string message{"Cannot watch " + path.u8string() + ": " + std::strerror(errno)};
+                Close();
+                throw std::runtime_error{message};
+            }
+            mDirectories.push_back(Directory{watch, path});
+        }
+    }
+
+    Notifier(const Notifier& rhs) = delete;
+    Notifier& operator=(const Notifier& rhs) = delete;
+
+    ~Notifier()
+    {
+        Close();
+    }
+
+    // Blocks until files changed or Stop was called.  Returns false once stopped.
+    bool Wait(std::vector<std::filesystem::path>& changed)
+    {
+        while (changed.empty())
+        {
+            pollfd fds[2]{
+                {mInotify, POLLIN, 0},
+                {   mStop, POLLIN, 0},
+            };
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            if (fds[1].revents != 0)
+            {
+                return false;
+            }
+
+            alignas(inotify_event) char buffer[16 * 1024];
+            ssize_t length{0};
+            while ((length = read(mInotify, buffer, sizeof(buffer))) > 0)
+            {
+                for (auto* record{buffer}; record < buffer + length;)
+                {
+                    const auto* event{reinterpret_cast<const inotify_event*>(record)};
+                    AddChanges(*event, changed);
+                    record += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (length < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Stop()
+    {
+        std::uint64_t one{1};
+        static_cast<void>(write(mStop, &one, sizeof(one)));
+    }
+
+private:
+    struct Directory
+    {
+        int Watch{-1};
+        std::filesystem::path Path{};
+    };
+
+    void AddChanges(const inotify_event& event, std::vector<std::filesystem::path>& changed) const
+    {
+        if ((event.mask & IN_Q_OVERFLOW) != 0)
+        {
+            // The queue overflowed and the changes were dropped.
+            for (const auto& directory : mDirectories)
+            {
+                AddDirectoryFiles(directory.Path, changed);
+            }
+            return;
+        }
+        if (event.len == 0 || (event.mask & IN_ISDIR) != 0)
+        {
+            return;
+        }
+
+        for (const auto& directory : mDirectories)
+        {
+            if (directory.Watch == event.wd)
+            {
+                changed.push_back((directory.Path / event.name).lexically_normal());
+            }
+        }
+    }
+
+    void Close()
+    {
+        if (mInotify >= 0)
+        {
+            close(mInotify);
+            mInotify = -1;
+        }
+        if (mStop >= 0)
+        {
+            close(mStop);
+            mStop = -1;
+        }
+    }
+
+    int mInotify{-1};
+    int mStop{-1};
+    std::vector<Directory> mDirectories{};
+};
+
+#endif
+
+FileWatcher::FileWatcher(const std::vector<std::wstring>& directories, std::chrono::milliseconds settleTime)
+    : mSettleTime{settleTime}, mNotifier{std::make_unique<Notifier>(directories)}
+{
+    mThread = std::thread{[this] { Run(); }};
+}
+
+FileWatcher::~FileWatcher()
+{
+    mNotifier->Stop();
+    mThread.join();
+}
+
+std::vector<std::wstring> FileWatcher::TakeChanges()
+{
+    std::vector<std::wstring> settled{};
+    auto now{Clock::now()};
+
+    std::lock_guard<std::mutex> lock{mMutex};
+    for (auto it{mChanged.begin()}; it != mChanged.end();)
+    {
+        if (now - it->second >= mSettleTime)
+        {
+            settled.push_back(it->first);
+            it = mChanged.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return settled;
+}
+
+void FileWatcher::Run()
+{
+    std::vector<std::filesystem::path> changed{};
+    while (mNotifier->Wait(changed))
+    {
+        auto now{Clock::now()};
+
+        std::lock_guard<std::mutex> lock{mMutex};
+        for (const auto& file : changed)
+        {
+            mChanged[file.wstring()] = now;
+        }
+        changed.clear();
+    }
+}
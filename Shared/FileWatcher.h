@@ -0,0 +1,57 @@
+#ifndef _FILEWATCHER_
+#define _FILEWATCHER_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Reports files that were written, created or renamed into a set of directories.
+//
+// A background thread blocks on the platform's change notifications (ReadDirectoryChangesW on
+// Windows, inotify on Linux) and only records which files changed and when.  TakeChanges hands a
+// file out once it has been quiet for the settle time, so an editor's burst of writes, or a save
+// through a temporary file and a rename, is reported once and after the file is complete.
+//
+// Directories are watched without their subdirectories.  Reported paths are the watched directory
+// as given joined with the file name, lexically normalized.  When reading a directory's changes
+// fails, all of its files are reported as changed and the watch is re-armed; on Windows the failure
+// is logged to the debugger output.
+namespace Files
+{
+class FileWatcher
+{
+public:
+    // Throws std::runtime_error when a directory cannot be watched.
+    explicit FileWatcher(const std::vector<std::wstring>& directories,
+                         std::chrono::milliseconds settleTime = std::chrono::milliseconds{100});
+    FileWatcher(const FileWatcher& rhs) = delete;
+    FileWatcher& operator=(const FileWatcher& rhs) = delete;
+    ~FileWatcher();
+
+    // Files that changed and have been quiet for the settle time since the last call, each once.
+    // Cheap when nothing changed; meant to be polled once a frame.
+    [[nodiscard]] std::vector<std::wstring> TakeChanges();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    class Notifier;
+
+    void Run();
+
+    std::chrono::milliseconds mSettleTime{};
+    std::unique_ptr<Notifier> mNotifier{};
+
+    std::mutex mMutex{};
+    // Last change of every file not yet handed out.
+    std::unordered_map<std::wstring, Clock::time_point> mChanged{};
+
+    std::thread mThread{};
+};
+} // namespace Files
+
+#endif // _FILEWATCHER_
@@ -0,0 +1,77 @@
+#include "FrameLatency.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace Gfx;
+
+void FrameLatencyTracker::SetSetting(FrameLatencySetting setting)
+{
+    auto stats{std::find_if(mStats.begin(), mStats.end(), [&setting](const FrameLatencyStats& entry) {
+        return entry.Setting.FramesInFlight == setting.FramesInFlight
+               && entry.Setting.BackBufferCount == setting.BackBufferCount;
+    })};
+    if (stats == mStats.end())
+    {
+        // The entry in use before any setting was given is taken over rather than kept.
+        if (mStats.size() == 1 && mStats.front().FrameCount == 0)
+        {
+            mStats.clear();
+        }
+        mStats.push_back(FrameLatencyStats{setting});
+        stats = std::prev(mStats.end());
+    }
+
+    mCurrent = static_cast<std::size_t>(stats - mStats.begin());
+    mPending.clear();
+}
+
+void FrameLatencyTracker::BeginFrame()
+{
+    mInputTime = Clock::now();
+    mFrameStall = std::chrono::nanoseconds{0};
+}
+
+void FrameLatencyTracker::AddFenceStall(std::chrono::nanoseconds stall)
+{
+    mFrameStall += stall;
+}
+
+void FrameLatencyTracker::EndFrame(std::uint64_t fenceValue)
+{
+    auto& stats{Current()};
+    ++stats.FrameCount;
+    stats.InputToPresent += Clock::now() - mInputTime;
+    stats.FenceStall += mFrameStall;
+
+    mPending.push_back(PendingFrame{fenceValue, mInputTime});
+}
+
+void FrameLatencyTracker::Update(std::uint64_t completedFenceValue)
+{
+    auto now{Clock::now()};
+    auto& stats{Current()};
+    while (!mPending.empty() && mPending.front().FenceValue <= completedFenceValue)
+    {
+        std::chrono::nanoseconds latency{now - mPending.front().InputTime};
+        ++stats.GpuDoneCount;
+        stats.InputToGpuDone += latency;
+        stats.MaxInputToGpuDone = std::max(stats.MaxInputToGpuDone, latency);
+        mPending.pop_front();
+    }
+}
+
+const FrameLatencyStats& FrameLatencyTracker::Stats() const
+{
+    return mStats[mCurrent];
+}
+
+const std::vector<FrameLatencyStats>& FrameLatencyTracker::AllStats() const
+{
+    return mStats;
+}
+
+FrameLatencyStats& FrameLatencyTracker::Current()
+{
+    return mStats[mCurrent];
+}
@@ -0,0 +1,77 @@
+#ifndef _FRAMELATENCY_
+#define _FRAMELATENCY_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Latency of the frame loop under each frames-in-flight and back buffer setting it runs with, so
+// the two can be traded off per workload: more frames in flight buy throughput, fewer cut the time
+// from input to the picture.
+//
+// Each frame is timed from when it samples input to when Present returns, and to when the GPU has
+// finished it.  The latter is observed on the first Update after the frame's fence completed, so
+// it is an upper bound by up to one frame.  Not thread-safe.
+namespace Gfx
+{
+struct FrameLatencySetting
+{
+    std::uint32_t FramesInFlight{0};
+    std::uint32_t BackBufferCount{0};
+};
+
+// Totals over the frames measured under Setting; divide by FrameCount, or by GpuDoneCount for
+// InputToGpuDone, for averages.
+struct FrameLatencyStats
+{
+    FrameLatencySetting Setting{};
+    std::uint64_t FrameCount{0};
+    std::uint64_t GpuDoneCount{0};
+    std::chrono::nanoseconds InputToPresent{0};
+    std::chrono::nanoseconds InputToGpuDone{0};
+    std::chrono::nanoseconds MaxInputToGpuDone{0};
+    // Time the CPU spent blocked on fences.
+    std::chrono::nanoseconds FenceStall{0};
+};
+
+class FrameLatencyTracker
+{
+public:
+    // Frames still in flight under the previous setting are not counted.
+    void SetSetting(FrameLatencySetting setting);
+
+    // At the start of the frame, before it samples input.
+    void BeginFrame();
+    void AddFenceStall(std::chrono::nanoseconds stall);
+    // Right after Present.  fenceValue is the one the frame's GPU work signals.
+    void EndFrame(std::uint64_t fenceValue);
+    // Completes the frames whose fence value has completed.
+    void Update(std::uint64_t completedFenceValue);
+
+    // Stats of the current setting.
+    [[nodiscard]] const FrameLatencyStats& Stats() const;
+    // One entry per setting measured so far, in the order they were first used.
+    [[nodiscard]] const std::vector<FrameLatencyStats>& AllStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingFrame
+    {
+        std::uint64_t FenceValue{0};
+        Clock::time_point InputTime{};
+    };
+
+    FrameLatencyStats& Current();
+
+    std::vector<FrameLatencyStats> mStats{FrameLatencyStats{}};
+    std::size_t mCurrent{0};
+
+    Clock::time_point mInputTime{};
+    std::chrono::nanoseconds mFrameStall{0};
+    std::deque<PendingFrame> mPending{};
+};
+} // namespace Gfx
+
+#endif // _FRAMELATENCY_
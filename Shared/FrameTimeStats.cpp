@@ -0,0 +1,97 @@
+#include "FrameTimeStats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+using namespace Gfx;
+
+namespace
+{
+// Nearest-rank percentile of sorted samples.
+float Percentile(const std::vector<float>& sorted, float percent)
+{
+    auto rank{static_cast<std::size_t>(std::ceil(percent / 100.0F * static_cast<float>(sorted.size())))};
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+} // namespace
+
+FrameTimeStats::FrameTimeStats(std::uint32_t capacity) :
+    mCapacity{capacity},
+    mSamplesMs{std::make_unique<std::atomic<float>[]>(capacity)}
+{
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+void FrameTimeStats::Record(double frameSeconds)
+{
+    // Announce the write before making it, so Summarize can tell which slots it may have raced.
+    auto frame{mFrameCount.load(std::memory_order_relaxed)};
+    mStartedCount.store(frame + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mSamplesMs[frame & (mCapacity - 1)].store(static_cast<float>(frameSeconds * 1000.0), std::memory_order_relaxed);
+    mFrameCount.store(frame + 1, std::memory_order_release);
+}
+
+FrameTimeSummary FrameTimeStats::Summarize(std::uint32_t window) const
+{
+    auto end{mFrameCount.load(std::memory_order_acquire)};
+    auto count{static_cast<std::uint32_t>(std::min<std::uint64_t>(end, mCapacity))};
+    if (window > 0)
+    {
+        count = std::min(count, window);
+    }
+
+    std::vector<float> samples(count);
+    for (std::uint32_t i{0}; i < count; ++i)
+    {
+        samples[i] = mSamplesMs[(end - count + i) & (mCapacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    // Frame i shares its slot with frame i + capacity.  Any write seen while copying was started
+    // before the count loaded below, so the frames older than that count minus the capacity may
+    // hold a newer frame's time; they are dropped.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto started{mStartedCount.load(std::memory_order_relaxed)};
+    auto first{end - count};
+    if (started > first + mCapacity)
+    {
+        auto dropped{static_cast<std::uint32_t>(std::min<std::uint64_t>(started - mCapacity - first, count))};
+        samples.erase(samples.begin(), samples.begin() + dropped);
+    }
+
+    FrameTimeSummary summary{};
+    summary.SampleCount = static_cast<std::uint32_t>(samples.size());
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    double total{0.0};
+    for (auto sample : samples)
+    {
+        total += sample;
+        auto bin{std::lower_bound(FrameTimeHistogramEdgesMs.begin(), FrameTimeHistogramEdgesMs.end(), sample)};
+        ++summary.Histogram[std::min<std::size_t>(bin - FrameTimeHistogramEdgesMs.begin(), summary.Histogram.size() - 1)];
+    }
+
+    std::sort(samples.begin(), samples.end());
+    summary.MinMs = samples.front();
+    summary.MeanMs = static_cast<float>(total / static_cast<double>(samples.size()));
+    summary.P50Ms = Percentile(samples, 50.0F);
+    summary.P95Ms = Percentile(samples, 95.0F);
+    summary.P99Ms = Percentile(samples, 99.0F);
+    summary.MaxMs = samples.back();
+    return summary;
+}
+
+std::uint32_t FrameTimeStats::Capacity() const
+{
+    return mCapacity;
+}
+
+std::uint64_t FrameTimeStats::FrameCount() const
+{
+    return mFrameCount.load(std::memory_order_acquire);
+}
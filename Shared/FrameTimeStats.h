@@ -0,0 +1,64 @@
+#ifndef _FRAMETIMESTATS_
+#define _FRAMETIMESTATS_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Per-frame durations and their distribution.  Averages hide stutter; budgets are set on the tail
+// (p99) of the frame time, so every frame is kept, in a ring of the most recent ones.
+//
+// Record is called by one thread, the one running the frame loop.  Summarize may be called from
+// any thread at the same time, without locks: the ring slots are atomics, and a summary drops the
+// samples overwritten while it was copying them.
+namespace Gfx
+{
+// Upper edges of the histogram bins, in milliseconds: the frame budgets of 240, 144, 120, 90, 60,
+// 45, 30, 20 and 15 Hz, then everything slower.
+constexpr std::array<float, 10> FrameTimeHistogramEdgesMs{4.17F, 6.94F, 8.33F, 11.1F, 16.7F, 22.2F, 33.3F, 50.0F, 66.7F,
+                                                         1.0e30F};
+
+struct FrameTimeSummary
+{
+    std::uint32_t SampleCount{0};
+    float MinMs{0.0F};
+    float MeanMs{0.0F};
+    float P50Ms{0.0F};
+    float P95Ms{0.0F};
+    float P99Ms{0.0F};
+    float MaxMs{0.0F};
+    // Frames per bin; bin i holds the frames up to FrameTimeHistogramEdgesMs[i].
+    std::array<std::uint32_t, FrameTimeHistogramEdgesMs.size()> Histogram{};
+};
+
+class FrameTimeStats
+{
+public:
+    static constexpr std::uint32_t DefaultCapacity{1024};
+
+    // capacity must be a power of two.
+    explicit FrameTimeStats(std::uint32_t capacity = DefaultCapacity);
+    FrameTimeStats(const FrameTimeStats& rhs) = delete;
+    FrameTimeStats& operator=(const FrameTimeStats& rhs) = delete;
+
+    // Timer::DeltaTime() of the frame that just ended.
+    void Record(double frameSeconds);
+
+    // Over the latest window frames, or all the ring holds when window is 0 or larger than that.
+    [[nodiscard]] FrameTimeSummary Summarize(std::uint32_t window = 0) const;
+
+    [[nodiscard]] std::uint32_t Capacity() const;
+    // Frames recorded since construction, including those the ring no longer holds.
+    [[nodiscard]] std::uint64_t FrameCount() const;
+
+private:
+    std::uint32_t mCapacity{0};
+    std::unique_ptr<std::atomic<float>[]> mSamplesMs{};
+    std::atomic<std::uint64_t> mFrameCount{0};
+    // Frames whose slot Record has started to write.
+    std::atomic<std::uint64_t> mStartedCount{0};
+};
+} // namespace Gfx
+
+#endif // _FRAMETIMESTATS_
@@ -0,0 +1,257 @@
+#ifndef _GFXBACKEND_
+#define _GFXBACKEND_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Thin device/command-list abstraction over the subset of D3D12 the framework uses.  The real
+// backend (GfxD3D12.h) forwards straight to D3D12; the null backend (GfxNull.h) records commands
+// into memory and emulates fences and mapped memory so CPU-side frame logic can run headless.
+//
+// Handles, enums and structs mirror the D3D12 values and layouts so the D3D12 backend can pass
+// them through without translation.  This header must not include any Windows header.
+namespace Gfx
+{
+using ResourceHandle = std::uint64_t;       // ID3D12Resource* in the D3D12 backend
+using PipelineHandle = std::uint64_t;       // ID3D12PipelineState*
+using RootSignatureHandle = std::uint64_t;  // ID3D12RootSignature*
+using DescriptorHeapHandle = std::uint64_t; // ID3D12DescriptorHeap*
+using GpuAddress = std::uint64_t;           // D3D12_GPU_VIRTUAL_ADDRESS
+using GpuDescriptor = std::uint64_t;        // D3D12_GPU_DESCRIPTOR_HANDLE::ptr
+using CpuDescriptor = std::uint64_t;        // D3D12_CPU_DESCRIPTOR_HANDLE::ptr
+using QueryHeapHandle = std::uint64_t;      // ID3D12QueryHeap*
+
+constexpr ResourceHandle NullResource{0};
+
+// D3D12_COMMAND_LIST_TYPE
+enum class QueueType : std::uint32_t
+{
+    Direct = 0,
+    Compute = 2,
+    Copy = 3,
+};
+
+// D3D12_HEAP_TYPE
+enum class HeapType : std::uint32_t
+{
+    Default = 1,
+    Upload = 2,
+    Readback = 3,
+};
+
+// D3D12_QUERY_HEAP_TYPE; timestamps on copy queues need an optional feature and are not exposed.
+enum class QueryHeapType : std::uint32_t
+{
+    Timestamp = 1,
+};
+
+// D3D12_QUERY_TYPE
+enum class QueryType : std::uint32_t
+{
+    Timestamp = 2,
+};
+
+// D3D12_RESOURCE_STATES bits.
+using ResourceStates = std::uint32_t;
+
+namespace States
+{
+constexpr ResourceStates Common{0};
+constexpr ResourceStates VertexAndConstantBuffer{0x1};
+constexpr ResourceStates IndexBuffer{0x2};
+constexpr ResourceStates RenderTarget{0x4};
+constexpr ResourceStates UnorderedAccess{0x8};
+constexpr ResourceStates DepthWrite{0x10};
+constexpr ResourceStates DepthRead{0x20};
+constexpr ResourceStates NonPixelShaderResource{0x40};
+constexpr ResourceStates PixelShaderResource{0x80};
+constexpr ResourceStates IndirectArgument{0x200};
+constexpr ResourceStates CopyDest{0x400};
+constexpr ResourceStates CopySource{0x800};
+constexpr ResourceStates GenericRead{0xAC3};
+constexpr ResourceStates Present{0};
+} // namespace States
+
+constexpr std::uint32_t AllSubresources{0xffffffff};
+
+// D3D12_RESOURCE_BARRIER_FLAGS
+enum class BarrierFlags : std::uint32_t
+{
+    None = 0,
+    BeginOnly = 1,
+    EndOnly = 2,
+};
+
+// A transition barrier; the only kind the framework issues.
+struct Barrier
+{
+    ResourceHandle Resource{NullResource};
+    std::uint32_t Subresource{AllSubresources};
+    ResourceStates Before{States::Common};
+    ResourceStates After{States::Common};
+    BarrierFlags Flags{BarrierFlags::None};
+};
+
+// A queue's GPU timestamp and the CPU time sampled at the same moment, for placing GPU timestamps
+// on the CPU timeline.
+struct ClockCalibration
+{
+    std::uint64_t GpuTimestamp{0};
+    std::chrono::steady_clock::time_point CpuTime{};
+};
+
+// Layout-compatible with D3D12_VIEWPORT.
+struct Viewport
+{
+    float TopLeftX{0.0F};
+    float TopLeftY{0.0F};
+    float Width{0.0F};
+    float Height{0.0F};
+    float MinDepth{0.0F};
+    float MaxDepth{1.0F};
+};
+
+// Layout-compatible with D3D12_RECT.
+struct Rect
+{
+    std::int32_t Left{0};
+    std::int32_t Top{0};
+    std::int32_t Right{0};
+    std::int32_t Bottom{0};
+};
+
+// Layout-compatible with D3D12_VERTEX_BUFFER_VIEW.
+struct VertexBufferView
+{
+    GpuAddress BufferLocation{0};
+    std::uint32_t SizeInBytes{0};
+    std::uint32_t StrideInBytes{0};
+};
+
+// Layout-compatible with D3D12_INDEX_BUFFER_VIEW; Format is a DXGI_FORMAT.
+struct IndexBufferView
+{
+    GpuAddress BufferLocation{0};
+    std::uint32_t SizeInBytes{0};
+    std::uint32_t Format{0};
+};
+
+class ICommandAllocator
+{
+public:
+    virtual ~ICommandAllocator() = default;
+
+    virtual void Reset() = 0;
+};
+
+class ICommandList
+{
+public:
+    virtual ~ICommandList() = default;
+
+    [[nodiscard]] virtual QueueType Type() const = 0;
+
+    virtual void Reset(ICommandAllocator* allocator, PipelineHandle initialState) = 0;
+    virtual void Close() = 0;
+
+    virtual void SetPipelineState(PipelineHandle pso) = 0;
+    virtual void SetGraphicsRootSignature(RootSignatureHandle rootSignature) = 0;
+    virtual void SetDescriptorHeaps(std::uint32_t count, const DescriptorHeapHandle* heaps) = 0;
+    virtual void SetGraphicsRootDescriptorTable(std::uint32_t rootIndex, GpuDescriptor table) = 0;
+    virtual void SetGraphicsRoot32BitConstant(std::uint32_t rootIndex, std::uint32_t value, std::uint32_t offset) = 0;
+    virtual void SetGraphicsRootConstantBufferView(std::uint32_t rootIndex, GpuAddress address) = 0;
+    virtual void SetGraphicsRootShaderResourceView(std::uint32_t rootIndex, GpuAddress address) = 0;
+
+    virtual void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t count, const VertexBufferView* views) = 0;
+    virtual void IASetIndexBuffer(const IndexBufferView* view) = 0;
+    virtual void IASetPrimitiveTopology(std::uint32_t topology) = 0;
+    virtual void RSSetViewports(std::uint32_t count, const Viewport* viewports) = 0;
+    virtual void RSSetScissorRects(std::uint32_t count, const Rect* rects) = 0;
+    virtual void OMSetRenderTargets(std::uint32_t count,
+                                    const CpuDescriptor* renderTargets,
+                                    const CpuDescriptor* depthStencil) = 0;
+
+    virtual void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) = 0;
+    virtual void ClearDepthStencilView(CpuDescriptor depthStencil, std::uint32_t flags, float depth, std::uint8_t stencil) = 0;
+
+    virtual void ResourceBarrier(std::uint32_t count, const Barrier* barriers) = 0;
+
+    virtual void DrawIndexedInstanced(std::uint32_t indexCountPerInstance,
+                                      std::uint32_t instanceCount,
+                                      std::uint32_t startIndexLocation,
+                                      std::int32_t baseVertexLocation,
+                                      std::uint32_t startInstanceLocation) = 0;
+
+    virtual void CopyBufferRegion(ResourceHandle dst,
+                                  std::uint64_t dstOffset,
+                                  ResourceHandle src,
+                                  std::uint64_t srcOffset,
+                                  std::uint64_t byteSize) = 0;
+
+    // Timestamp queries are written with EndQuery alone.
+    virtual void EndQuery(QueryHeapHandle heap, QueryType type, std::uint32_t index) = 0;
+    // Writes count 64-bit results from startIndex on to dst, a buffer in the CopyDest state;
+    // dstOffset must be a multiple of 8.
+    virtual void ResolveQueryData(QueryHeapHandle heap,
+                                  QueryType type,
+                                  std::uint32_t startIndex,
+                                  std::uint32_t count,
+                                  ResourceHandle dst,
+                                  std::uint64_t dstOffset) = 0;
+};
+
+class IFence
+{
+public:
+    virtual ~IFence() = default;
+
+    [[nodiscard]] virtual std::uint64_t GetCompletedValue() const = 0;
+    // Has the OS event (a HANDLE on Windows) signaled once the fence reaches value, or right away
+    // when it already has.  Returns false when the backend cannot; callers poll instead.
+    virtual bool SetEventOnCompletion(std::uint64_t value, void* event) = 0;
+};
+
+class ICommandQueue
+{
+public:
+    virtual ~ICommandQueue() = default;
+
+    [[nodiscard]] virtual QueueType Type() const = 0;
+
+    virtual void ExecuteCommandLists(std::uint32_t count, ICommandList* const* lists) = 0;
+    virtual void Signal(IFence* fence, std::uint64_t value) = 0;
+    // GPU-side wait: later work on this queue does not start until fence reaches value.
+    virtual void Wait(IFence* fence, std::uint64_t value) = 0;
+
+    // Ticks per second of the timestamps written by lists run on this queue.
+    [[nodiscard]] virtual std::uint64_t GetTimestampFrequency() const = 0;
+    [[nodiscard]] virtual ClockCalibration GetClockCalibration() const = 0;
+};
+
+class IDevice
+{
+public:
+    virtual ~IDevice() = default;
+
+    virtual std::unique_ptr<ICommandQueue> CreateCommandQueue(QueueType type) = 0;
+    virtual std::unique_ptr<ICommandAllocator> CreateCommandAllocator(QueueType type) = 0;
+    // The list is created closed.
+    virtual std::unique_ptr<ICommandList> CreateCommandList(QueueType type, ICommandAllocator* allocator) = 0;
+    virtual std::unique_ptr<IFence> CreateFence(std::uint64_t initialValue) = 0;
+
+    // Committed buffer; the device owns it until ReleaseResource.
+    virtual ResourceHandle CreateBuffer(HeapType heapType, std::uint64_t byteSize, ResourceStates initialState) = 0;
+    virtual void ReleaseResource(ResourceHandle resource) = 0;
+
+    // The device owns it until ReleaseQueryHeap.
+    virtual QueryHeapHandle CreateQueryHeap(QueryHeapType type, std::uint32_t count) = 0;
+    virtual void ReleaseQueryHeap(QueryHeapHandle heap) = 0;
+
+    // Upload and readback buffers stay mapped for their whole lifetime.
+    virtual void* Map(ResourceHandle resource) = 0;
+    [[nodiscard]] virtual GpuAddress GetGpuAddress(ResourceHandle resource) const = 0;
+};
+} // namespace Gfx
+
+#endif // _GFXBACKEND_
@@ -0,0 +1,574 @@
+#include "GfxD3D12.h"
+
+#include "PlatformHelpers.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+using namespace Gfx;
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+static_assert(sizeof(Viewport) == sizeof(D3D12_VIEWPORT), "Viewport must match D3D12_VIEWPORT.");
+static_assert(sizeof(Rect) == sizeof(D3D12_RECT), "Rect must match D3D12_RECT.");
+static_assert(sizeof(VertexBufferView) == sizeof(D3D12_VERTEX_BUFFER_VIEW), "Layout must match D3D12.");
+static_assert(sizeof(IndexBufferView) == sizeof(D3D12_INDEX_BUFFER_VIEW), "Layout must match D3D12.");
+static_assert(sizeof(CpuDescriptor) == sizeof(D3D12_CPU_DESCRIPTOR_HANDLE), "Layout must match D3D12.");
+static_assert(States::GenericRead == D3D12_RESOURCE_STATE_GENERIC_READ, "States must match D3D12.");
+static_assert(static_cast<UINT>(QueueType::Copy) == D3D12_COMMAND_LIST_TYPE_COPY, "QueueType must match D3D12.");
+static_assert(static_cast<UINT>(QueryHeapType::Timestamp) == D3D12_QUERY_HEAP_TYPE_TIMESTAMP, "Must match D3D12.");
+static_assert(static_cast<UINT>(QueryType::Timestamp) == D3D12_QUERY_TYPE_TIMESTAMP, "QueryType must match D3D12.");
+static_assert(sizeof(BlendDesc) == sizeof(D3D12_BLEND_DESC), "Layout must match D3D12.");
+static_assert(sizeof(RasterizerDesc) == sizeof(D3D12_RASTERIZER_DESC), "Layout must match D3D12.");
+static_assert(sizeof(DepthStencilDesc) == sizeof(D3D12_DEPTH_STENCIL_DESC), "Layout must match D3D12.");
+static_assert(offsetof(DepthStencilDesc, FrontFace) == offsetof(D3D12_DEPTH_STENCIL_DESC, FrontFace),
+              "Layout must match D3D12.");
+static_assert(sizeof(InputElementDesc) == sizeof(D3D12_INPUT_ELEMENT_DESC), "Layout must match D3D12.");
+
+namespace
+{
+// Barriers are converted in fixed-size batches so the call never allocates.
+constexpr std::uint32_t BarrierBatchSize{16};
+} // namespace
+
+D3D12CommandAllocator::D3D12CommandAllocator(ComPtr<ID3D12CommandAllocator> allocator) : mAllocator{std::move(allocator)}
+{
+}
+
+void D3D12CommandAllocator::Reset()
+{
+    ThrowIfFailed(mAllocator->Reset());
+}
+
+ID3D12CommandAllocator* D3D12CommandAllocator::Native() const
+{
+    return mAllocator.Get();
+}
+
+D3D12CommandList::D3D12CommandList(ComPtr<ID3D12GraphicsCommandList> commandList) : mCommandList{std::move(commandList)}
+{
+}
+
+QueueType D3D12CommandList::Type() const
+{
+    return static_cast<QueueType>(mCommandList->GetType());
+}
+
+void D3D12CommandList::Reset(ICommandAllocator* allocator, PipelineHandle initialState)
+{
+    ThrowIfFailed(mCommandList->Reset(static_cast<D3D12CommandAllocator*>(allocator)->Native(),
+                                      reinterpret_cast<ID3D12PipelineState*>(initialState)));
+}
+
+void D3D12CommandList::Close()
+{
+    ThrowIfFailed(mCommandList->Close());
+}
+
+void D3D12CommandList::SetPipelineState(PipelineHandle pso)
+{
+    mCommandList->SetPipelineState(reinterpret_cast<ID3D12PipelineState*>(pso));
+}
+
+void D3D12CommandList::SetGraphicsRootSignature(RootSignatureHandle rootSignature)
+{
+    mCommandList->SetGraphicsRootSignature(reinterpret_cast<ID3D12RootSignature*>(rootSignature));
+}
+
+void D3D12CommandList::SetDescriptorHeaps(std::uint32_t count, const DescriptorHeapHandle* heaps)
+{
+    std::array<ID3D12DescriptorHeap*, 2> nativeHeaps{};
+    assert(count <= nativeHeaps.size() && "At most one CBV/SRV/UAV and one sampler heap can be bound.");
+    for (std::uint32_t i{0}; i < count; ++i)
+    {
+        nativeHeaps[i] = reinterpret_cast<ID3D12DescriptorHeap*>(heaps[i]);
+    }
+    mCommandList->SetDescriptorHeaps(count, nativeHeaps.data());
+}
+
+void D3D12CommandList::SetGraphicsRootDescriptorTable(std::uint32_t rootIndex, GpuDescriptor table)
+{
+    mCommandList->SetGraphicsRootDescriptorTable(rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE{table});
+}
+
+void D3D12CommandList::SetGraphicsRoot32BitConstant(std::uint32_t rootIndex, std::uint32_t value, std::uint32_t offset)
+{
+    mCommandList->SetGraphicsRoot32BitConstant(rootIndex, value, offset);
+}
+
+void D3D12CommandList::SetGraphicsRootConstantBufferView(std::uint32_t rootIndex, GpuAddress address)
+{
+    mCommandList->SetGraphicsRootConstantBufferView(rootIndex, address);
+}
+
+void D3D12CommandList::SetGraphicsRootShaderResourceView(std::uint32_t rootIndex, GpuAddress address)
+{
+    mCommandList->SetGraphicsRootShaderResourceView(rootIndex, address);
+}
+
+void D3D12CommandList::IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t count, const VertexBufferView* views)
+{
+    mCommandList->IASetVertexBuffers(startSlot, count, reinterpret_cast<const D3D12_VERTEX_BUFFER_VIEW*>(views));
+}
+
+void D3D12CommandList::IASetIndexBuffer(const IndexBufferView* view)
+{
+    mCommandList->IASetIndexBuffer(reinterpret_cast<const D3D12_INDEX_BUFFER_VIEW*>(view));
+}
+
+void D3D12CommandList::IASetPrimitiveTopology(std::uint32_t topology)
+{
+    mCommandList->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(topology));
+}
+
+void D3D12CommandList::RSSetViewports(std::uint32_t count, const Viewport* viewports)
+{
+    mCommandList->RSSetViewports(count, reinterpret_cast<const D3D12_VIEWPORT*>(viewports));
+}
+
+void D3D12CommandList::RSSetScissorRects(std::uint32_t count, const Rect* rects)
+{
+    mCommandList->RSSetScissorRects(count, reinterpret_cast<const D3D12_RECT*>(rects));
+}
+
+void D3D12CommandList::OMSetRenderTargets(std::uint32_t count,
+                                          const CpuDescriptor* renderTargets,
+                                          const CpuDescriptor* depthStencil)
+{
+    mCommandList->OMSetRenderTargets(count,
+                                     reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(renderTargets),
+                                     FALSE,
+                                     reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(depthStencil));
+}
+
+void D3D12CommandList::ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4])
+{
+    mCommandList->ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE{static_cast<SIZE_T>(renderTarget)}, color, 0, nullptr);
+}
+
+void D3D12CommandList::ClearDepthStencilView(CpuDescriptor depthStencil, std::uint32_t flags, float depth, std::uint8_t stencil)
+{
+    mCommandList->ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE{static_cast<SIZE_T>(depthStencil)},
+                                        static_cast<D3D12_CLEAR_FLAGS>(flags),
+                                        depth,
+                                        stencil,
+                                        0,
+                                        nullptr);
+}
+
+void D3D12CommandList::ResourceBarrier(std::uint32_t count, const Barrier* barriers)
+{
+    std::array<D3D12_RESOURCE_BARRIER, BarrierBatchSize> nativeBarriers{};
+    for (std::uint32_t first{0}; first < count; first += BarrierBatchSize)
+    {
+        auto batch{std::min<std::uint32_t>(BarrierBatchSize, count - first)};
+        for (std::uint32_t i{0}; i < batch; ++i)
+        {
+            const auto& barrier{barriers[first + i]};
+            nativeBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(ToD3D12(barrier.Resource),
+                                                                     static_cast<D3D12_RESOURCE_STATES>(barrier.Before),
+                                                                     static_cast<D3D12_RESOURCE_STATES>(barrier.After),
+                                                                     barrier.Subresource,
+                                                                     static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(barrier.Flags));
+        }
+        mCommandList->ResourceBarrier(batch, nativeBarriers.data());
+    }
+}
+
+void D3D12CommandList::DrawIndexedInstanced(std::uint32_t indexCountPerInstance,
+                                            std::uint32_t instanceCount,
+                                            std::uint32_t startIndexLocation,
+                                            std::int32_t baseVertexLocation,
+                                            std::uint32_t startInstanceLocation)
+{
+    mCommandList->DrawIndexedInstanced(indexCountPerInstance,
+                                       instanceCount,
+                                       startIndexLocation,
+                                       baseVertexLocation,
+                                       startInstanceLocation);
+}
+
+void D3D12CommandList::CopyBufferRegion(ResourceHandle dst,
+                                        std::uint64_t dstOffset,
+                                        ResourceHandle src,
+                                        std::uint64_t srcOffset,
+                                        std::uint64_t byteSize)
+{
+    mCommandList->CopyBufferRegion(ToD3D12(dst), dstOffset, ToD3D12(src), srcOffset, byteSize);
+}
+
+void D3D12CommandList::EndQuery(QueryHeapHandle heap, QueryType type, std::uint32_t index)
+{
+    mCommandList->EndQuery(ToD3D12QueryHeap(heap), static_cast<D3D12_QUERY_TYPE>(type), index);
+}
+
+void D3D12CommandList::ResolveQueryData(QueryHeapHandle heap,
+                                        QueryType type,
+                                        std::uint32_t startIndex,
+                                        std::uint32_t count,
+                                        ResourceHandle dst,
+                                        std::uint64_t dstOffset)
+{
+    mCommandList->ResolveQueryData(ToD3D12QueryHeap(heap),
+                                   static_cast<D3D12_QUERY_TYPE>(type),
+                                   startIndex,
+                                   count,
+                                   ToD3D12(dst),
+                                   dstOffset);
+}
+
+ID3D12GraphicsCommandList* D3D12CommandList::Native() const
+{
+    return mCommandList.Get();
+}
+
+D3D12Fence::D3D12Fence(ComPtr<ID3D12Fence> fence) : mFence{std::move(fence)}
+{
+}
+
+std::uint64_t D3D12Fence::GetCompletedValue() const
+{
+    return mFence->GetCompletedValue();
+}
+
+bool D3D12Fence::SetEventOnCompletion(std::uint64_t value, void* event)
+{
+    ThrowIfFailed(mFence->SetEventOnCompletion(value, static_cast<HANDLE>(event)));
+    return true;
+}
+
+ID3D12Fence* D3D12Fence::Native() const
+{
+    return mFence.Get();
+}
+
+D3D12CommandQueue::D3D12CommandQueue(ComPtr<ID3D12CommandQueue> queue) : mQueue{std::move(queue)}
+{
+}
+
+QueueType D3D12CommandQueue::Type() const
+{
+    return static_cast<QueueType>(mQueue->GetDesc().Type);
+}
+
+void D3D12CommandQueue::ExecuteCommandLists(std::uint32_t count, ICommandList* const* lists)
+{
+    constexpr std::uint32_t MaxLists{64};
+    std::array<ID3D12CommandList*, MaxLists> nativeLists{};
+    for (std::uint32_t first{0}; first < count; first += MaxLists)
+    {
+        auto batch{std::min<std::uint32_t>(MaxLists, count - first)};
+        for (std::uint32_t i{0}; i < batch; ++i)
+        {
+            nativeLists[i] = static_cast<D3D12CommandList*>(lists[first + i])->Native();
+        }
+        mQueue->ExecuteCommandLists(batch, nativeLists.data());
+    }
+}
+
+void D3D12CommandQueue::Signal(IFence* fence, std::uint64_t value)
+{
+    ThrowIfFailed(mQueue->Signal(static_cast<D3D12Fence*>(fence)->Native(), value));
+}
+
+void D3D12CommandQueue::Wait(IFence* fence, std::uint64_t value)
+{
+    ThrowIfFailed(mQueue->Wait(static_cast<D3D12Fence*>(fence)->Native(), value));
+}
+
+std::uint64_t D3D12CommandQueue::GetTimestampFrequency() const
+{
+    UINT64 frequency{0};
+    ThrowIfFailed(mQueue->GetTimestampFrequency(&frequency));
+    return frequency;
+}
+
+ClockCalibration D3D12CommandQueue::GetClockCalibration() const
+{
+    UINT64 gpuTimestamp{0};
+    UINT64 cpuTimestamp{0};
+    ThrowIfFailed(mQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+
+    // steady_clock need not count QueryPerformanceCounter ticks; go through the time since then.
+    LARGE_INTEGER now{};
+    LARGE_INTEGER frequency{};
+    QueryPerformanceCounter(&now);
+    auto cpuNow{std::chrono::steady_clock::now()};
+    QueryPerformanceFrequency(&frequency);
+
+    std::chrono::duration<double> sinceCalibration{static_cast<double>(now.QuadPart - static_cast<LONGLONG>(cpuTimestamp))
+                                                   / static_cast<double>(frequency.QuadPart)};
+    return ClockCalibration{gpuTimestamp,
+                            cpuNow - std::chrono::duration_cast<std::chrono::steady_clock::duration>(sinceCalibration)};
+}
+
+ID3D12CommandQueue* D3D12CommandQueue::Native() const
+{
+    return mQueue.Get();
+}
+
+D3D12Device::D3D12Device(ComPtr<ID3D12Device> device) : mDevice{std::move(device)}
+{
+}
+
+std::unique_ptr<ICommandQueue> D3D12Device::CreateCommandQueue(QueueType type)
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc{};
+    queueDesc.Type = static_cast<D3D12_COMMAND_LIST_TYPE>(type);
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+
+    ComPtr<ID3D12CommandQueue> queue{};
+    ThrowIfFailed(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+    return std::make_unique<D3D12CommandQueue>(queue);
+}
+
+std::unique_ptr<ICommandAllocator> D3D12Device::CreateCommandAllocator(QueueType type)
+{
+    ComPtr<ID3D12CommandAllocator> allocator{};
+    ThrowIfFailed(mDevice->CreateCommandAllocator(static_cast<D3D12_COMMAND_LIST_TYPE>(type), IID_PPV_ARGS(&allocator)));
+    return std::make_unique<D3D12CommandAllocator>(allocator);
+}
+
+std::unique_ptr<ICommandList> D3D12Device::CreateCommandList(QueueType type, ICommandAllocator* allocator)
+{
+    ComPtr<ID3D12GraphicsCommandList> commandList{};
+    ThrowIfFailed(mDevice->CreateCommandList(0,
+                                             static_cast<D3D12_COMMAND_LIST_TYPE>(type),
+                                             static_cast<D3D12CommandAllocator*>(allocator)->Native(),
+                                             nullptr,
+                                             IID_PPV_ARGS(&commandList)));
+    ThrowIfFailed(commandList->Close());
+    return std::make_unique<D3D12CommandList>(commandList);
+}
+
+std::unique_ptr<IFence> D3D12Device::CreateFence(std::uint64_t initialValue)
+{
+    ComPtr<ID3D12Fence> fence{};
+    ThrowIfFailed(mDevice->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+    return std::make_unique<D3D12Fence>(fence);
+}
+
+ResourceHandle D3D12Device::CreateBuffer(HeapType heapType, std::uint64_t byteSize, ResourceStates initialState)
+{
+    auto heapProperties{CD3DX12_HEAP_PROPERTIES(static_cast<D3D12_HEAP_TYPE>(heapType))};
+    auto resourceDesc{CD3DX12_RESOURCE_DESC::Buffer(byteSize)};
+
+    OwnedBuffer buffer{};
+    ThrowIfFailed(mDevice->CreateCommittedResource(&heapProperties,
+                                                   D3D12_HEAP_FLAG_NONE,
+                                                   &resourceDesc,
+                                                   static_cast<D3D12_RESOURCE_STATES>(initialState),
+                                                   nullptr,
+                                                   IID_PPV_ARGS(buffer.Resource.GetAddressOf())));
+
+    auto handle{ToHandle(buffer.Resource.Get())};
+    mBuffers.emplace(handle, std::move(buffer));
+    return handle;
+}
+
+void D3D12Device::ReleaseResource(ResourceHandle resource)
+{
+    auto it{mBuffers.find(resource)};
+    assert(it != mBuffers.end() && "Releasing a resource this device does not own.");
+
+    if (it->second.Mapped != nullptr)
+    {
+        it->second.Resource->Unmap(0, nullptr);
+    }
+    mBuffers.erase(it);
+}
+
+QueryHeapHandle D3D12Device::CreateQueryHeap(QueryHeapType type, std::uint32_t count)
+{
+    D3D12_QUERY_HEAP_DESC heapDesc{};
+    heapDesc.Type = static_cast<D3D12_QUERY_HEAP_TYPE>(type);
+    heapDesc.Count = count;
+
+    ComPtr<ID3D12QueryHeap> heap{};
+    ThrowIfFailed(mDevice->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(heap.GetAddressOf())));
+
+    auto handle{ToHandle(heap.Get())};
+    mQueryHeaps.emplace(handle, std::move(heap));
+    return handle;
+}
+
+void D3D12Device::ReleaseQueryHeap(QueryHeapHandle heap)
+{
+    [[maybe_unused]] auto erased{mQueryHeaps.erase(heap)};
+    assert(erased == 1 && "Releasing a query heap this device does not own.");
+}
+
+void* D3D12Device::Map(ResourceHandle resource)
+{
+    auto it{mBuffers.find(resource)};
+    assert(it != mBuffers.end() && "Mapping a resource this device does not own.");
+
+    if (it->second.Mapped == nullptr)
+    {
+        ThrowIfFailed(it->second.Resource->Map(0, nullptr, &it->second.Mapped));
+    }
+    return it->second.Mapped;
+}
+
+GpuAddress D3D12Device::GetGpuAddress(ResourceHandle resource) const
+{
+    return ToD3D12(resource)->GetGPUVirtualAddress();
+}
+
+ID3D12Device* D3D12Device::Native() const
+{
+    return mDevice.Get();
+}
+
+GraphicsPipelineDesc Gfx::ToGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                                 std::uint64_t rootSignatureHash)
+{
+    assert(desc.StreamOutput.NumEntries == 0 && "Stream output is not supported.");
+
+    GraphicsPipelineDesc result{};
+    result.RootSignature = ToHandle(desc.pRootSignature);
+    result.RootSignatureHash = rootSignatureHash;
+    result.VS = {desc.VS.pShaderBytecode, desc.VS.BytecodeLength};
+    result.PS = {desc.PS.pShaderBytecode, desc.PS.BytecodeLength};
+    result.DS = {desc.DS.pShaderBytecode, desc.DS.BytecodeLength};
+    result.HS = {desc.HS.pShaderBytecode, desc.HS.BytecodeLength};
+    result.GS = {desc.GS.pShaderBytecode, desc.GS.BytecodeLength};
+    std::memcpy(&result.BlendState, &desc.BlendState, sizeof(result.BlendState));
+    result.SampleMask = desc.SampleMask;
+    std::memcpy(&result.RasterizerState, &desc.RasterizerState, sizeof(result.RasterizerState));
+    std::memcpy(&result.DepthStencilState, &desc.DepthStencilState, sizeof(result.DepthStencilState));
+    result.InputElements = reinterpret_cast<const InputElementDesc*>(desc.InputLayout.pInputElementDescs);
+    result.InputElementCount = desc.InputLayout.NumElements;
+    result.IBStripCutValue = desc.IBStripCutValue;
+    result.PrimitiveTopologyType = desc.PrimitiveTopologyType;
+    result.NumRenderTargets = desc.NumRenderTargets;
+    for (UINT i{0}; i < desc.NumRenderTargets; ++i)
+    {
+        result.RTVFormats[i] = desc.RTVFormats[i];
+    }
+    result.DSVFormat = desc.DSVFormat;
+    result.SampleCount = desc.SampleDesc.Count;
+    result.SampleQuality = desc.SampleDesc.Quality;
+    result.NodeMask = desc.NodeMask;
+    result.Flags = desc.Flags;
+    return result;
+}
+
+D3D12_GRAPHICS_PIPELINE_STATE_DESC Gfx::ToD3D12(const GraphicsPipelineDesc& desc)
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC result{};
+    result.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(desc.RootSignature);
+    result.VS = {desc.VS.Data, desc.VS.ByteSize};
+    result.PS = {desc.PS.Data, desc.PS.ByteSize};
+    result.DS = {desc.DS.Data, desc.DS.ByteSize};
+    result.HS = {desc.HS.Data, desc.HS.ByteSize};
+    result.GS = {desc.GS.Data, desc.GS.ByteSize};
+    std::memcpy(&result.BlendState, &desc.BlendState, sizeof(result.BlendState));
+    result.SampleMask = desc.SampleMask;
+    std::memcpy(&result.RasterizerState, &desc.RasterizerState, sizeof(result.RasterizerState));
+    std::memcpy(&result.DepthStencilState, &desc.DepthStencilState, sizeof(result.DepthStencilState));
+    result.InputLayout = {reinterpret_cast<const D3D12_INPUT_ELEMENT_DESC*>(desc.InputElements), desc.InputElementCount};
+    result.IBStripCutValue = static_cast<D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>(desc.IBStripCutValue);
+    result.PrimitiveTopologyType = static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(desc.PrimitiveTopologyType);
+    result.NumRenderTargets = desc.NumRenderTargets;
+    for (UINT i{0}; i < desc.NumRenderTargets; ++i)
+    {
+        result.RTVFormats[i] = static_cast<DXGI_FORMAT>(desc.RTVFormats[i]);
+    }
+    result.DSVFormat = static_cast<DXGI_FORMAT>(desc.DSVFormat);
+    result.SampleDesc = {desc.SampleCount, desc.SampleQuality};
+    result.NodeMask = desc.NodeMask;
+    result.Flags = static_cast<D3D12_PIPELINE_STATE_FLAGS>(desc.Flags);
+    return result;
+}
+
+D3D12PipelineLibrary::D3D12PipelineLibrary(ComPtr<ID3D12Device> device, std::vector<std::uint8_t> blob)
+    : mDevice{std::move(device)}, mBlob{std::move(blob)}
+{
+    ComPtr<ID3D12Device1> device1{};
+    if (FAILED(mDevice.As(&device1)))
+    {
+        return;
+    }
+
+    if (!mBlob.empty() && FAILED(device1->CreatePipelineLibrary(mBlob.data(), mBlob.size(), IID_PPV_ARGS(&mLibrary))))
+    {
+        // Written by another driver or adapter; the next save replaces it.
+        mBlob.clear();
+        mIsDirty = true;
+    }
+
+    if (mLibrary == nullptr && FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+    {
+        mLibrary.Reset();
+        mIsDirty = false;
+    }
+}
+
+PipelineHandle D3D12PipelineLibrary::Load(std::uint64_t key, const GraphicsPipelineDesc& desc)
+{
+    if (mLibrary == nullptr)
+    {
+        return NullPipeline;
+    }
+
+    // Fails when the entry is missing or was stored for a different desc.
+    auto d3dDesc{ToD3D12(desc)};
+    ComPtr<ID3D12PipelineState> pso{};
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (FAILED(mLibrary->LoadGraphicsPipeline(HashName(key).c_str(), &d3dDesc, IID_PPV_ARGS(&pso))))
+    {
+        return NullPipeline;
+    }
+    return ToHandle(pso.Detach());
+}
+
+PipelineHandle D3D12PipelineLibrary::Create(std::uint64_t key, const GraphicsPipelineDesc& desc)
+{
+    auto d3dDesc{ToD3D12(desc)};
+    ComPtr<ID3D12PipelineState> pso{};
+    ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&pso)));
+
+    // Storing fails if the name is taken by a stale entry; the pipeline is still usable.
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(HashName(key).c_str(), pso.Get())))
+    {
+        mIsDirty = true;
+    }
+    return ToHandle(pso.Detach());
+}
+
+void D3D12PipelineLibrary::Release(PipelineHandle pipeline)
+{
+    ToD3D12PipelineState(pipeline)->Release();
+}
+
+bool D3D12PipelineLibrary::IsDirty() const
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    return mIsDirty;
+}
+
+std::vector<std::uint8_t> D3D12PipelineLibrary::Serialize()
+{
+    // GetSerializedSize and Serialize must see the same set of pipelines.
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (mLibrary == nullptr)
+    {
+        return {};
+    }
+
+    std::vector<std::uint8_t> blob(mLibrary->GetSerializedSize());
+    ThrowIfFailed(mLibrary->Serialize(blob.data(), blob.size()));
+    mIsDirty = false;
+    return blob;
+}
+
+bool D3D12PipelineLibrary::IsSupported() const
+{
+    return mLibrary != nullptr;
+}
@@ -0,0 +1,234 @@
+#ifndef _GFXD3D12_
+#define _GFXD3D12_
+
+#include "GfxBackend.h"
+#include "PipelineCache.h"
+
+#include <d3d12.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+// D3D12 implementation of the Gfx interfaces.  Every call forwards straight to the native object;
+// the wrappers can also adopt objects the app already created (e.g. D3DApp's queue and list).
+namespace Gfx
+{
+inline ResourceHandle ToHandle(ID3D12Resource* resource)
+{
+    return reinterpret_cast<ResourceHandle>(resource);
+}
+
+inline ID3D12Resource* ToD3D12(ResourceHandle resource)
+{
+    return reinterpret_cast<ID3D12Resource*>(resource);
+}
+
+inline PipelineHandle ToHandle(ID3D12PipelineState* pso)
+{
+    return reinterpret_cast<PipelineHandle>(pso);
+}
+
+inline ID3D12PipelineState* ToD3D12PipelineState(PipelineHandle pso)
+{
+    return reinterpret_cast<ID3D12PipelineState*>(pso);
+}
+
+inline RootSignatureHandle ToHandle(ID3D12RootSignature* rootSignature)
+{
+    return reinterpret_cast<RootSignatureHandle>(rootSignature);
+}
+
+inline DescriptorHeapHandle ToHandle(ID3D12DescriptorHeap* heap)
+{
+    return reinterpret_cast<DescriptorHeapHandle>(heap);
+}
+
+inline QueryHeapHandle ToHandle(ID3D12QueryHeap* heap)
+{
+    return reinterpret_cast<QueryHeapHandle>(heap);
+}
+
+inline ID3D12QueryHeap* ToD3D12QueryHeap(QueryHeapHandle heap)
+{
+    return reinterpret_cast<ID3D12QueryHeap*>(heap);
+}
+
+class D3D12CommandAllocator : public ICommandAllocator
+{
+public:
+    explicit D3D12CommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
+
+    void Reset() override;
+
+    [[nodiscard]] ID3D12CommandAllocator* Native() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mAllocator{};
+};
+
+class D3D12CommandList : public ICommandList
+{
+public:
+    explicit D3D12CommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList);
+
+    [[nodiscard]] QueueType Type() const override;
+
+    void Reset(ICommandAllocator* allocator, PipelineHandle initialState) override;
+    void Close() override;
+
+    void SetPipelineState(PipelineHandle pso) override;
+    void SetGraphicsRootSignature(RootSignatureHandle rootSignature) override;
+    void SetDescriptorHeaps(std::uint32_t count, const DescriptorHeapHandle* heaps) override;
+    void SetGraphicsRootDescriptorTable(std::uint32_t rootIndex, GpuDescriptor table) override;
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootIndex, std::uint32_t value, std::uint32_t offset) override;
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootIndex, GpuAddress address) override;
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootIndex, GpuAddress address) override;
+
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t count, const VertexBufferView* views) override;
+    void IASetIndexBuffer(const IndexBufferView* view) override;
+    void IASetPrimitiveTopology(std::uint32_t topology) override;
+    void RSSetViewports(std::uint32_t count, const Viewport* viewports) override;
+    void RSSetScissorRects(std::uint32_t count, const Rect* rects) override;
+    void OMSetRenderTargets(std::uint32_t count,
+                            const CpuDescriptor* renderTargets,
+                            const CpuDescriptor* depthStencil) override;
+
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override;
+    void ClearDepthStencilView(CpuDescriptor depthStencil, std::uint32_t flags, float depth, std::uint8_t stencil) override;
+
+    void ResourceBarrier(std::uint32_t count, const Barrier* barriers) override;
+
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance,
+                              std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation,
+                              std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override;
+
+    void CopyBufferRegion(ResourceHandle dst,
+                          std::uint64_t dstOffset,
+                          ResourceHandle src,
+                          std::uint64_t srcOffset,
+                          std::uint64_t byteSize) override;
+
+    void EndQuery(QueryHeapHandle heap, QueryType type, std::uint32_t index) override;
+    void ResolveQueryData(QueryHeapHandle heap,
+                          QueryType type,
+                          std::uint32_t startIndex,
+                          std::uint32_t count,
+                          ResourceHandle dst,
+                          std::uint64_t dstOffset) override;
+
+    [[nodiscard]] ID3D12GraphicsCommandList* Native() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList{};
+};
+
+class D3D12Fence : public IFence
+{
+public:
+    explicit D3D12Fence(Microsoft::WRL::ComPtr<ID3D12Fence> fence);
+
+    [[nodiscard]] std::uint64_t GetCompletedValue() const override;
+    bool SetEventOnCompletion(std::uint64_t value, void* event) override;
+
+    [[nodiscard]] ID3D12Fence* Native() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Fence> mFence{};
+};
+
+class D3D12CommandQueue : public ICommandQueue
+{
+public:
+    explicit D3D12CommandQueue(Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue);
+
+    [[nodiscard]] QueueType Type() const override;
+
+    void ExecuteCommandLists(std::uint32_t count, ICommandList* const* lists) override;
+    void Signal(IFence* fence, std::uint64_t value) override;
+    void Wait(IFence* fence, std::uint64_t value) override;
+
+    [[nodiscard]] std::uint64_t GetTimestampFrequency() const override;
+    // The CPU time is converted from QueryPerformanceCounter ticks.
+    [[nodiscard]] ClockCalibration GetClockCalibration() const override;
+
+    [[nodiscard]] ID3D12CommandQueue* Native() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> mQueue{};
+};
+
+class D3D12Device : public IDevice
+{
+public:
+    explicit D3D12Device(Microsoft::WRL::ComPtr<ID3D12Device> device);
+
+    std::unique_ptr<ICommandQueue> CreateCommandQueue(QueueType type) override;
+    std::unique_ptr<ICommandAllocator> CreateCommandAllocator(QueueType type) override;
+    std::unique_ptr<ICommandList> CreateCommandList(QueueType type, ICommandAllocator* allocator) override;
+    std::unique_ptr<IFence> CreateFence(std::uint64_t initialValue) override;
+
+    ResourceHandle CreateBuffer(HeapType heapType, std::uint64_t byteSize, ResourceStates initialState) override;
+    void ReleaseResource(ResourceHandle resource) override;
+
+    QueryHeapHandle CreateQueryHeap(QueryHeapType type, std::uint32_t count) override;
+    void ReleaseQueryHeap(QueryHeapHandle heap) override;
+
+    void* Map(ResourceHandle resource) override;
+    [[nodiscard]] GpuAddress GetGpuAddress(ResourceHandle resource) const override;
+
+    [[nodiscard]] ID3D12Device* Native() const;
+
+private:
+    struct OwnedBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource{};
+        void* Mapped{nullptr};
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12Device> mDevice{};
+    std::unordered_map<ResourceHandle, OwnedBuffer> mBuffers{};
+    std::unordered_map<QueryHeapHandle, Microsoft::WRL::ComPtr<ID3D12QueryHeap>> mQueryHeaps{};
+};
+
+// The returned descs point at the same shaders, input elements and semantic names as the source.
+// Stream output is not supported.
+[[nodiscard]] GraphicsPipelineDesc ToGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                                          std::uint64_t rootSignatureHash);
+[[nodiscard]] D3D12_GRAPHICS_PIPELINE_STATE_DESC ToD3D12(const GraphicsPipelineDesc& desc);
+
+// ID3D12PipelineLibrary with entries named by pipeline key.  Falls back to compiling every
+// pipeline when the device has no pipeline library support, and starts empty when the driver
+// rejects the blob (e.g. after a driver update).
+class D3D12PipelineLibrary : public IPipelineLibrary
+{
+public:
+    D3D12PipelineLibrary(Microsoft::WRL::ComPtr<ID3D12Device> device, std::vector<std::uint8_t> blob);
+    D3D12PipelineLibrary(const D3D12PipelineLibrary& rhs) = delete;
+    D3D12PipelineLibrary& operator=(const D3D12PipelineLibrary& rhs) = delete;
+    ~D3D12PipelineLibrary() override = default;
+
+    PipelineHandle Load(std::uint64_t key, const GraphicsPipelineDesc& desc) override;
+    PipelineHandle Create(std::uint64_t key, const GraphicsPipelineDesc& desc) override;
+    void Release(PipelineHandle pipeline) override;
+
+    [[nodiscard]] bool IsDirty() const override;
+    [[nodiscard]] std::vector<std::uint8_t> Serialize() override;
+
+    [[nodiscard]] bool IsSupported() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> mDevice{};
+    // The library reads from the blob it was created with for as long as it lives.
+    std::vector<std::uint8_t> mBlob{};
+    // Pipelines are created on worker threads while the main thread may serialize: StorePipeline,
+    // LoadGraphicsPipeline and Serialize all go through mMutex.  Compiling happens outside it.
+    mutable std::mutex mMutex{};
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary{};
+    bool mIsDirty{false};
+};
+} // namespace Gfx
+
+#endif // _GFXD3D12_
@@ -0,0 +1,677 @@
+#include "GfxNull.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr std::size_t StreamAlignment{8};
+
+constexpr std::size_t AlignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Fake GPU allocations are spaced like D3D12 placed resources.
+constexpr std::uint64_t GpuAddressAlignment{64 * 1024};
+} // namespace
+
+CommandStreamReader::CommandStreamReader(const std::uint8_t* data, std::size_t size) : mData{data}, mSize{size}
+{
+}
+
+bool CommandStreamReader::Next()
+{
+    if (mNext + sizeof(CommandHeader) > mSize)
+    {
+        mCurrent = nullptr;
+        return false;
+    }
+
+    mCurrent = reinterpret_cast<const CommandHeader*>(mData + mNext);
+    mNext += sizeof(CommandHeader) + AlignUp(mCurrent->PayloadSize, StreamAlignment);
+    return true;
+}
+
+CommandOp CommandStreamReader::Op() const
+{
+    assert(mCurrent != nullptr);
+    return mCurrent->Op;
+}
+
+const std::uint8_t* CommandStreamReader::Payload() const
+{
+    assert(mCurrent != nullptr);
+    return reinterpret_cast<const std::uint8_t*>(mCurrent) + sizeof(CommandHeader);
+}
+
+std::uint32_t CommandStreamReader::PayloadSize() const
+{
+    assert(mCurrent != nullptr);
+    return mCurrent->PayloadSize;
+}
+
+void NullCommandAllocator::Reset()
+{
+    ++mResetCount;
+}
+
+std::uint64_t NullCommandAllocator::ResetCount() const
+{
+    return mResetCount;
+}
+
+NullCommandList::NullCommandList(QueueType type) : mType{type}
+{
+}
+
+QueueType NullCommandList::Type() const
+{
+    return mType;
+}
+
+template <typename Fixed, typename T>
+void NullCommandList::Record(CommandOp op, const Fixed& fixed, const T* elements, std::uint32_t count)
+{
+    assert(!mClosed && "Recording into a closed command list.");
+
+    auto payloadSize{static_cast<std::uint32_t>(sizeof(Fixed) + sizeof(T) * count)};
+    auto offset{mStream.size()};
+    mStream.resize(offset + sizeof(CommandHeader) + AlignUp(payloadSize, StreamAlignment));
+
+    CommandHeader header{};
+    header.Op = op;
+    header.PayloadSize = payloadSize;
+    std::memcpy(&mStream[offset], &header, sizeof(header));
+    std::memcpy(&mStream[offset + sizeof(header)], &fixed, sizeof(Fixed));
+    if (count != 0)
+    {
+        std::memcpy(&mStream[offset + sizeof(header) + sizeof(Fixed)], elements, sizeof(T) * count);
+    }
+
+    ++mStats.CommandCount;
+}
+
+void NullCommandList::Reset(ICommandAllocator* allocator, PipelineHandle initialState)
+{
+    assert(mClosed && "Command lists must be closed before Reset.");
+    assert(allocator != nullptr);
+
+    mClosed = false;
+    mStream.clear();
+    mStats = {};
+
+    if (initialState != 0)
+    {
+        SetPipelineState(initialState);
+    }
+}
+
+void NullCommandList::Close()
+{
+    assert(!mClosed && "Command list is already closed.");
+    mClosed = true;
+}
+
+void NullCommandList::SetPipelineState(PipelineHandle pso)
+{
+    Record(CommandOp::SetPipelineState, NullCommands::Handle{pso});
+}
+
+void NullCommandList::SetGraphicsRootSignature(RootSignatureHandle rootSignature)
+{
+    Record(CommandOp::SetGraphicsRootSignature, NullCommands::Handle{rootSignature});
+}
+
+void NullCommandList::SetDescriptorHeaps(std::uint32_t count, const DescriptorHeapHandle* heaps)
+{
+    Record(CommandOp::SetDescriptorHeaps, NullCommands::Array{0, count}, heaps, count);
+}
+
+void NullCommandList::SetGraphicsRootDescriptorTable(std::uint32_t rootIndex, GpuDescriptor table)
+{
+    Record(CommandOp::SetGraphicsRootDescriptorTable, NullCommands::RootValue{rootIndex, 0, table});
+}
+
+void NullCommandList::SetGraphicsRoot32BitConstant(std::uint32_t rootIndex, std::uint32_t value, std::uint32_t offset)
+{
+    Record(CommandOp::SetGraphicsRoot32BitConstant, NullCommands::Root32BitConstant{rootIndex, value, offset, 0});
+}
+
+void NullCommandList::SetGraphicsRootConstantBufferView(std::uint32_t rootIndex, GpuAddress address)
+{
+    Record(CommandOp::SetGraphicsRootConstantBufferView, NullCommands::RootValue{rootIndex, 0, address});
+}
+
+void NullCommandList::SetGraphicsRootShaderResourceView(std::uint32_t rootIndex, GpuAddress address)
+{
+    Record(CommandOp::SetGraphicsRootShaderResourceView, NullCommands::RootValue{rootIndex, 0, address});
+}
+
+void NullCommandList::IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t count, const VertexBufferView* views)
+{
+    Record(CommandOp::IASetVertexBuffers, NullCommands::Array{startSlot, count}, views, count);
+}
+
+void NullCommandList::IASetIndexBuffer(const IndexBufferView* view)
+{
+    Record(CommandOp::IASetIndexBuffer, view != nullptr ? *view : IndexBufferView{});
+}
+
+void NullCommandList::IASetPrimitiveTopology(std::uint32_t topology)
+{
+    Record(CommandOp::IASetPrimitiveTopology, NullCommands::Handle{topology});
+}
+
+void NullCommandList::RSSetViewports(std::uint32_t count, const Viewport* viewports)
+{
+    Record(CommandOp::RSSetViewports, NullCommands::Array{0, count}, viewports, count);
+}
+
+void NullCommandList::RSSetScissorRects(std::uint32_t count, const Rect* rects)
+{
+    Record(CommandOp::RSSetScissorRects, NullCommands::Array{0, count}, rects, count);
+}
+
+void NullCommandList::OMSetRenderTargets(std::uint32_t count,
+                                         const CpuDescriptor* renderTargets,
+                                         const CpuDescriptor* depthStencil)
+{
+    NullCommands::RenderTargets fixed{count, depthStencil != nullptr ? 1U : 0U, depthStencil != nullptr ? *depthStencil : 0};
+    Record(CommandOp::OMSetRenderTargets, fixed, renderTargets, count);
+}
+
+void NullCommandList::ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4])
+{
+    NullCommands::ClearRenderTarget fixed{renderTarget, {color[0], color[1], color[2], color[3]}};
+    Record(CommandOp::ClearRenderTargetView, fixed);
+}
+
+void NullCommandList::ClearDepthStencilView(CpuDescriptor depthStencil, std::uint32_t flags, float depth, std::uint8_t stencil)
+{
+    Record(CommandOp::ClearDepthStencilView, NullCommands::ClearDepthStencil{depthStencil, flags, depth, stencil, 0});
+}
+
+void NullCommandList::ResourceBarrier(std::uint32_t count, const Barrier* barriers)
+{
+    Record(CommandOp::ResourceBarrier, NullCommands::Array{0, count}, barriers, count);
+
+    ++mStats.BarrierCalls;
+    mStats.BarrierCount += count;
+}
+
+void NullCommandList::DrawIndexedInstanced(std::uint32_t indexCountPerInstance,
+                                           std::uint32_t instanceCount,
+                                           std::uint32_t startIndexLocation,
+                                           std::int32_t baseVertexLocation,
+                                           std::uint32_t startInstanceLocation)
+{
+    NullCommands::Draw fixed{indexCountPerInstance,
+                             instanceCount,
+                             startIndexLocation,
+                             baseVertexLocation,
+                             startInstanceLocation,
+                             0};
+    Record(CommandOp::DrawIndexedInstanced, fixed);
+
+    ++mStats.DrawCount;
+    mStats.IndexCount += static_cast<std::uint64_t>(indexCountPerInstance) * instanceCount;
+}
+
+void NullCommandList::CopyBufferRegion(ResourceHandle dst,
+                                       std::uint64_t dstOffset,
+                                       ResourceHandle src,
+                                       std::uint64_t srcOffset,
+                                       std::uint64_t byteSize)
+{
+    Record(CommandOp::CopyBufferRegion, NullCommands::Copy{dst, dstOffset, src, srcOffset, byteSize});
+
+    ++mStats.CopyCount;
+}
+
+void NullCommandList::EndQuery(QueryHeapHandle heap, QueryType type, std::uint32_t index)
+{
+    Record(CommandOp::EndQuery, NullCommands::Query{heap, type, index});
+}
+
+void NullCommandList::ResolveQueryData(QueryHeapHandle heap,
+                                       QueryType type,
+                                       std::uint32_t startIndex,
+                                       std::uint32_t count,
+                                       ResourceHandle dst,
+                                       std::uint64_t dstOffset)
+{
+    Record(CommandOp::ResolveQueryData, NullCommands::ResolveQuery{heap, type, startIndex, count, 0, dst, dstOffset});
+}
+
+bool NullCommandList::IsClosed() const
+{
+    return mClosed;
+}
+
+CommandStreamReader NullCommandList::Commands() const
+{
+    return CommandStreamReader{mStream.data(), mStream.size()};
+}
+
+const std::uint8_t* NullCommandList::StreamData() const
+{
+    return mStream.data();
+}
+
+std::size_t NullCommandList::StreamByteSize() const
+{
+    return mStream.size();
+}
+
+const CommandListStats& NullCommandList::Stats() const
+{
+    return mStats;
+}
+
+NullFence::NullFence(std::uint64_t initialValue) : mCompletedValue{initialValue}
+{
+}
+
+std::uint64_t NullFence::GetCompletedValue() const
+{
+    return mCompletedValue;
+}
+
+bool NullFence::SetEventOnCompletion(std::uint64_t /*value*/, void* /*event*/)
+{
+    return false;
+}
+
+void NullFence::Complete(std::uint64_t value)
+{
+    mCompletedValue = value;
+}
+
+NullCommandQueue::NullCommandQueue(NullDevice& device, QueueType type) : mDevice{device}, mType{type}
+{
+    mDevice.mQueues.push_back(this);
+}
+
+NullCommandQueue::~NullCommandQueue()
+{
+    auto& queues{mDevice.mQueues};
+    queues.erase(std::remove(queues.begin(), queues.end(), this), queues.end());
+}
+
+QueueType NullCommandQueue::Type() const
+{
+    return mType;
+}
+
+void NullCommandQueue::ExecuteCommandLists(std::uint32_t count, ICommandList* const* lists)
+{
+    for (std::uint32_t i{0}; i < count; ++i)
+    {
+        const auto* list{static_cast<const NullCommandList*>(lists[i])};
+        assert(list->IsClosed() && "Executing a command list that is still open.");
+
+        if (mPendingWaits == 0 && mPendingLists == 0)
+        {
+            Execute(list->Commands());
+        }
+        else
+        {
+            const auto* stream{list->StreamData()};
+            mPending.push_back({PendingKind::Execute, nullptr, 0, {stream, stream + list->StreamByteSize()}});
+            ++mPendingLists;
+        }
+
+        if (mSubmitObserver)
+        {
+            mSubmitObserver(*list);
+        }
+        ++mSubmittedListCount;
+    }
+}
+
+void NullCommandQueue::Execute(CommandStreamReader commands)
+{
+    while (commands.Next())
+    {
+        mTimestamp += mTimestampStep;
+        if (commands.Op() == CommandOp::CopyBufferRegion)
+        {
+            const auto& copy{commands.As<NullCommands::Copy>()};
+            auto* dst{static_cast<std::uint8_t*>(mDevice.Map(copy.Dst))};
+            const auto* src{static_cast<const std::uint8_t*>(mDevice.Map(copy.Src))};
+            assert(copy.DstOffset + copy.ByteSize <= mDevice.BufferByteSize(copy.Dst));
+            assert(copy.SrcOffset + copy.ByteSize <= mDevice.BufferByteSize(copy.Src));
+            std::memcpy(dst + copy.DstOffset, src + copy.SrcOffset, copy.ByteSize);
+        }
+        else if (commands.Op() == CommandOp::EndQuery)
+        {
+            const auto& query{commands.As<NullCommands::Query>()};
+            auto& results{mDevice.mQueryHeaps.at(query.Heap)};
+            assert(query.Index < results.size());
+            results[query.Index] = mTimestamp;
+        }
+        else if (commands.Op() == CommandOp::ResolveQueryData)
+        {
+            const auto& resolve{commands.As<NullCommands::ResolveQuery>()};
+            const auto& results{mDevice.mQueryHeaps.at(resolve.Heap)};
+            auto byteSize{sizeof(std::uint64_t) * resolve.Count};
+            assert(resolve.StartIndex + resolve.Count <= results.size());
+            assert(resolve.DstOffset % sizeof(std::uint64_t) == 0);
+            assert(resolve.DstOffset + byteSize <= mDevice.BufferByteSize(resolve.Dst));
+            auto* dst{static_cast<std::uint8_t*>(mDevice.Map(resolve.Dst))};
+            std::memcpy(dst + resolve.DstOffset, results.data() + resolve.StartIndex, byteSize);
+        }
+    }
+}
+
+void NullCommandQueue::Signal(IFence* fence, std::uint64_t value)
+{
+    mPending.push_back({PendingKind::Signal, static_cast<NullFence*>(fence), value, {}});
+    ++mPendingSignals;
+    mDevice.Pump();
+}
+
+void NullCommandQueue::Wait(IFence* fence, std::uint64_t value)
+{
+    mPending.push_back({PendingKind::Wait, static_cast<NullFence*>(fence), value, {}});
+    ++mPendingWaits;
+    mDevice.Pump();
+}
+
+std::uint64_t NullCommandQueue::GetTimestampFrequency() const
+{
+    return NullTimestampFrequency;
+}
+
+ClockCalibration NullCommandQueue::GetClockCalibration() const
+{
+    return ClockCalibration{mTimestamp, std::chrono::steady_clock::now()};
+}
+
+void NullCommandQueue::SetTimestampStep(std::uint64_t ticks)
+{
+    mTimestampStep = ticks;
+}
+
+void NullCommandQueue::AdvanceTimestamp(std::uint64_t ticks)
+{
+    mTimestamp += ticks;
+}
+
+std::uint64_t NullCommandQueue::Timestamp() const
+{
+    return mTimestamp;
+}
+
+void NullCommandQueue::SetLatency(std::uint32_t signals)
+{
+    mLatency = signals;
+    mDevice.Pump();
+}
+
+void NullCommandQueue::Advance(std::uint32_t signals)
+{
+    mForcedSignals = signals;
+    mDevice.Pump();
+    mForcedSignals = 0;
+}
+
+void NullCommandQueue::Drain()
+{
+    mDraining = true;
+    mDevice.Pump();
+    mDraining = false;
+}
+
+void NullCommandQueue::SetSubmitObserver(std::function<void(const NullCommandList&)> observer)
+{
+    mSubmitObserver = std::move(observer);
+}
+
+std::uint64_t NullCommandQueue::SubmittedListCount() const
+{
+    return mSubmittedListCount;
+}
+
+std::size_t NullCommandQueue::PendingOperationCount() const
+{
+    return mPending.size();
+}
+
+bool NullCommandQueue::ProcessPending()
+{
+    bool progress{false};
+    while (!mPending.empty())
+    {
+        const auto& op{mPending.front()};
+        if (op.Kind == PendingKind::Wait)
+        {
+            if (op.Fence->GetCompletedValue() < op.Value)
+            {
+                break;
+            }
+            --mPendingWaits;
+        }
+        else if (op.Kind == PendingKind::Execute)
+        {
+            Execute(CommandStreamReader{op.Commands.data(), op.Commands.size()});
+            --mPendingLists;
+        }
+        else
+        {
+            bool forced{mDraining || mForcedSignals > 0};
+            if (!forced && mPendingSignals <= mLatency)
+            {
+                break;
+            }
+
+            if (mForcedSignals > 0)
+            {
+                --mForcedSignals;
+            }
+            op.Fence->Complete(op.Value);
+            --mPendingSignals;
+        }
+
+        mPending.pop_front();
+        progress = true;
+    }
+    return progress;
+}
+
+std::unique_ptr<ICommandQueue> NullDevice::CreateCommandQueue(QueueType type)
+{
+    return std::make_unique<NullCommandQueue>(*this, type);
+}
+
+std::unique_ptr<ICommandAllocator> NullDevice::CreateCommandAllocator(QueueType /*type*/)
+{
+    return std::make_unique<NullCommandAllocator>();
+}
+
+std::unique_ptr<ICommandList> NullDevice::CreateCommandList(QueueType type, ICommandAllocator* /*allocator*/)
+{
+    return std::make_unique<NullCommandList>(type);
+}
+
+std::unique_ptr<IFence> NullDevice::CreateFence(std::uint64_t initialValue)
+{
+    return std::make_unique<NullFence>(initialValue);
+}
+
+ResourceHandle NullDevice::CreateBuffer(HeapType heapType, std::uint64_t byteSize, ResourceStates /*initialState*/)
+{
+    Buffer buffer{};
+    buffer.Memory.resize(static_cast<std::size_t>(byteSize));
+    buffer.Address = mNextGpuAddress;
+    buffer.Heap = heapType;
+
+    mNextGpuAddress += (std::max<std::uint64_t>(byteSize, 1) + GpuAddressAlignment - 1) & ~(GpuAddressAlignment - 1);
+    mLiveBytes += byteSize;
+
+    auto handle{mNextHandle++};
+    mBuffers.emplace(handle, std::move(buffer));
+    return handle;
+}
+
+void NullDevice::ReleaseResource(ResourceHandle resource)
+{
+    auto it{mBuffers.find(resource)};
+    assert(it != mBuffers.end() && "Releasing an unknown resource.");
+
+    mLiveBytes -= it->second.Memory.size();
+    mBuffers.erase(it);
+}
+
+QueryHeapHandle NullDevice::CreateQueryHeap(QueryHeapType /*type*/, std::uint32_t count)
+{
+    auto handle{mNextHandle++};
+    mQueryHeaps.emplace(handle, std::vector<std::uint64_t>(count));
+    return handle;
+}
+
+void NullDevice::ReleaseQueryHeap(QueryHeapHandle heap)
+{
+    [[maybe_unused]] auto erased{mQueryHeaps.erase(heap)};
+    assert(erased == 1 && "Releasing an unknown query heap.");
+}
+
+void* NullDevice::Map(ResourceHandle resource)
+{
+    auto it{mBuffers.find(resource)};
+    assert(it != mBuffers.end() && "Mapping an unknown resource.");
+    return it->second.Memory.data();
+}
+
+GpuAddress NullDevice::GetGpuAddress(ResourceHandle resource) const
+{
+    auto it{mBuffers.find(resource)};
+    assert(it != mBuffers.end() && "Querying an unknown resource.");
+    return it->second.Address;
+}
+
+std::uint64_t NullDevice::BufferByteSize(ResourceHandle resource) const
+{
+    auto it{mBuffers.find(resource)};
+    return it != mBuffers.end() ? it->second.Memory.size() : 0;
+}
+
+std::size_t NullDevice::LiveResourceCount() const
+{
+    return mBuffers.size();
+}
+
+std::uint64_t NullDevice::LiveResourceBytes() const
+{
+    return mLiveBytes;
+}
+
+std::size_t NullDevice::LiveQueryHeapCount() const
+{
+    return mQueryHeaps.size();
+}
+
+void NullDevice::Pump()
+{
+    // Guard against re-entry from fence completions triggering further queue processing.
+    if (mPumping)
+    {
+        return;
+    }
+    mPumping = true;
+
+    bool progress{true};
+    while (progress)
+    {
+        progress = false;
+        for (auto* queue : mQueues)
+        {
+            progress = queue->ProcessPending() || progress;
+        }
+    }
+
+    mPumping = false;
+}
+
+NullPipelineLibrary::NullPipelineLibrary(const std::vector<std::uint8_t>& blob)
+{
+    if (blob.size() % sizeof(std::uint64_t) != 0)
+    {
+        return;
+    }
+
+    for (std::size_t offset{0}; offset < blob.size(); offset += sizeof(std::uint64_t))
+    {
+        std::uint64_t key{};
+        std::memcpy(&key, blob.data() + offset, sizeof(key));
+        mKeys.insert(key);
+    }
+}
+
+PipelineHandle NullPipelineLibrary::Load(std::uint64_t key, const GraphicsPipelineDesc& /*desc*/)
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (mKeys.find(key) == mKeys.end())
+    {
+        return NullPipeline;
+    }
+
+    auto pipeline{mNextHandle++};
+    mLive.insert(pipeline);
+    return pipeline;
+}
+
+PipelineHandle NullPipelineLibrary::Create(std::uint64_t key, const GraphicsPipelineDesc& /*desc*/)
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    mIsDirty = mKeys.insert(key).second || mIsDirty;
+
+    auto pipeline{mNextHandle++};
+    mLive.insert(pipeline);
+    return pipeline;
+}
+
+void NullPipelineLibrary::Release(PipelineHandle pipeline)
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    [[maybe_unused]] auto erased{mLive.erase(pipeline)};
+    assert(erased == 1 && "Releasing a pipeline the library did not hand out.");
+}
+
+bool NullPipelineLibrary::IsDirty() const
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    return mIsDirty;
+}
+
+std::vector<std::uint8_t> NullPipelineLibrary::Serialize()
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    std::vector<std::uint64_t> keys(mKeys.begin(), mKeys.end());
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<std::uint8_t> blob(keys.size() * sizeof(std::uint64_t));
+    if (!keys.empty())
+    {
+        std::memcpy(blob.data(), keys.data(), blob.size());
+    }
+    mIsDirty = false;
+    return blob;
+}
+
+std::size_t NullPipelineLibrary::StoredCount() const
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    return mKeys.size();
+}
+
+std::size_t NullPipelineLibrary::LivePipelineCount() const
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    return mLive.size();
+}
@@ -0,0 +1,458 @@
+#ifndef _GFXNULL_
+#define _GFXNULL_
+
+#include "GfxBackend.h"
+#include "PipelineCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Null backend: no GPU, no Windows.  Command lists record into a compact in-memory stream that
+// can be decoded with CommandStreamReader, queues emulate GPU progress on a configurable number
+// of outstanding signals, and buffers are plain host memory with fake GPU addresses.  Timestamps
+// come from a per-queue clock that every executed command advances by a fixed step.
+//
+// The emulation is single-threaded: record lists on any thread, but drive queues from one thread.
+namespace Gfx
+{
+// Ticks per second of null queue timestamps: nanoseconds.
+constexpr std::uint64_t NullTimestampFrequency{1000000000};
+
+enum class CommandOp : std::uint8_t
+{
+    SetPipelineState,
+    SetGraphicsRootSignature,
+    SetDescriptorHeaps,
+    SetGraphicsRootDescriptorTable,
+    SetGraphicsRoot32BitConstant,
+    SetGraphicsRootConstantBufferView,
+    SetGraphicsRootShaderResourceView,
+    IASetVertexBuffers,
+    IASetIndexBuffer,
+    IASetPrimitiveTopology,
+    RSSetViewports,
+    RSSetScissorRects,
+    OMSetRenderTargets,
+    ClearRenderTargetView,
+    ClearDepthStencilView,
+    ResourceBarrier,
+    DrawIndexedInstanced,
+    CopyBufferRegion,
+    EndQuery,
+    ResolveQueryData,
+};
+
+// Recorded payloads.  Commands taking an array store a fixed part followed by Count elements.
+namespace NullCommands
+{
+struct Handle
+{
+    std::uint64_t Value;
+};
+
+struct RootValue
+{
+    std::uint32_t RootIndex;
+    std::uint32_t Reserved;
+    std::uint64_t Value;
+};
+
+struct Root32BitConstant
+{
+    std::uint32_t RootIndex;
+    std::uint32_t Value;
+    std::uint32_t Offset;
+    std::uint32_t Reserved;
+};
+
+struct Array
+{
+    std::uint32_t StartSlot;
+    std::uint32_t Count;
+};
+
+struct RenderTargets
+{
+    std::uint32_t Count;
+    std::uint32_t HasDepthStencil;
+    CpuDescriptor DepthStencil;
+};
+
+struct ClearRenderTarget
+{
+    CpuDescriptor RenderTarget;
+    float Color[4];
+};
+
+struct ClearDepthStencil
+{
+    CpuDescriptor DepthStencil;
+    std::uint32_t Flags;
+    float Depth;
+    std::uint32_t Stencil;
+    std::uint32_t Reserved;
+};
+
+struct Draw
+{
+    std::uint32_t IndexCountPerInstance;
+    std::uint32_t InstanceCount;
+    std::uint32_t StartIndexLocation;
+    std::int32_t BaseVertexLocation;
+    std::uint32_t StartInstanceLocation;
+    std::uint32_t Reserved;
+};
+
+struct Copy
+{
+    ResourceHandle Dst;
+    std::uint64_t DstOffset;
+    ResourceHandle Src;
+    std::uint64_t SrcOffset;
+    std::uint64_t ByteSize;
+};
+
+struct Query
+{
+    QueryHeapHandle Heap;
+    QueryType Type;
+    std::uint32_t Index;
+};
+
+struct ResolveQuery
+{
+    QueryHeapHandle Heap;
+    QueryType Type;
+    std::uint32_t StartIndex;
+    std::uint32_t Count;
+    std::uint32_t Reserved;
+    ResourceHandle Dst;
+    std::uint64_t DstOffset;
+};
+} // namespace NullCommands
+
+// Each command is a header followed by its payload, padded to 8 bytes.
+struct CommandHeader
+{
+    CommandOp Op;
+    std::uint8_t Reserved[3];
+    std::uint32_t PayloadSize;
+};
+
+class CommandStreamReader
+{
+public:
+    CommandStreamReader(const std::uint8_t* data, std::size_t size);
+
+    // Advances to the next command; returns false at the end of the stream.
+    bool Next();
+
+    [[nodiscard]] CommandOp Op() const;
+    [[nodiscard]] const std::uint8_t* Payload() const;
+    [[nodiscard]] std::uint32_t PayloadSize() const;
+
+    // Fixed part of the payload.
+    template <typename T>
+    [[nodiscard]] const T& As() const
+    {
+        return *reinterpret_cast<const T*>(Payload());
+    }
+
+    // Array following a fixed part of type Fixed.
+    template <typename Fixed, typename T>
+    [[nodiscard]] const T* Elements() const
+    {
+        return reinterpret_cast<const T*>(Payload() + sizeof(Fixed));
+    }
+
+private:
+    const std::uint8_t* mData{nullptr};
+    std::size_t mSize{0};
+    std::size_t mNext{0};
+    const CommandHeader* mCurrent{nullptr};
+};
+
+// Counters accumulated while recording, for validating and profiling command streams.
+struct CommandListStats
+{
+    std::uint32_t CommandCount{0};
+    std::uint32_t DrawCount{0};
+    std::uint64_t IndexCount{0};
+    std::uint32_t BarrierCalls{0};
+    std::uint32_t BarrierCount{0};
+    std::uint32_t CopyCount{0};
+};
+
+class NullCommandAllocator : public ICommandAllocator
+{
+public:
+    void Reset() override;
+
+    [[nodiscard]] std::uint64_t ResetCount() const;
+
+private:
+    std::uint64_t mResetCount{0};
+};
+
+class NullCommandList : public ICommandList
+{
+public:
+    explicit NullCommandList(QueueType type);
+
+    [[nodiscard]] QueueType Type() const override;
+
+    void Reset(ICommandAllocator* allocator, PipelineHandle initialState) override;
+    void Close() override;
+
+    void SetPipelineState(PipelineHandle pso) override;
+    void SetGraphicsRootSignature(RootSignatureHandle rootSignature) override;
+    void SetDescriptorHeaps(std::uint32_t count, const DescriptorHeapHandle* heaps) override;
+    void SetGraphicsRootDescriptorTable(std::uint32_t rootIndex, GpuDescriptor table) override;
+    void SetGraphicsRoot32BitConstant(std::uint32_t rootIndex, std::uint32_t value, std::uint32_t offset) override;
+    void SetGraphicsRootConstantBufferView(std::uint32_t rootIndex, GpuAddress address) override;
+    void SetGraphicsRootShaderResourceView(std::uint32_t rootIndex, GpuAddress address) override;
+
+    void IASetVertexBuffers(std::uint32_t startSlot, std::uint32_t count, const VertexBufferView* views) override;
+    void IASetIndexBuffer(const IndexBufferView* view) override;
+    void IASetPrimitiveTopology(std::uint32_t topology) override;
+    void RSSetViewports(std::uint32_t count, const Viewport* viewports) override;
+    void RSSetScissorRects(std::uint32_t count, const Rect* rects) override;
+    void OMSetRenderTargets(std::uint32_t count,
+                            const CpuDescriptor* renderTargets,
+                            const CpuDescriptor* depthStencil) override;
+
+    void ClearRenderTargetView(CpuDescriptor renderTarget, const float color[4]) override;
+    void ClearDepthStencilView(CpuDescriptor depthStencil, std::uint32_t flags, float depth, std::uint8_t stencil) override;
+
+    void ResourceBarrier(std::uint32_t count, const Barrier* barriers) override;
+
+    void DrawIndexedInstanced(std::uint32_t indexCountPerInstance,
+                              std::uint32_t instanceCount,
+                              std::uint32_t startIndexLocation,
+                              std::int32_t baseVertexLocation,
+                              std::uint32_t startInstanceLocation) override;
+
+    void CopyBufferRegion(ResourceHandle dst,
+                          std::uint64_t dstOffset,
+                          ResourceHandle src,
+                          std::uint64_t srcOffset,
+                          std::uint64_t byteSize) override;
+
+    void EndQuery(QueryHeapHandle heap, QueryType type, std::uint32_t index) override;
+    void ResolveQueryData(QueryHeapHandle heap,
+                          QueryType type,
+                          std::uint32_t startIndex,
+                          std::uint32_t count,
+                          ResourceHandle dst,
+                          std::uint64_t dstOffset) override;
+
+    [[nodiscard]] bool IsClosed() const;
+    [[nodiscard]] CommandStreamReader Commands() const;
+    [[nodiscard]] const std::uint8_t* StreamData() const;
+    [[nodiscard]] std::size_t StreamByteSize() const;
+    [[nodiscard]] const CommandListStats& Stats() const;
+
+private:
+    // Appends a command made of a fixed part and an optional trailing array.
+    template <typename Fixed, typename T = std::uint8_t>
+    void Record(CommandOp op, const Fixed& fixed, const T* elements = nullptr, std::uint32_t count = 0);
+
+    QueueType mType{QueueType::Direct};
+    bool mClosed{true};
+
+    // The stream keeps its capacity across Reset, so steady-state recording does not allocate.
+    std::vector<std::uint8_t> mStream{};
+    CommandListStats mStats{};
+};
+
+class NullFence : public IFence
+{
+public:
+    explicit NullFence(std::uint64_t initialValue);
+
+    [[nodiscard]] std::uint64_t GetCompletedValue() const override;
+    // No GPU thread to signal from; always false.
+    bool SetEventOnCompletion(std::uint64_t value, void* event) override;
+
+    // Emulated GPU write of the fence value.
+    void Complete(std::uint64_t value);
+
+private:
+    std::uint64_t mCompletedValue{0};
+};
+
+class NullDevice;
+
+class NullCommandQueue : public ICommandQueue
+{
+public:
+    NullCommandQueue(NullDevice& device, QueueType type);
+    NullCommandQueue(const NullCommandQueue& rhs) = delete;
+    NullCommandQueue& operator=(const NullCommandQueue& rhs) = delete;
+    ~NullCommandQueue() override;
+
+    [[nodiscard]] QueueType Type() const override;
+
+    // Copies, timestamp queries and their resolves are applied to host memory at submission, or,
+    // behind a Wait on this queue that is not met yet, in order once it is.  Lists run later are
+    // copied, so they may be reset right away; the submit observer still sees them at submission.
+    void ExecuteCommandLists(std::uint32_t count, ICommandList* const* lists) override;
+    void Signal(IFence* fence, std::uint64_t value) override;
+    void Wait(IFence* fence, std::uint64_t value) override;
+
+    // NullTimestampFrequency.
+    [[nodiscard]] std::uint64_t GetTimestampFrequency() const override;
+    // The current timestamp and steady_clock::now().
+    [[nodiscard]] ClockCalibration GetClockCalibration() const override;
+
+    // Ticks each executed command adds to the timestamp clock; 1000 by default.
+    void SetTimestampStep(std::uint64_t ticks);
+    // Moves the clock on, as if the GPU had been busy or idle between submissions.
+    void AdvanceTimestamp(std::uint64_t ticks);
+    [[nodiscard]] std::uint64_t Timestamp() const;
+
+    // Emulated GPU lag: the newest `signals` Signal() calls stay pending until Advance().
+    // The default of 0 completes every signal as soon as nothing ahead of it is waiting.
+    void SetLatency(std::uint32_t signals);
+    // Forces the oldest pending signals to complete, as if the GPU caught up.
+    void Advance(std::uint32_t signals = 1);
+    // Completes everything that is not blocked by a Wait on another queue.
+    void Drain();
+
+    // Called for every submitted list, e.g. to validate command streams.
+    void SetSubmitObserver(std::function<void(const NullCommandList&)> observer);
+
+    [[nodiscard]] std::uint64_t SubmittedListCount() const;
+    [[nodiscard]] std::size_t PendingOperationCount() const;
+
+    // Processes pending operations; returns true if any completed.  Used by NullDevice::Pump.
+    bool ProcessPending();
+
+private:
+    enum class PendingKind
+    {
+        Signal,
+        Wait,
+        Execute,
+    };
+
+    struct PendingOperation
+    {
+        PendingKind Kind{PendingKind::Signal};
+        NullFence* Fence{nullptr};
+        std::uint64_t Value{0};
+        // Execute: the list's command stream.
+        std::vector<std::uint8_t> Commands{};
+    };
+
+    void Execute(CommandStreamReader commands);
+
+    NullDevice& mDevice;
+    QueueType mType{QueueType::Direct};
+
+    std::deque<PendingOperation> mPending{};
+    std::uint32_t mPendingSignals{0};
+    std::uint32_t mPendingWaits{0};
+    // Lists held behind a Wait; later lists queue behind them to keep submission order.
+    std::uint32_t mPendingLists{0};
+    std::uint32_t mLatency{0};
+    std::uint32_t mForcedSignals{0};
+    bool mDraining{false};
+
+    std::uint64_t mTimestamp{0};
+    std::uint64_t mTimestampStep{1000};
+
+    std::uint64_t mSubmittedListCount{0};
+    std::function<void(const NullCommandList&)> mSubmitObserver{};
+};
+
+class NullDevice : public IDevice
+{
+public:
+    NullDevice() = default;
+    NullDevice(const NullDevice& rhs) = delete;
+    NullDevice& operator=(const NullDevice& rhs) = delete;
+    ~NullDevice() override = default;
+
+    std::unique_ptr<ICommandQueue> CreateCommandQueue(QueueType type) override;
+    std::unique_ptr<ICommandAllocator> CreateCommandAllocator(QueueType type) override;
+    std::unique_ptr<ICommandList> CreateCommandList(QueueType type, ICommandAllocator* allocator) override;
+    std::unique_ptr<IFence> CreateFence(std::uint64_t initialValue) override;
+
+    ResourceHandle CreateBuffer(HeapType heapType, std::uint64_t byteSize, ResourceStates initialState) override;
+    void ReleaseResource(ResourceHandle resource) override;
+
+    QueryHeapHandle CreateQueryHeap(QueryHeapType type, std::uint32_t count) override;
+    void ReleaseQueryHeap(QueryHeapHandle heap) override;
+
+    void* Map(ResourceHandle resource) override;
+    [[nodiscard]] GpuAddress GetGpuAddress(ResourceHandle resource) const override;
+
+    [[nodiscard]] std::uint64_t BufferByteSize(ResourceHandle resource) const;
+    [[nodiscard]] std::size_t LiveResourceCount() const;
+    [[nodiscard]] std::uint64_t LiveResourceBytes() const;
+    [[nodiscard]] std::size_t LiveQueryHeapCount() const;
+
+    // Re-runs every queue until none can make progress, so cross-queue waits resolve.
+    void Pump();
+
+private:
+    friend class NullCommandQueue;
+
+    struct Buffer
+    {
+        std::vector<std::uint8_t> Memory{};
+        GpuAddress Address{0};
+        HeapType Heap{HeapType::Default};
+    };
+
+    std::unordered_map<ResourceHandle, Buffer> mBuffers{};
+    // Query results, as the GPU would hold them.  Handles share one space with the buffers'.
+    std::unordered_map<QueryHeapHandle, std::vector<std::uint64_t>> mQueryHeaps{};
+    ResourceHandle mNextHandle{1};
+    GpuAddress mNextGpuAddress{0x100000000ULL};
+    std::uint64_t mLiveBytes{0};
+
+    std::vector<NullCommandQueue*> mQueues{};
+    bool mPumping{false};
+};
+
+// Pipeline library without a compiler.  Pipelines are fake handles and the serialized blob is the
+// list of stored keys, so cache hits and misses across runs can be checked headless.  Thread-safe,
+// like the D3D12 library, so asynchronous pipeline creation can run on it.
+class NullPipelineLibrary : public IPipelineLibrary
+{
+public:
+    // An empty or malformed blob starts an empty library.
+    explicit NullPipelineLibrary(const std::vector<std::uint8_t>& blob = {});
+    NullPipelineLibrary(const NullPipelineLibrary& rhs) = delete;
+    NullPipelineLibrary& operator=(const NullPipelineLibrary& rhs) = delete;
+    ~NullPipelineLibrary() override = default;
+
+    PipelineHandle Load(std::uint64_t key, const GraphicsPipelineDesc& desc) override;
+    PipelineHandle Create(std::uint64_t key, const GraphicsPipelineDesc& desc) override;
+    void Release(PipelineHandle pipeline) override;
+
+    [[nodiscard]] bool IsDirty() const override;
+    [[nodiscard]] std::vector<std::uint8_t> Serialize() override;
+
+    [[nodiscard]] std::size_t StoredCount() const;
+    [[nodiscard]] std::size_t LivePipelineCount() const;
+
+private:
+    mutable std::mutex mMutex{};
+    std::unordered_set<std::uint64_t> mKeys{};
+    std::unordered_set<PipelineHandle> mLive{};
+    PipelineHandle mNextHandle{1};
+    bool mIsDirty{false};
+};
+} // namespace Gfx
+
+#endif // _GFXNULL_
@@ -0,0 +1,202 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+using namespace Gfx;
+
+GpuProfiler::GpuProfiler(IDevice& device, ICommandQueue& queue, std::uint32_t frameCount, std::uint32_t maxScopes) :
+    mDevice{device},
+    mQueue{queue},
+    mFrameCount{frameCount},
+    mMaxScopes{maxScopes},
+    mTicksPerMs{static_cast<double>(queue.GetTimestampFrequency()) / 1000.0},
+    mTrack{Profiling::CreateTrack("GPU")},
+    mFrames{std::make_unique<Frame[]>(frameCount)}
+{
+    assert(frameCount > 0 && maxScopes > 0);
+    assert(queue.Type() != QueueType::Copy && "Copy queue timestamps are not supported.");
+
+    // Two timestamps per scope.
+    for (std::uint32_t i{0}; i < frameCount; ++i)
+    {
+        auto& frame{mFrames[i]};
+        frame.Heap = device.CreateQueryHeap(QueryHeapType::Timestamp, maxScopes * 2);
+        frame.Readback = device.CreateBuffer(HeapType::Readback, sizeof(std::uint64_t) * maxScopes * 2, States::CopyDest);
+        frame.Timestamps = static_cast<const std::uint64_t*>(device.Map(frame.Readback));
+        frame.Scopes = std::make_unique<Scope[]>(maxScopes);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (std::uint32_t i{0}; i < mFrameCount; ++i)
+    {
+        mDevice.ReleaseQueryHeap(mFrames[i].Heap);
+        mDevice.ReleaseResource(mFrames[i].Readback);
+    }
+}
+
+void GpuProfiler::BeginFrame()
+{
+    assert(mRecording == nullptr && "BeginFrame without EndFrame.");
+
+    auto& frame{mFrames[mNextFrame]};
+    if (frame.IsPending)
+    {
+        ++mStats.SkippedFrames;
+        return;
+    }
+
+    mNextFrame = (mNextFrame + 1) % mFrameCount;
+    frame.ScopeCount.store(0, std::memory_order_relaxed);
+    frame.ProfilerFrame = Profiling::Stats().FrameCount;
+    mRecording = &frame;
+}
+
+GpuProfiler::ScopeId GpuProfiler::BeginScope(ICommandList& list, const char* name)
+{
+    if (mRecording == nullptr)
+    {
+        return NoScope;
+    }
+
+    auto scope{mRecording->ScopeCount.fetch_add(1, std::memory_order_relaxed)};
+    if (scope >= mMaxScopes)
+    {
+        mDroppedScopes.fetch_add(1, std::memory_order_relaxed);
+        return NoScope;
+    }
+
+    mRecording->Scopes[scope] = Scope{name, false};
+    list.EndQuery(mRecording->Heap, QueryType::Timestamp, scope * 2);
+    return scope;
+}
+
+void GpuProfiler::EndScope(ICommandList& list, ScopeId scope)
+{
+    if (scope == NoScope)
+    {
+        return;
+    }
+
+    assert(mRecording != nullptr && scope < mMaxScopes && "EndScope outside the frame of its BeginScope.");
+    list.EndQuery(mRecording->Heap, QueryType::Timestamp, scope * 2 + 1);
+    mRecording->Scopes[scope].IsEnded = true;
+}
+
+void GpuProfiler::EndFrame(ICommandList& list, std::uint64_t fenceValue)
+{
+    if (mRecording == nullptr)
+    {
+        return;
+    }
+
+    auto scopeCount{std::min(mRecording->ScopeCount.load(std::memory_order_relaxed), mMaxScopes)};
+    mRecording->ScopeCount.store(scopeCount, std::memory_order_relaxed);
+    if (scopeCount > 0)
+    {
+        list.ResolveQueryData(mRecording->Heap, QueryType::Timestamp, 0, scopeCount * 2, mRecording->Readback, 0);
+    }
+
+    mRecording->FenceValue = fenceValue;
+    mRecording->IsPending = true;
+    mPending.push_back(mRecording);
+    mRecording = nullptr;
+}
+
+void GpuProfiler::Collect(std::uint64_t completedFenceValue)
+{
+    if (mPending.empty() || mPending.front()->FenceValue > completedFenceValue)
+    {
+        return;
+    }
+
+    // One calibration serves every frame collected now; the clocks drift far slower than that.
+    auto calibration{mQueue.GetClockCalibration()};
+    while (!mPending.empty() && mPending.front()->FenceValue <= completedFenceValue)
+    {
+        auto& frame{*mPending.front()};
+        Resolve(frame, calibration);
+        frame.IsPending = false;
+        mPending.pop_front();
+        ++mStats.TimedFrames;
+    }
+}
+
+const GpuFrameTimings& GpuProfiler::Latest() const
+{
+    return mLatest;
+}
+
+GpuProfilerStats GpuProfiler::Stats() const
+{
+    auto stats{mStats};
+    stats.DroppedScopes = mDroppedScopes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void GpuProfiler::Resolve(Frame& frame, const ClockCalibration& calibration)
+{
+    auto scopeCount{frame.ScopeCount.load(std::memory_order_relaxed)};
+
+    mLatest.Frame = frame.ProfilerFrame;
+    mLatest.TotalMs = 0.0;
+    mLatest.Scopes.clear();
+
+    auto first{UINT64_MAX};
+    std::uint64_t last{0};
+    for (std::uint32_t i{0}; i < scopeCount; ++i)
+    {
+        if (frame.Scopes[i].IsEnded && frame.Timestamps[i * 2] <= frame.Timestamps[i * 2 + 1])
+        {
+            first = std::min(first, frame.Timestamps[i * 2]);
+            last = std::max(last, frame.Timestamps[i * 2 + 1]);
+        }
+    }
+    if (first > last)
+    {
+        return;
+    }
+    mLatest.TotalMs = static_cast<double>(last - first) / mTicksPerMs;
+
+    auto isCapturing{Profiling::IsCapturing()};
+    for (std::uint32_t i{0}; i < scopeCount; ++i)
+    {
+        const auto& scope{frame.Scopes[i]};
+        auto begin{frame.Timestamps[i * 2]};
+        auto end{frame.Timestamps[i * 2 + 1]};
+        if (!scope.IsEnded || begin > end)
+        {
+            continue;
+        }
+
+        mLatest.Scopes.push_back(GpuScopeTiming{scope.Name,
+                                                static_cast<double>(begin - first) / mTicksPerMs,
+                                                static_cast<double>(end - begin) / mTicksPerMs});
+
+        if (isCapturing)
+        {
+            // Ticks before the calibration count down from its CPU time.
+            auto toCpuTime{[&](std::uint64_t timestamp) {
+                std::chrono::duration<double, std::milli> offset{
+                    (static_cast<double>(timestamp) - static_cast<double>(calibration.GpuTimestamp)) / mTicksPerMs};
+                return calibration.CpuTime + std::chrono::duration_cast<Profiling::Clock::duration>(offset);
+            }};
+            Profiling::RecordZone(mTrack, scope.Name, toCpuTime(begin), toCpuTime(end), frame.ProfilerFrame);
+        }
+    }
+}
+
+GpuScope::GpuScope(GpuProfiler& profiler, ICommandList& list, const char* name) :
+    mProfiler{profiler},
+    mList{list},
+    mScope{profiler.BeginScope(list, name)}
+{
+}
+
+GpuScope::~GpuScope()
+{
+    mProfiler.EndScope(mList, mScope);
+}
@@ -0,0 +1,148 @@
+#ifndef _GPUPROFILER_
+#define _GPUPROFILER_
+
+#include "GfxBackend.h"
+#include "Profiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// GPU time of scopes recorded on command lists, measured with timestamp queries.
+//
+// Every frame slot owns a query heap and a readback buffer, and the slots are used round-robin.
+// A scope writes a timestamp where it begins and one where it ends; EndFrame resolves the frame's
+// timestamps into the slot's readback buffer, and Collect reads them once the frame's fence has
+// completed.  Nothing waits on the GPU: a frame whose slot has not been collected yet goes
+// untimed.  While a profiler capture runs, collected scopes join the trace on a "GPU" track, at
+// the CPU time they ran.
+//
+// BeginScope and EndScope may be called from every thread recording the frame's lists; the other
+// functions from the thread that submits them.
+namespace Gfx
+{
+struct GpuScopeTiming
+{
+    const char* Name{nullptr};
+    // From the frame's first timestamp.
+    double BeginMs{0.0};
+    double DurationMs{0.0};
+};
+
+struct GpuFrameTimings
+{
+    // Profiler frame the scopes were recorded in.
+    std::uint64_t Frame{0};
+    // From the earliest scope begin to the latest scope end.
+    double TotalMs{0.0};
+    // In BeginScope order; scopes never ended are left out.
+    std::vector<GpuScopeTiming> Scopes{};
+};
+
+struct GpuProfilerStats
+{
+    std::uint64_t TimedFrames{0};
+    // Frames begun while their slot was still waiting for the GPU.
+    std::uint64_t SkippedFrames{0};
+    // Scopes past the per-frame maximum.
+    std::uint64_t DroppedScopes{0};
+};
+
+class GpuProfiler
+{
+public:
+    using ScopeId = std::uint32_t;
+    static constexpr ScopeId NoScope{0xffffffff};
+
+    // frameCount slots of maxScopes scopes each; more slots than frames in flight keep every frame
+    // timed.  queue runs the timed lists and must not be a copy queue.
+    GpuProfiler(IDevice& device, ICommandQueue& queue, std::uint32_t frameCount, std::uint32_t maxScopes = 256);
+    GpuProfiler(const GpuProfiler& rhs) = delete;
+    GpuProfiler& operator=(const GpuProfiler& rhs) = delete;
+    // The GPU must be done with every frame by then.
+    ~GpuProfiler();
+
+    // Before the frame's first BeginScope.
+    void BeginFrame();
+    // Returns NoScope, which EndScope ignores, when the frame is not timed or has run out of scopes.
+    // name must outlive the profiler; a literal is best.
+    [[nodiscard]] ScopeId BeginScope(ICommandList& list, const char* name);
+    // list may differ from the one the scope began on, as long as it runs after it.
+    void EndScope(ICommandList& list, ScopeId scope);
+    // Recorded on a list that runs after every other list of the frame; fenceValue is the one the
+    // frame's Signal sets.
+    void EndFrame(ICommandList& list, std::uint64_t fenceValue);
+
+    // Reads back the frames whose fence value has completed.
+    void Collect(std::uint64_t completedFenceValue);
+
+    // The latest frame collected.
+    [[nodiscard]] const GpuFrameTimings& Latest() const;
+    [[nodiscard]] GpuProfilerStats Stats() const;
+
+private:
+    struct Scope
+    {
+        const char* Name{nullptr};
+        bool IsEnded{false};
+    };
+
+    struct Frame
+    {
+        QueryHeapHandle Heap{0};
+        ResourceHandle Readback{NullResource};
+        const std::uint64_t* Timestamps{nullptr};
+        std::unique_ptr<Scope[]> Scopes{};
+        std::atomic<std::uint32_t> ScopeCount{0};
+        std::uint64_t FenceValue{0};
+        std::uint64_t ProfilerFrame{0};
+        bool IsPending{false};
+    };
+
+    void Resolve(Frame& frame, const ClockCalibration& calibration);
+
+    IDevice& mDevice;
+    ICommandQueue& mQueue;
+    std::uint32_t mFrameCount{0};
+    std::uint32_t mMaxScopes{0};
+    double mTicksPerMs{0.0};
+    std::uint32_t mTrack{0};
+
+    std::unique_ptr<Frame[]> mFrames{};
+    std::uint32_t mNextFrame{0};
+    // The frame being recorded, if it is timed.
+    Frame* mRecording{nullptr};
+    // Slots waiting for their fence, oldest first.
+    std::deque<Frame*> mPending{};
+
+    GpuFrameTimings mLatest{};
+    GpuProfilerStats mStats{};
+    std::atomic<std::uint64_t> mDroppedScopes{0};
+};
+
+// Times the rest of the enclosing scope on list.
+class GpuScope
+{
+public:
+    GpuScope(GpuProfiler& profiler, ICommandList& list, const char* name);
+    GpuScope(const GpuScope& rhs) = delete;
+    GpuScope& operator=(const GpuScope& rhs) = delete;
+    ~GpuScope();
+
+private:
+    GpuProfiler& mProfiler;
+    ICommandList& mList;
+    GpuProfiler::ScopeId mScope{GpuProfiler::NoScope};
+};
+} // namespace Gfx
+
+#if defined(PROFILER_DISABLED)
+#define GPU_PROFILE_SCOPE(profiler, list, name) static_cast<void>(0)
+#else
+#define GPU_PROFILE_SCOPE(profiler, list, name) \
+    const ::Gfx::GpuScope PROFILE_CONCAT(gpuProfileScope, __LINE__){profiler, list, name}
+#endif
+
+#endif // _GPUPROFILER_
@@ -0,0 +1,113 @@
+#include "Hash.h"
+
+#include <cstring>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr std::uint64_t Prime1{0x9E3779B185EBCA87ULL};
+constexpr std::uint64_t Prime2{0xC2B2AE3D27D4EB4FULL};
+constexpr std::uint64_t Prime3{0x165667B19E3779F9ULL};
+
+constexpr std::uint64_t RotateLeft(std::uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+constexpr std::uint64_t MixWord(std::uint64_t state, std::uint64_t word)
+{
+    word *= Prime2;
+    word = RotateLeft(word, 31);
+    word *= Prime1;
+    state ^= word;
+    return RotateLeft(state, 27) * Prime1 + Prime3;
+}
+} // namespace
+
+Hasher::Hasher(std::uint64_t seed) : mState{seed + Prime3}
+{
+}
+
+void Hasher::Add(const void* data, std::size_t byteSize)
+{
+    const auto* bytes{static_cast<const std::uint8_t*>(data)};
+    auto remaining{byteSize};
+
+    for (; remaining >= sizeof(std::uint64_t); remaining -= sizeof(std::uint64_t), bytes += sizeof(std::uint64_t))
+    {
+        std::uint64_t word{};
+        std::memcpy(&word, bytes, sizeof(word));
+        mState = MixWord(mState, word);
+    }
+
+    if (remaining > 0)
+    {
+        std::uint64_t word{0};
+        std::memcpy(&word, bytes, remaining);
+        mState = MixWord(mState, word ^ (std::uint64_t{remaining} << 56));
+    }
+
+    mByteCount += byteSize;
+}
+
+void Hasher::Add(std::uint32_t value)
+{
+    Add(&value, sizeof(value));
+}
+
+void Hasher::Add(std::uint64_t value)
+{
+    Add(&value, sizeof(value));
+}
+
+void Hasher::Add(float value)
+{
+    // -0.0 and 0.0 configure the same state.
+    if (value == 0.0f)
+    {
+        value = 0.0f;
+    }
+
+    std::uint32_t bits{};
+    std::memcpy(&bits, &value, sizeof(bits));
+    Add(bits);
+}
+
+void Hasher::AddString(const char* text)
+{
+    auto length{text != nullptr ? std::strlen(text) : 0};
+    Add(static_cast<std::uint64_t>(length));
+    Add(text, length);
+}
+
+std::uint64_t Hasher::Finish() const
+{
+    // MurmurHash3 finalizer.
+    auto hash{mState ^ mByteCount};
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+std::uint64_t Gfx::HashBytes(const void* data, std::size_t byteSize)
+{
+    Hasher hasher{};
+    hasher.Add(data, byteSize);
+    return hasher.Finish();
+}
+
+std::wstring Gfx::HashName(std::uint64_t hash)
+{
+    constexpr wchar_t Digits[]{L"0123456789abcdef"};
+
+    std::wstring name(16, L'0');
+    for (auto i{name.size()}; i-- > 0; hash >>= 4)
+    {
+        name[i] = Digits[hash & 0xf];
+    }
+    return name;
+}
@@ -0,0 +1,38 @@
+#ifndef _HASH_
+#define _HASH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Content hashing for cache keys that are persisted, so results must not change between runs,
+// builds or platforms.
+namespace Gfx
+{
+// 64-bit hash over little-endian bytes; not cryptographic.
+class Hasher
+{
+public:
+    explicit Hasher(std::uint64_t seed = 0);
+
+    void Add(const void* data, std::size_t byteSize);
+    void Add(std::uint32_t value);
+    void Add(std::uint64_t value);
+    void Add(float value);
+    // Hashes the characters and the length, so "ab","c" and "a","bc" differ.  Null hashes as "".
+    void AddString(const char* text);
+
+    [[nodiscard]] std::uint64_t Finish() const;
+
+private:
+    std::uint64_t mState{0};
+    std::uint64_t mByteCount{0};
+};
+
+[[nodiscard]] std::uint64_t HashBytes(const void* data, std::size_t byteSize);
+
+// 16 lowercase hex digits, for naming cache entries.
+[[nodiscard]] std::wstring HashName(std::uint64_t hash);
+} // namespace Gfx
+
+#endif // _HASH_
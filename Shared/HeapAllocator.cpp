@@ -0,0 +1,351 @@
+#include "HeapAllocator.h"
+
+#include "GfxD3D12.h"
+#include "PlatformHelpers.h"
+#include "directx/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+using namespace Gfx;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+constexpr std::uint64_t PlacementAlignment{D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT};
+constexpr std::uint64_t MsaaPlacementAlignment{D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT};
+
+std::uint64_t NextPowerOfTwo(std::uint64_t value)
+{
+    std::uint64_t power{1};
+    while (power < value)
+    {
+        power <<= 1;
+    }
+    return power;
+}
+
+HeapResourceClass ClassOf(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        return HeapResourceClass::Buffer;
+    }
+    if ((desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0)
+    {
+        return HeapResourceClass::RenderTargetOrDepth;
+    }
+    return HeapResourceClass::Texture;
+}
+
+D3D12_HEAP_FLAGS HeapFlags(HeapResourceClass resourceClass, bool isMixed)
+{
+    if (isMixed)
+    {
+        return D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+    }
+
+    switch (resourceClass)
+    {
+    case HeapResourceClass::Texture:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    case HeapResourceClass::RenderTargetOrDepth:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    default:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    }
+}
+} // namespace
+
+D3D12HeapAllocator::D3D12HeapAllocator(ComPtr<ID3D12Device> device, ResourceStateRegistry* registry, std::uint64_t blockSize) :
+    mDevice{std::move(device)},
+    mRegistry{registry},
+    mBlockSize{blockSize}
+{
+    assert(blockSize >= MsaaPlacementAlignment && (blockSize & (blockSize - 1)) == 0);
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+    ThrowIfFailed(mDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    mHeapTier = options.ResourceHeapTier;
+}
+
+D3D12HeapAllocator::~D3D12HeapAllocator()
+{
+    for (auto& pool : mPools)
+    {
+        for (auto& block : pool.Blocks)
+        {
+            ReleaseBlock(block);
+        }
+    }
+}
+
+ComPtr<ID3D12Resource> D3D12HeapAllocator::CreateResource(D3D12_HEAP_TYPE heapType,
+                                                          const D3D12_RESOURCE_DESC& desc,
+                                                          D3D12_RESOURCE_STATES initialState,
+                                                          const D3D12_CLEAR_VALUE* clearValue,
+                                                          HeapAllocation& allocation)
+{
+    auto info{mDevice->GetResourceAllocationInfo(0, 1, &desc)};
+    allocation = Allocate(FindPool(heapType, ClassOf(desc), false), info.SizeInBytes, info.Alignment);
+
+    try
+    {
+        return CreatePlacedResource(allocation, desc, initialState, clearValue);
+    }
+    catch (...)
+    {
+        Free(allocation);
+        throw;
+    }
+}
+
+BufferRange D3D12HeapAllocator::AllocateBuffer(D3D12_HEAP_TYPE heapType, std::uint64_t byteSize, std::uint64_t alignment)
+{
+    assert(byteSize > 0);
+
+    auto allocation{Allocate(FindPool(heapType, HeapResourceClass::Buffer, true), byteSize, alignment)};
+    return BufferAt(allocation, byteSize);
+}
+
+void D3D12HeapAllocator::Free(HeapAllocation& allocation)
+{
+    if (allocation.Pool >= mPools.size())
+    {
+        return;
+    }
+
+    auto& block{mPools[allocation.Pool].Blocks[allocation.Block]};
+    assert(block.Allocator && "Freeing into a released block.");
+    block.Allocator->Free(allocation.Offset);
+    allocation = HeapAllocation{};
+}
+
+std::vector<HeapAllocationMove> D3D12HeapAllocator::PlanMoves(std::uint32_t maxMoves)
+{
+    std::vector<HeapAllocationMove> moves{};
+    for (std::uint32_t pool{0}; pool < mPools.size(); ++pool)
+    {
+        auto& blocks{mPools[pool].Blocks};
+        for (std::uint32_t block{0}; block < blocks.size() && moves.size() < maxMoves; ++block)
+        {
+            if (!blocks[block].Allocator)
+            {
+                continue;
+            }
+
+            auto planned{blocks[block].Allocator->PlanMoves(maxMoves - static_cast<std::uint32_t>(moves.size()))};
+            for (const auto& move : planned)
+            {
+                moves.push_back(HeapAllocationMove{{pool, block, move.From}, {pool, block, move.To}, move.ByteSize});
+            }
+        }
+    }
+    return moves;
+}
+
+ComPtr<ID3D12Resource> D3D12HeapAllocator::CreatePlacedResource(const HeapAllocation& allocation,
+                                                                const D3D12_RESOURCE_DESC& desc,
+                                                                D3D12_RESOURCE_STATES initialState,
+                                                                const D3D12_CLEAR_VALUE* clearValue)
+{
+    const auto& pool{mPools[allocation.Pool]};
+    const auto& block{pool.Blocks[allocation.Block]};
+    assert(!pool.IsBufferRanges && block.Heap && "Placing a resource in a block of buffer ranges.");
+
+    ComPtr<ID3D12Resource> resource{};
+    ThrowIfFailed(mDevice->CreatePlacedResource(block.Heap.Get(),
+                                                allocation.Offset,
+                                                &desc,
+                                                initialState,
+                                                clearValue,
+                                                IID_PPV_ARGS(resource.GetAddressOf())));
+    return resource;
+}
+
+BufferRange D3D12HeapAllocator::BufferAt(const HeapAllocation& allocation, std::uint64_t byteSize) const
+{
+    const auto& pool{mPools[allocation.Pool]};
+    const auto& block{pool.Blocks[allocation.Block]};
+    assert(pool.IsBufferRanges && block.Buffer);
+
+    BufferRange range{};
+    range.Resource = block.Buffer.Get();
+    range.Offset = allocation.Offset;
+    range.ByteSize = byteSize;
+    range.GpuAddress = block.Buffer->GetGPUVirtualAddress() + allocation.Offset;
+    range.CpuAddress = block.Mapped != nullptr ? block.Mapped + allocation.Offset : nullptr;
+    range.Allocation = allocation;
+    return range;
+}
+
+void D3D12HeapAllocator::ReleaseEmptyBlocks()
+{
+    for (auto& pool : mPools)
+    {
+        for (auto& block : pool.Blocks)
+        {
+            if (block.Allocator && block.Allocator->IsEmpty())
+            {
+                ReleaseBlock(block);
+            }
+        }
+    }
+}
+
+D3D12_RESOURCE_HEAP_TIER D3D12HeapAllocator::HeapTier() const
+{
+    return mHeapTier;
+}
+
+HeapAllocatorStats D3D12HeapAllocator::Stats() const
+{
+    HeapAllocatorStats stats{};
+    for (const auto& pool : mPools)
+    {
+        for (const auto& block : pool.Blocks)
+        {
+            if (!block.Allocator)
+            {
+                continue;
+            }
+
+            const auto& blockStats{block.Allocator->Stats()};
+            ++stats.HeapCount;
+            stats.HeapBytes += block.Allocator->Capacity();
+            stats.UsedBytes += blockStats.UsedBytes;
+            stats.RequestedBytes += blockStats.RequestedBytes;
+            stats.AllocationCount += blockStats.AllocationCount;
+        }
+    }
+    return stats;
+}
+
+std::uint32_t D3D12HeapAllocator::FindPool(D3D12_HEAP_TYPE heapType, HeapResourceClass resourceClass, bool isBufferRanges)
+{
+    // Tier 2 heaps take any resource, so placed resources of every class share one pool.
+    if (!isBufferRanges && mHeapTier != D3D12_RESOURCE_HEAP_TIER_1)
+    {
+        resourceClass = HeapResourceClass::Buffer;
+    }
+
+    auto pool{std::find_if(mPools.begin(), mPools.end(), [&](const Pool& candidate) {
+        return candidate.HeapType == heapType && candidate.Class == resourceClass
+               && candidate.IsBufferRanges == isBufferRanges;
+    })};
+    if (pool != mPools.end())
+    {
+        return static_cast<std::uint32_t>(pool - mPools.begin());
+    }
+
+    mPools.push_back(Pool{heapType, resourceClass, isBufferRanges, {}});
+    return static_cast<std::uint32_t>(mPools.size() - 1);
+}
+
+HeapAllocation D3D12HeapAllocator::Allocate(std::uint32_t pool, std::uint64_t byteSize, std::uint64_t alignment)
+{
+    auto& blocks{mPools[pool].Blocks};
+    for (std::uint32_t block{0}; block < blocks.size(); ++block)
+    {
+        if (blocks[block].Allocator)
+        {
+            auto offset{blocks[block].Allocator->Allocate(byteSize, alignment)};
+            if (offset != InvalidHeapOffset)
+            {
+                return HeapAllocation{pool, block, offset};
+            }
+        }
+    }
+
+    // A new block, in a released slot when there is one: twice the largest live block, capped at
+    // the block size, and at least large enough for the request.
+    std::uint64_t largestBlock{0};
+    for (const auto& existing : blocks)
+    {
+        if (existing.Allocator)
+        {
+            largestBlock = std::max<std::uint64_t>(largestBlock, existing.Allocator->Capacity());
+        }
+    }
+    auto blockSize{std::max<std::uint64_t>({std::min<std::uint64_t>(largestBlock * 2, mBlockSize),
+                                            NextPowerOfTwo(std::max<std::uint64_t>(byteSize, alignment)),
+                                            BlockAlignment(mPools[pool])})};
+
+    auto slot{std::find_if(blocks.begin(), blocks.end(), [](const Block& block) { return !block.Allocator; })};
+    auto block{static_cast<std::uint32_t>(slot - blocks.begin())};
+    if (slot == blocks.end())
+    {
+        blocks.emplace_back();
+    }
+
+    CreateBlock(mPools[pool], blocks[block], blockSize);
+    auto offset{blocks[block].Allocator->Allocate(byteSize, alignment)};
+    assert(offset != InvalidHeapOffset);
+    return HeapAllocation{pool, block, offset};
+}
+
+bool D3D12HeapAllocator::IsMixed(const Pool& pool) const
+{
+    return !pool.IsBufferRanges && mHeapTier != D3D12_RESOURCE_HEAP_TIER_1;
+}
+
+std::uint64_t D3D12HeapAllocator::BlockAlignment(const Pool& pool) const
+{
+    return IsMixed(pool) || pool.Class == HeapResourceClass::RenderTargetOrDepth ? MsaaPlacementAlignment
+                                                                                 : PlacementAlignment;
+}
+
+void D3D12HeapAllocator::CreateBlock(Pool& pool, Block& block, std::uint64_t byteSize)
+{
+    CD3DX12_HEAP_DESC heapDesc{byteSize, pool.HeapType, BlockAlignment(pool), HeapFlags(pool.Class, IsMixed(pool))};
+    ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(block.Heap.ReleaseAndGetAddressOf())));
+
+    if (pool.IsBufferRanges)
+    {
+        auto state{pool.HeapType == D3D12_HEAP_TYPE_UPLOAD     ? D3D12_RESOURCE_STATE_GENERIC_READ
+                   : pool.HeapType == D3D12_HEAP_TYPE_READBACK ? D3D12_RESOURCE_STATE_COPY_DEST
+                                                               : D3D12_RESOURCE_STATE_COMMON};
+        auto bufferDesc{CD3DX12_RESOURCE_DESC::Buffer(byteSize)};
+        ThrowIfFailed(mDevice->CreatePlacedResource(block.Heap.Get(),
+                                                    0,
+                                                    &bufferDesc,
+                                                    state,
+                                                    nullptr,
+                                                    IID_PPV_ARGS(block.Buffer.ReleaseAndGetAddressOf())));
+
+        if (pool.HeapType == D3D12_HEAP_TYPE_UPLOAD || pool.HeapType == D3D12_HEAP_TYPE_READBACK)
+        {
+            void* mapped{nullptr};
+            ThrowIfFailed(block.Buffer->Map(0, nullptr, &mapped));
+            block.Mapped = static_cast<std::uint8_t*>(mapped);
+        }
+        else if (mRegistry != nullptr)
+        {
+            mRegistry->Register(ToHandle(block.Buffer.Get()), States::Common, 1, true);
+        }
+    }
+
+    block.Allocator = std::make_unique<BuddyAllocator>(byteSize,
+                                                       pool.IsBufferRanges ? BufferRangeGranularity : PlacementAlignment);
+}
+
+void D3D12HeapAllocator::ReleaseBlock(Block& block)
+{
+    if (block.Buffer)
+    {
+        if (block.Mapped != nullptr)
+        {
+            block.Buffer->Unmap(0, nullptr);
+        }
+        else if (mRegistry != nullptr)
+        {
+            mRegistry->Unregister(ToHandle(block.Buffer.Get()));
+        }
+    }
+
+    block.Buffer.Reset();
+    block.Heap.Reset();
+    block.Mapped = nullptr;
+    block.Allocator.reset();
+}
@@ -0,0 +1,159 @@
+#ifndef _HEAPALLOCATOR_
+#define _HEAPALLOCATOR_
+
+#include "BuddyAllocator.h"
+#include "ResourceStateTracker.h"
+
+#include <cstdint>
+#include <d3d12.h>
+#include <memory>
+#include <vector>
+#include <wrl.h>
+
+// GPU memory for D3D12 resources, carved out of large ID3D12Heap blocks instead of one implicit
+// heap per committed resource.
+//
+// Blocks are grouped in pools by heap type and by the class of resource they hold.  Resource heap
+// tier 1 hardware cannot mix buffers, textures and render target or depth textures in one heap, so
+// those get pools of their own; on tier 2 every class shares a pool per heap type.  Within a block,
+// space is handed out by a BuddyAllocator.
+//
+// Two kinds of allocation:
+//  - CreateResource places a resource in a block, at the 64 KiB granularity D3D12 places
+//    resources at (4 MiB for multisampled ones).
+//  - AllocateBuffer returns a range of a buffer that spans a whole block, at 256-byte granularity,
+//    for the many small vertex, index and constant buffers that would waste most of 64 KiB each.
+//    Those buffers are registered with the state registry as buffers in COMMON.
+//
+// A pool's first block is sized for the request that creates it, and each further block doubles
+// the largest one the pool has, up to the block size, so an app with a few kilobytes of geometry
+// does not commit a whole block for it.  Requests larger than the block size get a block of their
+// own.  Not thread-safe.
+namespace Gfx
+{
+enum class HeapResourceClass : std::uint32_t
+{
+    Buffer,
+    Texture,
+    RenderTargetOrDepth,
+};
+
+struct HeapAllocation
+{
+    std::uint32_t Pool{0xffffffff};
+    std::uint32_t Block{0};
+    std::uint64_t Offset{InvalidHeapOffset};
+};
+
+struct BufferRange
+{
+    // The shared buffer; the allocator owns it.
+    ID3D12Resource* Resource{nullptr};
+    std::uint64_t Offset{0};
+    std::uint64_t ByteSize{0};
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress{0};
+    // Mapped pointer to the range in upload and readback heaps, else null.
+    std::uint8_t* CpuAddress{nullptr};
+    HeapAllocation Allocation{};
+};
+
+// A relocation planned by PlanMoves.  To is allocated in the same block as From.
+struct HeapAllocationMove
+{
+    HeapAllocation From{};
+    HeapAllocation To{};
+    std::uint64_t ByteSize{0};
+};
+
+struct HeapAllocatorStats
+{
+    std::uint32_t HeapCount{0};
+    std::uint64_t HeapBytes{0};
+    std::uint64_t UsedBytes{0};
+    std::uint64_t RequestedBytes{0};
+    std::uint32_t AllocationCount{0};
+};
+
+class D3D12HeapAllocator
+{
+public:
+    static constexpr std::uint64_t DefaultBlockSize{64 * 1024 * 1024};
+    static constexpr std::uint64_t BufferRangeGranularity{256};
+
+    // blockSize, the size blocks grow to, must be a power of two of at least 4 MiB.  Buffers are
+    // registered with registry when it is given.
+    D3D12HeapAllocator(Microsoft::WRL::ComPtr<ID3D12Device> device,
+                       ResourceStateRegistry* registry = nullptr,
+                       std::uint64_t blockSize = DefaultBlockSize);
+    D3D12HeapAllocator(const D3D12HeapAllocator& rhs) = delete;
+    D3D12HeapAllocator& operator=(const D3D12HeapAllocator& rhs) = delete;
+    // Every resource created from the allocator must have been released.
+    ~D3D12HeapAllocator();
+
+    // A placed resource; allocation receives where it lives.  Render targets and depth buffers must
+    // be cleared, discarded or copied to before their first other use, as with any placed resource.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE heapType,
+                                                          const D3D12_RESOURCE_DESC& desc,
+                                                          D3D12_RESOURCE_STATES initialState,
+                                                          const D3D12_CLEAR_VALUE* clearValue,
+                                                          HeapAllocation& allocation);
+    // alignment must be a power of two; ranges are always aligned to at least 256 bytes.
+    BufferRange AllocateBuffer(D3D12_HEAP_TYPE heapType, std::uint64_t byteSize, std::uint64_t alignment = 0);
+
+    // Returns the space to its block and resets allocation; invalid allocations are ignored.  The
+    // GPU must be done with it, and a placed resource in it must have been released.
+    void Free(HeapAllocation& allocation);
+
+    // Defragmentation hooks.  PlanMoves plans up to maxMoves relocations within blocks, moving
+    // allocations down so the blocks' upper parts merge back (see BuddyAllocator::PlanMoves).  For
+    // each move the caller recreates the resource at To with CreatePlacedResource, or copies the
+    // range to BufferAt(To), switches its users over, and then frees From once the GPU is done
+    // with it.  ReleaseEmptyBlocks then returns blocks nothing lives in to the OS.
+    [[nodiscard]] std::vector<HeapAllocationMove> PlanMoves(std::uint32_t maxMoves);
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreatePlacedResource(const HeapAllocation& allocation,
+                                                                const D3D12_RESOURCE_DESC& desc,
+                                                                D3D12_RESOURCE_STATES initialState,
+                                                                const D3D12_CLEAR_VALUE* clearValue);
+    [[nodiscard]] BufferRange BufferAt(const HeapAllocation& allocation, std::uint64_t byteSize) const;
+    void ReleaseEmptyBlocks();
+
+    [[nodiscard]] D3D12_RESOURCE_HEAP_TIER HeapTier() const;
+    [[nodiscard]] HeapAllocatorStats Stats() const;
+
+private:
+    struct Block
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> Heap{};
+        // The buffer spanning the heap, for pools of buffer ranges.
+        Microsoft::WRL::ComPtr<ID3D12Resource> Buffer{};
+        std::uint8_t* Mapped{nullptr};
+        // Null once the block has been released; the slot is reused.
+        std::unique_ptr<BuddyAllocator> Allocator{};
+    };
+
+    struct Pool
+    {
+        D3D12_HEAP_TYPE HeapType{D3D12_HEAP_TYPE_DEFAULT};
+        HeapResourceClass Class{HeapResourceClass::Buffer};
+        bool IsBufferRanges{false};
+        std::vector<Block> Blocks{};
+    };
+
+    std::uint32_t FindPool(D3D12_HEAP_TYPE heapType, HeapResourceClass resourceClass, bool isBufferRanges);
+    HeapAllocation Allocate(std::uint32_t pool, std::uint64_t byteSize, std::uint64_t alignment);
+    [[nodiscard]] bool IsMixed(const Pool& pool) const;
+    // Heap alignment of the pool's blocks, and the smallest block it creates.
+    [[nodiscard]] std::uint64_t BlockAlignment(const Pool& pool) const;
+    void CreateBlock(Pool& pool, Block& block, std::uint64_t byteSize);
+    void ReleaseBlock(Block& block);
+
+    Microsoft::WRL::ComPtr<ID3D12Device> mDevice{};
+    ResourceStateRegistry* mRegistry{nullptr};
+    std::uint64_t mBlockSize{0};
+    D3D12_RESOURCE_HEAP_TIER mHeapTier{D3D12_RESOURCE_HEAP_TIER_1};
+
+    std::vector<Pool> mPools{};
+};
+} // namespace Gfx
+
+#endif // _HEAPALLOCATOR_
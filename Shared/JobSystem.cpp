@@ -0,0 +1,488 @@
+#include "JobSystem.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Jobs;
+
+struct Jobs::Job
+{
+    std::function<void()> Fn{};
+    JobCounter* Counter{nullptr};
+};
+
+namespace
+{
+// Idle rounds a thread spends looking for work before it sleeps (workers) or yields (waiters).
+constexpr int SpinRounds{64};
+
+thread_local JobSystem* tSystem{nullptr};
+thread_local std::size_t tQueueIndex{0};
+
+// Recycles Job objects per thread so steady-state submission does not hit the allocator.
+struct JobCache
+{
+    JobCache() = default;
+    JobCache(const JobCache& rhs) = delete;
+    JobCache& operator=(const JobCache& rhs) = delete;
+
+    ~JobCache()
+    {
+        for (auto* job : FreeJobs)
+        {
+            delete job;
+        }
+    }
+
+    std::vector<Job*> FreeJobs{};
+};
+
+thread_local JobCache tJobCache{};
+
+constexpr std::size_t MaxCachedJobs{1024};
+
+Job* AllocateJob(std::function<void()> fn, JobCounter* counter)
+{
+    Job* job{nullptr};
+    if (!tJobCache.FreeJobs.empty())
+    {
+        job = tJobCache.FreeJobs.back();
+        tJobCache.FreeJobs.pop_back();
+    }
+    else
+    {
+        job = new Job{};
+    }
+
+    job->Fn = std::move(fn);
+    job->Counter = counter;
+    return job;
+}
+
+void FreeJob(Job* job)
+{
+    job->Fn = nullptr;
+    job->Counter = nullptr;
+
+    if (tJobCache.FreeJobs.size() < MaxCachedJobs)
+    {
+        tJobCache.FreeJobs.push_back(job);
+    }
+    else
+    {
+        delete job;
+    }
+}
+
+// xorshift, for picking steal victims.
+std::uint32_t NextRandom()
+{
+    thread_local std::uint32_t state{static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1U};
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+} // namespace
+
+bool JobCounter::IsDone() const
+{
+    return mValue.load(std::memory_order_acquire) == 0;
+}
+
+int JobCounter::Value() const
+{
+    return mValue.load(std::memory_order_acquire);
+}
+
+void JobCounter::Increment()
+{
+    mValue.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobCounter::Decrement(JobSystem& system)
+{
+    // Fast path: not the last job, nothing else to do.
+    int value{mValue.load(std::memory_order_relaxed)};
+    while (value > 1)
+    {
+        if (mValue.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    // The last job releases the continuations.  Doing it under the lock means a waiter that saw the
+    // counter reach zero can take the lock once to know this thread no longer touches the counter.
+    std::vector<Job*> ready{};
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mValue.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            ready.swap(mContinuations);
+        }
+    }
+
+    for (auto* job : ready)
+    {
+        system.Schedule(job);
+    }
+}
+
+void JobCounter::SetException(std::exception_ptr exception)
+{
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (!mException)
+    {
+        mException = std::move(exception);
+    }
+}
+
+void JobCounter::RethrowIfFailed()
+{
+    std::exception_ptr exception{};
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        exception = std::exchange(mException, nullptr);
+    }
+
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+bool WorkStealingQueue::Push(Job* job)
+{
+    auto bottom{mBottom.load(std::memory_order_relaxed)};
+    auto top{mTop.load(std::memory_order_acquire)};
+    if (bottom - top >= Capacity)
+    {
+        return false;
+    }
+
+    mJobs[bottom & Mask].store(job, std::memory_order_relaxed);
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingQueue::Pop()
+{
+    auto bottom{mBottom.load(std::memory_order_relaxed) - 1};
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top{mTop.load(std::memory_order_relaxed)};
+
+    if (top > bottom)
+    {
+        // Empty.
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job{mJobs[bottom & Mask].load(std::memory_order_relaxed)};
+    if (top == bottom)
+    {
+        // Last element: race the thieves for it.
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingQueue::Steal()
+{
+    auto top{mTop.load(std::memory_order_acquire)};
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom{mBottom.load(std::memory_order_acquire)};
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* job{mJobs[top & Mask].load(std::memory_order_relaxed)};
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        // Lost the race to another thief or the owner.
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max(1U, std::thread::hardware_concurrency() - 1);
+    }
+
+    for (unsigned i{0}; i < workerCount + 1; ++i)
+    {
+        mQueues.emplace_back(std::make_unique<WorkStealingQueue>());
+    }
+
+    tSystem = this;
+    tQueueIndex = 0;
+
+    for (unsigned i{0}; i < workerCount; ++i)
+    {
+        mWorkers.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{mSleepMutex};
+        mStop.store(true);
+    }
+    mWakeUp.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+
+    // Drop whatever never ran.
+    for (auto& queue : mQueues)
+    {
+        while (auto* job{queue->Pop()})
+        {
+            FreeJob(job);
+        }
+    }
+    for (auto* job : mInjected)
+    {
+        FreeJob(job);
+    }
+
+    if (tSystem == this)
+    {
+        tSystem = nullptr;
+    }
+}
+
+unsigned JobSystem::WorkerCount() const
+{
+    return static_cast<unsigned>(mWorkers.size());
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter)
+{
+    if (counter != nullptr)
+    {
+        counter->Increment();
+    }
+    Schedule(AllocateJob(std::move(job), counter));
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+{
+    if (counter != nullptr)
+    {
+        counter->Increment();
+    }
+    auto* pending{AllocateJob(std::move(job), counter)};
+
+    {
+        std::lock_guard<std::mutex> lock{dependency.mMutex};
+        if (dependency.mValue.load(std::memory_order_acquire) != 0)
+        {
+            dependency.mContinuations.push_back(pending);
+            return;
+        }
+    }
+
+    Schedule(pending);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    auto queueIndex{CurrentQueueIndex()};
+
+    int idleRounds{0};
+    while (!counter.IsDone())
+    {
+        if (auto* job{FindJob(queueIndex)})
+        {
+            Execute(job);
+            idleRounds = 0;
+        }
+        else if (++idleRounds > SpinRounds)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Synchronize with the last Decrement so the caller may destroy the counter right away.
+    {
+        std::lock_guard<std::mutex> lock{counter.mMutex};
+    }
+    counter.RethrowIfFailed();
+}
+
+void JobSystem::ParallelFor(std::size_t count,
+                            std::size_t grainSize,
+                            const std::function<void(std::size_t, std::size_t)>& body)
+{
+    grainSize = std::max<std::size_t>(grainSize, 1);
+    if (count <= grainSize)
+    {
+        if (count > 0)
+        {
+            body(0, count);
+        }
+        return;
+    }
+
+    JobCounter counter{};
+    for (std::size_t begin{grainSize}; begin < count; begin += grainSize)
+    {
+        auto end{std::min(begin + grainSize, count)};
+        Run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+
+    // The queued ranges reference body and counter, so they must finish before this frame unwinds.
+    try
+    {
+        body(0, grainSize);
+    }
+    catch (...)
+    {
+        try
+        {
+            Wait(counter);
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+    Wait(counter);
+}
+
+void JobSystem::WorkerMain(std::size_t queueIndex)
+{
+    tSystem = this;
+    tQueueIndex = queueIndex;
+    Profiling::SetThreadName("Job worker");
+
+    int idleRounds{0};
+    while (!mStop.load(std::memory_order_acquire))
+    {
+        if (auto* job{FindJob(queueIndex)})
+        {
+            Execute(job);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < SpinRounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Schedule() bumps mQueuedJobs before checking mSleepers, and we register as a sleeper before
+        // checking mQueuedJobs, so a job queued concurrently either is seen here or wakes us up.
+        std::unique_lock<std::mutex> lock{mSleepMutex};
+        mSleepers.fetch_add(1);
+        mWakeUp.wait(lock, [this]() { return mQueuedJobs.load() > 0 || mStop.load(); });
+        mSleepers.fetch_sub(1);
+        idleRounds = 0;
+    }
+}
+
+void JobSystem::Schedule(Job* job)
+{
+    auto queueIndex{CurrentQueueIndex()};
+    if (queueIndex == NoQueue || !mQueues[queueIndex]->Push(job))
+    {
+        std::lock_guard<std::mutex> lock{mInjectedMutex};
+        mInjected.push_back(job);
+    }
+
+    mQueuedJobs.fetch_add(1);
+    if (mSleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock{mSleepMutex};
+        mWakeUp.notify_one();
+    }
+}
+
+Job* JobSystem::FindJob(std::size_t queueIndex)
+{
+    Job* job{nullptr};
+
+    if (queueIndex != NoQueue)
+    {
+        job = mQueues[queueIndex]->Pop();
+    }
+
+    if (job == nullptr && mQueuedJobs.load(std::memory_order_relaxed) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mInjectedMutex};
+            if (!mInjected.empty())
+            {
+                job = mInjected.front();
+                mInjected.pop_front();
+            }
+        }
+
+        if (job == nullptr)
+        {
+            auto queueCount{mQueues.size()};
+            auto start{static_cast<std::size_t>(NextRandom()) % queueCount};
+            for (std::size_t i{0}; i < queueCount && job == nullptr; ++i)
+            {
+                auto victim{(start + i) % queueCount};
+                if (victim != queueIndex)
+                {
+                    job = mQueues[victim]->Steal();
+                }
+            }
+        }
+    }
+
+    if (job != nullptr)
+    {
+        mQueuedJobs.fetch_sub(1);
+    }
+    return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    auto* counter{job->Counter};
+    try
+    {
+        job->Fn();
+    }
+    catch (...)
+    {
+        if (counter == nullptr)
+        {
+            std::terminate();
+        }
+        counter->SetException(std::current_exception());
+    }
+
+    // Release the job's captures before signalling, so waiters see a fully finished job.
+    FreeJob(job);
+    if (counter != nullptr)
+    {
+        counter->Decrement(*this);
+    }
+}
+
+std::size_t JobSystem::CurrentQueueIndex() const
+{
+    return tSystem == this ? tQueueIndex : NoQueue;
+}
@@ -0,0 +1,129 @@
+#ifndef _JOBSYSTEM_
+#define _JOBSYSTEM_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler.  Every worker thread, and the thread that created the system, owns
+// a Chase-Lev deque: the owner pushes and pops at the bottom, idle threads steal from the top.
+// Jobs submitted from any other thread go through a shared injection queue.
+//
+// Waiting on a JobCounter never just blocks: the waiting thread keeps running jobs until the
+// counter reaches zero, so waiting inside a job cannot deadlock the pool.
+namespace Jobs
+{
+struct Job;
+class JobSystem;
+
+// Number of outstanding jobs in a group.  Jobs passed a counter increment it when submitted and
+// decrement it when they finish; continuations registered with RunAfter start when it reaches zero.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter& rhs) = delete;
+    JobCounter& operator=(const JobCounter& rhs) = delete;
+    ~JobCounter() = default;
+
+    [[nodiscard]] bool IsDone() const;
+    [[nodiscard]] int Value() const;
+
+private:
+    friend class JobSystem;
+
+    void Increment();
+    void Decrement(JobSystem& system);
+    void SetException(std::exception_ptr exception);
+    void RethrowIfFailed();
+
+    std::atomic<int> mValue{0};
+
+    std::mutex mMutex{};
+    std::vector<Job*> mContinuations{};
+    std::exception_ptr mException{};
+};
+
+// Fixed-capacity Chase-Lev deque of job pointers.
+class WorkStealingQueue
+{
+public:
+    static constexpr std::int64_t Capacity{4096};
+
+    // Owner only.  Returns false when full.
+    bool Push(Job* job);
+    // Owner only.
+    Job* Pop();
+    // Any thread.
+    Job* Steal();
+
+private:
+    static constexpr std::int64_t Mask{Capacity - 1};
+
+    alignas(64) std::atomic<std::int64_t> mTop{0};
+    alignas(64) std::atomic<std::int64_t> mBottom{0};
+    std::array<std::atomic<Job*>, Capacity> mJobs{};
+};
+
+class JobSystem
+{
+public:
+    // workerCount == 0 uses one worker per hardware thread besides the calling thread.
+    explicit JobSystem(unsigned workerCount = 0);
+    JobSystem(const JobSystem& rhs) = delete;
+    JobSystem& operator=(const JobSystem& rhs) = delete;
+    // Jobs still queued at destruction are dropped; wait on their counters first.
+    ~JobSystem();
+
+    [[nodiscard]] unsigned WorkerCount() const;
+
+    // Queues job.  Without a counter it is fire-and-forget and an exception escaping it terminates.
+    // With a counter, the first exception is rethrown by Wait(counter).
+    void Run(std::function<void()> job, JobCounter* counter = nullptr);
+
+    // Queues job once dependency reaches zero (immediately if it already has).
+    void RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+
+    // Runs jobs until counter reaches zero, then rethrows the first exception of its jobs.
+    void Wait(JobCounter& counter);
+
+    // Calls body(begin, end) over [0, count) in ranges of at most grainSize and returns when all are
+    // done.  The calling thread takes part; counts that fit in one range run inline.
+    void ParallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& body);
+
+private:
+    friend class JobCounter;
+
+    static constexpr std::size_t NoQueue{static_cast<std::size_t>(-1)};
+
+    void WorkerMain(std::size_t queueIndex);
+    void Schedule(Job* job);
+    Job* FindJob(std::size_t queueIndex);
+    void Execute(Job* job);
+    [[nodiscard]] std::size_t CurrentQueueIndex() const;
+
+    // Queue 0 belongs to the creating thread, queue i (i > 0) to worker i - 1.
+    std::vector<std::unique_ptr<WorkStealingQueue>> mQueues{};
+    std::vector<std::thread> mWorkers{};
+
+    std::mutex mInjectedMutex{};
+    std::deque<Job*> mInjected{};
+
+    std::atomic<std::int64_t> mQueuedJobs{0};
+    std::atomic<int> mSleepers{0};
+    std::mutex mSleepMutex{};
+    std::condition_variable mWakeUp{};
+    std::atomic<bool> mStop{false};
+};
+} // namespace Jobs
+
+#endif // _JOBSYSTEM_
@@ -0,0 +1,276 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#error "MappedFile has no implementation for this platform."
+#endif
+
+using namespace Files;
+
+#if defined(_WIN32)
+
+namespace
+{
+std::runtime_error FileError(const char* what, const std::wstring& filename)
+{
+    return std::runtime_error{std::string{what} + " " + std::filesystem::path{filename}.u8string() + ": "
+                              + std::to_string(GetLastError())};
+}
+
+// Closes the handle on every way out of the constructor; views keep their mapping alive.
+struct ScopedHandle
+{
+    ~ScopedHandle()
+    {
+        if (Handle != nullptr && Handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(Handle);
+        }
+    }
+
+    HANDLE Handle{nullptr};
+};
+} // namespace
+
+MappedFile::MappedFile(const std::wstring& filename, AccessHint hint)
+{
+    DWORD flags{FILE_ATTRIBUTE_NORMAL};
+    if (hint == AccessHint::Sequential)
+    {
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    else if (hint == AccessHint::Random)
+    {
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+
+    ScopedHandle file{CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr)};
+    LARGE_INTEGER size{};
+    if (file.Handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file.Handle, &size))
+    {
+        throw FileError("Cannot open", filename);
+    }
+
+    if (static_cast<std::uint64_t>(size.QuadPart) < MinMappedSize)
+    {
+        mCopy.resize(static_cast<std::size_t>(size.QuadPart));
+        DWORD byteCount{0};
+        if (!mCopy.empty()
+            && (!ReadFile(file.Handle, mCopy.data(), static_cast<DWORD>(mCopy.size()), &byteCount, nullptr)
+                || byteCount != mCopy.size()))
+        {
+            throw FileError("Cannot read", filename);
+        }
+        mData = mCopy.data();
+        mSize = mCopy.size();
+        return;
+    }
+
+    ScopedHandle mapping{CreateFileMappingW(file.Handle, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    auto* view{mapping.Handle != nullptr ? MapViewOfFile(mapping.Handle, FILE_MAP_READ, 0, 0, 0) : nullptr};
+    if (view == nullptr)
+    {
+        throw FileError("Cannot map", filename);
+    }
+
+    mData = static_cast<const std::uint8_t*>(view);
+    mSize = static_cast<std::size_t>(size.QuadPart);
+    mIsMapped = true;
+
+    if (hint == AccessHint::WillNeed)
+    {
+        Prefetch(0, mSize);
+    }
+}
+
+void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+{
+    if (!mIsMapped || offset >= mSize)
+    {
+        return;
+    }
+
+    // A hint only; PrefetchVirtualMemory needs no page alignment.
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::uint8_t*>(mData) + offset, std::min<std::size_t>(size, mSize - offset)};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::Unmap()
+{
+    if (mIsMapped)
+    {
+        UnmapViewOfFile(mData);
+    }
+}
+
+#elif defined(__linux__)
+
+namespace
+{
+std::runtime_error FileError(const char* what, const std::wstring& filename)
+{
+    return std::runtime_error{std::string{what} + " " + std::filesystem::path{filename}.u8string() + ": "
+                              + std::strerror(errno)};
+}
+
+int ToAdvice(AccessHint hint)
+{
+    switch (hint)
+    {
+    case AccessHint::Sequential:
+        return MADV_SEQUENTIAL;
+    case AccessHint::Random:
+        return MADV_RANDOM;
+    case AccessHint::WillNeed:
+        return MADV_WILLNEED;
+    default:
+        return MADV_NORMAL;
+    }
+}
+
+// Closes the descriptor on every way out of the constructor; mappings outlive it.
+struct ScopedDescriptor
+{
+    ~ScopedDescriptor()
+    {
+        if (Descriptor >= 0)
+        {
+            close(Descriptor);
+        }
+    }
+
+    int Descriptor{-1};
+};
+} // namespace
+
+MappedFile::MappedFile(const std::wstring& filename, AccessHint hint)
+{
+    std::filesystem::path path{filename};
+    ScopedDescriptor file{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    struct stat status{};
+    if (file.Descriptor < 0 || fstat(file.Descriptor, &status) != 0)
+    {
+        throw FileError("Cannot open", filename);
+    }
+
+    auto size{static_cast<std::size_t>(status.st_size)};
+    if (size < MinMappedSize)
+    {
+        mCopy.resize(size);
+        std::size_t done{0};
+        while (done < size)
+        {
+            auto count{read(file.Descriptor, mCopy.data() + done, size - done)};
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                throw FileError("Cannot read", filename);
+            }
+            done += static_cast<std::size_t>(count);
+        }
+        mData = mCopy.data();
+        mSize = size;
+        return;
+    }
+
+    auto* view{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.Descriptor, 0)};
+    if (view == MAP_FAILED)
+    {
+        throw FileError("Cannot map", filename);
+    }
+
+    mData = static_cast<const std::uint8_t*>(view);
+    mSize = size;
+    mIsMapped = true;
+
+    if (hint != AccessHint::Normal)
+    {
+        madvise(view, size, ToAdvice(hint));
+    }
+}
+
+void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+{
+    if (!mIsMapped || offset >= mSize)
+    {
+        return;
+    }
+
+    // madvise takes page-aligned addresses; the mapping itself starts on a page.
+    auto pageSize{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+    auto first{offset / pageSize * pageSize};
+    auto last{std::min<std::size_t>(offset + size, mSize)};
+    madvise(const_cast<std::uint8_t*>(mData) + first, last - first, MADV_WILLNEED);
+}
+
+void MappedFile::Unmap()
+{
+    if (mIsMapped)
+    {
+        munmap(const_cast<std::uint8_t*>(mData), mSize);
+    }
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+    : mData{std::exchange(rhs.mData, nullptr)},
+      mSize{std::exchange(rhs.mSize, 0)},
+      mIsMapped{std::exchange(rhs.mIsMapped, false)},
+      mCopy{std::move(rhs.mCopy)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Unmap();
+        mData = std::exchange(rhs.mData, nullptr);
+        mSize = std::exchange(rhs.mSize, 0);
+        mIsMapped = std::exchange(rhs.mIsMapped, false);
+        mCopy = std::move(rhs.mCopy);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Unmap();
+}
+
+const std::uint8_t* MappedFile::Data() const
+{
+    return mData;
+}
+
+std::size_t MappedFile::Size() const
+{
+    return mSize;
+}
+
+bool MappedFile::Empty() const
+{
+    return mSize == 0;
+}
+
+bool MappedFile::IsMapped() const
+{
+    return mIsMapped;
+}
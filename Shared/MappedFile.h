@@ -0,0 +1,65 @@
+#ifndef _MAPPEDFILE_
+#define _MAPPEDFILE_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file.
+//
+// Files of at least MinMappedSize bytes are mapped (mmap on Linux, a file mapping on Windows), so
+// their pages are read on first touch and consumers use the bytes in place.  Smaller files are read
+// into memory, where a mapping would cost more in setup and page faults than the copy it saves.
+// Either way Data() stays valid, and unchanged, for the lifetime of the object.
+//
+// On Windows a mapped file cannot be replaced or deleted while the view exists; map files that are
+// only ever written under a new name.
+namespace Files
+{
+// How the contents will be read; passed to madvise or used as a prefetch request.
+enum class AccessHint : std::uint32_t
+{
+    Normal,
+    Sequential,
+    Random,
+    // Start reading the whole file in the background now.
+    WillNeed,
+};
+
+class MappedFile
+{
+public:
+    static constexpr std::size_t MinMappedSize{64 * 1024};
+
+    MappedFile() = default;
+    // Throws std::runtime_error when the file cannot be opened or read.
+    explicit MappedFile(const std::wstring& filename, AccessHint hint = AccessHint::Normal);
+    MappedFile(MappedFile&& rhs) noexcept;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] const std::uint8_t* Data() const;
+    [[nodiscard]] std::size_t Size() const;
+    [[nodiscard]] bool Empty() const;
+    // False when the file was small enough to be read instead.
+    [[nodiscard]] bool IsMapped() const;
+
+    // Asks the OS to read [offset, offset + size) ahead of use.  Does nothing for files read into
+    // memory, or where the OS has no such request.
+    void Prefetch(std::size_t offset, std::size_t size) const;
+
+private:
+    void Unmap();
+
+    const std::uint8_t* mData{nullptr};
+    std::size_t mSize{0};
+    bool mIsMapped{false};
+    // Holds the contents of files too small to map.
+    std::vector<std::uint8_t> mCopy{};
+};
+} // namespace Files
+
+#endif // _MAPPEDFILE_
@@ -0,0 +1,46 @@
+#ifndef _PACKEDOBJECTDATA_
+#define _PACKEDOBJECTDATA_
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+namespace D3DUtils
+{
+// Per-object data packed tightly into a StructuredBuffer and indexed by object ID in the shader.
+// A constant buffer view needs every element padded to 256 bytes; a structured buffer only needs
+// sizeof(ObjectData).  The world matrix is stored as a 3x4 affine matrix: the fourth column of a
+// row-vector affine transform is always (0, 0, 0, 1), so it is dropped.
+struct ObjectData
+{
+    // Rows of the transposed world matrix, read in HLSL as a row_major float3x4.
+    DirectX::XMFLOAT3X4 World{1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F};
+};
+
+static_assert(sizeof(ObjectData) == 48, "ObjectData must match the HLSL layout.");
+
+inline void PackObjectData(DirectX::FXMMATRIX world, ObjectData& dst)
+{
+    // XMStoreFloat3x4 transposes, which is exactly the layout mul(float3x4, float4) expects.
+    DirectX::XMStoreFloat3x4(&dst.World, world);
+}
+
+// Upload-heap bytes needed for one frame of per-object data, and the bytes written per frame
+// when every object is dirty, for both the padded constant buffer and the packed layout.
+struct ObjectDataFootprint
+{
+    std::uint64_t ConstantBufferBytes{0};
+    std::uint64_t PackedBytes{0};
+};
+
+inline ObjectDataFootprint CalcObjectDataFootprint(std::uint64_t objectCount,
+                                                   std::uint64_t frameResourceCount,
+                                                   std::uint64_t constantElementByteSize)
+{
+    ObjectDataFootprint footprint{};
+    footprint.ConstantBufferBytes = objectCount * frameResourceCount * ((constantElementByteSize + 255) & ~255ULL);
+    footprint.PackedBytes = objectCount * frameResourceCount * sizeof(ObjectData);
+    return footprint;
+}
+} // namespace D3DUtils
+
+#endif // _PACKEDOBJECTDATA_
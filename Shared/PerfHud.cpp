@@ -0,0 +1,144 @@
+#include "PerfHud.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace Profiling;
+
+namespace
+{
+constexpr float GraphHeight{48.0F};
+// Graphs never scale below a 60 Hz frame, so a quiet series stays flat.
+constexpr float MinGraphScaleMs{1000.0F / 60.0F};
+
+void DrawGraph(const PerfMonitor& monitor, PerfSeries series, const char* label)
+{
+    auto summary{monitor.Summarize(series)};
+    char overlay[96]{};
+    std::snprintf(overlay,
+                  sizeof(overlay),
+                  "mean %.2f  p99 %.2f  max %.2f ms",
+                  summary.MeanMs,
+                  summary.P99Ms,
+                  summary.MaxMs);
+    ImGui::PlotLines(label,
+                     monitor.History(series),
+                     static_cast<int>(monitor.HistoryCount()),
+                     static_cast<int>(monitor.HistoryOffset()),
+                     overlay,
+                     0.0F,
+                     std::max(MinGraphScaleMs, summary.MaxMs),
+                     ImVec2{0.0F, GraphHeight});
+}
+
+void DrawUsage(const char* label, double used, double capacity, const char* overlay)
+{
+    ImGui::ProgressBar(capacity > 0.0 ? static_cast<float>(used / capacity) : 0.0F, ImVec2{-80.0F, 0.0F}, overlay);
+    ImGui::SameLine(0.0F, ImGui::GetStyle().ItemInnerSpacing.x);
+    ImGui::TextUnformatted(label);
+}
+} // namespace
+
+void Profiling::DrawPerfHud(const PerfMonitor& monitor, const Gfx::GpuFrameTimings* gpuTimings, bool* isOpen)
+{
+    ImGui::SetNextWindowPos(ImVec2{10.0F, 10.0F}, ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2{420.0F, 0.0F}, ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.85F);
+    if (!ImGui::Begin("Performance", isOpen))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::PushItemWidth(-80.0F);
+    DrawGraph(monitor, PerfSeries::Cpu, "CPU frame");
+    DrawGraph(monitor, PerfSeries::Gpu, "GPU frame");
+    DrawGraph(monitor, PerfSeries::FenceStall, "Fence stall");
+    ImGui::PopItemWidth();
+
+    const auto& counters{monitor.LastCounters()};
+    if (ImGui::CollapsingHeader("Counters", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Text("Draw calls: %u", counters.DrawCalls);
+        ImGui::Text("Triangles: %llu", static_cast<unsigned long long>(counters.Triangles));
+        ImGui::Text("Visible items: %u / %u", counters.VisibleItems, counters.TotalItems);
+        char overlay[64]{};
+        if (counters.UploadCapacityBytes > 0)
+        {
+            constexpr double BytesPerMiB{1024.0 * 1024.0};
+            std::snprintf(overlay,
+                          sizeof(overlay),
+                          "%.1f / %.1f MiB",
+                          static_cast<double>(counters.UploadUsedBytes) / BytesPerMiB,
+                          static_cast<double>(counters.UploadCapacityBytes) / BytesPerMiB);
+            DrawUsage("Upload",
+                      static_cast<double>(counters.UploadUsedBytes),
+                      static_cast<double>(counters.UploadCapacityBytes),
+                      overlay);
+        }
+        if (counters.DescriptorCapacity > 0)
+        {
+            std::snprintf(overlay, sizeof(overlay), "%u / %u", counters.DescriptorsUsed, counters.DescriptorCapacity);
+            DrawUsage("Descriptors", counters.DescriptorsUsed, counters.DescriptorCapacity, overlay);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("CPU zones", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        if (!monitor.IsEnabled())
+        {
+            ImGui::TextDisabled("Zone timing is off.");
+        }
+        else if (ImGui::BeginTable("CPU zones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+        {
+            ImGui::TableSetupColumn("Zone");
+            ImGui::TableSetupColumn("ms/frame");
+            ImGui::TableSetupColumn("calls/frame");
+            ImGui::TableHeadersRow();
+            for (std::uint32_t i{0}; i < monitor.ZoneCount(); ++i)
+            {
+                const auto& zone{monitor.Zones()[i]};
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(zone.Name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", zone.TotalMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", zone.Count);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (gpuTimings != nullptr && ImGui::CollapsingHeader("GPU scopes", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        if (ImGui::BeginTable("GPU scopes", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+        {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableHeadersRow();
+            for (const auto& scope : gpuTimings->Scopes)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(scope.Name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", scope.DurationMs);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::End();
+}
+
+void Profiling::CountImGuiDrawData(const ImDrawData& drawData, PerfCounters& counters)
+{
+    for (int i{0}; i < drawData.CmdListsCount; ++i)
+    {
+        counters.DrawCalls += static_cast<std::uint32_t>(drawData.CmdLists[i]->CmdBuffer.Size);
+    }
+    counters.Triangles += static_cast<std::uint64_t>(drawData.TotalIdxCount / 3);
+}
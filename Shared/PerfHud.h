@@ -0,0 +1,24 @@
+#ifndef _PERFHUD_
+#define _PERFHUD_
+
+#include "GpuProfiler.h"
+#include "PerfMonitor.h"
+
+// Dear ImGui window showing a PerfMonitor: frame-time graphs, CPU zone and GPU scope timings,
+// counters, and upload and descriptor heap usage.
+//
+// Kept out of the D3DApp library, which does not link ImGui; an app that does adds this file to
+// its sources and calls DrawPerfHud between ImGui::NewFrame and ImGui::Render.  Does not allocate.
+struct ImDrawData;
+
+namespace Profiling
+{
+// gpuTimings may be null.  isOpen, if not null, gets the window's close button.  The upload and
+// descriptor bars are shown only when the app reports a capacity for them.
+void DrawPerfHud(const PerfMonitor& monitor, const Gfx::GpuFrameTimings* gpuTimings, bool* isOpen);
+
+// Adds the draw calls and triangles of ImGui's frame to counters.  Call after ImGui::Render.
+void CountImGuiDrawData(const ImDrawData& drawData, PerfCounters& counters);
+} // namespace Profiling
+
+#endif // _PERFHUD_
@@ -0,0 +1,153 @@
+#include "PerfMonitor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Profiling;
+
+PerfMonitor::~PerfMonitor()
+{
+    SetEnabled(false);
+}
+
+void PerfMonitor::SetEnabled(bool enabled)
+{
+    if (enabled == mIsEnabled)
+    {
+        return;
+    }
+
+    mIsEnabled = enabled;
+    SetZoneTimingEnabled(enabled);
+    // Start from a clean window; totals gathered while disabled would be partial.
+    std::array<ZoneTiming, MaxZones> discarded{};
+    TakeZoneTimings(discarded.data(), MaxZones);
+    mWindowZoneCount = 0;
+    mWindowFrames = 0;
+    mZoneCount = 0;
+}
+
+bool PerfMonitor::IsEnabled() const
+{
+    return mIsEnabled;
+}
+
+PerfCounters& PerfMonitor::Counters()
+{
+    return mCounters;
+}
+
+void PerfMonitor::EndFrame(const PerfFrame& frame)
+{
+    mLastCounters = mCounters;
+    mCounters = PerfCounters{};
+
+    mHistory[static_cast<std::size_t>(PerfSeries::Cpu)][mHistoryNext] = frame.CpuMs;
+    mHistory[static_cast<std::size_t>(PerfSeries::Gpu)][mHistoryNext] = frame.GpuMs;
+    mHistory[static_cast<std::size_t>(PerfSeries::FenceStall)][mHistoryNext] = frame.FenceStallMs;
+    mHistoryNext = (mHistoryNext + 1) % HistoryLength;
+    mHistoryCount = std::min(mHistoryCount + 1, HistoryLength);
+
+    if (!mIsEnabled)
+    {
+        return;
+    }
+
+    // Accumulate by name into the window; the names are in the profiler's own order, so the
+    // window keeps the order they were first seen in.
+    std::array<ZoneTiming, MaxZones> taken{};
+    auto takenCount{TakeZoneTimings(taken.data(), MaxZones)};
+    for (std::uint32_t i{0}; i < takenCount; ++i)
+    {
+        auto* end{mWindowZones.data() + mWindowZoneCount};
+        auto* zone{std::find_if(mWindowZones.data(), end, [&](const ZoneTiming& entry) {
+            return std::strcmp(entry.Name, taken[i].Name) == 0;
+        })};
+        if (zone != end)
+        {
+            zone->TotalMs += taken[i].TotalMs;
+            zone->Count += taken[i].Count;
+        }
+        else if (mWindowZoneCount < MaxZones)
+        {
+            mWindowZones[mWindowZoneCount++] = taken[i];
+        }
+    }
+
+    if (++mWindowFrames < ZoneWindow)
+    {
+        return;
+    }
+
+    // Publish per-frame averages; a zone that ran on some frames only reads lower, as it cost.
+    mZoneCount = mWindowZoneCount;
+    for (std::uint32_t i{0}; i < mZoneCount; ++i)
+    {
+        mZones[i] = ZoneTiming{mWindowZones[i].Name,
+                               mWindowZones[i].TotalMs / ZoneWindow,
+                               (mWindowZones[i].Count + ZoneWindow - 1) / ZoneWindow};
+        mWindowZones[i].TotalMs = 0.0;
+        mWindowZones[i].Count = 0;
+    }
+    mWindowFrames = 0;
+}
+
+const float* PerfMonitor::History(PerfSeries series) const
+{
+    return mHistory[static_cast<std::size_t>(series)].data();
+}
+
+std::uint32_t PerfMonitor::HistoryCount() const
+{
+    return mHistoryCount;
+}
+
+std::uint32_t PerfMonitor::HistoryOffset() const
+{
+    return mHistoryCount < HistoryLength ? 0 : mHistoryNext;
+}
+
+PerfSeriesSummary PerfMonitor::Summarize(PerfSeries series) const
+{
+    PerfSeriesSummary summary{};
+    if (mHistoryCount == 0)
+    {
+        return summary;
+    }
+
+    std::array<float, HistoryLength> samples{};
+    const auto& history{mHistory[static_cast<std::size_t>(series)]};
+    std::copy_n(history.begin(), mHistoryCount, samples.begin());
+    auto* end{samples.data() + mHistoryCount};
+
+    double total{0.0};
+    for (auto* sample{samples.data()}; sample != end; ++sample)
+    {
+        total += *sample;
+    }
+    summary.MeanMs = static_cast<float>(total / mHistoryCount);
+
+    // Nearest rank.
+    auto rank{static_cast<std::uint32_t>(std::ceil(0.99F * static_cast<float>(mHistoryCount)))};
+    auto* p99{samples.data() + std::clamp<std::uint32_t>(rank, 1, mHistoryCount) - 1};
+    std::nth_element(samples.data(), p99, end);
+    summary.P99Ms = *p99;
+    summary.MaxMs = *std::max_element(p99, end);
+    return summary;
+}
+
+const PerfCounters& PerfMonitor::LastCounters() const
+{
+    return mLastCounters;
+}
+
+const ZoneTiming* PerfMonitor::Zones() const
+{
+    return mZones.data();
+}
+
+std::uint32_t PerfMonitor::ZoneCount() const
+{
+    return mZoneCount;
+}
@@ -0,0 +1,102 @@
+#ifndef _PERFMONITOR_
+#define _PERFMONITOR_
+
+#include "Profiler.h"
+
+#include <array>
+#include <cstdint>
+
+// Per-frame numbers for a performance overlay: frame-time history, counters the app fills while it
+// draws, and CPU zone timings averaged over a short window.
+//
+// Everything lives in fixed arrays, so neither the frame loop nor the overlay allocates.  Zone
+// timings are gathered only while the monitor is enabled, which turns on the profiler's per-name
+// totals.  Used from the thread running the frame loop.
+namespace Profiling
+{
+// Counted afresh every frame; EndFrame keeps the last frame's.
+struct PerfCounters
+{
+    std::uint32_t DrawCalls{0};
+    std::uint64_t Triangles{0};
+    // Render items drawn, of those considered.
+    std::uint32_t VisibleItems{0};
+    std::uint32_t TotalItems{0};
+    std::uint64_t UploadUsedBytes{0};
+    std::uint64_t UploadCapacityBytes{0};
+    std::uint32_t DescriptorsUsed{0};
+    std::uint32_t DescriptorCapacity{0};
+};
+
+struct PerfFrame
+{
+    float CpuMs{0.0F};
+    // Of the latest frame the GPU profiler collected; 0 when none was.
+    float GpuMs{0.0F};
+    // Time the frame loop spent waiting on fences.
+    float FenceStallMs{0.0F};
+};
+
+enum class PerfSeries
+{
+    Cpu,
+    Gpu,
+    FenceStall,
+};
+
+struct PerfSeriesSummary
+{
+    float MeanMs{0.0F};
+    float P99Ms{0.0F};
+    float MaxMs{0.0F};
+};
+
+class PerfMonitor
+{
+public:
+    static constexpr std::uint32_t HistoryLength{256};
+    static constexpr std::uint32_t MaxZones{32};
+    // Frames the zone timings are averaged over.
+    static constexpr std::uint32_t ZoneWindow{30};
+
+    PerfMonitor() = default;
+    PerfMonitor(const PerfMonitor& rhs) = delete;
+    PerfMonitor& operator=(const PerfMonitor& rhs) = delete;
+    ~PerfMonitor();
+
+    void SetEnabled(bool enabled);
+    [[nodiscard]] bool IsEnabled() const;
+
+    // The frame being counted.
+    [[nodiscard]] PerfCounters& Counters();
+    void EndFrame(const PerfFrame& frame);
+
+    // Oldest first from HistoryOffset, wrapping, as ImGui::PlotLines reads it.
+    [[nodiscard]] const float* History(PerfSeries series) const;
+    [[nodiscard]] std::uint32_t HistoryCount() const;
+    [[nodiscard]] std::uint32_t HistoryOffset() const;
+    [[nodiscard]] PerfSeriesSummary Summarize(PerfSeries series) const;
+
+    [[nodiscard]] const PerfCounters& LastCounters() const;
+    // Per frame over the last full window, in the order the names were first seen.
+    [[nodiscard]] const ZoneTiming* Zones() const;
+    [[nodiscard]] std::uint32_t ZoneCount() const;
+
+private:
+    bool mIsEnabled{false};
+    PerfCounters mCounters{};
+    PerfCounters mLastCounters{};
+
+    std::array<std::array<float, HistoryLength>, 3> mHistory{};
+    std::uint32_t mHistoryNext{0};
+    std::uint32_t mHistoryCount{0};
+
+    std::array<ZoneTiming, MaxZones> mWindowZones{};
+    std::uint32_t mWindowZoneCount{0};
+    std::uint32_t mWindowFrames{0};
+    std::array<ZoneTiming, MaxZones> mZones{};
+    std::uint32_t mZoneCount{0};
+};
+} // namespace Profiling
+
+#endif // _PERFMONITOR_
@@ -0,0 +1,414 @@
+#include "PipelineCache.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+using namespace Gfx;
+
+namespace
+{
+std::uint32_t Bool(std::uint32_t value)
+{
+    return value != 0 ? 1 : 0;
+}
+
+void HashShader(Hasher& hasher, const ShaderBytecode& shader)
+{
+    hasher.Add(shader.ByteSize > 0 ? HashBytes(shader.Data, shader.ByteSize) : std::uint64_t{0});
+}
+
+void HashRenderTargetBlend(Hasher& hasher, const RenderTargetBlendDesc& blend)
+{
+    hasher.Add(Bool(blend.BlendEnable));
+    if (blend.BlendEnable)
+    {
+        hasher.Add(blend.SrcBlend);
+        hasher.Add(blend.DestBlend);
+        hasher.Add(blend.BlendOp);
+        hasher.Add(blend.SrcBlendAlpha);
+        hasher.Add(blend.DestBlendAlpha);
+        hasher.Add(blend.BlendOpAlpha);
+    }
+
+    hasher.Add(Bool(blend.LogicOpEnable));
+    if (blend.LogicOpEnable)
+    {
+        hasher.Add(blend.LogicOp);
+    }
+
+    hasher.Add(std::uint32_t{blend.RenderTargetWriteMask});
+}
+
+void HashStencilOp(Hasher& hasher, const DepthStencilOpDesc& op)
+{
+    hasher.Add(op.StencilFailOp);
+    hasher.Add(op.StencilDepthFailOp);
+    hasher.Add(op.StencilPassOp);
+    hasher.Add(op.StencilFunc);
+}
+
+struct LibraryFileHeader
+{
+    std::uint32_t Magic{0};
+    std::uint32_t KeyVersion{0};
+    std::uint64_t ByteSize{0};
+    std::uint64_t Hash{0};
+};
+
+constexpr std::uint32_t LibraryFileMagic{0x424C5047}; // "GPLB"
+} // namespace
+
+std::uint64_t Gfx::HashGraphicsPipelineDesc(const GraphicsPipelineDesc& desc)
+{
+    assert(desc.NumRenderTargets <= 8);
+
+    Hasher hasher{PipelineKeyVersion};
+    hasher.Add(desc.RootSignatureHash);
+
+    HashShader(hasher, desc.VS);
+    HashShader(hasher, desc.PS);
+    HashShader(hasher, desc.DS);
+    HashShader(hasher, desc.HS);
+    HashShader(hasher, desc.GS);
+
+    // Without independent blending every target uses RenderTarget[0]; hashing the effective state
+    // per bound target makes both spellings of the same blend state equal.
+    const auto& blend{desc.BlendState};
+    hasher.Add(Bool(blend.AlphaToCoverageEnable));
+    for (std::uint32_t i{0}; i < desc.NumRenderTargets; ++i)
+    {
+        HashRenderTargetBlend(hasher, blend.RenderTarget[blend.IndependentBlendEnable ? i : 0]);
+    }
+
+    auto sampleBits{desc.SampleCount < 32 ? (1U << desc.SampleCount) - 1 : 0xffffffffU};
+    hasher.Add(desc.SampleMask & sampleBits);
+
+    const auto& raster{desc.RasterizerState};
+    hasher.Add(raster.FillMode);
+    hasher.Add(raster.CullMode);
+    hasher.Add(Bool(raster.FrontCounterClockwise));
+    hasher.Add(static_cast<std::uint32_t>(raster.DepthBias));
+    hasher.Add(raster.DepthBiasClamp);
+    hasher.Add(raster.SlopeScaledDepthBias);
+    hasher.Add(Bool(raster.DepthClipEnable));
+    hasher.Add(Bool(raster.MultisampleEnable));
+    hasher.Add(Bool(raster.AntialiasedLineEnable));
+    hasher.Add(raster.ForcedSampleCount);
+    hasher.Add(raster.ConservativeRaster);
+
+    const auto& depthStencil{desc.DepthStencilState};
+    hasher.Add(Bool(depthStencil.DepthEnable));
+    if (depthStencil.DepthEnable)
+    {
+        hasher.Add(depthStencil.DepthWriteMask);
+        hasher.Add(depthStencil.DepthFunc);
+    }
+    hasher.Add(Bool(depthStencil.StencilEnable));
+    if (depthStencil.StencilEnable)
+    {
+        hasher.Add(std::uint32_t{depthStencil.StencilReadMask});
+        hasher.Add(std::uint32_t{depthStencil.StencilWriteMask});
+        HashStencilOp(hasher, depthStencil.FrontFace);
+        HashStencilOp(hasher, depthStencil.BackFace);
+    }
+
+    // Element order assigns input registers, so it is part of the key.
+    hasher.Add(desc.InputElementCount);
+    for (std::uint32_t i{0}; i < desc.InputElementCount; ++i)
+    {
+        const auto& element{desc.InputElements[i]};
+        hasher.AddString(element.SemanticName);
+        hasher.Add(element.SemanticIndex);
+        hasher.Add(element.Format);
+        hasher.Add(element.InputSlot);
+        hasher.Add(element.AlignedByteOffset);
+        hasher.Add(element.InputSlotClass);
+        // Only per-instance elements step.
+        hasher.Add(element.InputSlotClass != 0 ? element.InstanceDataStepRate : 0);
+    }
+
+    hasher.Add(desc.IBStripCutValue);
+    hasher.Add(desc.PrimitiveTopologyType);
+    hasher.Add(desc.NumRenderTargets);
+    for (std::uint32_t i{0}; i < desc.NumRenderTargets; ++i)
+    {
+        hasher.Add(desc.RTVFormats[i]);
+    }
+    hasher.Add(desc.DSVFormat);
+    hasher.Add(desc.SampleCount);
+    hasher.Add(desc.SampleQuality);
+    hasher.Add(desc.NodeMask);
+    hasher.Add(desc.Flags);
+
+    return hasher.Finish();
+}
+
+std::vector<std::uint8_t> Gfx::ReadPipelineLibraryFile(const std::wstring& filename)
+{
+    std::filesystem::path path{filename};
+    std::error_code error{};
+    auto fileSize{std::filesystem::file_size(path, error)};
+    if (error || fileSize < sizeof(LibraryFileHeader))
+    {
+        return {};
+    }
+
+    std::ifstream fin(path, std::ios::binary);
+    LibraryFileHeader header{};
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fin || header.Magic != LibraryFileMagic || header.KeyVersion != PipelineKeyVersion
+        || header.ByteSize != fileSize - sizeof(header))
+    {
+        return {};
+    }
+
+    std::vector<std::uint8_t> blob(static_cast<std::size_t>(header.ByteSize));
+    fin.read(reinterpret_cast<char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+    if (!fin || HashBytes(blob.data(), blob.size()) != header.Hash)
+    {
+        return {};
+    }
+
+    return blob;
+}
+
+bool Gfx::WritePipelineLibraryFile(const std::wstring& filename, const std::vector<std::uint8_t>& blob)
+{
+    std::filesystem::path path{filename};
+    auto temporary{path};
+    temporary += L".tmp";
+
+    {
+        std::ofstream fout(temporary, std::ios::binary | std::ios::trunc);
+        LibraryFileHeader header{LibraryFileMagic, PipelineKeyVersion, blob.size(), HashBytes(blob.data(), blob.size())};
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fout.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+        if (!fout.flush())
+        {
+            return false;
+        }
+    }
+
+    std::error_code error{};
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+PipelineCache::PipelineCache(IPipelineLibrary& library, Jobs::JobSystem* jobs) : mLibrary{library}, mJobs{jobs}
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+    for (auto& entry : mPipelines)
+    {
+        WaitFor(entry);
+    }
+
+    for (auto entry{mPipelines.rbegin()}; entry != mPipelines.rend(); ++entry)
+    {
+        if (entry->Pipeline != NullPipeline)
+        {
+            mLibrary.Release(entry->Pipeline);
+        }
+    }
+}
+
+PipelineId PipelineCache::GetOrCreate(const GraphicsPipelineDesc& desc)
+{
+    auto requested{Clock::now()};
+    auto key{HashGraphicsPipelineDesc(desc)};
+
+    auto id{Find(key)};
+    if (id == InvalidPipelineId)
+    {
+        id = Add(key, InvalidPipelineId);
+        Create(mPipelines[id], desc, requested);
+    }
+
+    Wait(id);
+    return id;
+}
+
+PipelineId PipelineCache::GetOrCreateAsync(const GraphicsPipelineDesc& desc, PipelineId fallback)
+{
+    assert(mJobs != nullptr && "Asynchronous creation needs a job system.");
+    assert(fallback == InvalidPipelineId || fallback < mPipelines.size());
+
+    auto requested{Clock::now()};
+    auto key{HashGraphicsPipelineDesc(desc)};
+
+    auto id{Find(key)};
+    if (id != InvalidPipelineId)
+    {
+        return id;
+    }
+
+    id = Add(key, fallback);
+    // The job gets the entry itself: indexing mPipelines is not safe while requests add to it.
+    auto& entry{mPipelines[id]};
+    mJobs->Run([this, &entry, desc, requested] { Create(entry, desc, requested); }, &entry.Done);
+    return id;
+}
+
+PipelineState PipelineCache::State(PipelineId id) const
+{
+    assert(id < mPipelines.size());
+    return mPipelines[id].State.load(std::memory_order_acquire);
+}
+
+bool PipelineCache::IsReady(PipelineId id) const
+{
+    return State(id) == PipelineState::Ready;
+}
+
+PipelineHandle PipelineCache::Get(PipelineId id) const
+{
+    assert(IsReady(id));
+    return mPipelines[id].Pipeline;
+}
+
+PipelineHandle PipelineCache::Resolve(PipelineId id) const
+{
+    if (IsReady(id))
+    {
+        return mPipelines[id].Pipeline;
+    }
+
+    auto fallback{mPipelines[id].Fallback};
+    return fallback != InvalidPipelineId && IsReady(fallback) ? mPipelines[fallback].Pipeline : NullPipeline;
+}
+
+void PipelineCache::Wait(PipelineId id)
+{
+    assert(id < mPipelines.size());
+    auto& entry{mPipelines[id]};
+
+    WaitFor(entry);
+    if (entry.State.load(std::memory_order_acquire) == PipelineState::Failed)
+    {
+        std::rethrow_exception(entry.Error);
+    }
+}
+
+void PipelineCache::WaitAll()
+{
+    for (PipelineId id{0}; id < mPipelines.size(); ++id)
+    {
+        Wait(id);
+    }
+}
+
+std::uint64_t PipelineCache::Key(PipelineId id) const
+{
+    assert(id < mPipelines.size());
+    return mPipelines[id].Key;
+}
+
+std::size_t PipelineCache::Size() const
+{
+    return mPipelines.size();
+}
+
+PipelineCacheStats PipelineCache::Stats() const
+{
+    PipelineCacheStats stats{};
+    stats.Requests = mRequests;
+    stats.Deduplicated = mDeduplicated;
+    stats.LibraryLoads = mLibraryLoads.load();
+    stats.Compiles = mCompiles.load();
+    stats.Pending = mPending.load();
+    stats.Failed = mFailed.load();
+
+    auto finished{mFinished.load()};
+    if (finished > 0)
+    {
+        stats.AverageLatencyMilliseconds = static_cast<double>(mTotalLatencyMicroseconds.load()) / finished / 1000.0;
+    }
+    stats.MaxLatencyMilliseconds = static_cast<double>(mMaxLatencyMicroseconds.load()) / 1000.0;
+    return stats;
+}
+
+bool PipelineCache::Save(const std::wstring& filename)
+{
+    if (!mLibrary.IsDirty())
+    {
+        return true;
+    }
+
+    return WritePipelineLibraryFile(filename, mLibrary.Serialize());
+}
+
+PipelineId PipelineCache::Find(std::uint64_t key)
+{
+    ++mRequests;
+
+    auto known{mIds.find(key)};
+    if (known == mIds.end())
+    {
+        return InvalidPipelineId;
+    }
+
+    ++mDeduplicated;
+    return known->second;
+}
+
+PipelineId PipelineCache::Add(std::uint64_t key, PipelineId fallback)
+{
+    auto id{static_cast<PipelineId>(mPipelines.size())};
+    auto& entry{mPipelines.emplace_back()};
+    entry.Key = key;
+    entry.Fallback = fallback;
+
+    mIds.emplace(key, id);
+    ++mPending;
+    return id;
+}
+
+void PipelineCache::Create(Entry& entry, const GraphicsPipelineDesc& desc, Clock::time_point requested)
+{
+    try
+    {
+        auto pipeline{mLibrary.Load(entry.Key, desc)};
+        if (pipeline != NullPipeline)
+        {
+            ++mLibraryLoads;
+        }
+        else
+        {
+            pipeline = mLibrary.Create(entry.Key, desc);
+            ++mCompiles;
+        }
+        entry.Pipeline = pipeline;
+    }
+    catch (...)
+    {
+        entry.Error = std::current_exception();
+        ++mFailed;
+    }
+
+    auto latency{static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - requested).count())};
+    mTotalLatencyMicroseconds += latency;
+    auto maxLatency{mMaxLatencyMicroseconds.load()};
+    while (latency > maxLatency && !mMaxLatencyMicroseconds.compare_exchange_weak(maxLatency, latency))
+    {
+    }
+    ++mFinished;
+
+    --mPending;
+    entry.State.store(entry.Error ? PipelineState::Failed : PipelineState::Ready, std::memory_order_release);
+}
+
+void PipelineCache::WaitFor(Entry& entry)
+{
+    // Entries created synchronously never raise their counter.  Waiting also lets a job that has
+    // just published its entry finish with it.
+    if (mJobs != nullptr)
+    {
+        mJobs->Wait(entry.Done);
+    }
+    assert(entry.State.load(std::memory_order_acquire) != PipelineState::Pending);
+}
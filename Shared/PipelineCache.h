@@ -0,0 +1,274 @@
+#ifndef _PIPELINECACHE_
+#define _PIPELINECACHE_
+
+#include "GfxBackend.h"
+#include "Hash.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Graphics pipeline cache keyed by a canonical 64-bit hash of the pipeline description.
+//
+// GraphicsPipelineDesc mirrors D3D12_GRAPHICS_PIPELINE_STATE_DESC without any Windows type; the
+// D3D12 backend converts between the two.  HashGraphicsPipelineDesc() only hashes what can change
+// the compiled pipeline: shaders by content, input element names by string, and fields that the
+// runtime ignores (blend factors of disabled targets, stencil ops with stencil off, formats past
+// NumRenderTargets, ...) are left out.  Keys are stable across runs, so they also name the entries
+// of the on-disk pipeline library.
+namespace Gfx
+{
+constexpr PipelineHandle NullPipeline{0};
+
+struct ShaderBytecode
+{
+    const void* Data{nullptr};
+    std::size_t ByteSize{0};
+};
+
+// D3D12_RENDER_TARGET_BLEND_DESC
+struct RenderTargetBlendDesc
+{
+    std::uint32_t BlendEnable{0};
+    std::uint32_t LogicOpEnable{0};
+    std::uint32_t SrcBlend{2};
+    std::uint32_t DestBlend{1};
+    std::uint32_t BlendOp{1};
+    std::uint32_t SrcBlendAlpha{2};
+    std::uint32_t DestBlendAlpha{1};
+    std::uint32_t BlendOpAlpha{1};
+    std::uint32_t LogicOp{4};
+    std::uint8_t RenderTargetWriteMask{0xf};
+};
+
+// D3D12_BLEND_DESC
+struct BlendDesc
+{
+    std::uint32_t AlphaToCoverageEnable{0};
+    std::uint32_t IndependentBlendEnable{0};
+    RenderTargetBlendDesc RenderTarget[8]{};
+};
+
+// D3D12_RASTERIZER_DESC
+struct RasterizerDesc
+{
+    std::uint32_t FillMode{3};
+    std::uint32_t CullMode{3};
+    std::uint32_t FrontCounterClockwise{0};
+    std::int32_t DepthBias{0};
+    float DepthBiasClamp{0.0f};
+    float SlopeScaledDepthBias{0.0f};
+    std::uint32_t DepthClipEnable{1};
+    std::uint32_t MultisampleEnable{0};
+    std::uint32_t AntialiasedLineEnable{0};
+    std::uint32_t ForcedSampleCount{0};
+    std::uint32_t ConservativeRaster{0};
+};
+
+// D3D12_DEPTH_STENCILOP_DESC
+struct DepthStencilOpDesc
+{
+    std::uint32_t StencilFailOp{1};
+    std::uint32_t StencilDepthFailOp{1};
+    std::uint32_t StencilPassOp{1};
+    std::uint32_t StencilFunc{8};
+};
+
+// D3D12_DEPTH_STENCIL_DESC
+struct DepthStencilDesc
+{
+    std::uint32_t DepthEnable{1};
+    std::uint32_t DepthWriteMask{1};
+    std::uint32_t DepthFunc{2};
+    std::uint32_t StencilEnable{0};
+    std::uint8_t StencilReadMask{0xff};
+    std::uint8_t StencilWriteMask{0xff};
+    DepthStencilOpDesc FrontFace{};
+    DepthStencilOpDesc BackFace{};
+};
+
+// D3D12_INPUT_ELEMENT_DESC
+struct InputElementDesc
+{
+    const char* SemanticName{nullptr};
+    std::uint32_t SemanticIndex{0};
+    std::uint32_t Format{0};
+    std::uint32_t InputSlot{0};
+    std::uint32_t AlignedByteOffset{0};
+    std::uint32_t InputSlotClass{0};
+    std::uint32_t InstanceDataStepRate{0};
+};
+
+// D3D12_GRAPHICS_PIPELINE_STATE_DESC minus stream output and the cached blob.  Defaults match the
+// CD3DX12 default states.  Pointers must stay valid while the desc is hashed or compiled.
+struct GraphicsPipelineDesc
+{
+    RootSignatureHandle RootSignature{0};
+    // Hash of the serialized root signature; handles differ between runs, contents do not.
+    std::uint64_t RootSignatureHash{0};
+    ShaderBytecode VS{};
+    ShaderBytecode PS{};
+    ShaderBytecode DS{};
+    ShaderBytecode HS{};
+    ShaderBytecode GS{};
+    BlendDesc BlendState{};
+    std::uint32_t SampleMask{0xffffffff};
+    RasterizerDesc RasterizerState{};
+    DepthStencilDesc DepthStencilState{};
+    const InputElementDesc* InputElements{nullptr};
+    std::uint32_t InputElementCount{0};
+    std::uint32_t IBStripCutValue{0};
+    std::uint32_t PrimitiveTopologyType{0};
+    std::uint32_t NumRenderTargets{0};
+    std::uint32_t RTVFormats[8]{};
+    std::uint32_t DSVFormat{0};
+    std::uint32_t SampleCount{1};
+    std::uint32_t SampleQuality{0};
+    std::uint32_t NodeMask{0};
+    std::uint32_t Flags{0};
+};
+
+// Bump when the hashed fields change so old pipeline libraries stop matching.
+constexpr std::uint32_t PipelineKeyVersion{1};
+
+[[nodiscard]] std::uint64_t HashGraphicsPipelineDesc(const GraphicsPipelineDesc& desc);
+
+// Compiles pipelines and keeps them in a blob that can be saved and handed back on the next run.
+// Handles it returns hold a reference the caller gives back with Release.
+class IPipelineLibrary
+{
+public:
+    virtual ~IPipelineLibrary() = default;
+
+    // Returns NullPipeline when the library has nothing stored under key.
+    virtual PipelineHandle Load(std::uint64_t key, const GraphicsPipelineDesc& desc) = 0;
+    // Compiles desc and stores the result under key.
+    virtual PipelineHandle Create(std::uint64_t key, const GraphicsPipelineDesc& desc) = 0;
+    virtual void Release(PipelineHandle pipeline) = 0;
+
+    // True when pipelines were stored since the library was loaded or last serialized.
+    [[nodiscard]] virtual bool IsDirty() const = 0;
+    [[nodiscard]] virtual std::vector<std::uint8_t> Serialize() = 0;
+};
+
+// Library files wrap the serialized blob with a header checked on load.  Reading returns an empty
+// blob when the file is missing, truncated or was written for another key version, so a stale
+// cache only costs a recompile.  Writing goes through a temporary file and a rename.
+[[nodiscard]] std::vector<std::uint8_t> ReadPipelineLibraryFile(const std::wstring& filename);
+bool WritePipelineLibraryFile(const std::wstring& filename, const std::vector<std::uint8_t>& blob);
+
+using PipelineId = std::uint32_t;
+
+constexpr PipelineId InvalidPipelineId{0xffffffff};
+
+enum class PipelineState : std::uint32_t
+{
+    Pending,
+    Ready,
+    Failed,
+};
+
+struct PipelineCacheStats
+{
+    std::uint32_t Requests{0};
+    // Requests answered by a pipeline the cache already held or was already creating.
+    std::uint32_t Deduplicated{0};
+    std::uint32_t LibraryLoads{0};
+    std::uint32_t Compiles{0};
+    std::uint32_t Pending{0};
+    std::uint32_t Failed{0};
+    // From request to ready, over the pipelines finished so far.
+    double AverageLatencyMilliseconds{0.0};
+    double MaxLatencyMilliseconds{0.0};
+};
+
+// Deduplicates pipelines by key and hands out dense ids for per-frame lookup.  Pipelines live as
+// long as the cache.
+//
+// GetOrCreateAsync creates pipelines as jobs, so a new pipeline never stalls the requesting
+// thread; Resolve then picks what to bind each frame: the pipeline once ready, else the fallback
+// named at request time, else NullPipeline, meaning the draw should be skipped.
+//
+// Requests, Resolve and Save come from one thread; only the creation itself runs on workers.
+class PipelineCache
+{
+public:
+    // jobs may be null when only GetOrCreate is used.
+    explicit PipelineCache(IPipelineLibrary& library, Jobs::JobSystem* jobs = nullptr);
+    PipelineCache(const PipelineCache& rhs) = delete;
+    PipelineCache& operator=(const PipelineCache& rhs) = delete;
+    // Waits for pipelines still being created.
+    ~PipelineCache();
+
+    // Creates the pipeline on the calling thread, or waits for it if it is already being created.
+    // Rethrows creation errors.
+    PipelineId GetOrCreate(const GraphicsPipelineDesc& desc);
+    // Returns at once.  Everything desc points to must stay valid until the pipeline is no longer
+    // pending.
+    PipelineId GetOrCreateAsync(const GraphicsPipelineDesc& desc, PipelineId fallback = InvalidPipelineId);
+
+    [[nodiscard]] PipelineState State(PipelineId id) const;
+    [[nodiscard]] bool IsReady(PipelineId id) const;
+    // The pipeline itself; it must be ready.
+    [[nodiscard]] PipelineHandle Get(PipelineId id) const;
+    // What to bind for id right now; NullPipeline when neither it nor its fallback is ready.
+    [[nodiscard]] PipelineHandle Resolve(PipelineId id) const;
+
+    // Blocks until id is no longer pending, helping with other jobs, then rethrows its error.
+    void Wait(PipelineId id);
+    void WaitAll();
+
+    [[nodiscard]] std::uint64_t Key(PipelineId id) const;
+    [[nodiscard]] std::size_t Size() const;
+    [[nodiscard]] PipelineCacheStats Stats() const;
+
+    // Writes the library to filename if it changed.  Returns false if the write failed.  Call
+    // while nothing is pending, or pipelines still being created may be left out.
+    bool Save(const std::wstring& filename);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::uint64_t Key{0};
+        PipelineId Fallback{InvalidPipelineId};
+        std::atomic<PipelineState> State{PipelineState::Pending};
+        PipelineHandle Pipeline{NullPipeline};
+        std::exception_ptr Error{};
+        Jobs::JobCounter Done{};
+    };
+
+    // Counts the request; returns the id already holding key, or InvalidPipelineId.
+    PipelineId Find(std::uint64_t key);
+    PipelineId Add(std::uint64_t key, PipelineId fallback);
+    void Create(Entry& entry, const GraphicsPipelineDesc& desc, Clock::time_point requested);
+    void WaitFor(Entry& entry);
+
+    IPipelineLibrary& mLibrary;
+    Jobs::JobSystem* mJobs{nullptr};
+
+    std::unordered_map<std::uint64_t, PipelineId> mIds{};
+    // Entries never move; creation jobs hold references to them.
+    std::deque<Entry> mPipelines{};
+
+    std::uint32_t mRequests{0};
+    std::uint32_t mDeduplicated{0};
+    std::atomic<std::uint32_t> mLibraryLoads{0};
+    std::atomic<std::uint32_t> mCompiles{0};
+    std::atomic<std::uint32_t> mPending{0};
+    std::atomic<std::uint32_t> mFailed{0};
+    std::atomic<std::uint32_t> mFinished{0};
+    std::atomic<std::uint64_t> mTotalLatencyMicroseconds{0};
+    std::atomic<std::uint64_t> mMaxLatencyMicroseconds{0};
+};
+} // namespace Gfx
+
+#endif // _PIPELINECACHE_
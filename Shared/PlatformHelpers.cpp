@@ -1,8 +1,52 @@
 #include "PlatformHelpers.h"
 
+#include "Hash.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <winver.h>
+
+#pragma comment(lib, "version.lib")
+
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+// File version of the d3dcompiler DLL actually loaded, which need not match the headers'
+// D3D_COMPILER_VERSION: the same _47 name has shipped with different compilers.  0 if unknown.
+std::uint64_t LoadedCompilerVersion()
+{
+    // d3dcompiler.lib imports the DLL, so it is loaded for the life of the process.
+    auto module{GetModuleHandleW(D3DCOMPILER_DLL_W)};
+    if (module == nullptr)
+    {
+        return 0;
+    }
+
+    wchar_t path[MAX_PATH]{};
+    if (GetModuleFileNameW(module, path, MAX_PATH) == 0)
+    {
+        return 0;
+    }
+
+    DWORD handle{0};
+    auto infoSize{GetFileVersionInfoSizeW(path, &handle)};
+    std::vector<std::uint8_t> info(infoSize);
+    VS_FIXEDFILEINFO* fixedInfo{nullptr};
+    UINT fixedInfoSize{0};
+    if (infoSize == 0 || !GetFileVersionInfoW(path, 0, infoSize, info.data())
+        || !VerQueryValueW(info.data(), L"\\", reinterpret_cast<void**>(&fixedInfo), &fixedInfoSize)
+        || fixedInfoSize < sizeof(VS_FIXEDFILEINFO))
+    {
+        return 0;
+    }
+
+    return (std::uint64_t{fixedInfo->dwFileVersionMS} << 32) | fixedInfo->dwFileVersionLS;
+}
+} // namespace
+
 ComPtr<ID3D12Resource> D3DUtils::CreateDefaultBuffer(ID3D12Device* device,
                                                      ID3D12GraphicsCommandList* cmdList,
                                                      const void* initData,
@@ -46,52 +90,261 @@ ComPtr<ID3D12Resource> D3DUtils::CreateDefaultBuffer(ID3D12Device* device,
     return defaultBuffer;
 }
 
-ComPtr<ID3DBlob> D3DUtils::LoadShaderBinary(const std::wstring& filename)
+UINT64 D3DUtils::ResourceByteSize(ID3D12Resource* resource)
 {
-    std::ifstream fin(filename, std::ios::binary);
+    auto desc{resource->GetDesc()};
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        return desc.Width;
+    }
 
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = (int)fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
+    ComPtr<ID3D12Device> device{};
+    ThrowIfFailed(resource->GetDevice(IID_PPV_ARGS(device.GetAddressOf())));
+    return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+}
 
-    ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
+void D3DUtils::DeferRelease(Gfx::DeferredReleaseQueue& queue, ComPtr<ID3D12Resource>& resource, UINT64 fenceValue)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    auto byteSize{ResourceByteSize(resource.Get())};
+    queue.Enqueue(fenceValue, byteSize, [released = std::move(resource)]() mutable { released.Reset(); });
+}
 
-    fin.read((char*)blob->GetBufferPointer(), size);
-    fin.close();
+std::wstring D3DUtils::ExecutableRelativePath(const std::wstring& path)
+{
+    std::wstring module(MAX_PATH, L'\0');
+    for (;;)
+    {
+        auto length{GetModuleFileNameW(nullptr, module.data(), static_cast<DWORD>(module.size()))};
+        if (length == 0)
+        {
+            return path;
+        }
+        if (length < module.size())
+        {
+            module.resize(length);
+            break;
+        }
+        // Truncated: long paths can exceed MAX_PATH.
+        module.resize(module.size() * 2);
+    }
 
+    auto separator{module.find_last_of(L"\\/")};
+    return module.substr(0, separator == std::wstring::npos ? 0 : separator + 1) + path;
+}
+
+Files::AsyncFileIO& D3DUtils::DefaultFileIO()
+{
+    static Files::AsyncFileIO fileIO{};
+    return fileIO;
+}
+
+ComPtr<ID3DBlob> D3DUtils::LoadShaderBinary(const std::wstring& filename)
+{
+    auto& fileIO{DefaultFileIO()};
+    auto file{fileIO.Open(filename)};
+    auto byteSize{fileIO.FileSize(file)};
+
+    ComPtr<ID3DBlob> blob;
+    Files::ReadResult read{};
+    try
+    {
+        ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(byteSize), blob.GetAddressOf()));
+        if (byteSize > 0)
+        {
+            Files::ReadRequest request{file, 0, blob->GetBufferPointer(), static_cast<std::size_t>(byteSize), {}};
+            read = fileIO.Read(std::move(request)).get();
+        }
+    }
+    catch (...)
+    {
+        fileIO.Close(file);
+        throw;
+    }
+    fileIO.Close(file);
+
+    if (read.Error != 0 || read.ByteCount != byteSize)
+    {
+        throw std::runtime_error("Cannot read " + std::filesystem::path{filename}.u8string() + ": error "
+                                 + std::to_string(read.Error));
+    }
     return blob;
 }
 
-ComPtr<ID3DBlob> D3DUtils::CompileShader(const std::wstring& filename,
-                                         const D3D_SHADER_MACRO* defines,
-                                         const std::string& entrypoint,
-                                         const std::string& target)
+UINT D3DUtils::ShaderCompileFlags()
 {
     UINT compileFlags = 0;
 #ifndef NDEBUG
     compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+    return compileFlags;
+}
 
-    HRESULT hr = S_OK;
+ComPtr<ID3DBlob> D3DUtils::CompileShader(const std::wstring& filename,
+                                         const D3D_SHADER_MACRO* defines,
+                                         const std::string& entrypoint,
+                                         const std::string& target)
+{
+    Gfx::ShaderCompileRequest request{filename, {}, entrypoint, target, ShaderCompileFlags()};
+    for (auto* define{defines}; define != nullptr && define->Name != nullptr; ++define)
+    {
+        request.Defines.push_back(Gfx::ShaderDefine{define->Name, define->Definition != nullptr ? define->Definition : ""});
+    }
+
+    return LoadShaderBinary(DefaultShaderCache().Resolve(request));
+}
+
+std::uint64_t D3DUtils::D3DShaderCompiler::Identity() const
+{
+    Gfx::Hasher hasher{};
+    hasher.AddString("D3DCompileFromFile");
+    hasher.Add(std::uint32_t{D3D_COMPILER_VERSION});
+    // Keys are computed per request; the DLL cannot change while the process runs.
+    static const auto loadedVersion{LoadedCompilerVersion()};
+    hasher.Add(loadedVersion);
+    return hasher.Finish();
+}
+
+bool D3DUtils::D3DShaderCompiler::Compile(const Gfx::ShaderCompileRequest& request,
+                                          std::vector<std::uint8_t>& bytecode,
+                                          std::string& errors)
+{
+    std::vector<D3D_SHADER_MACRO> defines{};
+    defines.reserve(request.Defines.size() + 1);
+    for (const auto& define : request.Defines)
+    {
+        defines.push_back(D3D_SHADER_MACRO{define.Name.c_str(), define.Value.c_str()});
+    }
+    defines.push_back(D3D_SHADER_MACRO{nullptr, nullptr});
 
     ComPtr<ID3DBlob> byteCode = nullptr;
-    ComPtr<ID3DBlob> errors;
-    hr = D3DCompileFromFile(filename.c_str(),
-                            defines,
-                            D3D_COMPILE_STANDARD_FILE_INCLUDE,
-                            entrypoint.c_str(),
-                            target.c_str(),
-                            compileFlags,
-                            0,
-                            &byteCode,
-                            &errors);
-
-    if (errors != nullptr)
+    ComPtr<ID3DBlob> errorBlob;
+    HRESULT hr = D3DCompileFromFile(request.Filename.c_str(),
+                                    defines.data(),
+                                    D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                                    request.EntryPoint.c_str(),
+                                    request.Target.c_str(),
+                                    request.Flags,
+                                    0,
+                                    &byteCode,
+                                    &errorBlob);
+
+    if (errorBlob != nullptr)
     {
-        OutputDebugStringA((char*)errors->GetBufferPointer());
+        OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+        errors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
     }
     ThrowIfFailed(hr);
 
-    return byteCode;
+    const auto* data{static_cast<const std::uint8_t*>(byteCode->GetBufferPointer())};
+    bytecode.assign(data, data + byteCode->GetBufferSize());
+    return true;
+}
+
+Gfx::ShaderCache& D3DUtils::DefaultShaderCache()
+{
+    static D3DShaderCompiler compiler{};
+    static Gfx::ShaderCache cache{compiler, ExecutableRelativePath(L"ShaderCache"), &DefaultFileIO()};
+    return cache;
+}
+
+D3DUtils::StagingDescriptorHeap::StagingDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity)
+    : mAllocator{capacity}
+{
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+    heapDesc.NumDescriptors = capacity;
+    heapDesc.Type = type;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+    mCpuStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+    mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+}
+
+UINT D3DUtils::StagingDescriptorHeap::Allocate(UINT count)
+{
+    auto index{mAllocator.Allocate(count)};
+    if (index == Gfx::InvalidDescriptorIndex)
+    {
+        throw std::runtime_error{"Staging descriptor heap exhausted: no free range of " + std::to_string(count)
+                                 + " descriptors."};
+    }
+    return index;
+}
+
+void D3DUtils::StagingDescriptorHeap::Free(UINT index, UINT count, UINT64 fenceValue)
+{
+    mAllocator.FreeAfter(index, count, fenceValue);
+}
+
+void D3DUtils::StagingDescriptorHeap::ReleaseCompleted(UINT64 completedFenceValue)
+{
+    mAllocator.ReleaseCompleted(completedFenceValue);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3DUtils::StagingDescriptorHeap::CpuHandle(UINT index) const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(mCpuStart, static_cast<INT>(index), mDescriptorSize);
+}
+
+const Gfx::DescriptorFreeList& D3DUtils::StagingDescriptorHeap::Allocator() const
+{
+    return mAllocator;
+}
+
+D3DUtils::DynamicDescriptorHeap::DynamicDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity)
+    : mDevice{device}, mType{type}, mAllocator{capacity}
+{
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+    heapDesc.NumDescriptors = capacity;
+    heapDesc.Type = type;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+    mCpuStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+    mGpuStart = mHeap->GetGPUDescriptorHandleForHeapStart();
+    mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+}
+
+ID3D12DescriptorHeap* D3DUtils::DynamicDescriptorHeap::Heap() const
+{
+    return mHeap.Get();
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3DUtils::DynamicDescriptorHeap::CopyTable(const StagingDescriptorHeap& staging,
+                                                                       UINT first,
+                                                                       UINT count)
+{
+    auto index{mAllocator.Allocate(count)};
+    if (index == Gfx::InvalidDescriptorIndex)
+    {
+        throw std::runtime_error{"Dynamic descriptor heap full: too many descriptors in flight."};
+    }
+
+    mDevice->CopyDescriptorsSimple(count,
+                                   CD3DX12_CPU_DESCRIPTOR_HANDLE(mCpuStart, static_cast<INT>(index), mDescriptorSize),
+                                   staging.CpuHandle(first),
+                                   mType);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(mGpuStart, static_cast<INT>(index), mDescriptorSize);
+}
+
+void D3DUtils::DynamicDescriptorHeap::FinishFrame(UINT64 fenceValue)
+{
+    mAllocator.FinishFrame(fenceValue);
+}
+
+void D3DUtils::DynamicDescriptorHeap::ReleaseCompleted(UINT64 completedFenceValue)
+{
+    mAllocator.ReleaseCompleted(completedFenceValue);
+}
+
+const Gfx::DescriptorRing& D3DUtils::DynamicDescriptorHeap::Allocator() const
+{
+    return mAllocator;
 }
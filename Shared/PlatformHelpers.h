@@ -13,11 +13,19 @@
 
 #pragma warning(disable : 4324)
 
+#include "AsyncFileIO.h"
+#include "DeferredRelease.h"
+#include "DescriptorAllocator.h"
+#include "ResourceStateTracker.h"
+#include "ShaderCache.h"
+#include "StreamCopy.h"
 #include "directx/d3dx12.h"
 
 #include <D3Dcompiler.h>
 #include <DirectXCollision.h>
 #include <array>
+#include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <d3d12.h>
@@ -26,6 +34,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <wrl.h>
 
 #ifndef MAKEFOURCC
@@ -145,13 +154,48 @@ Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device,
                                                            UINT64 byteSize,
                                                            Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+// Memory resource occupies: its width for buffers, its allocation size for textures.
+UINT64 ResourceByteSize(ID3D12Resource* resource);
+
+// Hands resource to queue, to be released once fenceValue completes, and resets it.  Null
+// resources are ignored.
+void DeferRelease(Gfx::DeferredReleaseQueue& queue, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, UINT64 fenceValue);
+
+// path resolved against the directory of the executable rather than the working directory, which
+// depends on how the app was started.  Returns path unchanged if the module path is unavailable.
+std::wstring ExecutableRelativePath(const std::wstring& path);
+
+// Process-wide reader that shader sources and bytecode are loaded through.
+Files::AsyncFileIO& DefaultFileIO();
+
+// Read through DefaultFileIO() straight into the blob.  Throws std::runtime_error when the file
+// cannot be read.
 Microsoft::WRL::ComPtr<ID3DBlob> LoadShaderBinary(const std::wstring& filename);
 
+// D3DCOMPILE_* flags CompileShader uses: debug info and no optimization in debug builds.
+UINT ShaderCompileFlags();
+
+// Compiles through DefaultShaderCache() and loads the cached bytecode, so the compiler only runs
+// when the source, an include, the defines or the flags changed since the last run.
 Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(const std::wstring& filename,
                                                const D3D_SHADER_MACRO* defines,
                                                const std::string& entrypoint,
                                                const std::string& target);
 
+// D3DCompileFromFile with the standard file include handler.  Errors go to the debug output and
+// are thrown as com_exception.  Identity() covers both the header's D3D_COMPILER_VERSION and the
+// file version of the d3dcompiler DLL loaded at run time.
+class D3DShaderCompiler : public Gfx::IShaderCompiler
+{
+public:
+    [[nodiscard]] std::uint64_t Identity() const override;
+    bool Compile(const Gfx::ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode, std::string& errors) override;
+};
+
+// Process-wide cache in the ShaderCache directory next to the executable, reading sources through
+// DefaultFileIO().
+Gfx::ShaderCache& DefaultShaderCache();
+
 inline UINT CalcConstantBufferByteSize(UINT byteSize)
 {
     return (byteSize + 255) & ~255;
@@ -176,6 +220,9 @@ struct MeshGeometry
 
     std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, N> VertexBufferGPU{};
     Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU{};
+    // Where the data starts in the resources above, which may be shared with other meshes.
+    std::array<UINT64, N> VertexBufferOffset{};
+    UINT64 IndexBufferOffset = 0;
 
     std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, N> VertexBufferUploader{};
     Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader{};
@@ -193,7 +240,7 @@ struct MeshGeometry
     {
         for (size_t i = 0; i < N; ++i)
         {
-            VertexBufferViews[i].BufferLocation = VertexBufferGPU[i]->GetGPUVirtualAddress();
+            VertexBufferViews[i].BufferLocation = VertexBufferGPU[i]->GetGPUVirtualAddress() + VertexBufferOffset[i];
             VertexBufferViews[i].StrideInBytes = static_cast<UINT>(VertexByteStride[i]);
             VertexBufferViews[i].SizeInBytes = VertexBufferByteSize[i];
         }
@@ -203,7 +250,7 @@ struct MeshGeometry
     [[nodiscard]] D3D12_INDEX_BUFFER_VIEW IndexBufferView() const
     {
         D3D12_INDEX_BUFFER_VIEW ibv{};
-        ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
+        ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress() + IndexBufferOffset;
         ibv.Format = IndexFormat;
         ibv.SizeInBytes = IndexBufferByteSize;
 
@@ -218,6 +265,16 @@ struct MeshGeometry
         }
         IndexBufferUploader = nullptr;
     }
+
+    // Releases the uploaders once fenceValue, signaled after the copies from them, completes.
+    void DisposeUploaders(Gfx::DeferredReleaseQueue& queue, UINT64 fenceValue)
+    {
+        for (auto& i : VertexBufferUploader)
+        {
+            DeferRelease(queue, i, fenceValue);
+        }
+        DeferRelease(queue, IndexBufferUploader, fenceValue);
+    }
 };
 
 template <typename T>
@@ -271,38 +328,206 @@ public:
 
     void CopyData(int elementIndex, const T& data)
     {
+        AssertNotInFlight();
         memcpy(&mMappedData[static_cast<size_t>(elementIndex) * mElementByteSize], &data, sizeof(T));
     }
 
+    // Batched copy of count consecutive elements starting at firstElement.  Packed buffers are
+    // written as one contiguous stream of full cache lines; constant buffers one element per
+    // 256-byte slot.  Either way the non-temporal stores are fenced once at the end of the batch.
+    void CopyRange(int firstElement, const T* data, size_t count)
+    {
+        AssertNotInFlight();
+        BYTE* dst{&mMappedData[static_cast<size_t>(firstElement) * mElementByteSize]};
+        if (!mIsConstantBuffer)
+        {
+            StreamCopy(dst, data, count * sizeof(T));
+        }
+        else
+        {
+            for (size_t i{0}; i < count; ++i)
+            {
+                StreamCopy(dst + i * mElementByteSize, &data[i], sizeof(T));
+            }
+        }
+        StreamCopyFence();
+    }
+
+    // Debug builds assert that the buffer is not written while the GPU may still read it, i.e.
+    // before fence has reached *fenceValue (typically the owning FrameResource::Fence).
+    void SetInFlightGuard(ID3D12Fence* fence, const UINT64* fenceValue)
+    {
+        mGuardFence = fence;
+        mGuardFenceValue = fenceValue;
+    }
+
 private:
+    void AssertNotInFlight() const
+    {
+#ifndef NDEBUG
+        assert((mGuardFence == nullptr || mGuardFence->GetCompletedValue() >= *mGuardFenceValue)
+               && "Writing to an upload buffer that is still in flight.");
+#endif
+    }
+
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer{};
     BYTE* mMappedData{nullptr};
 
+    ID3D12Fence* mGuardFence{nullptr};
+    const UINT64* mGuardFenceValue{nullptr};
+
     ULONGLONG mElementByteSize{0};
     bool mIsConstantBuffer{false};
 };
 
+// A fixed set of command allocator/list pairs, one per recording thread, so several threads can
+// record in parallel.  Every list is created closed.
+class CommandListPool
+{
+public:
+    CommandListPool(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, UINT listCount)
+    {
+        mAllocators.resize(listCount);
+        mCommandLists.resize(listCount);
+        for (UINT i{0}; i < listCount; ++i)
+        {
+            DirectX::ThrowIfFailed(device->CreateCommandAllocator(type, IID_PPV_ARGS(&mAllocators[i])));
+            DirectX::ThrowIfFailed(
+                device->CreateCommandList(0, type, mAllocators[i].Get(), nullptr, IID_PPV_ARGS(&mCommandLists[i])));
+            DirectX::ThrowIfFailed(mCommandLists[i]->Close());
+        }
+    }
+
+    CommandListPool(const CommandListPool& rhs) = delete;
+    CommandListPool& operator=(const CommandListPool& rhs) = delete;
+    ~CommandListPool() = default;
+
+    [[nodiscard]] UINT Size() const
+    {
+        return static_cast<UINT>(mCommandLists.size());
+    }
+
+    // Resets the allocator and list at index for recording.  The GPU must have finished the
+    // previous submission of that list.  Different indices may be begun from different threads.
+    ID3D12GraphicsCommandList* Begin(UINT index, ID3D12PipelineState* initialState)
+    {
+        DirectX::ThrowIfFailed(mAllocators[index]->Reset());
+        DirectX::ThrowIfFailed(mCommandLists[index]->Reset(mAllocators[index].Get(), initialState));
+        return mCommandLists[index].Get();
+    }
+
+    [[nodiscard]] ID3D12GraphicsCommandList* List(UINT index) const
+    {
+        return mCommandLists[index].Get();
+    }
+
+private:
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mAllocators{};
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> mCommandLists{};
+};
+
+// CPU-only descriptor heap for long-lived descriptors.  Ranges are allocated from a free list and
+// returned once the GPU is done with the last frame that copied them.
+class StagingDescriptorHeap
+{
+public:
+    StagingDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity);
+    StagingDescriptorHeap(const StagingDescriptorHeap& rhs) = delete;
+    StagingDescriptorHeap& operator=(const StagingDescriptorHeap& rhs) = delete;
+    ~StagingDescriptorHeap() = default;
+
+    // Throws when the heap has no free range of count descriptors.
+    UINT Allocate(UINT count = 1);
+    // The range becomes reusable once fenceValue completes.
+    void Free(UINT index, UINT count, UINT64 fenceValue);
+    void ReleaseCompleted(UINT64 completedFenceValue);
+
+    [[nodiscard]] D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index) const;
+    [[nodiscard]] const Gfx::DescriptorFreeList& Allocator() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap{};
+    D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart{};
+    UINT mDescriptorSize{0};
+    Gfx::DescriptorFreeList mAllocator;
+};
+
+// Shader-visible heap rebuilt every frame: descriptor tables are copied in from staging heaps as
+// they are needed, into a ring whose slots retire with the frame's fence.  Not thread-safe; build
+// the frame's tables before recording on worker threads.
+class DynamicDescriptorHeap
+{
+public:
+    DynamicDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity);
+    DynamicDescriptorHeap(const DynamicDescriptorHeap& rhs) = delete;
+    DynamicDescriptorHeap& operator=(const DynamicDescriptorHeap& rhs) = delete;
+    ~DynamicDescriptorHeap() = default;
+
+    [[nodiscard]] ID3D12DescriptorHeap* Heap() const;
+
+    // Copies count descriptors starting at first in staging into a contiguous table.  Throws when
+    // the ring is full of in-flight frames.
+    D3D12_GPU_DESCRIPTOR_HANDLE CopyTable(const StagingDescriptorHeap& staging, UINT first, UINT count);
+
+    // Tables copied since the previous call retire once fenceValue completes.
+    void FinishFrame(UINT64 fenceValue);
+    void ReleaseCompleted(UINT64 completedFenceValue);
+
+    [[nodiscard]] const Gfx::DescriptorRing& Allocator() const;
+
+private:
+    ID3D12Device* mDevice{nullptr};
+    D3D12_DESCRIPTOR_HEAP_TYPE mType{D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV};
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap{};
+    D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart{};
+    D3D12_GPU_DESCRIPTOR_HANDLE mGpuStart{};
+    UINT mDescriptorSize{0};
+    Gfx::DescriptorRing mAllocator;
+};
+
 template <typename ObjectConstants, typename PassConstants>
 struct FrameResource
 {
 public:
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount) :
+    // Pass objectsAsConstantBuffer = false to pack ObjectCB tightly for use as a structured buffer
+    // instead of padding every element to 256 bytes for constant buffer views.
+    // recordListCount > 0 creates a pool of lists for recording this frame on several threads.
+    FrameResource(ID3D12Device* device,
+                  UINT passCount,
+                  UINT objectCount,
+                  bool objectsAsConstantBuffer = true,
+                  UINT recordListCount = 0) :
         PassCB{std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true)},
-        ObjectCB{std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true)}
+        ObjectCB{std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, objectsAsConstantBuffer)}
     {
         DirectX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&CmdListAlloc)));
+
+        if (recordListCount > 0)
+        {
+            RecordLists = std::make_unique<CommandListPool>(device, D3D12_COMMAND_LIST_TYPE_DIRECT, recordListCount);
+        }
     }
 
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource() = default;
 
+    // Lets debug builds catch CPU writes into this frame's buffers before Fence has completed.
+    void SetInFlightGuard(ID3D12Fence* fence)
+    {
+        PassCB->SetInFlightGuard(fence, &Fence);
+        ObjectCB->SetInFlightGuard(fence, &Fence);
+    }
+
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc{};
+    std::unique_ptr<CommandListPool> RecordLists{};
 
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB{};
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB{};
 
     UINT64 Fence{0};
+    // How long the CPU last waited for Fence before it could reuse this frame resource.
+    std::chrono::nanoseconds CpuWaitTime{0};
 };
 } // namespace D3DUtils
 
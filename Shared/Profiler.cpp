@@ -0,0 +1,511 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Profiling;
+
+namespace
+{
+struct ZoneEvent
+{
+    const char* Name{nullptr};
+    Clock::time_point Begin{};
+    Clock::time_point End{};
+    std::uint64_t Frame{0};
+    // 0 for the recording thread's own timeline.
+    std::uint32_t Track{0};
+};
+
+// Zones of one thread.  Single producer, the owning thread; single consumer, the writer thread.
+class ThreadBuffer
+{
+public:
+    static constexpr std::uint64_t Capacity{1U << 15U};
+
+    explicit ThreadBuffer(std::uint32_t id) : mId{id}
+    {
+    }
+    ThreadBuffer(const ThreadBuffer& rhs) = delete;
+    ThreadBuffer& operator=(const ThreadBuffer& rhs) = delete;
+
+    // Returns false when the ring is full.
+    bool Push(const ZoneEvent& event)
+    {
+        auto head{mHead.load(std::memory_order_relaxed)};
+        if (head - mTail.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        mEvents[head & (Capacity - 1)] = event;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Function>
+    void Drain(Function&& function)
+    {
+        auto tail{mTail.load(std::memory_order_relaxed)};
+        auto head{mHead.load(std::memory_order_acquire)};
+        for (; tail != head; ++tail)
+        {
+            function(mEvents[tail & (Capacity - 1)]);
+        }
+        mTail.store(tail, std::memory_order_release);
+    }
+
+    [[nodiscard]] std::uint32_t Id() const
+    {
+        return mId;
+    }
+    [[nodiscard]] const char* Name() const
+    {
+        return mName.load(std::memory_order_acquire);
+    }
+    void SetName(const char* name)
+    {
+        mName.store(name, std::memory_order_release);
+    }
+
+private:
+    std::uint32_t mId{0};
+    std::atomic<const char*> mName{nullptr};
+
+    alignas(64) std::atomic<std::uint64_t> mHead{0};
+    alignas(64) std::atomic<std::uint64_t> mTail{0};
+    std::unique_ptr<ZoneEvent[]> mEvents{std::make_unique<ZoneEvent[]>(Capacity)};
+};
+
+class Profiler
+{
+public:
+    Profiler() = default;
+    Profiler(const Profiler& rhs) = delete;
+    Profiler& operator=(const Profiler& rhs) = delete;
+    ~Profiler()
+    {
+        StopCapture();
+        if (mWriter.joinable())
+        {
+            mWriter.join();
+        }
+    }
+
+    bool StartCapture(const std::wstring& filename)
+    {
+        std::unique_lock<std::mutex> lock{mMutex};
+        if (mCapturing.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        // The previous capture may still be finishing its file.
+        if (mWriter.joinable())
+        {
+            lock.unlock();
+            mWriter.join();
+            lock.lock();
+        }
+
+        std::ofstream file(std::filesystem::path{filename}, std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error{"Failed to create trace file: " + std::filesystem::path{filename}.u8string()};
+        }
+
+        mWrittenCount.store(0, std::memory_order_relaxed);
+        mDroppedCount.store(0, std::memory_order_relaxed);
+        mStop = false;
+        mWriter = std::thread{&Profiler::WriterMain, this, std::move(file), Clock::now()};
+        mCapturing.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void StopCapture()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mCapturing.store(false, std::memory_order_relaxed);
+            mStop = true;
+        }
+        mWake.notify_one();
+    }
+
+    [[nodiscard]] bool IsCapturing() const
+    {
+        return mCapturing.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] ProfilerStats Stats() const
+    {
+        return ProfilerStats{mWrittenCount.load(std::memory_order_relaxed),
+                             mDroppedCount.load(std::memory_order_relaxed),
+                             mFrameCount.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] std::uint64_t FrameCount() const
+    {
+        return mFrameCount.load(std::memory_order_relaxed);
+    }
+
+    void MarkFrame()
+    {
+        auto now{Clock::now()};
+        auto begin{std::exchange(mFrameBegin, now)};
+        // Zones of the frame that just ended saw the count before the increment.
+        auto frame{mFrameCount.fetch_add(1, std::memory_order_relaxed)};
+        if (IsCapturing())
+        {
+            Record(ZoneEvent{"Frame", begin, now, frame});
+        }
+    }
+
+    [[nodiscard]] bool IsZoneTimingEnabled() const
+    {
+        return mZoneTimingEnabled.load(std::memory_order_relaxed);
+    }
+
+    void SetZoneTimingEnabled(bool enabled)
+    {
+        mZoneTimingEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void AddZoneTime(const char* name, Clock::duration duration)
+    {
+        // Open addressing on the name's address; a slot, once claimed, keeps its name.
+        auto hash{static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(name)) * 0x9E3779B97F4A7C15ULL >> 32U};
+        for (std::uint32_t probe{0}; probe < MaxZoneNames; ++probe)
+        {
+            auto& total{mZoneTotals[(hash + probe) % MaxZoneNames]};
+            auto* slotName{total.Name.load(std::memory_order_acquire)};
+            if (slotName == nullptr && total.Name.compare_exchange_strong(slotName, name, std::memory_order_acq_rel))
+            {
+                slotName = name;
+            }
+            if (slotName != name)
+            {
+                continue;
+            }
+
+            auto nanoseconds{std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+            total.Nanoseconds.fetch_add(static_cast<std::uint64_t>(nanoseconds), std::memory_order_relaxed);
+            total.Count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    std::uint32_t TakeZoneTimings(ZoneTiming* timings, std::uint32_t capacity)
+    {
+        std::uint32_t count{0};
+        for (auto& total : mZoneTotals)
+        {
+            auto* name{total.Name.load(std::memory_order_acquire)};
+            if (name == nullptr || total.Count.load(std::memory_order_relaxed) == 0)
+            {
+                continue;
+            }
+            // A zone ending in between may be split across two takes; that evens out.
+            auto zoneCount{total.Count.exchange(0, std::memory_order_relaxed)};
+            auto nanoseconds{total.Nanoseconds.exchange(0, std::memory_order_relaxed)};
+            auto totalMs{static_cast<double>(nanoseconds) / 1.0e6};
+
+            auto* timing{std::find_if(timings, timings + count, [name](const ZoneTiming& entry) {
+                return std::strcmp(entry.Name, name) == 0;
+            })};
+            if (timing != timings + count)
+            {
+                timing->TotalMs += totalMs;
+                timing->Count += zoneCount;
+            }
+            else if (count < capacity)
+            {
+                timings[count++] = ZoneTiming{name, totalMs, zoneCount};
+            }
+        }
+        return count;
+    }
+
+    void Record(const ZoneEvent& event)
+    {
+        if (!CurrentBuffer().Push(event))
+        {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ThreadBuffer& CurrentBuffer()
+    {
+        thread_local ThreadBuffer* buffer{nullptr};
+        if (buffer == nullptr)
+        {
+            // Buffers are kept for the life of the profiler, past their thread's.
+            std::lock_guard<std::mutex> lock{mMutex};
+            mBuffers.push_back(std::make_unique<ThreadBuffer>(mNextId++));
+            buffer = mBuffers.back().get();
+        }
+        return *buffer;
+    }
+
+    std::uint32_t CreateTrack(const char* name)
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mTracks.push_back(Track{mNextId++, name});
+        return mTracks.back().Id;
+    }
+
+private:
+    void WriterMain(std::ofstream file, Clock::time_point start)
+    {
+        file << "{\"traceEvents\":[\n";
+        auto isFirst{true};
+        std::vector<ThreadBuffer*> buffers{};
+        std::vector<Track> tracks{};
+
+        std::unique_lock<std::mutex> lock{mMutex};
+        while (true)
+        {
+            auto isStopping{mStop};
+            buffers.clear();
+            for (const auto& buffer : mBuffers)
+            {
+                buffers.push_back(buffer.get());
+            }
+            tracks = mTracks;
+            lock.unlock();
+
+            for (auto* buffer : buffers)
+            {
+                std::uint64_t writtenCount{0};
+                buffer->Drain([&](const ZoneEvent& event) {
+                    // Left over from before this capture.
+                    if (event.Begin < start)
+                    {
+                        return;
+                    }
+                    file << (isFirst ? "" : ",\n");
+                    WriteZone(file, event, start, event.Track != 0 ? event.Track : buffer->Id());
+                    isFirst = false;
+                    ++writtenCount;
+                });
+                mWrittenCount.fetch_add(writtenCount, std::memory_order_relaxed);
+            }
+
+            lock.lock();
+            if (isStopping)
+            {
+                break;
+            }
+            mWake.wait_for(lock, std::chrono::milliseconds{10}, [this] { return mStop; });
+        }
+        lock.unlock();
+
+        for (auto* buffer : buffers)
+        {
+            WriteThreadName(file, isFirst, buffer->Id(), buffer->Name());
+        }
+        for (const auto& track : tracks)
+        {
+            WriteThreadName(file, isFirst, track.Id, track.Name);
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    static void WriteZone(std::ofstream& file, const ZoneEvent& event, Clock::time_point start, std::uint32_t threadId)
+    {
+        // Timestamps are in microseconds.
+        using Microseconds = std::chrono::duration<double, std::micro>;
+        char times[64]{};
+        std::snprintf(times,
+                      sizeof(times),
+                      R"("ts":%.3f,"dur":%.3f)",
+                      Microseconds{event.Begin - start}.count(),
+                      Microseconds{event.End - event.Begin}.count());
+
+        file << R"({"name":)";
+        WriteString(file, event.Name);
+        file << R"(,"ph":"X",)" << times << R"(,"pid":1,"tid":)" << threadId << R"(,"args":{"frame":)" << event.Frame
+             << "}}";
+    }
+
+    static void WriteThreadName(std::ofstream& file, bool& isFirst, std::uint32_t threadId, const char* name)
+    {
+        file << (isFirst ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << threadId
+             << R"(,"args":{"name":)";
+        if (name != nullptr)
+        {
+            WriteString(file, name);
+        }
+        else
+        {
+            file << "\"Thread " << threadId << '"';
+        }
+        file << "}}";
+        isFirst = false;
+    }
+
+    static void WriteString(std::ofstream& file, const char* text)
+    {
+        file << '"';
+        for (; *text != '\0'; ++text)
+        {
+            auto c{*text};
+            if (c == '"' || c == '\\')
+            {
+                file << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8]{};
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                file << escaped;
+            }
+            else
+            {
+                file << c;
+            }
+        }
+        file << '"';
+    }
+
+    std::atomic<bool> mCapturing{false};
+    std::atomic<std::uint64_t> mFrameCount{0};
+    std::atomic<std::uint64_t> mWrittenCount{0};
+    std::atomic<std::uint64_t> mDroppedCount{0};
+
+    struct ZoneTotal
+    {
+        std::atomic<const char*> Name{nullptr};
+        std::atomic<std::uint64_t> Nanoseconds{0};
+        std::atomic<std::uint32_t> Count{0};
+    };
+    std::atomic<bool> mZoneTimingEnabled{false};
+    std::array<ZoneTotal, MaxZoneNames> mZoneTotals{};
+
+    // MarkFrame's thread only.
+    Clock::time_point mFrameBegin{};
+
+    struct Track
+    {
+        std::uint32_t Id{0};
+        const char* Name{nullptr};
+    };
+
+    // Guards the members below.
+    std::mutex mMutex{};
+    std::condition_variable mWake{};
+    std::vector<std::unique_ptr<ThreadBuffer>> mBuffers{};
+    std::vector<Track> mTracks{};
+    // Thread and track ids share one space, as trace thread ids.
+    std::uint32_t mNextId{1};
+    std::thread mWriter{};
+    bool mStop{false};
+};
+
+Profiler& Instance()
+{
+    static Profiler profiler{};
+    return profiler;
+}
+} // namespace
+
+bool Profiling::StartCapture(const std::wstring& filename)
+{
+    return Instance().StartCapture(filename);
+}
+
+void Profiling::StopCapture()
+{
+    Instance().StopCapture();
+}
+
+bool Profiling::IsCapturing()
+{
+    return Instance().IsCapturing();
+}
+
+ProfilerStats Profiling::Stats()
+{
+    return Instance().Stats();
+}
+
+void Profiling::MarkFrame()
+{
+    Instance().MarkFrame();
+}
+
+void Profiling::SetThreadName(const char* name)
+{
+    Instance().CurrentBuffer().SetName(name);
+}
+
+void Profiling::SetZoneTimingEnabled(bool enabled)
+{
+    Instance().SetZoneTimingEnabled(enabled);
+}
+
+bool Profiling::IsZoneTimingEnabled()
+{
+    return Instance().IsZoneTimingEnabled();
+}
+
+std::uint32_t Profiling::TakeZoneTimings(ZoneTiming* timings, std::uint32_t capacity)
+{
+    return Instance().TakeZoneTimings(timings, capacity);
+}
+
+std::uint32_t Profiling::CreateTrack(const char* name)
+{
+    return Instance().CreateTrack(name);
+}
+
+void Profiling::RecordZone(std::uint32_t track,
+                           const char* name,
+                           Clock::time_point begin,
+                           Clock::time_point end,
+                           std::uint64_t frame)
+{
+    auto& profiler{Instance()};
+    if (profiler.IsCapturing())
+    {
+        profiler.Record(ZoneEvent{name, begin, end, frame, track});
+    }
+}
+
+Zone::Zone(const char* name)
+{
+    auto& profiler{Instance()};
+    if (profiler.IsCapturing() || profiler.IsZoneTimingEnabled())
+    {
+        mName = name;
+        mBegin = Clock::now();
+        mFrame = profiler.FrameCount();
+    }
+}
+
+Zone::~Zone()
+{
+    if (mName != nullptr)
+    {
+        auto end{Clock::now()};
+        auto& profiler{Instance()};
+        if (profiler.IsCapturing())
+        {
+            profiler.Record(ZoneEvent{mName, mBegin, end, mFrame});
+        }
+        if (profiler.IsZoneTimingEnabled())
+        {
+            profiler.AddZoneTime(mName, end - mBegin);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef _PROFILER_
+#define _PROFILER_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped-zone CPU profiler that writes Chrome trace-event JSON, for chrome://tracing or Perfetto.
+//
+// Zones are timed with steady_clock and recorded into a lock-free ring owned by the thread that
+// ran them; zones nest by their timestamps.  While a capture runs, a writer thread drains the rings
+// into the file, so capturing does not stop the frame loop.  Outside a capture a zone costs one
+// relaxed load.  A full ring drops zones rather than blocking; ProfilerStats counts them.
+//
+// Zones can also be summed per name while timing is enabled, capture or not, for live displays.
+//
+// Every function may be called from any thread.  MarkFrame is meant for the thread running the
+// frame loop.  Define PROFILER_DISABLED to compile the macros out.
+namespace Profiling
+{
+using Clock = std::chrono::steady_clock;
+
+struct ProfilerStats
+{
+    // Of the current capture, or of the last one once it has stopped.
+    std::uint64_t WrittenCount{0};
+    std::uint64_t DroppedCount{0};
+    // Frames marked since startup.
+    std::uint64_t FrameCount{0};
+};
+
+struct ZoneTiming
+{
+    const char* Name{nullptr};
+    double TotalMs{0.0};
+    std::uint32_t Count{0};
+};
+
+// Starts writing every zone that begins from now on to filename.  Returns false when a capture is
+// already running.  Throws std::runtime_error when the file cannot be created.
+bool StartCapture(const std::wstring& filename);
+// Returns at once; the writer thread drains the zones recorded so far and closes the file.
+void StopCapture();
+[[nodiscard]] bool IsCapturing();
+[[nodiscard]] ProfilerStats Stats();
+
+// Ends the frame that began at the previous call and starts the next one; the frame shows as a
+// zone of its own.  Zones carry the number of the frame they ran in.
+void MarkFrame();
+// Names the calling thread in the trace.  name must outlive the capture, a literal is best.
+void SetThreadName(const char* name);
+
+// Per-name totals cover the first MaxZoneNames zone names seen; zones named past that are not timed.
+constexpr std::uint32_t MaxZoneNames{128};
+void SetZoneTimingEnabled(bool enabled);
+[[nodiscard]] bool IsZoneTimingEnabled();
+// Moves the totals gathered since the previous call into timings, at most capacity of them, and
+// returns how many were written.  Zones whose names read the same are merged.  Does not allocate.
+std::uint32_t TakeZoneTimings(ZoneTiming* timings, std::uint32_t capacity);
+
+// A timeline of its own for zones timed elsewhere, e.g. on a GPU queue; it shows as a thread
+// named name.  Returns its id for RecordZone.
+std::uint32_t CreateTrack(const char* name);
+// Adds a zone measured by other means to track; ignored outside a capture.
+void RecordZone(std::uint32_t track, const char* name, Clock::time_point begin, Clock::time_point end, std::uint64_t frame);
+
+class Zone
+{
+public:
+    // name must outlive the capture; the macros pass a literal.
+    explicit Zone(const char* name);
+    Zone(const Zone& rhs) = delete;
+    Zone& operator=(const Zone& rhs) = delete;
+    ~Zone();
+
+private:
+    const char* mName{nullptr};
+    Clock::time_point mBegin{};
+    std::uint64_t mFrame{0};
+};
+} // namespace Profiling
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(PROFILER_DISABLED)
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#define PROFILE_FRAME()    static_cast<void>(0)
+#else
+// Times the rest of the enclosing scope.
+#define PROFILE_ZONE(name) const ::Profiling::Zone PROFILE_CONCAT(profileZone, __LINE__){name}
+#define PROFILE_FRAME()    ::Profiling::MarkFrame()
+#endif
+
+#endif // _PROFILER_
@@ -0,0 +1,508 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, RenderGraphPass pass) : mGraph{graph}, mPass{pass}
+{
+}
+
+void RenderGraph::PassBuilder::Read(RenderGraphResource resource, ResourceStates state)
+{
+    mGraph.AddAccess(mPass, resource, state, false);
+}
+
+void RenderGraph::PassBuilder::Write(RenderGraphResource resource, ResourceStates state)
+{
+    mGraph.AddAccess(mPass, resource, state, true);
+}
+
+void RenderGraph::PassBuilder::HasSideEffects()
+{
+    mGraph.mPasses[mPass].HasSideEffects = true;
+}
+
+void RenderGraph::Reset()
+{
+    mPasses.clear();
+    mAccesses.clear();
+    mResources.clear();
+    mCompiledPasses.clear();
+    mBarriers.clear();
+    mFirstFinalBarrier = 0;
+    mTransientHeapSize = 0;
+    mUnaliasedTransientBytes = 0;
+    mCompiled = false;
+}
+
+RenderGraphResource RenderGraph::Import(const char* name,
+                                        ResourceHandle resource,
+                                        ResourceStates initialState,
+                                        ResourceStates finalState)
+{
+    assert(!mCompiled && "Add resources before Compile.");
+
+    Resource imported{};
+    imported.Name = name;
+    imported.Handle = resource;
+    imported.IsImported = true;
+    imported.InitialState = initialState;
+    imported.FinalState = finalState;
+    mResources.push_back(imported);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTransient(const char* name, const TransientDesc& desc)
+{
+    assert(!mCompiled && "Add resources before Compile.");
+    assert(desc.Alignment > 0);
+
+    Resource transient{};
+    transient.Name = name;
+    transient.Desc = desc;
+    mResources.push_back(transient);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphPass RenderGraph::BeginPass(const char* name, ExecuteFn execute)
+{
+    assert(!mCompiled && "Add passes before Compile.");
+
+    Pass pass{};
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+    pass.FirstAccess = static_cast<std::uint32_t>(mAccesses.size());
+    mPasses.push_back(std::move(pass));
+    return static_cast<RenderGraphPass>(mPasses.size() - 1);
+}
+
+void RenderGraph::AddAccess(RenderGraphPass pass, RenderGraphResource resource, ResourceStates state, bool isWrite)
+{
+    // Accesses of a pass are contiguous because setup runs inside AddPass.
+    assert(pass == mPasses.size() - 1 && "Declare accesses inside the pass setup.");
+    assert(resource < mResources.size());
+
+    mAccesses.push_back(Access{resource, state, isWrite});
+    ++mPasses[pass].AccessCount;
+}
+
+void RenderGraph::Compile()
+{
+    assert(!mCompiled && "Reset the graph before compiling it again.");
+
+    CullPasses();
+
+    mCompiledPasses.clear();
+    for (RenderGraphPass pass{0}; pass < mPasses.size(); ++pass)
+    {
+        if (!mPasses[pass].IsCulled)
+        {
+            mCompiledPasses.push_back(pass);
+        }
+    }
+
+    BuildBarriers();
+    PlaceTransients();
+
+    mCompiled = true;
+}
+
+void RenderGraph::CullPasses()
+{
+    // Walk backwards from what must exist at the end of the frame.  A pass survives if it has side
+    // effects or writes something still needed; everything it touches is then needed before it.
+    mNeeded.assign(mResources.size(), 0);
+    for (std::size_t i{0}; i < mResources.size(); ++i)
+    {
+        mNeeded[i] = mResources[i].IsImported ? 1 : 0;
+    }
+
+    for (auto pass{mPasses.size()}; pass-- > 0;)
+    {
+        auto& current{mPasses[pass]};
+        auto first{mAccesses.begin() + current.FirstAccess};
+        auto last{first + current.AccessCount};
+
+        auto isLive{current.HasSideEffects ||
+                    std::any_of(first, last, [this](const Access& access) {
+                        return access.IsWrite && mNeeded[access.Resource] != 0;
+                    })};
+
+        current.IsCulled = !isLive;
+        if (isLive)
+        {
+            std::for_each(first, last, [this](const Access& access) { mNeeded[access.Resource] = 1; });
+        }
+    }
+}
+
+void RenderGraph::BuildBarriers()
+{
+    // Two segments per resource: [2r] is the last closed one, [2r + 1] the one being extended.
+    // An imported resource starts with a closed segment standing for its state before the frame.
+    mSegments.assign(mResources.size() * 2, Segment{});
+    for (std::size_t r{0}; r < mResources.size(); ++r)
+    {
+        auto& resource{mResources[r]};
+        resource.Placement = TransientPlacement{};
+        if (resource.IsImported)
+        {
+            mSegments[r * 2].State = resource.InitialState;
+        }
+    }
+
+    mSlottedBarriers.clear();
+
+    for (std::uint32_t slot{0}; slot < mCompiledPasses.size(); ++slot)
+    {
+        const auto& pass{mPasses[mCompiledPasses[slot]]};
+        for (auto i{pass.FirstAccess}; i < pass.FirstAccess + pass.AccessCount; ++i)
+        {
+            auto resource{mAccesses[i].Resource};
+
+            // Fold every access of this pass to the resource into one use.
+            auto alreadySeen{false};
+            for (auto j{pass.FirstAccess}; j < i && !alreadySeen; ++j)
+            {
+                alreadySeen = mAccesses[j].Resource == resource;
+            }
+            if (alreadySeen)
+            {
+                continue;
+            }
+
+            Segment use{slot, slot, mAccesses[i].State, mAccesses[i].IsWrite};
+            for (auto j{i + 1}; j < pass.FirstAccess + pass.AccessCount; ++j)
+            {
+                if (mAccesses[j].Resource == resource)
+                {
+                    use.State |= mAccesses[j].State;
+                    use.IsWrite = use.IsWrite || mAccesses[j].IsWrite;
+                }
+            }
+
+            auto& previous{mSegments[resource * 2]};
+            auto& current{mSegments[resource * 2 + 1]};
+            if (current.First == InvalidRenderGraphIndex)
+            {
+                mResources[resource].Placement.FirstPass = slot;
+                current = use;
+            }
+            else if (!use.IsWrite && !current.IsWrite)
+            {
+                current.State |= use.State;
+                current.Last = slot;
+            }
+            else if (use.IsWrite && current.IsWrite && use.State == current.State)
+            {
+                current.Last = slot;
+            }
+            else
+            {
+                AddTransition(resource, previous, current);
+                previous = current;
+                current = use;
+            }
+        }
+    }
+
+    for (RenderGraphResource r{0}; r < mResources.size(); ++r)
+    {
+        auto& resource{mResources[r]};
+        const auto& previous{mSegments[r * 2]};
+        const auto& current{mSegments[r * 2 + 1]};
+
+        if (current.First != InvalidRenderGraphIndex)
+        {
+            AddTransition(r, previous, current);
+            resource.Placement.LastPass = current.Last;
+        }
+
+        if (resource.IsImported)
+        {
+            const auto& last{current.First != InvalidRenderGraphIndex ? current : previous};
+            Segment end{FinalSlot, FinalSlot, resource.FinalState, false};
+            AddTransition(r, last, end);
+        }
+    }
+
+    // Bucket by slot.  Counting instead of sorting keeps this allocation-free once warmed up.
+    for (auto pass : mCompiledPasses)
+    {
+        mPasses[pass].BarrierCount = 0;
+    }
+    std::uint32_t finalCount{0};
+    for (const auto& slotted : mSlottedBarriers)
+    {
+        if (slotted.Slot == FinalSlot)
+        {
+            ++finalCount;
+        }
+        else
+        {
+            ++mPasses[mCompiledPasses[slotted.Slot]].BarrierCount;
+        }
+    }
+
+    std::uint32_t next{0};
+    for (auto pass : mCompiledPasses)
+    {
+        mPasses[pass].FirstBarrier = next;
+        next += mPasses[pass].BarrierCount;
+        mPasses[pass].BarrierCount = 0;
+    }
+    mFirstFinalBarrier = next;
+    finalCount = 0;
+
+    mBarriers.resize(mSlottedBarriers.size());
+    for (const auto& slotted : mSlottedBarriers)
+    {
+        if (slotted.Slot == FinalSlot)
+        {
+            mBarriers[mFirstFinalBarrier + finalCount++] = slotted.Barrier;
+        }
+        else
+        {
+            auto& pass{mPasses[mCompiledPasses[slotted.Slot]]};
+            mBarriers[pass.FirstBarrier + pass.BarrierCount++] = slotted.Barrier;
+        }
+    }
+}
+
+void RenderGraph::AddTransition(RenderGraphResource resource, const Segment& from, const Segment& to)
+{
+    auto& placement{mResources[resource].Placement};
+    if (!mResources[resource].IsImported && from.First == InvalidRenderGraphIndex && to.First != FinalSlot)
+    {
+        // First use of a transient: it is created in this state, nothing to transition from.
+        placement.InitialState = to.State;
+        return;
+    }
+
+    if (from.State == to.State)
+    {
+        return;
+    }
+
+    // The transition can start right after the last use in the old state (the start of the frame
+    // for an imported resource's initial state) and must end before the first use in the new one.
+    auto beginSlot{from.Last == InvalidRenderGraphIndex ? 0U : from.Last + 1};
+    auto endSlot{to.First};
+    if (beginSlot >= mCompiledPasses.size())
+    {
+        beginSlot = FinalSlot;
+    }
+
+    RenderGraphBarrier barrier{resource, from.State, to.State, BarrierFlags::None};
+    if (beginSlot < endSlot)
+    {
+        barrier.Flags = BarrierFlags::BeginOnly;
+        mSlottedBarriers.push_back(SlottedBarrier{beginSlot, barrier});
+        barrier.Flags = BarrierFlags::EndOnly;
+    }
+    mSlottedBarriers.push_back(SlottedBarrier{endSlot, barrier});
+}
+
+void RenderGraph::PlaceTransients()
+{
+    mTransientOrder.clear();
+    mTransientHeapSize = 0;
+    mUnaliasedTransientBytes = 0;
+
+    for (RenderGraphResource r{0}; r < mResources.size(); ++r)
+    {
+        auto& resource{mResources[r]};
+        if (!resource.IsImported && resource.Placement.FirstPass != InvalidRenderGraphIndex)
+        {
+            resource.Placement.ByteSize = AlignUp(resource.Desc.ByteSize, resource.Desc.Alignment);
+            mUnaliasedTransientBytes += resource.Placement.ByteSize;
+            mTransientOrder.push_back(r);
+        }
+    }
+
+    // Largest first, then first fit: each transient goes at the lowest aligned offset that does not
+    // overlap a transient already placed and alive at the same time.
+    std::sort(mTransientOrder.begin(), mTransientOrder.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+        const auto& lhs{mResources[a].Placement};
+        const auto& rhs{mResources[b].Placement};
+        return lhs.ByteSize != rhs.ByteSize ? lhs.ByteSize > rhs.ByteSize : a < b;
+    });
+
+    for (std::size_t i{0}; i < mTransientOrder.size(); ++i)
+    {
+        auto& placement{mResources[mTransientOrder[i]].Placement};
+        auto alignment{mResources[mTransientOrder[i]].Desc.Alignment};
+
+        auto conflictsAt{[&](std::uint64_t offset) {
+            for (std::size_t j{0}; j < i; ++j)
+            {
+                const auto& other{mResources[mTransientOrder[j]].Placement};
+                auto livesOverlap{placement.FirstPass <= other.LastPass && other.FirstPass <= placement.LastPass};
+                auto memoryOverlaps{offset < other.Offset + other.ByteSize && other.Offset < offset + placement.ByteSize};
+                if (livesOverlap && memoryOverlaps)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }};
+
+        auto best{conflictsAt(0) ? UINT64_MAX : 0};
+        for (std::size_t j{0}; j < i && best != 0; ++j)
+        {
+            const auto& other{mResources[mTransientOrder[j]].Placement};
+            auto candidate{AlignUp(other.Offset + other.ByteSize, alignment)};
+            if (candidate < best && !conflictsAt(candidate))
+            {
+                best = candidate;
+            }
+        }
+
+        placement.Offset = best;
+        mTransientHeapSize = std::max(mTransientHeapSize, best + placement.ByteSize);
+    }
+}
+
+void RenderGraph::BindTransient(RenderGraphResource resource, ResourceHandle handle)
+{
+    assert(resource < mResources.size() && !mResources[resource].IsImported);
+    mResources[resource].Handle = handle;
+}
+
+void RenderGraph::Execute(ICommandList& cmdList)
+{
+    for (std::size_t i{0}; i < mCompiledPasses.size(); ++i)
+    {
+        RecordBarriers(i, cmdList);
+        ExecutePass(i, cmdList);
+    }
+    RecordFinalBarriers(cmdList);
+}
+
+void RenderGraph::RecordBarriers(std::size_t compiledPass, ICommandList& cmdList)
+{
+    std::size_t count{0};
+    const auto* barriers{PassBarriers(compiledPass, count)};
+    RecordBarrierRange(barriers, count, cmdList);
+}
+
+void RenderGraph::ExecutePass(std::size_t compiledPass, ICommandList& cmdList)
+{
+    assert(mCompiled && compiledPass < mCompiledPasses.size());
+
+    const auto& pass{mPasses[mCompiledPasses[compiledPass]]};
+    if (pass.Execute)
+    {
+        pass.Execute(cmdList);
+    }
+}
+
+void RenderGraph::RecordFinalBarriers(ICommandList& cmdList)
+{
+    std::size_t count{0};
+    const auto* barriers{FinalBarriers(count)};
+    RecordBarrierRange(barriers, count, cmdList);
+}
+
+void RenderGraph::RecordBarrierRange(const RenderGraphBarrier* barriers, std::size_t count, ICommandList& cmdList)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    mNativeBarriers.resize(count);
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        auto handle{mResources[barriers[i].Resource].Handle};
+        assert(handle != NullResource && "Bind transients before recording.");
+
+        mNativeBarriers[i] = Barrier{handle, AllSubresources, barriers[i].Before, barriers[i].After, barriers[i].Flags};
+    }
+    cmdList.ResourceBarrier(static_cast<std::uint32_t>(count), mNativeBarriers.data());
+}
+
+std::size_t RenderGraph::PassCount() const
+{
+    return mPasses.size();
+}
+
+std::size_t RenderGraph::ResourceCount() const
+{
+    return mResources.size();
+}
+
+const char* RenderGraph::PassName(RenderGraphPass pass) const
+{
+    assert(pass < mPasses.size());
+    return mPasses[pass].Name;
+}
+
+const char* RenderGraph::ResourceName(RenderGraphResource resource) const
+{
+    assert(resource < mResources.size());
+    return mResources[resource].Name;
+}
+
+bool RenderGraph::IsCulled(RenderGraphPass pass) const
+{
+    assert(mCompiled && pass < mPasses.size());
+    return mPasses[pass].IsCulled;
+}
+
+std::size_t RenderGraph::CompiledPassCount() const
+{
+    assert(mCompiled);
+    return mCompiledPasses.size();
+}
+
+RenderGraphPass RenderGraph::CompiledPass(std::size_t compiledPass) const
+{
+    assert(mCompiled && compiledPass < mCompiledPasses.size());
+    return mCompiledPasses[compiledPass];
+}
+
+const RenderGraphBarrier* RenderGraph::PassBarriers(std::size_t compiledPass, std::size_t& count) const
+{
+    assert(mCompiled && compiledPass < mCompiledPasses.size());
+
+    const auto& pass{mPasses[mCompiledPasses[compiledPass]]};
+    count = pass.BarrierCount;
+    return mBarriers.data() + pass.FirstBarrier;
+}
+
+const RenderGraphBarrier* RenderGraph::FinalBarriers(std::size_t& count) const
+{
+    assert(mCompiled);
+
+    count = mBarriers.size() - mFirstFinalBarrier;
+    return mBarriers.data() + mFirstFinalBarrier;
+}
+
+const TransientPlacement& RenderGraph::Placement(RenderGraphResource resource) const
+{
+    assert(mCompiled && resource < mResources.size());
+    return mResources[resource].Placement;
+}
+
+std::uint64_t RenderGraph::TransientHeapSize() const
+{
+    assert(mCompiled);
+    return mTransientHeapSize;
+}
+
+std::uint64_t RenderGraph::UnaliasedTransientBytes() const
+{
+    assert(mCompiled);
+    return mUnaliasedTransientBytes;
+}
@@ -0,0 +1,216 @@
+#ifndef _RENDERGRAPH_
+#define _RENDERGRAPH_
+
+#include "GfxBackend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Frame graph.  Each frame, passes are added in submission order together with the resources they
+// read and write, then Compile() works out, on the CPU only:
+//  - which passes can be culled because nothing downstream consumes what they write,
+//  - the transitions each surviving pass needs, batched per pass, with consecutive reads merged into
+//    one combined read state and transitions split (BeginOnly/EndOnly) when passes sit between the
+//    last use and the next one,
+//  - where transient resources go in one shared heap, overlapping those whose lifetimes do not.
+//
+// Writes are treated as read-modify-write, so every pass that wrote a resource before a surviving
+// reader or writer of it survives too.  Imported resources (e.g. the back buffer) count as consumed
+// at the end of the frame and are returned to their final state.
+//
+// Transients sharing memory hold garbage on first use; the first pass using one must fully
+// initialize it (clear, copy or discard).  Gfx has no aliasing barrier, so backends that need one
+// issue it themselves for transients whose FirstPass they are about to run.
+namespace Gfx
+{
+using RenderGraphResource = std::uint32_t;
+using RenderGraphPass = std::uint32_t;
+
+constexpr std::uint32_t InvalidRenderGraphIndex{0xffffffff};
+
+struct TransientDesc
+{
+    std::uint64_t ByteSize{0};
+    std::uint64_t Alignment{65536};
+};
+
+// A barrier produced by Compile(), naming a graph resource rather than a backend resource.
+struct RenderGraphBarrier
+{
+    RenderGraphResource Resource{InvalidRenderGraphIndex};
+    ResourceStates Before{States::Common};
+    ResourceStates After{States::Common};
+    BarrierFlags Flags{BarrierFlags::None};
+};
+
+// Where a transient lives in the transient heap, and the compiled passes that use it.
+struct TransientPlacement
+{
+    std::uint64_t Offset{0};
+    std::uint64_t ByteSize{0};
+    // State to create the placed resource in: the state of its first use.
+    ResourceStates InitialState{States::Common};
+    std::uint32_t FirstPass{InvalidRenderGraphIndex};
+    std::uint32_t LastPass{InvalidRenderGraphIndex};
+};
+
+class RenderGraph
+{
+public:
+    using ExecuteFn = std::function<void(ICommandList&)>;
+
+    class PassBuilder
+    {
+    public:
+        void Read(RenderGraphResource resource, ResourceStates state);
+        void Write(RenderGraphResource resource, ResourceStates state);
+        // Never cull this pass, e.g. because it writes something the graph does not track.
+        void HasSideEffects();
+
+    private:
+        friend class RenderGraph;
+
+        PassBuilder(RenderGraph& graph, RenderGraphPass pass);
+
+        RenderGraph& mGraph;
+        RenderGraphPass mPass{InvalidRenderGraphIndex};
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph& rhs) = delete;
+    RenderGraph& operator=(const RenderGraph& rhs) = delete;
+    ~RenderGraph() = default;
+
+    // Drops all passes and resources for the next frame.  Storage keeps its capacity.
+    void Reset();
+
+    // Names must outlive the graph's current frame; string literals are the intended use.
+    RenderGraphResource Import(const char* name,
+                               ResourceHandle resource,
+                               ResourceStates initialState,
+                               ResourceStates finalState);
+    RenderGraphResource CreateTransient(const char* name, const TransientDesc& desc);
+
+    // setup(PassBuilder&) declares the accesses right away.  execute may be empty for passes the
+    // caller records itself between RecordBarriers calls.
+    template <typename Setup>
+    RenderGraphPass AddPass(const char* name, Setup&& setup, ExecuteFn execute = {})
+    {
+        auto pass{BeginPass(name, std::move(execute))};
+        PassBuilder builder{*this, pass};
+        setup(builder);
+        return pass;
+    }
+
+    void Compile();
+
+    // Real resource for a transient, placed at Placement(resource).Offset in a heap of at least
+    // TransientHeapSize() bytes.  Needed before recording.
+    void BindTransient(RenderGraphResource resource, ResourceHandle handle);
+
+    // Records every surviving pass with its barriers, then the final barriers, into one list.
+    void Execute(ICommandList& cmdList);
+
+    // Piecewise recording, for passes spread over several command lists.  Indices are compiled
+    // pass indices, 0 .. CompiledPassCount() - 1.
+    void RecordBarriers(std::size_t compiledPass, ICommandList& cmdList);
+    void ExecutePass(std::size_t compiledPass, ICommandList& cmdList);
+    void RecordFinalBarriers(ICommandList& cmdList);
+
+    [[nodiscard]] std::size_t PassCount() const;
+    [[nodiscard]] std::size_t ResourceCount() const;
+    [[nodiscard]] const char* PassName(RenderGraphPass pass) const;
+    [[nodiscard]] const char* ResourceName(RenderGraphResource resource) const;
+
+    // Compile results.
+    [[nodiscard]] bool IsCulled(RenderGraphPass pass) const;
+    [[nodiscard]] std::size_t CompiledPassCount() const;
+    [[nodiscard]] RenderGraphPass CompiledPass(std::size_t compiledPass) const;
+    [[nodiscard]] const RenderGraphBarrier* PassBarriers(std::size_t compiledPass, std::size_t& count) const;
+    [[nodiscard]] const RenderGraphBarrier* FinalBarriers(std::size_t& count) const;
+    [[nodiscard]] const TransientPlacement& Placement(RenderGraphResource resource) const;
+    [[nodiscard]] std::uint64_t TransientHeapSize() const;
+    // What the transients would take without aliasing.
+    [[nodiscard]] std::uint64_t UnaliasedTransientBytes() const;
+
+private:
+    struct Access
+    {
+        RenderGraphResource Resource{InvalidRenderGraphIndex};
+        ResourceStates State{States::Common};
+        bool IsWrite{false};
+    };
+
+    struct Pass
+    {
+        const char* Name{nullptr};
+        ExecuteFn Execute{};
+        std::uint32_t FirstAccess{0};
+        std::uint32_t AccessCount{0};
+        bool HasSideEffects{false};
+        bool IsCulled{false};
+        std::uint32_t FirstBarrier{0};
+        std::uint32_t BarrierCount{0};
+    };
+
+    struct Resource
+    {
+        const char* Name{nullptr};
+        ResourceHandle Handle{NullResource};
+        bool IsImported{false};
+        ResourceStates InitialState{States::Common};
+        ResourceStates FinalState{States::Common};
+        TransientDesc Desc{};
+        TransientPlacement Placement{};
+    };
+
+    // A run of compiled passes using a resource in one state.  Consecutive reads merge into one
+    // segment whose state is the union of the read states.
+    struct Segment
+    {
+        std::uint32_t First{InvalidRenderGraphIndex};
+        std::uint32_t Last{InvalidRenderGraphIndex};
+        ResourceStates State{States::Common};
+        bool IsWrite{false};
+    };
+
+    // Barrier tagged with the compiled pass it goes before; FinalSlot for after the last pass.
+    struct SlottedBarrier
+    {
+        std::uint32_t Slot{0};
+        RenderGraphBarrier Barrier{};
+    };
+
+    static constexpr std::uint32_t FinalSlot{InvalidRenderGraphIndex};
+
+    RenderGraphPass BeginPass(const char* name, ExecuteFn execute);
+    void AddAccess(RenderGraphPass pass, RenderGraphResource resource, ResourceStates state, bool isWrite);
+
+    void CullPasses();
+    void BuildBarriers();
+    void AddTransition(RenderGraphResource resource, const Segment& from, const Segment& to);
+    void PlaceTransients();
+    void RecordBarrierRange(const RenderGraphBarrier* barriers, std::size_t count, ICommandList& cmdList);
+
+    std::vector<Pass> mPasses{};
+    std::vector<Access> mAccesses{};
+    std::vector<Resource> mResources{};
+
+    // Compile output and scratch, reused from frame to frame.
+    std::vector<RenderGraphPass> mCompiledPasses{};
+    std::vector<RenderGraphBarrier> mBarriers{};
+    std::uint32_t mFirstFinalBarrier{0};
+    std::vector<SlottedBarrier> mSlottedBarriers{};
+    std::vector<Segment> mSegments{};
+    std::vector<std::uint8_t> mNeeded{};
+    std::vector<RenderGraphResource> mTransientOrder{};
+    std::vector<Barrier> mNativeBarriers{};
+    std::uint64_t mTransientHeapSize{0};
+    std::uint64_t mUnaliasedTransientBytes{0};
+    bool mCompiled{false};
+};
+} // namespace Gfx
+
+#endif // _RENDERGRAPH_
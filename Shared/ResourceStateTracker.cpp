@@ -0,0 +1,269 @@
+#include "ResourceStateTracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr ResourceStates ReadOnlyStates{States::VertexAndConstantBuffer | States::IndexBuffer | States::DepthRead |
+                                        States::NonPixelShaderResource | States::PixelShaderResource |
+                                        States::IndirectArgument | States::CopySource};
+
+// COMMON is not a read state here: it cannot be combined with anything.
+constexpr bool IsReadOnly(ResourceStates state)
+{
+    return state != States::Common && (state & ~ReadOnlyStates) == 0;
+}
+
+// Single-subresource resources are always addressed as a whole.
+constexpr std::uint32_t BarrierSubresource(std::uint32_t subresource, std::size_t subresourceCount)
+{
+    return subresourceCount == 1 ? AllSubresources : subresource;
+}
+} // namespace
+
+void ResourceStateRegistry::Register(ResourceHandle resource,
+                                     ResourceStates initialState,
+                                     std::uint32_t subresourceCount,
+                                     bool isBuffer)
+{
+    assert(resource != NullResource && subresourceCount > 0);
+
+    std::unique_lock<std::shared_mutex> lock{mMutex};
+    auto& record{mRecords[resource]};
+    record.IsBuffer = isBuffer;
+    record.States.assign(subresourceCount, initialState);
+}
+
+void ResourceStateRegistry::Unregister(ResourceHandle resource)
+{
+    std::unique_lock<std::shared_mutex> lock{mMutex};
+    mRecords.erase(resource);
+}
+
+bool ResourceStateRegistry::IsRegistered(ResourceHandle resource) const
+{
+    std::shared_lock<std::shared_mutex> lock{mMutex};
+    return mRecords.find(resource) != mRecords.end();
+}
+
+ResourceStates ResourceStateRegistry::State(ResourceHandle resource, std::uint32_t subresource) const
+{
+    std::shared_lock<std::shared_mutex> lock{mMutex};
+    auto record{mRecords.find(resource)};
+    assert(record != mRecords.end() && subresource < record->second.States.size());
+    return record->second.States[subresource];
+}
+
+void ResourceStateRegistry::Submit(const ResourceStateTracker& tracker, std::vector<Barrier>& fixups)
+{
+    std::unique_lock<std::shared_mutex> lock{mMutex};
+    for (const auto& [resource, entry] : tracker.mEntries)
+    {
+        auto record{mRecords.find(resource)};
+        assert(record != mRecords.end() && "Resource was unregistered while a list using it was recorded.");
+
+        auto& committed{record->second.States};
+        auto firstFixup{fixups.size()};
+        for (std::uint32_t i{0}; i < entry.Subresources.size(); ++i)
+        {
+            const auto& state{entry.Subresources[i]};
+            if (!state.IsUsed)
+            {
+                continue;
+            }
+
+            auto isPromoted{record->second.IsBuffer && committed[i] == States::Common};
+            if (!isPromoted && committed[i] != state.Entry)
+            {
+                fixups.push_back(Barrier{resource,
+                                         BarrierSubresource(i, committed.size()),
+                                         committed[i],
+                                         state.Entry,
+                                         BarrierFlags::None});
+            }
+
+            committed[i] = record->second.IsBuffer ? States::Common : state.Current;
+        }
+
+        // One barrier for the whole resource when every subresource needs the same fixup.
+        auto added{fixups.size() - firstFixup};
+        if (committed.size() > 1 && added == committed.size())
+        {
+            const auto& first{fixups[firstFixup]};
+            auto isUniform{std::all_of(fixups.begin() + static_cast<std::ptrdiff_t>(firstFixup),
+                                       fixups.end(),
+                                       [&first](const Barrier& barrier) {
+                                           return barrier.Before == first.Before && barrier.After == first.After;
+                                       })};
+            if (isUniform)
+            {
+                fixups[firstFixup].Subresource = AllSubresources;
+                fixups.resize(firstFixup + 1);
+            }
+        }
+    }
+}
+
+ResourceStateTracker::ResourceStateTracker(const ResourceStateRegistry& registry) : mRegistry{registry}
+{
+}
+
+void ResourceStateTracker::Reset()
+{
+    assert(mPendingBarriers.empty() && "Flush barriers before starting a new recording.");
+
+    mEntries.clear();
+    mPendingBarriers.clear();
+    mStats = ResourceStateTrackerStats{};
+}
+
+ResourceStateTracker::Entry& ResourceStateTracker::FindEntry(ResourceHandle resource)
+{
+    auto entry{mEntries.find(resource)};
+    if (entry != mEntries.end())
+    {
+        return entry->second;
+    }
+
+    std::shared_lock<std::shared_mutex> lock{mRegistry.mMutex};
+    auto record{mRegistry.mRecords.find(resource)};
+    assert(record != mRegistry.mRecords.end() && "Register resources before tracking them.");
+
+    auto& created{mEntries[resource]};
+    created.IsBuffer = record->second.IsBuffer;
+    created.Subresources.resize(record->second.States.size());
+    return created;
+}
+
+void ResourceStateTracker::Transition(ResourceHandle resource, ResourceStates after, std::uint32_t subresource)
+{
+    auto& entry{FindEntry(resource)};
+    auto& subresources{entry.Subresources};
+
+    if (subresource != AllSubresources)
+    {
+        assert(subresource < subresources.size());
+        TransitionSubresource(resource, subresource, subresources.size(), subresources[subresource], after);
+        return;
+    }
+
+    auto firstQueued{mPendingBarriers.size()};
+    for (std::uint32_t i{0}; i < subresources.size(); ++i)
+    {
+        TransitionSubresource(resource, i, subresources.size(), subresources[i], after);
+    }
+
+    // Collapse per-subresource barriers that all say the same thing into one.
+    auto queued{mPendingBarriers.size() - firstQueued};
+    if (subresources.size() > 1 && queued == subresources.size())
+    {
+        const auto& first{mPendingBarriers[firstQueued]};
+        auto isUniform{std::all_of(mPendingBarriers.begin() + static_cast<std::ptrdiff_t>(firstQueued),
+                                   mPendingBarriers.end(),
+                                   [&first](const Barrier& barrier) {
+                                       return barrier.Before == first.Before && barrier.After == first.After;
+                                   })};
+        if (isUniform)
+        {
+            mPendingBarriers[firstQueued].Subresource = AllSubresources;
+            mPendingBarriers.resize(firstQueued + 1);
+        }
+    }
+}
+
+void ResourceStateTracker::TransitionSubresource(ResourceHandle resource,
+                                                 std::uint32_t subresource,
+                                                 std::size_t subresourceCount,
+                                                 SubresourceState& state,
+                                                 ResourceStates after)
+{
+    ++mStats.TransitionRequests;
+
+    if (!state.IsUsed)
+    {
+        // The entry state is settled against the registry at submission.
+        state.IsUsed = true;
+        state.IsAtEntry = true;
+        state.Entry = after;
+        state.Current = after;
+        ++mStats.DroppedTransitions;
+        return;
+    }
+
+    auto bothRead{IsReadOnly(state.Current) && IsReadOnly(after)};
+    if (state.Current == after || (bothRead && (state.Current & after) == after))
+    {
+        ++mStats.DroppedTransitions;
+        return;
+    }
+
+    if (bothRead && state.IsAtEntry)
+    {
+        state.Entry |= after;
+        state.Current |= after;
+        ++mStats.DroppedTransitions;
+        return;
+    }
+
+    // Moving between read states goes to their union, so the next read of either is free.
+    auto target{bothRead ? state.Current | after : after};
+    QueueBarrier(resource, BarrierSubresource(subresource, subresourceCount), state.Current, target);
+    state.Current = target;
+    state.IsAtEntry = false;
+}
+
+void ResourceStateTracker::QueueBarrier(ResourceHandle resource,
+                                        std::uint32_t subresource,
+                                        ResourceStates before,
+                                        ResourceStates after)
+{
+    auto queued{std::find_if(mPendingBarriers.begin(), mPendingBarriers.end(), [&](const Barrier& barrier) {
+        return barrier.Resource == resource && barrier.Subresource == subresource;
+    })};
+
+    if (queued != mPendingBarriers.end())
+    {
+        // Nothing used the resource since the queued barrier: retarget it, or drop it if it is undone.
+        assert(queued->After == before);
+        ++mStats.FoldedBarriers;
+        if (queued->Before == after)
+        {
+            mPendingBarriers.erase(queued);
+        }
+        else
+        {
+            queued->After = after;
+        }
+        return;
+    }
+
+    mPendingBarriers.push_back(Barrier{resource, subresource, before, after, BarrierFlags::None});
+}
+
+void ResourceStateTracker::FlushBarriers(ICommandList& cmdList)
+{
+    if (mPendingBarriers.empty())
+    {
+        return;
+    }
+
+    cmdList.ResourceBarrier(static_cast<std::uint32_t>(mPendingBarriers.size()), mPendingBarriers.data());
+
+    ++mStats.FlushCalls;
+    mStats.FlushedBarriers += static_cast<std::uint32_t>(mPendingBarriers.size());
+    mPendingBarriers.clear();
+}
+
+std::size_t ResourceStateTracker::PendingBarrierCount() const
+{
+    return mPendingBarriers.size();
+}
+
+const ResourceStateTrackerStats& ResourceStateTracker::Stats() const
+{
+    return mStats;
+}
@@ -0,0 +1,127 @@
+#ifndef _RESOURCESTATETRACKER_
+#define _RESOURCESTATETRACKER_
+
+#include "GfxBackend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+// Resource state tracking split in two, so command lists can be recorded independently:
+//  - ResourceStateRegistry holds the state each resource is in once all submitted work has run.
+//  - ResourceStateTracker, one per command list being recorded, tracks states as the list will see
+//    them.  The first use of a resource only records the state the list expects on entry; later
+//    uses queue transitions, which are dropped when redundant, folded when they undo or extend a
+//    queued one, and recorded as one batch by FlushBarriers().
+//
+// At submission the registry compares each list's entry states with the committed ones and returns
+// the fixup transitions to execute ahead of the list.  Buffers in COMMON are implicitly promoted to
+// their first state and decay back to COMMON after every ExecuteCommandLists, so they never need a
+// fixup.  Consecutive read states of a resource merge into one combined read state.
+namespace Gfx
+{
+class ResourceStateTracker;
+
+class ResourceStateRegistry
+{
+public:
+    ResourceStateRegistry() = default;
+    ResourceStateRegistry(const ResourceStateRegistry& rhs) = delete;
+    ResourceStateRegistry& operator=(const ResourceStateRegistry& rhs) = delete;
+    ~ResourceStateRegistry() = default;
+
+    // Replaces any stale record left under the same handle.
+    void Register(ResourceHandle resource, ResourceStates initialState, std::uint32_t subresourceCount, bool isBuffer);
+    void Unregister(ResourceHandle resource);
+
+    [[nodiscard]] bool IsRegistered(ResourceHandle resource) const;
+    [[nodiscard]] ResourceStates State(ResourceHandle resource, std::uint32_t subresource = 0) const;
+
+    // Call in submission order, right before the tracker's list is executed.  Appends to fixups the
+    // transitions that bring every resource the list uses into its entry state; they must execute
+    // before the list.  Then commits the list's final states.
+    void Submit(const ResourceStateTracker& tracker, std::vector<Barrier>& fixups);
+
+private:
+    friend class ResourceStateTracker;
+
+    struct Record
+    {
+        bool IsBuffer{false};
+        std::vector<ResourceStates> States{};
+    };
+
+    mutable std::shared_mutex mMutex{};
+    std::unordered_map<ResourceHandle, Record> mRecords{};
+};
+
+struct ResourceStateTrackerStats
+{
+    std::uint32_t TransitionRequests{0};
+    // Requests that needed no barrier: already in the state, merged into a read state, or a first
+    // use left to the submit-time fixup.
+    std::uint32_t DroppedTransitions{0};
+    // Queued barriers cancelled or replaced by a later request before they were flushed.
+    std::uint32_t FoldedBarriers{0};
+    std::uint32_t FlushCalls{0};
+    std::uint32_t FlushedBarriers{0};
+};
+
+class ResourceStateTracker
+{
+public:
+    // Resources must be registered with registry before a list transitions them.
+    explicit ResourceStateTracker(const ResourceStateRegistry& registry);
+    ResourceStateTracker(const ResourceStateTracker& rhs) = delete;
+    ResourceStateTracker& operator=(const ResourceStateTracker& rhs) = delete;
+    ~ResourceStateTracker() = default;
+
+    // Starts tracking a new recording.  Storage keeps its capacity.
+    void Reset();
+
+    void Transition(ResourceHandle resource, ResourceStates after, std::uint32_t subresource = AllSubresources);
+
+    // Records the queued barriers with one ResourceBarrier call.  Call before every draw, dispatch
+    // and copy that depends on them, and before closing the list.
+    void FlushBarriers(ICommandList& cmdList);
+
+    [[nodiscard]] std::size_t PendingBarrierCount() const;
+    [[nodiscard]] const ResourceStateTrackerStats& Stats() const;
+
+private:
+    friend class ResourceStateRegistry;
+
+    struct SubresourceState
+    {
+        bool IsUsed{false};
+        // No barrier was queued for it yet, so read states can still widen the entry state.
+        bool IsAtEntry{false};
+        ResourceStates Entry{States::Common};
+        ResourceStates Current{States::Common};
+    };
+
+    struct Entry
+    {
+        bool IsBuffer{false};
+        std::vector<SubresourceState> Subresources{};
+    };
+
+    Entry& FindEntry(ResourceHandle resource);
+    void TransitionSubresource(ResourceHandle resource,
+                               std::uint32_t subresource,
+                               std::size_t subresourceCount,
+                               SubresourceState& state,
+                               ResourceStates after);
+    void QueueBarrier(ResourceHandle resource, std::uint32_t subresource, ResourceStates before, ResourceStates after);
+
+    const ResourceStateRegistry& mRegistry;
+
+    std::unordered_map<ResourceHandle, Entry> mEntries{};
+    std::vector<Barrier> mPendingBarriers{};
+    ResourceStateTrackerStats mStats{};
+};
+} // namespace Gfx
+
+#endif // _RESOURCESTATETRACKER_
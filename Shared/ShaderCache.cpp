@@ -0,0 +1,212 @@
+#include "ShaderCache.h"
+
+#include "AsyncFileIO.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+using namespace Gfx;
+
+namespace
+{
+bool ReadText(Files::AsyncFileIO* fileIO, const std::filesystem::path& path, std::string& text)
+{
+    if (fileIO != nullptr)
+    {
+        Files::FileId file{};
+        try
+        {
+            file = fileIO->Open(path.wstring());
+            text.resize(fileIO->FileSize(file));
+        }
+        catch (const std::runtime_error&)
+        {
+            return false;
+        }
+
+        auto read{fileIO->Read(Files::ReadRequest{file, 0, text.data(), text.size(), {}}).get()};
+        fileIO->Close(file);
+        text.resize(read.ByteCount);
+        return read.Error == 0;
+    }
+
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+    {
+        return false;
+    }
+
+    text.assign(std::istreambuf_iterator<char>{fin}, std::istreambuf_iterator<char>{});
+    return !fin.bad();
+}
+
+// The file named by an #include directive on this line, or an empty string.
+std::string IncludeName(const char* first, const char* last)
+{
+    auto skipSpaces{[last](const char* position) {
+        while (position != last && (*position == ' ' || *position == '\t'))
+        {
+            ++position;
+        }
+        return position;
+    }};
+
+    constexpr char Directive[]{"include"};
+    constexpr std::size_t DirectiveLength{sizeof(Directive) - 1};
+
+    auto position{skipSpaces(first)};
+    if (position == last || *position != '#')
+    {
+        return {};
+    }
+    position = skipSpaces(position + 1);
+    if (static_cast<std::size_t>(last - position) < DirectiveLength
+        || !std::equal(Directive, Directive + DirectiveLength, position))
+    {
+        return {};
+    }
+    position = skipSpaces(position + DirectiveLength);
+    if (position == last || (*position != '"' && *position != '<'))
+    {
+        return {};
+    }
+
+    auto terminator{*position == '"' ? '"' : '>'};
+    auto nameEnd{std::find(position + 1, last, terminator)};
+    return nameEnd != last ? std::string(position + 1, nameEnd) : std::string{};
+}
+
+// Hashes file and, depth first, every file it includes.  Each file is hashed once.
+void HashSource(Hasher& hasher,
+                Files::AsyncFileIO* fileIO,
+                const std::filesystem::path& file,
+                const std::string& text,
+                std::vector<std::filesystem::path>& visited)
+{
+    hasher.Add(static_cast<std::uint64_t>(text.size()));
+    hasher.Add(text.data(), text.size());
+
+    const auto* cursor{text.data()};
+    const auto* end{text.data() + text.size()};
+    while (cursor != end)
+    {
+        const auto* lineEnd{std::find(cursor, end, '\n')};
+        auto name{IncludeName(cursor, lineEnd)};
+        cursor = lineEnd != end ? lineEnd + 1 : end;
+        if (name.empty())
+        {
+            continue;
+        }
+
+        auto included{(file.parent_path() / std::filesystem::u8path(name)).lexically_normal()};
+        if (std::find(visited.begin(), visited.end(), included) != visited.end())
+        {
+            continue;
+        }
+        visited.push_back(included);
+
+        // A missing include fails the compile, which is never cached; only its name matters.
+        std::string includedText{};
+        hasher.AddString(name.c_str());
+        if (ReadText(fileIO, included, includedText))
+        {
+            HashSource(hasher, fileIO, included, includedText, visited);
+        }
+    }
+}
+} // namespace
+
+ShaderCache::ShaderCache(IShaderCompiler& compiler, std::wstring directory, Files::AsyncFileIO* fileIO)
+    : mCompiler{compiler}, mDirectory{std::move(directory)}, mFileIO{fileIO}
+{
+}
+
+std::uint64_t ShaderCache::Key(const ShaderCompileRequest& request, std::vector<std::wstring>* sources) const
+{
+    std::filesystem::path source{std::filesystem::path{request.Filename}.lexically_normal()};
+    std::string text{};
+    if (!ReadText(mFileIO, source, text))
+    {
+        throw std::runtime_error("Cannot read shader source " + source.u8string());
+    }
+
+    Hasher hasher{mCompiler.Identity()};
+    std::vector<std::filesystem::path> visited{source};
+    HashSource(hasher, mFileIO, source, text, visited);
+
+    hasher.Add(static_cast<std::uint32_t>(request.Defines.size()));
+    for (const auto& define : request.Defines)
+    {
+        hasher.AddString(define.Name.c_str());
+        hasher.AddString(define.Value.c_str());
+    }
+    hasher.AddString(request.EntryPoint.c_str());
+    hasher.AddString(request.Target.c_str());
+    hasher.Add(request.Flags);
+
+    if (sources != nullptr)
+    {
+        sources->clear();
+        for (const auto& file : visited)
+        {
+            sources->push_back(file.wstring());
+        }
+    }
+    return hasher.Finish();
+}
+
+std::wstring ShaderCache::Resolve(const ShaderCompileRequest& request, std::vector<std::wstring>* sources)
+{
+    auto path{std::filesystem::path{mDirectory} / (HashName(Key(request, sources)) + L".cso")};
+
+    std::error_code error{};
+    auto byteSize{std::filesystem::file_size(path, error)};
+    if (!error && byteSize > 0)
+    {
+        ++mHits;
+        return path.wstring();
+    }
+
+    std::vector<std::uint8_t> bytecode{};
+    std::string errors{};
+    if (!mCompiler.Compile(request, bytecode, errors))
+    {
+        throw std::runtime_error(errors);
+    }
+    auto compileIndex{++mCompiles};
+
+    // Written under a name of its own and renamed, so readers never see a partial file.
+    std::filesystem::create_directories(mDirectory, error);
+    auto temporary{path};
+    temporary += L"." + std::to_wstring(compileIndex) + L".tmp";
+    {
+        std::ofstream fout(temporary, std::ios::binary | std::ios::trunc);
+        fout.write(reinterpret_cast<const char*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size()));
+        if (!fout.flush())
+        {
+            throw std::runtime_error("Cannot write shader cache entry " + temporary.u8string());
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        // Renaming over an entry another thread has open fails on Windows; that entry will do.
+        std::filesystem::remove(temporary, error);
+        if (!std::filesystem::exists(path, error))
+        {
+            throw std::runtime_error("Cannot store shader cache entry " + path.u8string());
+        }
+    }
+
+    return path.wstring();
+}
+
+ShaderCacheStats ShaderCache::Stats() const
+{
+    return ShaderCacheStats{mHits.load(), mCompiles.load()};
+}
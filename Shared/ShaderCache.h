@@ -0,0 +1,89 @@
+#ifndef _SHADERCACHE_
+#define _SHADERCACHE_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Persistent shader bytecode cache.  The key hashes everything that decides the output: the source
+// with every file it #includes (by content, not path), the defines, entry point, target, compile
+// flags and the compiler's identity.  Bytecode is stored as <key>.cso under the cache directory,
+// so a repeat run only reads sources to recompute keys and never calls the compiler.
+//
+// Includes are followed textually, including those in inactive #if branches; that can only cause
+// an unneeded recompile, never a stale hit.  Quoted and angle-bracket includes both resolve
+// relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+namespace Files
+{
+class AsyncFileIO;
+}
+
+namespace Gfx
+{
+struct ShaderDefine
+{
+    std::string Name{};
+    std::string Value{};
+};
+
+struct ShaderCompileRequest
+{
+    std::wstring Filename{};
+    std::vector<ShaderDefine> Defines{};
+    std::string EntryPoint{};
+    std::string Target{};
+    std::uint32_t Flags{0};
+};
+
+class IShaderCompiler
+{
+public:
+    virtual ~IShaderCompiler() = default;
+
+    // Changes whenever the same request could compile to different bytecode.
+    [[nodiscard]] virtual std::uint64_t Identity() const = 0;
+    // Returns false and fills errors when compilation fails; implementations may throw instead.
+    // Must be safe to call concurrently.
+    virtual bool Compile(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode, std::string& errors) = 0;
+};
+
+struct ShaderCacheStats
+{
+    std::uint32_t Hits{0};
+    std::uint32_t Compiles{0};
+};
+
+// Thread-safe: concurrent misses on the same key may both compile, and the last write wins.
+class ShaderCache
+{
+public:
+    // Sources are read through fileIO when given, else with a plain stream.
+    ShaderCache(IShaderCompiler& compiler, std::wstring directory, Files::AsyncFileIO* fileIO = nullptr);
+    ShaderCache(const ShaderCache& rhs) = delete;
+    ShaderCache& operator=(const ShaderCache& rhs) = delete;
+    ~ShaderCache() = default;
+
+    // Returns the path of the cached bytecode, compiling and storing it first on a miss.  Throws
+    // std::runtime_error with the compiler output when compilation fails.  sources, if given,
+    // receives the files the key was computed from, as for Key.
+    [[nodiscard]] std::wstring Resolve(const ShaderCompileRequest& request, std::vector<std::wstring>* sources = nullptr);
+
+    // Throws std::runtime_error when the source file cannot be read.  sources, if given, receives
+    // the normalized paths of the source and every include it names, found or not, so that a
+    // watcher knows which edits invalidate the key.
+    [[nodiscard]] std::uint64_t Key(const ShaderCompileRequest& request, std::vector<std::wstring>* sources = nullptr) const;
+
+    [[nodiscard]] ShaderCacheStats Stats() const;
+
+private:
+    IShaderCompiler& mCompiler;
+    std::wstring mDirectory{};
+    Files::AsyncFileIO* mFileIO{nullptr};
+
+    std::atomic<std::uint32_t> mHits{0};
+    std::atomic<std::uint32_t> mCompiles{0};
+};
+} // namespace Gfx
+
+#endif // _SHADERCACHE_
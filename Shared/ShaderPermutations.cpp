@@ -0,0 +1,334 @@
+#include "ShaderPermutations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <thread>
+#include <utility>
+
+using namespace Gfx;
+
+namespace
+{
+bool DependsOn(const std::vector<std::wstring>& sources, const std::vector<std::filesystem::path>& files)
+{
+    return std::any_of(sources.begin(), sources.end(), [&files](const std::wstring& source) {
+        return std::find(files.begin(), files.end(), std::filesystem::path{source}) != files.end();
+    });
+}
+} // namespace
+
+ShaderPermutations::ShaderPermutations(ShaderCache& cache, Jobs::JobSystem& jobs) : mCache{cache}, mJobs{jobs}
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    for (auto& slot : mSlots)
+    {
+        WaitFor(slot);
+        if (slot.ReloadState.load(std::memory_order_acquire) != SlotState::Idle)
+        {
+            mJobs.Wait(slot.ReloadDone);
+        }
+    }
+}
+
+ShaderId ShaderPermutations::Declare(ShaderProgramDesc desc)
+{
+    std::uint32_t count{1};
+    for (const auto& axis : desc.Axes)
+    {
+        assert(!axis.Values.empty() && "An axis needs at least one value.");
+        count *= static_cast<std::uint32_t>(axis.Values.size());
+    }
+
+    auto first{static_cast<ShaderPermutationHandle>(mSlots.size())};
+    for (std::uint32_t i{0}; i < count; ++i)
+    {
+        mSlots.emplace_back();
+    }
+
+    mPrograms.push_back(Program{std::move(desc), first, count});
+    return static_cast<ShaderId>(mPrograms.size() - 1);
+}
+
+std::uint32_t ShaderPermutations::PermutationCount(ShaderId shader) const
+{
+    assert(shader < mPrograms.size());
+    return mPrograms[shader].Count;
+}
+
+ShaderPermutationHandle ShaderPermutations::Permutation(ShaderId shader, const std::vector<std::uint32_t>& valueIndices) const
+{
+    assert(shader < mPrograms.size());
+    const auto& program{mPrograms[shader]};
+    assert(valueIndices.size() == program.Desc.Axes.size());
+
+    std::uint32_t index{0};
+    for (std::size_t i{0}; i < valueIndices.size(); ++i)
+    {
+        const auto& axis{program.Desc.Axes[i]};
+        assert(valueIndices[i] < axis.Values.size());
+        index = index * static_cast<std::uint32_t>(axis.Values.size()) + valueIndices[i];
+    }
+    return program.First + index;
+}
+
+ShaderPermutationHandle ShaderPermutations::Select(ShaderId shader,
+                                                   const std::vector<std::pair<std::string, std::string>>& values) const
+{
+    assert(shader < mPrograms.size());
+    const auto& axes{mPrograms[shader].Desc.Axes};
+
+    std::vector<std::uint32_t> valueIndices(axes.size(), 0);
+    for (const auto& [define, value] : values)
+    {
+        auto axis{std::find_if(axes.begin(), axes.end(), [&define = define](const ShaderAxis& candidate) {
+            return candidate.Define == define;
+        })};
+        assert(axis != axes.end() && "Unknown axis.");
+
+        auto selected{std::find(axis->Values.begin(), axis->Values.end(), value)};
+        assert(selected != axis->Values.end() && "Unknown axis value.");
+
+        valueIndices[static_cast<std::size_t>(axis - axes.begin())]
+            = static_cast<std::uint32_t>(selected - axis->Values.begin());
+    }
+    return Permutation(shader, valueIndices);
+}
+
+ShaderCompileRequest ShaderPermutations::Request(ShaderPermutationHandle permutation) const
+{
+    const auto& program{ProgramOf(permutation)};
+    const auto& axes{program.Desc.Axes};
+
+    ShaderCompileRequest request{program.Desc.Filename, {}, program.Desc.EntryPoint, program.Desc.Target, program.Desc.Flags};
+    request.Defines.resize(axes.size());
+
+    // The last axis varies fastest.
+    auto index{permutation - program.First};
+    for (auto i{axes.size()}; i-- > 0;)
+    {
+        auto valueCount{static_cast<std::uint32_t>(axes[i].Values.size())};
+        request.Defines[i] = ShaderDefine{axes[i].Define, axes[i].Values[index % valueCount]};
+        index /= valueCount;
+    }
+    return request;
+}
+
+void ShaderPermutations::CompileAll()
+{
+    for (ShaderPermutationHandle permutation{0}; permutation < mSlots.size(); ++permutation)
+    {
+        Start(permutation);
+    }
+
+    std::exception_ptr firstError{};
+    for (auto& slot : mSlots)
+    {
+        WaitFor(slot);
+        if (slot.State.load(std::memory_order_acquire) == SlotState::Failed && !firstError)
+        {
+            firstError = slot.Error;
+        }
+    }
+
+    if (firstError)
+    {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void ShaderPermutations::Prefetch(ShaderPermutationHandle permutation)
+{
+    Start(permutation);
+}
+
+ShaderBytecode ShaderPermutations::Get(ShaderPermutationHandle permutation)
+{
+    assert(permutation < mSlots.size());
+    auto& slot{mSlots[permutation]};
+
+    Start(permutation);
+    WaitFor(slot);
+    if (slot.State.load(std::memory_order_acquire) == SlotState::Failed)
+    {
+        std::rethrow_exception(slot.Error);
+    }
+    return ShaderBytecode{slot.Bytecode.Data(), slot.Bytecode.Size()};
+}
+
+bool ShaderPermutations::IsReady(ShaderPermutationHandle permutation) const
+{
+    assert(permutation < mSlots.size());
+    return mSlots[permutation].State.load(std::memory_order_acquire) == SlotState::Ready;
+}
+
+bool ShaderPermutations::Start(ShaderPermutationHandle permutation)
+{
+    assert(permutation < mSlots.size());
+    auto& slot{mSlots[permutation]};
+
+    auto expected{SlotState::Idle};
+    if (!slot.State.compare_exchange_strong(expected, SlotState::Compiling, std::memory_order_acq_rel))
+    {
+        return false;
+    }
+
+    mJobs.Run([this, permutation] { Compile(permutation); }, &slot.Done);
+    return true;
+}
+
+void ShaderPermutations::Compile(ShaderPermutationHandle permutation)
+{
+    auto& slot{mSlots[permutation]};
+    try
+    {
+        slot.Bytecode = Files::MappedFile{mCache.Resolve(Request(permutation), &slot.Sources), Files::AccessHint::Sequential};
+        slot.State.store(SlotState::Ready, std::memory_order_release);
+    }
+    catch (...)
+    {
+        slot.Error = std::current_exception();
+        slot.State.store(SlotState::Failed, std::memory_order_release);
+    }
+}
+
+std::uint32_t ShaderPermutations::Reload(const std::vector<std::wstring>& files)
+{
+    std::vector<std::filesystem::path> changed{};
+    for (const auto& file : files)
+    {
+        changed.push_back(std::filesystem::path{file}.lexically_normal());
+    }
+
+    std::uint32_t count{0};
+    for (ShaderPermutationHandle permutation{0}; permutation < mSlots.size(); ++permutation)
+    {
+        auto& slot{mSlots[permutation]};
+
+        // Permutations never compiled pick up the change when they are; those compiling now
+        // may have read the old source, but their Sources are not published yet.
+        auto state{slot.State.load(std::memory_order_acquire)};
+        if (state == SlotState::Idle || state == SlotState::Compiling || !DependsOn(slot.Sources, changed))
+        {
+            continue;
+        }
+
+        if (slot.ReloadState.load(std::memory_order_acquire) == SlotState::Idle)
+        {
+            StartReload(permutation);
+        }
+        else
+        {
+            slot.ReloadAgain = true;
+        }
+        ++count;
+    }
+    return count;
+}
+
+std::vector<ShaderReload> ShaderPermutations::ApplyReloads()
+{
+    std::vector<ShaderReload> finished{};
+    for (ShaderPermutationHandle permutation{0}; permutation < mSlots.size(); ++permutation)
+    {
+        auto& slot{mSlots[permutation]};
+        auto state{slot.ReloadState.load(std::memory_order_acquire)};
+        if (state != SlotState::Ready && state != SlotState::Failed)
+        {
+            continue;
+        }
+
+        // Let the job finish with the slot; it publishes its result before it releases the counter.
+        mJobs.Wait(slot.ReloadDone);
+        if (!slot.ReloadSources.empty())
+        {
+            slot.Sources = std::move(slot.ReloadSources);
+            slot.ReloadSources.clear();
+        }
+        slot.ReloadState.store(SlotState::Idle, std::memory_order_relaxed);
+
+        // The files changed again while this one compiled; its result is already stale.
+        if (slot.ReloadAgain)
+        {
+            slot.ReloadAgain = false;
+            StartReload(permutation);
+            continue;
+        }
+
+        if (state == SlotState::Ready)
+        {
+            slot.Bytecode = std::move(slot.ReloadBytecode);
+            slot.Error = nullptr;
+            slot.State.store(SlotState::Ready, std::memory_order_release);
+            finished.push_back(ShaderReload{permutation, {}});
+        }
+        else
+        {
+            finished.push_back(ShaderReload{permutation, std::move(slot.ReloadError)});
+            slot.ReloadError.clear();
+        }
+    }
+    return finished;
+}
+
+void ShaderPermutations::StartReload(ShaderPermutationHandle permutation)
+{
+    auto& slot{mSlots[permutation]};
+    slot.ReloadState.store(SlotState::Compiling, std::memory_order_relaxed);
+    mJobs.Run([this, permutation] { Recompile(permutation); }, &slot.ReloadDone);
+}
+
+void ShaderPermutations::Recompile(ShaderPermutationHandle permutation)
+{
+    auto& slot{mSlots[permutation]};
+    try
+    {
+        slot.ReloadBytecode
+            = Files::MappedFile{mCache.Resolve(Request(permutation), &slot.ReloadSources), Files::AccessHint::Sequential};
+        slot.ReloadState.store(SlotState::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& e)
+    {
+        slot.ReloadError = e.what();
+        slot.ReloadState.store(SlotState::Failed, std::memory_order_release);
+    }
+    catch (...)
+    {
+        slot.ReloadError = "Unknown shader compile error";
+        slot.ReloadState.store(SlotState::Failed, std::memory_order_release);
+    }
+}
+
+void ShaderPermutations::WaitFor(Slot& slot)
+{
+    while (slot.State.load(std::memory_order_acquire) == SlotState::Compiling)
+    {
+        // The thread that started the slot may not have queued its job yet.
+        mJobs.Wait(slot.Done);
+        if (slot.State.load(std::memory_order_acquire) == SlotState::Compiling)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // The job publishes its result before it releases the counter; let it finish with the slot.
+    if (slot.State.load(std::memory_order_acquire) != SlotState::Idle)
+    {
+        mJobs.Wait(slot.Done);
+    }
+}
+
+const ShaderPermutations::Program& ShaderPermutations::ProgramOf(ShaderPermutationHandle permutation) const
+{
+    auto program{std::upper_bound(mPrograms.begin(),
+                                  mPrograms.end(),
+                                  permutation,
+                                  [](ShaderPermutationHandle value, const Program& candidate) {
+                                      return value < candidate.First;
+                                  })};
+    assert(program != mPrograms.begin() && permutation < mSlots.size());
+    return *std::prev(program);
+}
@@ -0,0 +1,148 @@
+#ifndef _SHADERPERMUTATIONS_
+#define _SHADERPERMUTATIONS_
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "PipelineCache.h"
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Shader permutations compiled as jobs through a ShaderCache.
+//
+// A shader declares feature axes, each a define and the values it can take.  Every combination of
+// values is one permutation, compiled with those defines.  Permutations of a shader get
+// consecutive handles, the first axis varying slowest, so handles are stable across runs for the
+// same declarations.  Compiling is either eager (CompileAll, Prefetch) or happens on the first Get.
+//
+// Declare every shader before compiling any permutation.  After that, Prefetch, Get and IsReady may
+// be called from any thread.
+//
+// Hot reload: Reload recompiles, as jobs, the compiled permutations that depend on changed files,
+// next to the bytecode in use.  ApplyReloads swaps the results in at a point the caller picks,
+// usually a frame boundary.  Reload and ApplyReloads come from one thread.
+namespace Gfx
+{
+using ShaderId = std::uint32_t;
+using ShaderPermutationHandle = std::uint32_t;
+
+struct ShaderAxis
+{
+    std::string Define{};
+    // A define that is either off or on is {"0", "1"}.
+    std::vector<std::string> Values{};
+};
+
+// A finished reload.  Error is empty when the new bytecode was swapped in; otherwise it holds the
+// compiler output and the permutation keeps its previous bytecode.
+struct ShaderReload
+{
+    ShaderPermutationHandle Permutation{0};
+    std::string Error{};
+};
+
+struct ShaderProgramDesc
+{
+    std::wstring Filename{};
+    std::string EntryPoint{};
+    std::string Target{};
+    std::uint32_t Flags{0};
+    std::vector<ShaderAxis> Axes{};
+};
+
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(ShaderCache& cache, Jobs::JobSystem& jobs);
+    ShaderPermutations(const ShaderPermutations& rhs) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations& rhs) = delete;
+    // Waits for compiles still in flight.
+    ~ShaderPermutations();
+
+    ShaderId Declare(ShaderProgramDesc desc);
+
+    [[nodiscard]] std::uint32_t PermutationCount(ShaderId shader) const;
+    // valueIndices holds one index into each axis' Values, in declaration order.
+    [[nodiscard]] ShaderPermutationHandle Permutation(ShaderId shader, const std::vector<std::uint32_t>& valueIndices) const;
+    // By define name and value; axes left out take their first value.
+    [[nodiscard]] ShaderPermutationHandle Select(ShaderId shader,
+                                                 const std::vector<std::pair<std::string, std::string>>& values) const;
+    [[nodiscard]] ShaderCompileRequest Request(ShaderPermutationHandle permutation) const;
+
+    // Compiles every permutation of every declared shader in parallel and returns when all are
+    // done.  Rethrows the first compile error.
+    void CompileAll();
+    // Starts compiling permutation in the background unless it already has been.
+    void Prefetch(ShaderPermutationHandle permutation);
+    // Compiles permutation on first use and waits for it.  Rethrows its compile error, if any.
+    // The bytecode stays valid for the lifetime of this object.
+    ShaderBytecode Get(ShaderPermutationHandle permutation);
+    [[nodiscard]] bool IsReady(ShaderPermutationHandle permutation) const;
+
+    // Starts recompiling every compiled permutation whose source or includes are among files, and
+    // returns how many it covers.  A permutation already reloading is recompiled again afterwards.
+    std::uint32_t Reload(const std::vector<std::wstring>& files);
+    // Swaps in the bytecode of the reloads that finished since the last call and returns them.
+    // Invalidates what Get returned for the swapped permutations: call it while nothing uses that
+    // bytecode any more, e.g. no pipeline built from it is still being created.
+    std::vector<ShaderReload> ApplyReloads();
+
+private:
+    enum class SlotState : std::uint32_t
+    {
+        Idle,
+        Compiling,
+        Ready,
+        Failed,
+    };
+
+    struct Program
+    {
+        ShaderProgramDesc Desc{};
+        ShaderPermutationHandle First{0};
+        std::uint32_t Count{1};
+    };
+
+    struct Slot
+    {
+        std::atomic<SlotState> State{SlotState::Idle};
+        Jobs::JobCounter Done{};
+        // Cache entries are never rewritten in place, so the bytecode is used straight from the file.
+        Files::MappedFile Bytecode{};
+        std::exception_ptr Error{};
+        // Files the bytecode was compiled from, as ShaderCache::Key lists them.
+        std::vector<std::wstring> Sources{};
+
+        // The reload in flight, kept apart so Get returns the current bytecode meanwhile.
+        std::atomic<SlotState> ReloadState{SlotState::Idle};
+        Jobs::JobCounter ReloadDone{};
+        bool ReloadAgain{false};
+        Files::MappedFile ReloadBytecode{};
+        std::vector<std::wstring> ReloadSources{};
+        std::string ReloadError{};
+    };
+
+    // Returns false when the permutation was already started.
+    bool Start(ShaderPermutationHandle permutation);
+    void Compile(ShaderPermutationHandle permutation);
+    void StartReload(ShaderPermutationHandle permutation);
+    void Recompile(ShaderPermutationHandle permutation);
+    void WaitFor(Slot& slot);
+    [[nodiscard]] const Program& ProgramOf(ShaderPermutationHandle permutation) const;
+
+    ShaderCache& mCache;
+    Jobs::JobSystem& mJobs;
+
+    std::vector<Program> mPrograms{};
+    // Slots never move once created; jobs hold references to them.
+    std::deque<Slot> mSlots{};
+};
+} // namespace Gfx
+
+#endif // _SHADERPERMUTATIONS_
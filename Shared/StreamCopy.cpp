@@ -0,0 +1,74 @@
+#include "StreamCopy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+constexpr std::size_t CacheLineSize{64};
+
+inline void StreamCacheLine(std::uint8_t* dst, const std::uint8_t* src) noexcept
+{
+#if defined(__AVX2__)
+    __m256i lo{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src))};
+    __m256i hi{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32))};
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), lo);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), hi);
+#else
+    for (std::size_t i{0}; i < CacheLineSize; i += 16)
+    {
+        __m128i v{_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))};
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#endif
+}
+} // namespace
+
+void D3DUtils::StreamCopy(void* dst, const void* src, std::size_t byteSize) noexcept
+{
+    auto* d{static_cast<std::uint8_t*>(dst)};
+    const auto* s{static_cast<const std::uint8_t*>(src)};
+
+    // Streaming pays once the copy covers a line of its own; a lone line next to cached partial
+    // writes loses to memcpy (Benchmarks/CopyRangeBench.cpp).  So a 64-byte element in its own
+    // 256-byte constant buffer slot is streamed, a 96-byte one is not.
+    auto misalignment{reinterpret_cast<std::uintptr_t>(d) & (CacheLineSize - 1)};
+    auto head{misalignment != 0 ? std::min(byteSize, CacheLineSize - misalignment) : 0};
+    auto lineCount{(byteSize - head) / CacheLineSize};
+    auto isPartial{head != 0 || (byteSize - head) % CacheLineSize != 0};
+    if (lineCount == 0 || (lineCount == 1 && isPartial))
+    {
+        std::memcpy(d, s, byteSize);
+        return;
+    }
+
+    // Head: bring the destination up to a cache line boundary.
+    if (head != 0)
+    {
+        std::memcpy(d, s, head);
+        d += head;
+        s += head;
+        byteSize -= head;
+    }
+
+    // Body: full, aligned cache lines.
+    for (; byteSize >= CacheLineSize; byteSize -= CacheLineSize)
+    {
+        StreamCacheLine(d, s);
+        d += CacheLineSize;
+        s += CacheLineSize;
+    }
+
+    // Tail: the remaining partial line.
+    if (byteSize != 0)
+    {
+        std::memcpy(d, s, byteSize);
+    }
+}
+
+void D3DUtils::StreamCopyFence() noexcept
+{
+    _mm_sfence();
+}
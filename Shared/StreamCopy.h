@@ -0,0 +1,19 @@
+#ifndef _STREAMCOPY_
+#define _STREAMCOPY_
+
+#include <cstddef>
+
+namespace D3DUtils
+{
+// Copies byteSize bytes into write-combined (mapped upload heap) memory.  Whole 64-byte cache
+// lines are written with non-temporal stores (AVX2 when available, SSE2 otherwise), so the
+// write-combining buffers are flushed as full lines instead of stalling on partial writes.
+// Only the unaligned head and tail go through memcpy, and copies too short to stream a line of
+// their own go through it entirely.  The stores are weakly ordered: call StreamCopyFence() once
+// the whole batch has been written and before the GPU may read it.
+void StreamCopy(void* dst, const void* src, std::size_t byteSize) noexcept;
+
+void StreamCopyFence() noexcept;
+} // namespace D3DUtils
+
+#endif // _STREAMCOPY_
@@ -0,0 +1,243 @@
+#include "UploadBatcher.h"
+
+#include "Profiler.h"
+#include "StreamCopy.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <utility>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+UploadBatcher::UploadBatcher(IDevice& device,
+                             ICommandQueue& queue,
+                             ResourceStateRegistry& registry,
+                             std::uint64_t ringByteSize) :
+    mDevice{device},
+    mQueue{queue},
+    mRegistry{registry},
+    mFence{device.CreateFence(0)},
+    mRingByteSize{AlignUp(ringByteSize, Alignment)},
+    mTracker{registry}
+{
+    assert(ringByteSize > 0);
+
+    mRing = mDevice.CreateBuffer(HeapType::Upload, mRingByteSize, States::GenericRead);
+    mRingData = static_cast<std::uint8_t*>(mDevice.Map(mRing));
+
+    mFreeAllocators.push_back(mDevice.CreateCommandAllocator(mQueue.Type()));
+    mList = mDevice.CreateCommandList(mQueue.Type(), mFreeAllocators.back().get());
+}
+
+UploadBatcher::~UploadBatcher()
+{
+    // The ring must outlive every copy reading from it.
+    WaitForFence(mLastFenceValue);
+    mDevice.ReleaseResource(mRing);
+}
+
+ResourceHandle UploadBatcher::CreateBuffer(const void* data, std::uint64_t byteSize, ResourceStates finalState)
+{
+    assert(byteSize > 0);
+
+    auto buffer{mDevice.CreateBuffer(HeapType::Default, byteSize, States::Common)};
+    mRegistry.Register(buffer, States::Common, 1, true);
+    Upload(buffer, 0, data, byteSize, finalState);
+    return buffer;
+}
+
+void UploadBatcher::Upload(ResourceHandle buffer,
+                           std::uint64_t offset,
+                           const void* data,
+                           std::uint64_t byteSize,
+                           ResourceStates finalState)
+{
+    assert(buffer != NullResource && mRegistry.IsRegistered(buffer));
+    PROFILE_ZONE("Upload");
+
+    const auto* source{static_cast<const std::uint8_t*>(data)};
+    while (byteSize > 0)
+    {
+        auto chunk{std::min(byteSize, mRingByteSize)};
+        auto ringOffset{Allocate(chunk)};
+        if (!mAllocator)
+        {
+            BeginBatch();
+        }
+
+        // Upload heaps are write-combined; Submit fences the streamed stores once per batch.
+        D3DUtils::StreamCopy(mRingData + ringOffset, source, static_cast<std::size_t>(chunk));
+
+        // First use in the batch: promoted from COMMON, no barrier before the copy.
+        mTracker.Transition(buffer, States::CopyDest);
+        mList->CopyBufferRegion(buffer, offset, mRing, ringOffset, chunk);
+        if (mDestinations.empty() || mDestinations.back().Buffer != buffer
+            || mDestinations.back().FinalState != finalState)
+        {
+            mDestinations.push_back(Destination{buffer, finalState});
+        }
+
+        ++mStats.CopyCount;
+        mStats.UploadedBytes += chunk;
+        source += chunk;
+        offset += chunk;
+        byteSize -= chunk;
+    }
+}
+
+UploadTicket UploadBatcher::Submit()
+{
+    if (!mAllocator)
+    {
+        return UploadTicket{mLastFenceValue};
+    }
+    PROFILE_ZONE("UploadSubmit");
+
+    // Copy queues cannot use read states; the buffers decay to COMMON and are promoted where read.
+    if (mQueue.Type() != QueueType::Copy)
+    {
+        for (const auto& destination : mDestinations)
+        {
+            mTracker.Transition(destination.Buffer, destination.FinalState);
+        }
+    }
+    mTracker.FlushBarriers(*mList);
+    mList->Close();
+
+    mFixups.clear();
+    mRegistry.Submit(mTracker, mFixups);
+    assert(mFixups.empty() && "Upload destinations must be buffers.");
+
+    D3DUtils::StreamCopyFence();
+    std::array<ICommandList*, 1> lists{mList.get()};
+    mQueue.ExecuteCommandLists(static_cast<std::uint32_t>(lists.size()), lists.data());
+    mQueue.Signal(mFence.get(), ++mLastFenceValue);
+
+    mBatches.push_back(Batch{mOpenRingBytes, mLastFenceValue, std::move(mAllocator)});
+    mOpenRingBytes = 0;
+    mDestinations.clear();
+    ++mStats.BatchCount;
+
+    return UploadTicket{mLastFenceValue};
+}
+
+bool UploadBatcher::IsComplete(UploadTicket ticket) const
+{
+    return mFence->GetCompletedValue() >= ticket.FenceValue;
+}
+
+void UploadBatcher::Wait(UploadTicket ticket)
+{
+    assert(ticket.FenceValue <= mLastFenceValue && "Waiting for a batch that was never submitted.");
+
+    WaitForFence(ticket.FenceValue);
+    ReleaseCompleted();
+}
+
+IFence& UploadBatcher::Fence() const
+{
+    return *mFence;
+}
+
+std::uint64_t UploadBatcher::RingByteSize() const
+{
+    return mRingByteSize;
+}
+
+std::uint64_t UploadBatcher::RingUsedBytes() const
+{
+    return mUsed;
+}
+
+const UploadBatcherStats& UploadBatcher::Stats() const
+{
+    return mStats;
+}
+
+std::uint64_t UploadBatcher::Allocate(std::uint64_t byteSize)
+{
+    std::uint64_t offset{0};
+    ReleaseCompleted();
+    while (!TryAllocate(byteSize, offset))
+    {
+        // Free the oldest submitted batch first; the open batch only goes out early when it alone
+        // is in the way.
+        if (mBatches.empty())
+        {
+            assert(mOpenRingBytes > 0);
+            Submit();
+        }
+
+        ++mStats.RingWaits;
+        WaitForFence(mBatches.front().FenceValue);
+        ReleaseCompleted();
+    }
+    return offset;
+}
+
+bool UploadBatcher::TryAllocate(std::uint64_t byteSize, std::uint64_t& offset)
+{
+    auto size{AlignUp(byteSize, Alignment)};
+    assert(size <= mRingByteSize);
+
+    if (mUsed == 0)
+    {
+        mHead = 0;
+    }
+
+    // Skip the tail when the range would straddle the end of the ring.
+    auto skipped{mHead + size > mRingByteSize ? mRingByteSize - mHead : 0};
+    if (mUsed + skipped + size > mRingByteSize)
+    {
+        return false;
+    }
+
+    offset = skipped > 0 ? 0 : mHead;
+    mHead = (offset + size) % mRingByteSize;
+    mUsed += skipped + size;
+    mOpenRingBytes += skipped + size;
+    return true;
+}
+
+void UploadBatcher::BeginBatch()
+{
+    if (mFreeAllocators.empty())
+    {
+        mAllocator = mDevice.CreateCommandAllocator(mQueue.Type());
+    }
+    else
+    {
+        mAllocator = std::move(mFreeAllocators.back());
+        mFreeAllocators.pop_back();
+    }
+
+    mAllocator->Reset();
+    mList->Reset(mAllocator.get(), PipelineHandle{0});
+    mTracker.Reset();
+}
+
+void UploadBatcher::ReleaseCompleted()
+{
+    auto completed{mFence->GetCompletedValue()};
+    while (!mBatches.empty() && mBatches.front().FenceValue <= completed)
+    {
+        mUsed -= mBatches.front().RingBytes;
+        mFreeAllocators.push_back(std::move(mBatches.front().Allocator));
+        mBatches.pop_front();
+    }
+}
+
+void UploadBatcher::WaitForFence(std::uint64_t value)
+{
+    // Only a full ring or an explicit Wait gets here.
+    mWaiter.Wait(*mFence, value);
+}
@@ -0,0 +1,138 @@
+#ifndef _UPLOADBATCHER_
+#define _UPLOADBATCHER_
+
+#include "FenceWaiter.h"
+#include "GfxBackend.h"
+#include "ResourceStateTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Batched buffer uploads through one persistently mapped upload buffer used as a ring.
+//
+// Uploads write their data into the ring and record a copy into the open batch's command list;
+// Submit closes the batch, moves every destination to its final state with one ResourceBarrier
+// call and executes the list, returning a ticket that completes when the copies have run.  Ring
+// space is reclaimed as tickets complete.  When the ring is full the open batch is submitted and
+// the batcher waits for the oldest one; uploads larger than the ring are copied in pieces.
+//
+// Destinations are buffers registered with the registry.  Buffers decay to COMMON between lists,
+// so any buffer can be uploaded to whatever lists used it before.  On a copy queue the final
+// transitions are skipped: the destinations are promoted on first use by the queue that reads them.
+//
+// Not thread-safe.
+namespace Gfx
+{
+struct UploadTicket
+{
+    // Value the batcher's fence reaches once the batch has executed; 0 for no uploads.
+    std::uint64_t FenceValue{0};
+};
+
+struct UploadBatcherStats
+{
+    std::uint64_t UploadedBytes{0};
+    std::uint32_t CopyCount{0};
+    std::uint32_t BatchCount{0};
+    // Times an upload had to wait for the GPU to free ring space.
+    std::uint32_t RingWaits{0};
+};
+
+class UploadBatcher
+{
+public:
+    static constexpr std::uint64_t DefaultRingByteSize{16 * 1024 * 1024};
+    // Allocations start on cache lines, so neighbouring uploads never share a partial line.
+    static constexpr std::uint64_t Alignment{64};
+
+    UploadBatcher(IDevice& device,
+                  ICommandQueue& queue,
+                  ResourceStateRegistry& registry,
+                  std::uint64_t ringByteSize = DefaultRingByteSize);
+    UploadBatcher(const UploadBatcher& rhs) = delete;
+    UploadBatcher& operator=(const UploadBatcher& rhs) = delete;
+    // Waits for the submitted batches; an open batch is dropped.
+    ~UploadBatcher();
+
+    // Creates a default-heap buffer, registers it and queues the upload of byteSize bytes of data.
+    // The device owns the buffer.
+    [[nodiscard]] ResourceHandle CreateBuffer(const void* data,
+                                              std::uint64_t byteSize,
+                                              ResourceStates finalState = States::GenericRead);
+    // Queues the upload of byteSize bytes of data to [offset, offset + byteSize) of buffer.  data
+    // is copied before the call returns.
+    void Upload(ResourceHandle buffer,
+                std::uint64_t offset,
+                const void* data,
+                std::uint64_t byteSize,
+                ResourceStates finalState = States::GenericRead);
+
+    // Executes the open batch.  With nothing queued, returns the ticket of the last batch.
+    UploadTicket Submit();
+
+    [[nodiscard]] bool IsComplete(UploadTicket ticket) const;
+    // Blocks until the batch has executed.
+    void Wait(UploadTicket ticket);
+
+    // Signalled with each ticket's value, so other queues can wait for uploads on the GPU.
+    [[nodiscard]] IFence& Fence() const;
+    [[nodiscard]] std::uint64_t RingByteSize() const;
+    // Includes skipped tails and the open batch.
+    [[nodiscard]] std::uint64_t RingUsedBytes() const;
+    [[nodiscard]] const UploadBatcherStats& Stats() const;
+
+private:
+    struct Batch
+    {
+        std::uint64_t RingBytes{0};
+        std::uint64_t FenceValue{0};
+        std::unique_ptr<ICommandAllocator> Allocator{};
+    };
+
+    struct Destination
+    {
+        ResourceHandle Buffer{NullResource};
+        ResourceStates FinalState{States::Common};
+    };
+
+    // Returns the ring offset of byteSize bytes, submitting and waiting as needed.
+    std::uint64_t Allocate(std::uint64_t byteSize);
+    bool TryAllocate(std::uint64_t byteSize, std::uint64_t& offset);
+    void BeginBatch();
+    void ReleaseCompleted();
+    void WaitForFence(std::uint64_t value);
+
+    IDevice& mDevice;
+    ICommandQueue& mQueue;
+    ResourceStateRegistry& mRegistry;
+
+    std::unique_ptr<IFence> mFence{};
+    std::uint64_t mLastFenceValue{0};
+    FenceWaiter mWaiter{};
+
+    ResourceHandle mRing{NullResource};
+    std::uint8_t* mRingData{nullptr};
+    std::uint64_t mRingByteSize{0};
+    std::uint64_t mHead{0};
+    std::uint64_t mUsed{0};
+
+    // The open batch; mList is recording while mAllocator is set.
+    std::unique_ptr<ICommandList> mList{};
+    std::unique_ptr<ICommandAllocator> mAllocator{};
+    std::uint64_t mOpenRingBytes{0};
+    ResourceStateTracker mTracker;
+    std::vector<Destination> mDestinations{};
+    std::vector<Barrier> mFixups{};
+
+    // Submitted batches, oldest first; their allocators are reused once they complete.
+    std::deque<Batch> mBatches{};
+    std::vector<std::unique_ptr<ICommandAllocator>> mFreeAllocators{};
+
+    UploadBatcherStats mStats{};
+};
+} // namespace Gfx
+
+#endif // _UPLOADBATCHER_
@@ -0,0 +1,102 @@
+#include "../Shared/BuddyAllocator.h"
+#include "TestHarness.h"
+
+using namespace Gfx;
+
+TEST_CASE(BuddyAllocatorSplitsAndMergesBlocks)
+{
+    BuddyAllocator allocator{1024, 64};
+    CHECK(allocator.LargestFreeBlock() == 1024);
+
+    // 100 bytes round up to 128; splitting the range leaves free blocks of 128, 256 and 512.
+    CHECK(allocator.Allocate(100) == 0);
+    CHECK(allocator.BlockSize(0) == 128);
+    CHECK(allocator.LargestFreeBlock() == 512);
+
+    // The smallest free block that fits is split further, before any larger one.
+    CHECK(allocator.Allocate(64) == 128);
+    CHECK(allocator.Allocate(1) == 192);
+    CHECK(allocator.Allocate(256) == 256);
+    CHECK(allocator.LargestFreeBlock() == 512);
+
+    const auto& stats{allocator.Stats()};
+    CHECK(stats.AllocationCount == 4);
+    CHECK(stats.UsedBytes == 128 + 64 + 64 + 256);
+    CHECK(stats.RequestedBytes == 100 + 64 + 1 + 256);
+
+    // Each free merges with the free buddy, all the way back to one block.
+    allocator.Free(128);
+    CHECK(allocator.LargestFreeBlock() == 512);
+    allocator.Free(192);
+    allocator.Free(0);
+    CHECK(allocator.LargestFreeBlock() == 512);
+    allocator.Free(256);
+    CHECK(allocator.LargestFreeBlock() == 1024);
+    CHECK(allocator.IsEmpty());
+    CHECK(stats.UsedBytes == 0 && stats.RequestedBytes == 0);
+}
+
+TEST_CASE(BuddyAllocatorAlignsByBlockSize)
+{
+    BuddyAllocator allocator{1024, 64};
+    CHECK(allocator.Allocate(64) == 0);
+
+    // An alignment larger than the request takes a block of the alignment's size.
+    auto aligned{allocator.Allocate(64, 256)};
+    CHECK(aligned == 256);
+    CHECK(allocator.BlockSize(aligned) == 256);
+
+    CHECK(allocator.Allocate(2048) == InvalidHeapOffset);
+    CHECK(allocator.Allocate(64, 2048) == InvalidHeapOffset);
+}
+
+TEST_CASE(BuddyAllocatorFailsWhenFreeSpaceIsFragmented)
+{
+    BuddyAllocator allocator{1024, 64};
+    for (std::uint64_t i{0}; i < 16; ++i)
+    {
+        CHECK(allocator.Allocate(64) == i * 64);
+    }
+    CHECK(allocator.Allocate(64) == InvalidHeapOffset);
+
+    // Half the range is free, but no two free blocks are buddies.
+    for (std::uint64_t i{0}; i < 16; i += 2)
+    {
+        allocator.Free(i * 64);
+    }
+    CHECK(allocator.LargestFreeBlock() == 64);
+    CHECK(allocator.Allocate(128) == InvalidHeapOffset);
+
+    allocator.Free(64);
+    CHECK(allocator.LargestFreeBlock() == 128);
+    CHECK(allocator.Allocate(128) == 0);
+}
+
+TEST_CASE(BuddyAllocatorPlansMovesIntoLowerBlocks)
+{
+    BuddyAllocator allocator{1024, 64};
+    CHECK(allocator.Allocate(256) == 0);
+    CHECK(allocator.Allocate(256) == 256);
+    CHECK(allocator.Allocate(256) == 512);
+    CHECK(allocator.Allocate(200) == 768);
+    allocator.Free(0);
+    allocator.Free(512);
+    CHECK(allocator.LargestFreeBlock() == 256);
+
+    CHECK(allocator.PlanMoves(0).empty());
+
+    // Only the highest allocation moves: its buddy is no better a place, and the one at 256 has no
+    // free block below it once 0 is taken.
+    auto moves{allocator.PlanMoves(4)};
+    REQUIRE(moves.size() == 1);
+    CHECK(moves[0].From == 768);
+    CHECK(moves[0].To == 0);
+    CHECK(moves[0].ByteSize == 200);
+
+    // Source and destination are both allocated until the caller frees the source.
+    CHECK(allocator.Stats().AllocationCount == 3);
+    CHECK(allocator.BlockSize(0) == 256);
+    allocator.Free(moves[0].From);
+    CHECK(allocator.LargestFreeBlock() == 512);
+    CHECK(allocator.Allocate(512) == 512);
+}
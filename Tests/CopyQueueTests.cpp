@@ -0,0 +1,89 @@
+#include "../Shared/CopyQueue.h"
+#include "../Shared/GfxNull.h"
+#include "TestHarness.h"
+
+#include <cstring>
+
+using namespace Gfx;
+
+TEST_CASE(CopyQueueHoldsConsumersUntilTheUploadExecutes)
+{
+    NullDevice device{};
+    ResourceStateRegistry registry{};
+    CopyQueue copy{device, registry, 64 * 1024};
+    auto& nullCopyQueue{static_cast<NullCommandQueue&>(copy.Queue())};
+    auto directQueue{device.CreateCommandQueue(QueueType::Direct)};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    auto frameFence{device.CreateFence(0)};
+
+    // The copy queue lags one signal behind, so the upload is submitted but not yet complete.
+    nullCopyQueue.SetLatency(1);
+    const char message[]{"uploaded on the copy queue"};
+    auto buffer{copy.Uploads().CreateBuffer(message, sizeof(message))};
+    auto ticket{copy.Submit()};
+    CHECK(!copy.Uploads().IsComplete(ticket));
+
+    copy.InsertWait(*directQueue, ticket);
+    copy.InsertWait(*directQueue, ticket);
+    CHECK(copy.Stats().InsertedWaits == 1);
+    CHECK(copy.Stats().SkippedWaits == 1);
+
+    // Direct work that reads the upload is held behind the wait, with the signal after it.
+    auto readback{device.CreateBuffer(HeapType::Readback, sizeof(message), States::CopyDest)};
+    auto list{device.CreateCommandList(QueueType::Direct, allocator.get())};
+    list->Reset(allocator.get(), 0);
+    list->CopyBufferRegion(readback, 0, buffer, 0, sizeof(message));
+    list->Close();
+    ICommandList* lists[]{list.get()};
+    directQueue->ExecuteCommandLists(1, lists);
+    directQueue->Signal(frameFence.get(), 1);
+
+    const char zeros[sizeof(message)]{};
+    CHECK(std::memcmp(device.Map(readback), zeros, sizeof(message)) == 0);
+    CHECK(frameFence->GetCompletedValue() == 0);
+
+    // The list was copied at submission; recording over it does not change what executes.
+    list->Reset(allocator.get(), 0);
+    list->Close();
+
+    nullCopyQueue.Advance();
+    CHECK(copy.Uploads().IsComplete(ticket));
+    CHECK(std::memcmp(device.Map(readback), message, sizeof(message)) == 0);
+    CHECK(frameFence->GetCompletedValue() == 1);
+    CHECK(static_cast<NullCommandQueue&>(*directQueue).PendingOperationCount() == 0);
+
+    // A ticket that has completed needs no wait.
+    copy.InsertWait(*directQueue, copy.Submit());
+    CHECK(copy.Stats().InsertedWaits == 1);
+    CHECK(copy.Stats().SkippedWaits == 2);
+
+    device.ReleaseResource(readback);
+}
+
+TEST_CASE(CopyQueueWaitsPerConsumerQueue)
+{
+    NullDevice device{};
+    ResourceStateRegistry registry{};
+    CopyQueue copy{device, registry, 64 * 1024};
+    auto& nullCopyQueue{static_cast<NullCommandQueue&>(copy.Queue())};
+    auto directQueue{device.CreateCommandQueue(QueueType::Direct)};
+    auto computeQueue{device.CreateCommandQueue(QueueType::Compute)};
+
+    nullCopyQueue.SetLatency(2);
+    const std::uint32_t value{42};
+    static_cast<void>(copy.Uploads().CreateBuffer(&value, sizeof(value)));
+    auto first{copy.Submit()};
+    static_cast<void>(copy.Uploads().CreateBuffer(&value, sizeof(value)));
+    auto second{copy.Submit()};
+
+    // Each queue needs its own wait; an older ticket than one a queue waits for already is covered.
+    copy.InsertWait(*directQueue, second);
+    copy.InsertWait(*directQueue, first);
+    copy.InsertWait(*computeQueue, first);
+    CHECK(copy.Stats().InsertedWaits == 2);
+    CHECK(copy.Stats().SkippedWaits == 1);
+
+    nullCopyQueue.Drain();
+    CHECK(static_cast<NullCommandQueue&>(*directQueue).PendingOperationCount() == 0);
+    CHECK(static_cast<NullCommandQueue&>(*computeQueue).PendingOperationCount() == 0);
+}
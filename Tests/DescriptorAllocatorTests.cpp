@@ -0,0 +1,105 @@
+#include "../Shared/DescriptorAllocator.h"
+#include "TestHarness.h"
+
+using namespace Gfx;
+
+TEST_CASE(DescriptorFreeListReusesAndMergesFreedRanges)
+{
+    DescriptorFreeList list{100};
+    CHECK(list.Allocate(10) == 0);
+    CHECK(list.Allocate(20) == 10);
+    CHECK(list.Allocate(30) == 30);
+    CHECK(list.FreeCount() == 40);
+    CHECK(list.LargestFreeRange() == 40);
+
+    // A hole too small for the next request is skipped, first fit takes the tail.
+    list.Free(10, 20);
+    CHECK(list.FreeCount() == 60);
+    CHECK(list.LargestFreeRange() == 40);
+    CHECK(list.Allocate(25) == 60);
+
+    // Freeing the neighbour merges it with the hole, which then fits a larger request.
+    list.Free(0, 10);
+    CHECK(list.LargestFreeRange() == 30);
+    CHECK(list.Allocate(30) == 0);
+
+    list.Free(0, 30);
+    list.Free(30, 30);
+    list.Free(60, 25);
+    CHECK(list.FreeCount() == 100);
+    CHECK(list.LargestFreeRange() == 100);
+}
+
+TEST_CASE(DescriptorFreeListFailsWhenNoRangeFits)
+{
+    DescriptorFreeList list{64};
+    CHECK(list.Allocate(65) == InvalidDescriptorIndex);
+    CHECK(list.Allocate(32) == 0);
+    CHECK(list.Allocate(32) == 32);
+    CHECK(list.Allocate(1) == InvalidDescriptorIndex);
+
+    // Fragmented: 32 descriptors free, but no run of 32.
+    list.Free(0, 16);
+    list.Free(48, 16);
+    CHECK(list.FreeCount() == 32);
+    CHECK(list.Allocate(32) == InvalidDescriptorIndex);
+    CHECK(list.Allocate(16) == 0);
+}
+
+TEST_CASE(DescriptorFreeListHoldsRetiredRangesUntilTheirFence)
+{
+    DescriptorFreeList list{16};
+    auto first{list.Allocate(8)};
+    auto second{list.Allocate(8)};
+
+    list.FreeAfter(first, 8, 5);
+    list.FreeAfter(second, 8, 6);
+    CHECK(list.RetiringCount() == 16);
+    CHECK(list.FreeCount() == 0);
+    CHECK(list.Allocate(1) == InvalidDescriptorIndex);
+
+    list.ReleaseCompleted(4);
+    CHECK(list.FreeCount() == 0);
+
+    list.ReleaseCompleted(5);
+    CHECK(list.FreeCount() == 8);
+    CHECK(list.RetiringCount() == 8);
+    CHECK(list.Allocate(8) == first);
+
+    list.ReleaseCompleted(6);
+    CHECK(list.RetiringCount() == 0);
+    CHECK(list.FreeCount() == 8);
+}
+
+TEST_CASE(DescriptorRingRetiresWholeFramesAndSkipsTails)
+{
+    DescriptorRing ring{10};
+    CHECK(ring.Allocate(4) == 0);
+    CHECK(ring.Allocate(4) == 4);
+    ring.FinishFrame(1);
+
+    // Three more would straddle the end: the two-descriptor tail is skipped, and there is no room
+    // until frame 1 retires.
+    CHECK(ring.Allocate(3) == InvalidDescriptorIndex);
+    ring.ReleaseCompleted(0);
+    CHECK(ring.UsedCount() == 8);
+    ring.ReleaseCompleted(1);
+    CHECK(ring.UsedCount() == 0);
+
+    // The skipped tail stays used until the frame that skipped it retires.
+    CHECK(ring.Allocate(3) == 0);
+    CHECK(ring.UsedCount() == 5);
+    CHECK(ring.Allocate(6) == InvalidDescriptorIndex);
+    CHECK(ring.Allocate(5) == 3);
+    CHECK(ring.Allocate(1) == InvalidDescriptorIndex);
+    ring.FinishFrame(2);
+
+    // A frame that allocated nothing retires nothing and does not hold the ring back.
+    ring.FinishFrame(3);
+    ring.ReleaseCompleted(2);
+    CHECK(ring.UsedCount() == 0);
+    CHECK(ring.Allocate(11) == InvalidDescriptorIndex);
+    CHECK(ring.Allocate(2) == 8);
+    CHECK(ring.Allocate(8) == 0);
+    CHECK(ring.UsedCount() == 10);
+}
@@ -0,0 +1,86 @@
+#include "../Shared/FileWatcher.h"
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Files;
+
+namespace
+{
+constexpr std::chrono::milliseconds SettleTime{200};
+
+void WriteText(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    fout << text;
+    if (!fout.flush())
+    {
+        throw std::runtime_error("Cannot write " + path.u8string());
+    }
+}
+
+// Polls like a frame loop until expectedCount files were reported or a generous deadline passes.
+std::vector<std::wstring> PollChanges(FileWatcher& watcher, std::size_t expectedCount)
+{
+    std::vector<std::wstring> changes{};
+    auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+    while (changes.size() < expectedCount && std::chrono::steady_clock::now() < deadline)
+    {
+        auto taken{watcher.TakeChanges()};
+        changes.insert(changes.end(), taken.begin(), taken.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    std::sort(changes.begin(), changes.end());
+    return changes;
+}
+} // namespace
+
+TEST_CASE(FileWatcherReportsSettledFilesOnce)
+{
+    auto directory{std::filesystem::temp_directory_path() / "FileWatcherTests"};
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / "staging");
+
+    {
+        // Reported paths are normalized, whatever form the directory was given in.
+        FileWatcher watcher{{(directory / "staging" / "..").wstring()}, SettleTime};
+
+        // A burst of writes to one file, and a save through a file renamed into place from a
+        // subdirectory, which is not watched.
+        for (int i{0}; i < 3; ++i)
+        {
+            WriteText(directory / "a.txt", "version " + std::to_string(i));
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        }
+        WriteText(directory / "staging" / "b.txt", "saved");
+        std::filesystem::rename(directory / "staging" / "b.txt", directory / "b.txt");
+
+        // Nothing has been quiet for the settle time yet.
+        CHECK(watcher.TakeChanges().empty());
+
+        auto changes{PollChanges(watcher, 2)};
+        REQUIRE(changes.size() == 2);
+        CHECK(std::filesystem::path{changes[0]} == directory / "a.txt");
+        CHECK(std::filesystem::path{changes[1]} == directory / "b.txt");
+
+        // Each file was handed out once, with every event of the burst merged.
+        std::this_thread::sleep_for(SettleTime * 2);
+        CHECK(watcher.TakeChanges().empty());
+
+        // A later write is reported again.
+        WriteText(directory / "b.txt", "saved again");
+        changes = PollChanges(watcher, 1);
+        REQUIRE(changes.size() == 1);
+        CHECK(std::filesystem::path{changes[0]} == directory / "b.txt");
+    }
+
+    std::error_code error{};
+    std::filesystem::remove_all(directory, error);
+}
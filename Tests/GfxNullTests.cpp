@@ -0,0 +1,172 @@
+#include "../Shared/GfxNull.h"
+#include "TestHarness.h"
+
+#include <cstring>
+
+using namespace Gfx;
+
+namespace
+{
+// A closed list with one copy of byteSize bytes from src to dst.
+std::unique_ptr<ICommandList> RecordCopy(NullDevice& device,
+                                         ICommandAllocator& allocator,
+                                         ResourceHandle dst,
+                                         ResourceHandle src,
+                                         std::uint64_t byteSize)
+{
+    auto list{device.CreateCommandList(QueueType::Copy, &allocator)};
+    list->Reset(&allocator, 0);
+    list->CopyBufferRegion(dst, 0, src, 0, byteSize);
+    list->Close();
+    return list;
+}
+} // namespace
+
+TEST_CASE(NullCommandListRecordsDecodableStream)
+{
+    NullDevice device{};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    NullCommandList list{QueueType::Direct};
+
+    list.Reset(allocator.get(), 7);
+    Barrier barriers[2]{{1, AllSubresources, States::Common, States::RenderTarget, BarrierFlags::None},
+                        {2, AllSubresources, States::Common, States::DepthWrite, BarrierFlags::None}};
+    list.ResourceBarrier(2, barriers);
+    list.SetGraphicsRoot32BitConstant(3, 42, 1);
+    list.DrawIndexedInstanced(36, 2, 0, 0, 0);
+    list.Close();
+
+    const auto& stats{list.Stats()};
+    CHECK(stats.CommandCount == 4);
+    CHECK(stats.DrawCount == 1);
+    CHECK(stats.IndexCount == 72);
+    CHECK(stats.BarrierCalls == 1);
+    CHECK(stats.BarrierCount == 2);
+
+    auto commands{list.Commands()};
+    REQUIRE(commands.Next());
+    CHECK(commands.Op() == CommandOp::SetPipelineState);
+    CHECK(commands.As<NullCommands::Handle>().Value == 7);
+
+    REQUIRE(commands.Next());
+    CHECK(commands.Op() == CommandOp::ResourceBarrier);
+    CHECK(commands.As<NullCommands::Array>().Count == 2);
+    const auto* recorded{commands.Elements<NullCommands::Array, Barrier>()};
+    CHECK(recorded[1].Resource == 2);
+    CHECK(recorded[1].After == States::DepthWrite);
+
+    REQUIRE(commands.Next());
+    CHECK(commands.Op() == CommandOp::SetGraphicsRoot32BitConstant);
+    const auto& constant{commands.As<NullCommands::Root32BitConstant>()};
+    CHECK(constant.RootIndex == 3 && constant.Value == 42 && constant.Offset == 1);
+
+    REQUIRE(commands.Next());
+    CHECK(commands.Op() == CommandOp::DrawIndexedInstanced);
+    CHECK(commands.As<NullCommands::Draw>().InstanceCount == 2);
+    CHECK(!commands.Next());
+
+    list.Reset(allocator.get(), 0);
+    CHECK(list.StreamByteSize() == 0);
+    CHECK(list.Stats().CommandCount == 0);
+    list.Close();
+}
+
+TEST_CASE(NullQueueHoldsSignalsForItsLatency)
+{
+    NullDevice device{};
+    auto queue{device.CreateCommandQueue(QueueType::Direct)};
+    auto& nullQueue{static_cast<NullCommandQueue&>(*queue)};
+    auto fence{device.CreateFence(0)};
+
+    nullQueue.SetLatency(2);
+    queue->Signal(fence.get(), 1);
+    queue->Signal(fence.get(), 2);
+    CHECK(fence->GetCompletedValue() == 0);
+
+    queue->Signal(fence.get(), 3);
+    CHECK(fence->GetCompletedValue() == 1);
+
+    nullQueue.Advance();
+    CHECK(fence->GetCompletedValue() == 2);
+
+    nullQueue.Drain();
+    CHECK(fence->GetCompletedValue() == 3);
+    CHECK(nullQueue.PendingOperationCount() == 0);
+}
+
+TEST_CASE(NullQueueWaitBlocksUntilOtherQueueSignals)
+{
+    NullDevice device{};
+    auto copyQueue{device.CreateCommandQueue(QueueType::Copy)};
+    auto directQueue{device.CreateCommandQueue(QueueType::Direct)};
+    auto& nullCopyQueue{static_cast<NullCommandQueue&>(*copyQueue)};
+    auto copyFence{device.CreateFence(0)};
+    auto frameFence{device.CreateFence(0)};
+
+    nullCopyQueue.SetLatency(1);
+    copyQueue->Signal(copyFence.get(), 1);
+    directQueue->Wait(copyFence.get(), 1);
+    directQueue->Signal(frameFence.get(), 1);
+    CHECK(frameFence->GetCompletedValue() == 0);
+
+    nullCopyQueue.Advance();
+    CHECK(copyFence->GetCompletedValue() == 1);
+    CHECK(frameFence->GetCompletedValue() == 1);
+}
+
+TEST_CASE(NullQueueAppliesCopiesToMappedMemory)
+{
+    NullDevice device{};
+    auto queue{device.CreateCommandQueue(QueueType::Copy)};
+    auto allocator{device.CreateCommandAllocator(QueueType::Copy)};
+
+    auto upload{device.CreateBuffer(HeapType::Upload, 256, States::GenericRead)};
+    auto target{device.CreateBuffer(HeapType::Default, 256, States::CopyDest)};
+    CHECK(device.LiveResourceCount() == 2);
+    CHECK(device.LiveResourceBytes() == 512);
+    CHECK(device.GetGpuAddress(upload) != device.GetGpuAddress(target));
+
+    const char message[]{"null backend"};
+    std::memcpy(device.Map(upload), message, sizeof(message));
+
+    auto list{RecordCopy(device, *allocator, target, upload, sizeof(message))};
+    ICommandList* lists[]{list.get()};
+    queue->ExecuteCommandLists(1, lists);
+
+    CHECK(std::memcmp(device.Map(target), message, sizeof(message)) == 0);
+    CHECK(static_cast<NullCommandQueue&>(*queue).SubmittedListCount() == 1);
+
+    device.ReleaseResource(upload);
+    device.ReleaseResource(target);
+    CHECK(device.LiveResourceCount() == 0);
+    CHECK(device.LiveResourceBytes() == 0);
+}
+
+TEST_CASE(NullQueueRunsListsBehindAnUnmetWaitInOrder)
+{
+    NullDevice device{};
+    auto queue{device.CreateCommandQueue(QueueType::Copy)};
+    auto allocator{device.CreateCommandAllocator(QueueType::Copy)};
+    auto gate{device.CreateFence(0)};
+
+    auto first{device.CreateBuffer(HeapType::Upload, 4, States::GenericRead)};
+    auto second{device.CreateBuffer(HeapType::Upload, 4, States::GenericRead)};
+    auto target{device.CreateBuffer(HeapType::Readback, 4, States::CopyDest)};
+    std::memcpy(device.Map(first), "one", 4);
+    std::memcpy(device.Map(second), "two", 4);
+
+    queue->Wait(gate.get(), 1);
+    auto firstCopy{RecordCopy(device, *allocator, target, first, 4)};
+    auto secondCopy{RecordCopy(device, *allocator, target, second, 4)};
+    ICommandList* lists[]{firstCopy.get()};
+    queue->ExecuteCommandLists(1, lists);
+    lists[0] = secondCopy.get();
+    queue->ExecuteCommandLists(1, lists);
+    CHECK(static_cast<NullCommandQueue&>(*queue).SubmittedListCount() == 2);
+    CHECK(static_cast<const char*>(device.Map(target))[0] == '\0');
+
+    static_cast<NullFence&>(*gate).Complete(1);
+    device.Pump();
+    CHECK(std::memcmp(device.Map(target), "two", 4) == 0);
+    CHECK(static_cast<NullCommandQueue&>(*queue).PendingOperationCount() == 0);
+}
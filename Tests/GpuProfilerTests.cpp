@@ -0,0 +1,127 @@
+#include "../Shared/GfxNull.h"
+#include "../Shared/GpuProfiler.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace Gfx;
+
+namespace
+{
+// Every command the null queue executes takes one millisecond of GPU time.
+constexpr std::uint64_t TicksPerCommand{NullTimestampFrequency / 1000};
+
+bool IsNear(double value, double expected)
+{
+    return std::abs(value - expected) < 1.0e-9;
+}
+
+void Submit(ICommandQueue& queue, ICommandList& list)
+{
+    list.Close();
+    ICommandList* lists[]{&list};
+    queue.ExecuteCommandLists(1, lists);
+}
+} // namespace
+
+TEST_CASE(GpuProfilerMeasuresNestedScopes)
+{
+    NullDevice device{};
+    auto queue{device.CreateCommandQueue(QueueType::Direct)};
+    auto& nullQueue{static_cast<NullCommandQueue&>(*queue)};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    auto fence{device.CreateFence(0)};
+    nullQueue.SetTimestampStep(TicksPerCommand);
+
+    GpuProfiler profiler{device, *queue, 2};
+    profiler.BeginFrame();
+
+    // Timestamps land after the command that writes them: Outer begins at 1 ms, Inner runs from
+    // 3 ms to 6 ms inside it, and Outer ends at 8 ms.
+    auto first{device.CreateCommandList(QueueType::Direct, allocator.get())};
+    first->Reset(allocator.get(), 0);
+    auto outer{profiler.BeginScope(*first, "Outer")};
+    first->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    auto inner{profiler.BeginScope(*first, "Inner")};
+    first->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    first->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    profiler.EndScope(*first, inner);
+    first->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    profiler.EndScope(*first, outer);
+    auto unended{profiler.BeginScope(*first, "Unended")};
+    CHECK(unended != GpuProfiler::NoScope);
+    Submit(*queue, *first);
+
+    // Idle time between the lists counts towards the frame total, which spans every scope.
+    nullQueue.AdvanceTimestamp(10 * TicksPerCommand);
+    auto second{device.CreateCommandList(QueueType::Direct, allocator.get())};
+    second->Reset(allocator.get(), 0);
+    {
+        GpuScope scope{profiler, *second, "Second"};
+        second->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    }
+    profiler.EndFrame(*second, 1);
+    Submit(*queue, *second);
+    queue->Signal(fence.get(), 1);
+
+    profiler.Collect(fence->GetCompletedValue());
+    CHECK(profiler.Stats().TimedFrames == 1);
+
+    const auto& timings{profiler.Latest()};
+    REQUIRE(timings.Scopes.size() == 3);
+    CHECK(std::strcmp(timings.Scopes[0].Name, "Outer") == 0);
+    CHECK(IsNear(timings.Scopes[0].BeginMs, 0.0));
+    CHECK(IsNear(timings.Scopes[0].DurationMs, 7.0));
+    CHECK(std::strcmp(timings.Scopes[1].Name, "Inner") == 0);
+    CHECK(IsNear(timings.Scopes[1].BeginMs, 2.0));
+    CHECK(IsNear(timings.Scopes[1].DurationMs, 3.0));
+    CHECK(std::strcmp(timings.Scopes[2].Name, "Second") == 0);
+    CHECK(IsNear(timings.Scopes[2].BeginMs, 19.0));
+    CHECK(IsNear(timings.Scopes[2].DurationMs, 2.0));
+
+    // Nested scopes are not added up: the total runs from Outer's begin to Second's end.
+    CHECK(IsNear(timings.TotalMs, 21.0));
+}
+
+TEST_CASE(GpuProfilerSkipsFramesWhoseSlotIsPending)
+{
+    NullDevice device{};
+    auto queue{device.CreateCommandQueue(QueueType::Direct)};
+    auto& nullQueue{static_cast<NullCommandQueue&>(*queue)};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    auto fence{device.CreateFence(0)};
+    nullQueue.SetTimestampStep(TicksPerCommand);
+    nullQueue.SetLatency(1);
+
+    GpuProfiler profiler{device, *queue, 1, 1};
+    auto list{device.CreateCommandList(QueueType::Direct, allocator.get())};
+    for (std::uint64_t frame{1}; frame <= 2; ++frame)
+    {
+        profiler.BeginFrame();
+        list->Reset(allocator.get(), 0);
+        auto scope{profiler.BeginScope(*list, "Frame")};
+        // One scope per frame; the second is dropped.
+        CHECK(profiler.BeginScope(*list, "Dropped") == GpuProfiler::NoScope);
+        list->DrawIndexedInstanced(3, 1, 0, 0, 0);
+        profiler.EndScope(*list, scope);
+        profiler.EndFrame(*list, frame);
+        Submit(*queue, *list);
+        queue->Signal(fence.get(), frame);
+        profiler.Collect(fence->GetCompletedValue());
+    }
+
+    // The only slot was still waiting for frame 1 when frame 2 began, so frame 2 went untimed.
+    // Frame 1 completed behind frame 2's signal and was collected then.
+    auto stats{profiler.Stats()};
+    CHECK(stats.SkippedFrames == 1);
+    CHECK(stats.DroppedScopes == 1);
+    CHECK(stats.TimedFrames == 1);
+    REQUIRE(profiler.Latest().Scopes.size() == 1);
+    CHECK(IsNear(profiler.Latest().Scopes[0].DurationMs, 2.0));
+
+    // Frame 2 was never timed, so there is nothing more to collect.
+    nullQueue.Drain();
+    profiler.Collect(fence->GetCompletedValue());
+    CHECK(profiler.Stats().TimedFrames == 1);
+}
@@ -0,0 +1,46 @@
+#include "../Shared/Hash.h"
+#include "TestHarness.h"
+
+using namespace Gfx;
+
+TEST_CASE(HashIsStableAcrossBuilds)
+{
+    // Keys name files on disk, so a change here silently invalidates every cache: bump the cache
+    // key versions along with these values.
+    CHECK(HashBytes("", 0) == 0xf490368aba8bfeacULL);
+    CHECK(HashBytes("The quick brown fox", 19) == 0x30415b6106bc1e09ULL);
+}
+
+TEST_CASE(HasherSeparatesFieldsAndCanonicalizesZero)
+{
+    auto hashStrings{[](const char* first, const char* second) {
+        Hasher hasher{};
+        hasher.AddString(first);
+        hasher.AddString(second);
+        return hasher.Finish();
+    }};
+    CHECK(hashStrings("ab", "c") != hashStrings("a", "bc"));
+    CHECK(hashStrings(nullptr, "x") == hashStrings("", "x"));
+
+    auto hashFloat{[](float value) {
+        Hasher hasher{};
+        hasher.Add(value);
+        return hasher.Finish();
+    }};
+    CHECK(hashFloat(0.0f) == hashFloat(-0.0f));
+    CHECK(hashFloat(1.0f) != hashFloat(-1.0f));
+
+    Hasher seeded{1};
+    Hasher unseeded{};
+    CHECK(seeded.Finish() != unseeded.Finish());
+
+    // Trailing zero bytes still change the hash.
+    const std::uint8_t bytes[9]{};
+    CHECK(HashBytes(bytes, 8) != HashBytes(bytes, 9));
+}
+
+TEST_CASE(HashNameIsSixteenHexDigits)
+{
+    CHECK(HashName(0) == L"0000000000000000");
+    CHECK(HashName(0x0123456789abcdefULL) == L"0123456789abcdef");
+}
@@ -0,0 +1,211 @@
+#include "../Shared/JobSystem.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace Jobs;
+
+namespace
+{
+// Sums 1 for each node of a binary tree of the given depth, each node a job that waits on its
+// children from inside the job.
+void CountTree(JobSystem& system, int depth, std::atomic<int>& nodes)
+{
+    nodes.fetch_add(1, std::memory_order_relaxed);
+    if (depth == 0)
+    {
+        return;
+    }
+
+    JobCounter children{};
+    system.Run([&system, depth, &nodes]() { CountTree(system, depth - 1, nodes); }, &children);
+    system.Run([&system, depth, &nodes]() { CountTree(system, depth - 1, nodes); }, &children);
+    system.Wait(children);
+}
+} // namespace
+
+TEST_CASE(JobSystemRunsEveryJobOnceUnderStealContention)
+{
+    // More jobs than a queue holds, half of them spawned from workers, so the creating thread's
+    // queue, the workers' queues and the injection queue are all stolen from at once.
+    constexpr int ParentCount{WorkStealingQueue::Capacity + 1000};
+    constexpr int ChildrenPerParent{4};
+
+    JobSystem system{7};
+    for (int round{0}; round < 4; ++round)
+    {
+        std::vector<std::atomic<int>> runs(ParentCount * (ChildrenPerParent + 1));
+        JobCounter counter{};
+        for (int parent{0}; parent < ParentCount; ++parent)
+        {
+            system.Run(
+                [&system, &runs, &counter, parent]() {
+                    runs[parent].fetch_add(1, std::memory_order_relaxed);
+                    for (int child{0}; child < ChildrenPerParent; ++child)
+                    {
+                        auto index{ParentCount + parent * ChildrenPerParent + child};
+                        system.Run([&runs, index]() { runs[index].fetch_add(1, std::memory_order_relaxed); }, &counter);
+                    }
+                },
+                &counter);
+        }
+        system.Wait(counter);
+
+        int wrongCount{0};
+        for (const auto& run : runs)
+        {
+            wrongCount += run.load() != 1 ? 1 : 0;
+        }
+        CHECK(wrongCount == 0);
+        CHECK(counter.IsDone());
+    }
+}
+
+TEST_CASE(JobSystemNestedWaitsDoNotDeadlock)
+{
+    // Far more waiting jobs than threads: every waiter has to run other jobs while it waits.
+    constexpr int Depth{12};
+    for (unsigned workerCount : {1U, 3U})
+    {
+        JobSystem system{workerCount};
+        std::atomic<int> nodes{0};
+
+        JobCounter root{};
+        system.Run([&system, &nodes]() { CountTree(system, Depth, nodes); }, &root);
+        system.Wait(root);
+        CHECK(nodes.load() == (1 << (Depth + 1)) - 1);
+    }
+}
+
+TEST_CASE(JobSystemWaitRethrowsFirstException)
+{
+    JobSystem system{2};
+    JobCounter counter{};
+    std::atomic<int> finished{0};
+    for (int i{0}; i < 64; ++i)
+    {
+        system.Run(
+            [&finished, i]() {
+                if (i % 16 == 0)
+                {
+                    throw std::runtime_error{"job failed"};
+                }
+                finished.fetch_add(1);
+            },
+            &counter);
+    }
+
+    bool threw{false};
+    try
+    {
+        system.Wait(counter);
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(finished.load() == 60);
+    CHECK(counter.IsDone());
+}
+
+TEST_CASE(JobSystemRunAfterStartsContinuationsOnce)
+{
+    JobSystem system{3};
+    JobCounter first{};
+    JobCounter second{};
+    std::atomic<int> firstDone{0};
+    std::atomic<int> sawFirstUnfinished{0};
+
+    for (int i{0}; i < 100; ++i)
+    {
+        system.Run([&firstDone]() { firstDone.fetch_add(1); }, &first);
+    }
+    for (int i{0}; i < 10; ++i)
+    {
+        system.RunAfter(
+            first,
+            [&firstDone, &sawFirstUnfinished]() {
+                if (firstDone.load() != 100)
+                {
+                    sawFirstUnfinished.fetch_add(1);
+                }
+            },
+            &second);
+    }
+    system.Wait(second);
+
+    CHECK(first.IsDone());
+    CHECK(sawFirstUnfinished.load() == 0);
+
+    // A continuation on a finished counter runs right away.
+    std::atomic<bool> ran{false};
+    system.RunAfter(first, [&ran]() { ran.store(true); }, &second);
+    system.Wait(second);
+    CHECK(ran.load());
+}
+
+TEST_CASE(JobSystemParallelForCoversRangeOnce)
+{
+    JobSystem system{3};
+    for (std::size_t count : {0U, 1U, 63U, 64U, 65U, 10000U})
+    {
+        std::vector<std::atomic<int>> visits(count);
+        system.ParallelFor(count, 64, [&visits](std::size_t begin, std::size_t end) {
+            for (auto i{begin}; i < end; ++i)
+            {
+                visits[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        int wrongCount{0};
+        for (const auto& visit : visits)
+        {
+            wrongCount += visit.load() != 1 ? 1 : 0;
+        }
+        CHECK(wrongCount == 0);
+    }
+}
+
+TEST_CASE(JobSystemShutdownDropsQueuedJobs)
+{
+    // Every job holds a reference to token; if dropped jobs leaked or ran after shutdown the count
+    // would not come back to one.
+    auto token{std::make_shared<int>(0)};
+    std::atomic<int> ran{0};
+    constexpr int QueuedCount{1000};
+    {
+        JobSystem system{2};
+        std::atomic<bool> release{false};
+        std::atomic<int> blocked{0};
+
+        // Hold both workers so the jobs behind them stay queued.
+        for (int i{0}; i < 2; ++i)
+        {
+            system.Run([&release, &blocked]() {
+                blocked.fetch_add(1);
+                while (!release.load())
+                {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        while (blocked.load() != 2)
+        {
+            std::this_thread::yield();
+        }
+
+        for (int i{0}; i < QueuedCount; ++i)
+        {
+            system.Run([token, &ran]() { ran.fetch_add(1); });
+        }
+        CHECK(token.use_count() == QueuedCount + 1);
+        release.store(true);
+    }
+
+    CHECK(ran.load() <= QueuedCount);
+    CHECK(token.use_count() == 1);
+}
@@ -0,0 +1,189 @@
+#include "../Shared/GfxNull.h"
+#include "../Shared/PipelineCache.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace Gfx;
+
+namespace
+{
+const std::uint8_t VertexShader[]{0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4};
+const std::uint8_t PixelShader[]{0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8};
+
+GraphicsPipelineDesc OpaqueDesc(const InputElementDesc* elements, std::uint32_t elementCount)
+{
+    GraphicsPipelineDesc desc{};
+    desc.RootSignatureHash = 0x1234;
+    desc.VS = ShaderBytecode{VertexShader, sizeof(VertexShader)};
+    desc.PS = ShaderBytecode{PixelShader, sizeof(PixelShader)};
+    desc.InputElements = elements;
+    desc.InputElementCount = elementCount;
+    desc.PrimitiveTopologyType = 3;
+    desc.NumRenderTargets = 1;
+    desc.RTVFormats[0] = 28;
+    desc.DSVFormat = 45;
+    return desc;
+}
+
+const InputElementDesc Elements[]{{"POSITION", 0, 6, 0, 0, 0, 0}, {"NORMAL", 0, 6, 0, 12, 0, 0}};
+
+// A pipeline library whose compiles fail, for error propagation.
+class FailingLibrary : public NullPipelineLibrary
+{
+public:
+    PipelineHandle Create(std::uint64_t /*key*/, const GraphicsPipelineDesc& /*desc*/) override
+    {
+        throw std::runtime_error{"compile failed"};
+    }
+};
+
+std::wstring TemporaryFile(const wchar_t* name)
+{
+    return (std::filesystem::temp_directory_path() / name).wstring();
+}
+} // namespace
+
+TEST_CASE(PipelineKeyIgnoresStateTheRuntimeIgnores)
+{
+    auto base{OpaqueDesc(Elements, 2)};
+    auto key{HashGraphicsPipelineDesc(base)};
+
+    // Same contents through different pointers.
+    const std::uint8_t vertexShaderCopy[sizeof(VertexShader)]{0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4};
+    std::string position{"POSITION"};
+    const InputElementDesc elementsCopy[]{{position.c_str(), 0, 6, 0, 0, 0, 0}, {"NORMAL", 0, 6, 0, 12, 0, 0}};
+    auto copy{OpaqueDesc(elementsCopy, 2)};
+    copy.VS.Data = vertexShaderCopy;
+    CHECK(HashGraphicsPipelineDesc(copy) == key);
+
+    // Fields the runtime ignores.
+    auto ignored{base};
+    ignored.BlendState.RenderTarget[0].SrcBlend = 5;
+    ignored.BlendState.RenderTarget[3].BlendEnable = 1;
+    ignored.DepthStencilState.FrontFace.StencilFunc = 1;
+    ignored.RTVFormats[5] = 87;
+    ignored.SampleMask = 0xfffffff1;
+    CHECK(HashGraphicsPipelineDesc(ignored) == key);
+
+    // Fields that change the pipeline.
+    auto culled{base};
+    culled.RasterizerState.CullMode = 1;
+    CHECK(HashGraphicsPipelineDesc(culled) != key);
+
+    auto blended{base};
+    blended.BlendState.RenderTarget[0].BlendEnable = 1;
+    CHECK(HashGraphicsPipelineDesc(blended) != key);
+
+    const InputElementDesc swapped[]{Elements[1], Elements[0]};
+    CHECK(HashGraphicsPipelineDesc(OpaqueDesc(swapped, 2)) != key);
+}
+
+TEST_CASE(PipelineCacheDeduplicatesAndReloadsFromLibrary)
+{
+    auto opaque{OpaqueDesc(Elements, 2)};
+    auto wireframe{opaque};
+    wireframe.RasterizerState.FillMode = 2;
+
+    std::vector<std::uint8_t> blob{};
+    {
+        NullPipelineLibrary library{};
+        PipelineCache cache{library};
+        auto first{cache.GetOrCreate(opaque)};
+        CHECK(cache.GetOrCreate(opaque) == first);
+        auto second{cache.GetOrCreate(wireframe)};
+        CHECK(second != first);
+        CHECK(cache.IsReady(first) && cache.Get(first) != NullPipeline);
+
+        auto stats{cache.Stats()};
+        CHECK(stats.Requests == 3);
+        CHECK(stats.Deduplicated == 1);
+        CHECK(stats.Compiles == 2);
+        CHECK(stats.LibraryLoads == 0);
+        CHECK(library.IsDirty());
+        blob = library.Serialize();
+    }
+
+    // The next run finds both in the library and compiles nothing.
+    NullPipelineLibrary library{blob};
+    PipelineCache cache{library};
+    cache.GetOrCreate(opaque);
+    cache.GetOrCreate(wireframe);
+    CHECK(cache.Stats().LibraryLoads == 2);
+    CHECK(cache.Stats().Compiles == 0);
+    CHECK(!library.IsDirty());
+}
+
+TEST_CASE(PipelineCacheResolvesToFallbackWhilePending)
+{
+    Jobs::JobSystem jobs{2};
+    NullPipelineLibrary library{};
+    PipelineCache cache{library, &jobs};
+
+    auto opaque{OpaqueDesc(Elements, 2)};
+    auto fallback{cache.GetOrCreate(opaque)};
+
+    auto wireframe{opaque};
+    wireframe.RasterizerState.FillMode = 2;
+    auto id{cache.GetOrCreateAsync(wireframe, fallback)};
+    CHECK(cache.GetOrCreateAsync(wireframe, fallback) == id);
+
+    auto resolved{cache.Resolve(id)};
+    CHECK(resolved == cache.Get(fallback) || (cache.IsReady(id) && resolved == cache.Get(id)));
+
+    cache.Wait(id);
+    CHECK(cache.Resolve(id) == cache.Get(id));
+    CHECK(cache.Resolve(id) != cache.Get(fallback));
+    CHECK(cache.Stats().Pending == 0);
+}
+
+TEST_CASE(PipelineCacheRethrowsCreationErrors)
+{
+    Jobs::JobSystem jobs{1};
+    FailingLibrary library{};
+    PipelineCache cache{library, &jobs};
+
+    auto id{cache.GetOrCreateAsync(OpaqueDesc(Elements, 2))};
+    bool threw{false};
+    try
+    {
+        cache.Wait(id);
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(cache.State(id) == PipelineState::Failed);
+    CHECK(cache.Resolve(id) == NullPipeline);
+    CHECK(cache.Stats().Failed == 1);
+}
+
+TEST_CASE(PipelineLibraryFileRejectsDamagedFiles)
+{
+    auto filename{TemporaryFile(L"PipelineCacheTests.pipelines")};
+    std::vector<std::uint8_t> blob{1, 2, 3, 4, 5, 6, 7, 8, 9};
+    REQUIRE(WritePipelineLibraryFile(filename, blob));
+    CHECK(ReadPipelineLibraryFile(filename) == blob);
+
+    // Flip one payload byte: the hash no longer matches.
+    {
+        std::fstream file(std::filesystem::path{filename}, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put(static_cast<char>(0x7f));
+    }
+    CHECK(ReadPipelineLibraryFile(filename).empty());
+
+    // Truncated.
+    REQUIRE(WritePipelineLibraryFile(filename, blob));
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 1);
+    CHECK(ReadPipelineLibraryFile(filename).empty());
+
+    std::filesystem::remove(filename);
+    CHECK(ReadPipelineLibraryFile(filename).empty());
+}
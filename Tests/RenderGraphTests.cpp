@@ -0,0 +1,223 @@
+#include "../Shared/GfxNull.h"
+#include "../Shared/RenderGraph.h"
+#include "TestHarness.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr ResourceHandle BackBuffer{100};
+constexpr std::uint64_t Block{65536};
+
+bool IsBarrier(const RenderGraphBarrier& barrier,
+               RenderGraphResource resource,
+               ResourceStates before,
+               ResourceStates after,
+               BarrierFlags flags)
+{
+    return barrier.Resource == resource && barrier.Before == before && barrier.After == after && barrier.Flags == flags;
+}
+
+// X is written as a render target, then read by a pass two passes later, with an unrelated pass in
+// between.  Both readers are kept alive with side effects.
+void BuildSplitGraph(RenderGraph& graph, std::vector<const char*>* executed = nullptr)
+{
+    auto record{[executed](const char* name) {
+        return [executed, name](ICommandList&) {
+            if (executed != nullptr)
+            {
+                executed->push_back(name);
+            }
+        };
+    }};
+
+    auto x{graph.Import("X", BackBuffer, States::Common, States::Common)};
+    graph.AddPass("Write", [x](RenderGraph::PassBuilder& pass) { pass.Write(x, States::RenderTarget); }, record("Write"));
+    graph.AddPass("Unrelated", [](RenderGraph::PassBuilder& pass) { pass.HasSideEffects(); }, record("Unrelated"));
+    graph.AddPass(
+        "Read",
+        [x](RenderGraph::PassBuilder& pass) {
+            pass.Read(x, States::PixelShaderResource);
+            pass.HasSideEffects();
+        },
+        record("Read"));
+}
+} // namespace
+
+TEST_CASE(RenderGraphCullsPassesNothingConsumes)
+{
+    RenderGraph graph{};
+    auto backBuffer{graph.Import("BackBuffer", BackBuffer, States::Present, States::Present)};
+    auto unused{graph.CreateTransient("Unused", TransientDesc{Block})};
+    auto used{graph.CreateTransient("Used", TransientDesc{Block})};
+
+    auto orphan{graph.AddPass("Orphan", [unused](RenderGraph::PassBuilder& pass) {
+        pass.Write(unused, States::RenderTarget);
+    })};
+    auto producer{graph.AddPass("Producer", [used](RenderGraph::PassBuilder& pass) {
+        pass.Write(used, States::RenderTarget);
+    })};
+    auto consumer{graph.AddPass("Consumer", [used, backBuffer](RenderGraph::PassBuilder& pass) {
+        pass.Read(used, States::PixelShaderResource);
+        pass.Write(backBuffer, States::RenderTarget);
+    })};
+    auto readOnly{graph.AddPass("ReadOnly", [backBuffer](RenderGraph::PassBuilder& pass) {
+        pass.Read(backBuffer, States::PixelShaderResource);
+    })};
+    auto debug{graph.AddPass("Debug", [](RenderGraph::PassBuilder& pass) { pass.HasSideEffects(); })};
+    graph.Compile();
+
+    CHECK(graph.IsCulled(orphan));
+    CHECK(!graph.IsCulled(producer));
+    CHECK(!graph.IsCulled(consumer));
+    CHECK(graph.IsCulled(readOnly));
+    CHECK(!graph.IsCulled(debug));
+
+    REQUIRE(graph.CompiledPassCount() == 3);
+    CHECK(graph.CompiledPass(0) == producer);
+    CHECK(graph.CompiledPass(1) == consumer);
+    CHECK(graph.CompiledPass(2) == debug);
+
+    CHECK(graph.Placement(unused).FirstPass == InvalidRenderGraphIndex);
+    CHECK(graph.UnaliasedTransientBytes() == Block);
+}
+
+TEST_CASE(RenderGraphMergesConsecutiveReads)
+{
+    RenderGraph graph{};
+    auto x{graph.Import("X", BackBuffer, States::Common, States::Common)};
+    graph.AddPass("Write", [x](RenderGraph::PassBuilder& pass) { pass.Write(x, States::RenderTarget); });
+    graph.AddPass("ReadPixel", [x](RenderGraph::PassBuilder& pass) {
+        pass.Read(x, States::PixelShaderResource);
+        pass.HasSideEffects();
+    });
+    graph.AddPass("ReadNonPixel", [x](RenderGraph::PassBuilder& pass) {
+        pass.Read(x, States::NonPixelShaderResource);
+        pass.HasSideEffects();
+    });
+    graph.Compile();
+
+    constexpr ResourceStates AllReads{States::PixelShaderResource | States::NonPixelShaderResource};
+    std::size_t count{0};
+    const auto* barriers{graph.PassBarriers(0, count)};
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], x, States::Common, States::RenderTarget, BarrierFlags::None));
+
+    barriers = graph.PassBarriers(1, count);
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], x, States::RenderTarget, AllReads, BarrierFlags::None));
+
+    CHECK(graph.PassBarriers(2, count) != nullptr && count == 0);
+
+    barriers = graph.FinalBarriers(count);
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], x, AllReads, States::Common, BarrierFlags::None));
+}
+
+TEST_CASE(RenderGraphSplitsTransitionsAcrossIdlePasses)
+{
+    RenderGraph graph{};
+    BuildSplitGraph(graph);
+    graph.Compile();
+
+    std::size_t count{0};
+    const auto* barriers{graph.PassBarriers(0, count)};
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], 0, States::Common, States::RenderTarget, BarrierFlags::None));
+
+    barriers = graph.PassBarriers(1, count);
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], 0, States::RenderTarget, States::PixelShaderResource, BarrierFlags::BeginOnly));
+
+    barriers = graph.PassBarriers(2, count);
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], 0, States::RenderTarget, States::PixelShaderResource, BarrierFlags::EndOnly));
+
+    barriers = graph.FinalBarriers(count);
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], 0, States::PixelShaderResource, States::Common, BarrierFlags::None));
+}
+
+TEST_CASE(RenderGraphAliasesTransientsWithDisjointLifetimes)
+{
+    // A -> B -> C -> back buffer: A and C are never alive together, B overlaps both.
+    RenderGraph graph{};
+    auto backBuffer{graph.Import("BackBuffer", BackBuffer, States::Present, States::Present)};
+    auto a{graph.CreateTransient("A", TransientDesc{Block})};
+    auto b{graph.CreateTransient("B", TransientDesc{Block})};
+    auto c{graph.CreateTransient("C", TransientDesc{Block})};
+
+    graph.AddPass("MakeA", [a](RenderGraph::PassBuilder& pass) { pass.Write(a, States::RenderTarget); });
+    graph.AddPass("MakeB", [a, b](RenderGraph::PassBuilder& pass) {
+        pass.Read(a, States::PixelShaderResource);
+        pass.Write(b, States::UnorderedAccess);
+    });
+    graph.AddPass("MakeC", [b, c](RenderGraph::PassBuilder& pass) {
+        pass.Read(b, States::NonPixelShaderResource);
+        pass.Write(c, States::RenderTarget);
+    });
+    graph.AddPass("Present", [c, backBuffer](RenderGraph::PassBuilder& pass) {
+        pass.Read(c, States::PixelShaderResource);
+        pass.Write(backBuffer, States::RenderTarget);
+    });
+    graph.Compile();
+
+    const auto& placementA{graph.Placement(a)};
+    const auto& placementB{graph.Placement(b)};
+    const auto& placementC{graph.Placement(c)};
+    CHECK(placementA.FirstPass == 0 && placementA.LastPass == 1);
+    CHECK(placementB.FirstPass == 1 && placementB.LastPass == 2);
+    CHECK(placementC.FirstPass == 2 && placementC.LastPass == 3);
+
+    CHECK(placementA.Offset == placementC.Offset);
+    CHECK(placementB.Offset != placementA.Offset);
+    CHECK(graph.TransientHeapSize() == 2 * Block);
+    CHECK(graph.UnaliasedTransientBytes() == 3 * Block);
+
+    // Transients are created in the state of their first use instead of transitioning into it; the
+    // only barrier before the first pass starts the back buffer's transition for the last one.
+    CHECK(placementA.InitialState == States::RenderTarget);
+    CHECK(placementB.InitialState == States::UnorderedAccess);
+    std::size_t count{0};
+    const auto* barriers{graph.PassBarriers(0, count)};
+    REQUIRE(count == 1);
+    CHECK(IsBarrier(barriers[0], backBuffer, States::Present, States::RenderTarget, BarrierFlags::BeginOnly));
+}
+
+TEST_CASE(RenderGraphExecutesSurvivingPassesWithTheirBarriers)
+{
+    RenderGraph graph{};
+    std::vector<const char*> executed{};
+    for (int frame{0}; frame < 2; ++frame)
+    {
+        executed.clear();
+        graph.Reset();
+        BuildSplitGraph(graph, &executed);
+        graph.Compile();
+
+        NullDevice device{};
+        auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+        NullCommandList list{QueueType::Direct};
+        list.Reset(allocator.get(), 0);
+        graph.Execute(list);
+        list.Close();
+
+        REQUIRE(executed.size() == 3);
+        CHECK(std::strcmp(executed[0], "Write") == 0);
+        CHECK(std::strcmp(executed[2], "Read") == 0);
+
+        // One batch before each pass with a transition, one at the end: four barriers in total.
+        CHECK(list.Stats().BarrierCalls == 4);
+        CHECK(list.Stats().BarrierCount == 4);
+
+        auto commands{list.Commands()};
+        REQUIRE(commands.Next());
+        REQUIRE(commands.Op() == CommandOp::ResourceBarrier);
+        const auto* first{commands.Elements<NullCommands::Array, Barrier>()};
+        CHECK(first[0].Resource == BackBuffer);
+        CHECK(first[0].After == States::RenderTarget);
+    }
+}
@@ -0,0 +1,243 @@
+#include "../Shared/GfxNull.h"
+#include "../Shared/ResourceStateTracker.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+using namespace Gfx;
+
+namespace
+{
+constexpr ResourceHandle Texture{1};
+constexpr ResourceHandle VertexBuffer{2};
+constexpr ResourceHandle IndexBuffer{3};
+
+constexpr ResourceStates ShaderReads{States::PixelShaderResource | States::NonPixelShaderResource};
+
+bool IsBarrier(const Barrier& barrier,
+               ResourceHandle resource,
+               std::uint32_t subresource,
+               ResourceStates before,
+               ResourceStates after)
+{
+    return barrier.Resource == resource && barrier.Subresource == subresource && barrier.Before == before
+        && barrier.After == after && barrier.Flags == BarrierFlags::None;
+}
+
+// The barriers the tracker recorded into list, in order.
+std::vector<Barrier> RecordedBarriers(const NullCommandList& list)
+{
+    std::vector<Barrier> barriers{};
+    auto commands{list.Commands()};
+    while (commands.Next())
+    {
+        if (commands.Op() == CommandOp::ResourceBarrier)
+        {
+            const auto* recorded{commands.Elements<NullCommands::Array, Barrier>()};
+            barriers.insert(barriers.end(), recorded, recorded + commands.As<NullCommands::Array>().Count);
+        }
+    }
+    return barriers;
+}
+
+// Fixups come out in no particular resource order.
+const Barrier* FindBarrier(const std::vector<Barrier>& barriers, ResourceHandle resource)
+{
+    for (const auto& barrier : barriers)
+    {
+        if (barrier.Resource == resource)
+        {
+            return &barrier;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+TEST_CASE(ResourceStateTrackerDropsRedundantTransitions)
+{
+    NullDevice device{};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    NullCommandList list{QueueType::Direct};
+    list.Reset(allocator.get(), 0);
+
+    ResourceStateRegistry registry{};
+    registry.Register(Texture, States::Common, 1, false);
+    ResourceStateTracker tracker{registry};
+
+    // The first use only records the entry state; the registry settles it at submission.
+    tracker.Transition(Texture, States::RenderTarget);
+    tracker.Transition(Texture, States::RenderTarget);
+    CHECK(tracker.PendingBarrierCount() == 0);
+
+    tracker.Transition(Texture, States::PixelShaderResource);
+    tracker.Transition(Texture, States::PixelShaderResource);
+    CHECK(tracker.PendingBarrierCount() == 1);
+
+    tracker.FlushBarriers(list);
+    tracker.FlushBarriers(list);
+    CHECK(tracker.PendingBarrierCount() == 0);
+
+    auto barriers{RecordedBarriers(list)};
+    REQUIRE(barriers.size() == 1);
+    CHECK(IsBarrier(barriers[0], Texture, AllSubresources, States::RenderTarget, States::PixelShaderResource));
+
+    const auto& stats{tracker.Stats()};
+    CHECK(stats.TransitionRequests == 4);
+    CHECK(stats.DroppedTransitions == 3);
+    CHECK(stats.FoldedBarriers == 0);
+    CHECK(stats.FlushCalls == 1);
+    CHECK(stats.FlushedBarriers == 1);
+    list.Close();
+}
+
+TEST_CASE(ResourceStateTrackerMergesReadStates)
+{
+    NullDevice device{};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    NullCommandList list{QueueType::Direct};
+    list.Reset(allocator.get(), 0);
+
+    ResourceStateRegistry registry{};
+    registry.Register(Texture, States::Common, 4, false);
+    ResourceStateTracker tracker{registry};
+
+    // Reads before any barrier widen that subresource's entry state instead of queueing one.
+    tracker.Transition(Texture, States::PixelShaderResource, 1);
+    tracker.Transition(Texture, States::NonPixelShaderResource, 1);
+    tracker.Transition(Texture, States::PixelShaderResource, 1);
+    CHECK(tracker.PendingBarrierCount() == 0);
+    CHECK(tracker.Stats().DroppedTransitions == 3);
+
+    // Past a barrier, moving to another read state goes to the union of both.
+    tracker.Transition(Texture, States::RenderTarget, 2);
+    tracker.Transition(Texture, States::PixelShaderResource, 2);
+    tracker.FlushBarriers(list);
+    tracker.Transition(Texture, States::NonPixelShaderResource, 2);
+    tracker.Transition(Texture, States::PixelShaderResource, 2);
+    tracker.FlushBarriers(list);
+
+    auto barriers{RecordedBarriers(list)};
+    REQUIRE(barriers.size() == 2);
+    CHECK(IsBarrier(barriers[0], Texture, 2, States::RenderTarget, States::PixelShaderResource));
+    CHECK(IsBarrier(barriers[1], Texture, 2, States::PixelShaderResource, ShaderReads));
+
+    // Only the subresources the list used get a fixup, to their own entry state.
+    std::vector<Barrier> fixups{};
+    registry.Submit(tracker, fixups);
+    REQUIRE(fixups.size() == 2);
+    CHECK(IsBarrier(fixups[0], Texture, 1, States::Common, ShaderReads));
+    CHECK(IsBarrier(fixups[1], Texture, 2, States::Common, States::RenderTarget));
+    CHECK(registry.State(Texture, 0) == States::Common);
+    CHECK(registry.State(Texture, 1) == ShaderReads);
+    CHECK(registry.State(Texture, 2) == ShaderReads);
+    list.Close();
+}
+
+TEST_CASE(ResourceStateTrackerFoldsQueuedBarriers)
+{
+    ResourceStateRegistry registry{};
+    registry.Register(Texture, States::Common, 1, false);
+    ResourceStateTracker tracker{registry};
+
+    tracker.Transition(Texture, States::RenderTarget);
+    tracker.Transition(Texture, States::UnorderedAccess);
+    REQUIRE(tracker.PendingBarrierCount() == 1);
+
+    // Nothing used the resource in between, so the queued barrier is retargeted rather than
+    // followed by a second one, and dropped once a request undoes it.
+    tracker.Transition(Texture, States::CopyDest);
+    CHECK(tracker.PendingBarrierCount() == 1);
+    tracker.Transition(Texture, States::RenderTarget);
+    CHECK(tracker.PendingBarrierCount() == 0);
+    CHECK(tracker.Stats().FoldedBarriers == 2);
+
+    // The list ends where it started, so it leaves the registry in its entry state.
+    std::vector<Barrier> fixups{};
+    registry.Submit(tracker, fixups);
+    REQUIRE(fixups.size() == 1);
+    CHECK(IsBarrier(fixups[0], Texture, AllSubresources, States::Common, States::RenderTarget));
+    CHECK(registry.State(Texture) == States::RenderTarget);
+}
+
+TEST_CASE(ResourceStateTrackerCollapsesUniformSubresourceBarriers)
+{
+    NullDevice device{};
+    auto allocator{device.CreateCommandAllocator(QueueType::Direct)};
+    NullCommandList list{QueueType::Direct};
+    list.Reset(allocator.get(), 0);
+
+    ResourceStateRegistry registry{};
+    registry.Register(Texture, States::Common, 4, false);
+    ResourceStateTracker tracker{registry};
+
+    tracker.Transition(Texture, States::RenderTarget);
+    tracker.Transition(Texture, States::PixelShaderResource);
+    tracker.FlushBarriers(list);
+
+    // Subresources in different states need a barrier each, and only where they differ.
+    tracker.Transition(Texture, States::CopyDest, 3);
+    tracker.FlushBarriers(list);
+    tracker.Transition(Texture, States::PixelShaderResource);
+    tracker.FlushBarriers(list);
+
+    auto barriers{RecordedBarriers(list)};
+    REQUIRE(barriers.size() == 3);
+    CHECK(IsBarrier(barriers[0], Texture, AllSubresources, States::RenderTarget, States::PixelShaderResource));
+    CHECK(IsBarrier(barriers[1], Texture, 3, States::PixelShaderResource, States::CopyDest));
+    CHECK(IsBarrier(barriers[2], Texture, 3, States::CopyDest, States::PixelShaderResource));
+
+    // Back in step, the whole resource moves with one barrier again.
+    tracker.Transition(Texture, States::RenderTarget);
+    REQUIRE(tracker.PendingBarrierCount() == 1);
+    tracker.FlushBarriers(list);
+    barriers = RecordedBarriers(list);
+    REQUIRE(barriers.size() == 4);
+    CHECK(IsBarrier(barriers[3], Texture, AllSubresources, States::PixelShaderResource, States::RenderTarget));
+    list.Close();
+}
+
+TEST_CASE(ResourceStateRegistryFixesUpEntryStatesAtSubmit)
+{
+    ResourceStateRegistry registry{};
+    registry.Register(Texture, States::Common, 2, false);
+    registry.Register(VertexBuffer, States::Common, 1, true);
+    registry.Register(IndexBuffer, States::CopyDest, 1, true);
+    CHECK(registry.IsRegistered(IndexBuffer));
+
+    ResourceStateTracker tracker{registry};
+    tracker.Transition(Texture, States::RenderTarget);
+    tracker.Transition(VertexBuffer, States::VertexAndConstantBuffer);
+    tracker.Transition(IndexBuffer, States::IndexBuffer);
+
+    // Both texture subresources need the same fixup, so it covers the whole resource.  The vertex
+    // buffer is promoted from COMMON implicitly; the index buffer is not in COMMON, so it needs one.
+    std::vector<Barrier> fixups{};
+    registry.Submit(tracker, fixups);
+    REQUIRE(fixups.size() == 2);
+    REQUIRE(FindBarrier(fixups, Texture) != nullptr);
+    CHECK(IsBarrier(*FindBarrier(fixups, Texture), Texture, AllSubresources, States::Common, States::RenderTarget));
+    REQUIRE(FindBarrier(fixups, IndexBuffer) != nullptr);
+    CHECK(IsBarrier(*FindBarrier(fixups, IndexBuffer), IndexBuffer, AllSubresources, States::CopyDest, States::IndexBuffer));
+    CHECK(FindBarrier(fixups, VertexBuffer) == nullptr);
+
+    // Textures keep the list's final state; buffers decay back to COMMON.
+    CHECK(registry.State(Texture, 0) == States::RenderTarget);
+    CHECK(registry.State(Texture, 1) == States::RenderTarget);
+    CHECK(registry.State(VertexBuffer) == States::Common);
+    CHECK(registry.State(IndexBuffer) == States::Common);
+
+    // The next list is fixed up against the committed states, so the decayed buffer needs nothing.
+    tracker.Reset();
+    tracker.Transition(Texture, States::PixelShaderResource, 1);
+    tracker.Transition(IndexBuffer, States::CopyDest);
+    fixups.clear();
+    registry.Submit(tracker, fixups);
+    REQUIRE(fixups.size() == 1);
+    CHECK(IsBarrier(fixups[0], Texture, 1, States::RenderTarget, States::PixelShaderResource));
+    CHECK(registry.State(Texture, 0) == States::RenderTarget);
+    CHECK(registry.State(Texture, 1) == States::PixelShaderResource);
+
+    registry.Unregister(IndexBuffer);
+    CHECK(!registry.IsRegistered(IndexBuffer));
+}
@@ -0,0 +1,194 @@
+#include "../Shared/AsyncFileIO.h"
+#include "../Shared/ShaderCache.h"
+#include "TestHarness.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace Gfx;
+
+namespace
+{
+// Stands in for the D3D compiler: the bytecode is the entry point, and Identity is whatever the
+// test sets.
+class StubCompiler : public IShaderCompiler
+{
+public:
+    std::uint64_t Identity() const override
+    {
+        return mIdentity;
+    }
+
+    bool Compile(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode, std::string& errors) override
+    {
+        ++mCompileCount;
+        if (request.EntryPoint.empty())
+        {
+            errors = "no entry point";
+            return false;
+        }
+        bytecode.assign(request.EntryPoint.begin(), request.EntryPoint.end());
+        return true;
+    }
+
+    void SetIdentity(std::uint64_t identity)
+    {
+        mIdentity = identity;
+    }
+
+    std::uint32_t CompileCount() const
+    {
+        return mCompileCount;
+    }
+
+private:
+    std::uint64_t mIdentity{1};
+    std::uint32_t mCompileCount{0};
+};
+
+// A fresh directory under the system temporary directory, removed again when the test ends.
+class TemporaryDirectory
+{
+public:
+    explicit TemporaryDirectory(const wchar_t* name) : mPath{std::filesystem::temp_directory_path() / name}
+    {
+        std::filesystem::remove_all(mPath);
+        std::filesystem::create_directories(mPath);
+    }
+    TemporaryDirectory(const TemporaryDirectory& rhs) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory& rhs) = delete;
+    ~TemporaryDirectory()
+    {
+        std::error_code error{};
+        std::filesystem::remove_all(mPath, error);
+    }
+
+    const std::filesystem::path& Path() const
+    {
+        return mPath;
+    }
+
+private:
+    std::filesystem::path mPath{};
+};
+
+void WriteText(const std::filesystem::path& path, const char* text)
+{
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    fout << text;
+    if (!fout.flush())
+    {
+        throw std::runtime_error("Cannot write " + path.u8string());
+    }
+}
+
+// a.hlsl includes b.h from the same directory.
+ShaderCompileRequest WriteShader(const std::filesystem::path& directory)
+{
+    WriteText(directory / "a.hlsl", "#include \"b.h\"\nfloat4 PS() : SV_Target { return Color; }\n");
+    WriteText(directory / "b.h", "static const float4 Color = float4(1, 0, 0, 1);\n");
+    return ShaderCompileRequest{(directory / "a.hlsl").wstring(), {{"USE_FOG", "1"}}, "PS", "ps_5_1", 0};
+}
+} // namespace
+
+TEST_CASE(ShaderCacheCompilesOnceAndThenHits)
+{
+    TemporaryDirectory directory{L"ShaderCacheTests.Hits"};
+    auto request{WriteShader(directory.Path())};
+    StubCompiler compiler{};
+    ShaderCache cache{compiler, (directory.Path() / "cache").wstring()};
+
+    std::vector<std::wstring> sources{};
+    auto path{cache.Resolve(request, &sources)};
+    CHECK(cache.Stats().Compiles == 1);
+    CHECK(cache.Stats().Hits == 0);
+    CHECK(std::filesystem::file_size(path) == request.EntryPoint.size());
+
+    // The source and its include are both reported, so a watcher can invalidate on either.
+    REQUIRE(sources.size() == 2);
+    CHECK(std::filesystem::path{sources[0]} == directory.Path() / "a.hlsl");
+    CHECK(std::filesystem::path{sources[1]} == directory.Path() / "b.h");
+
+    CHECK(cache.Resolve(request) == path);
+    CHECK(cache.Stats().Compiles == 1);
+    CHECK(cache.Stats().Hits == 1);
+
+    // A second cache on the same directory, as on the next run, finds the entry without compiling.
+    ShaderCache reopened{compiler, (directory.Path() / "cache").wstring()};
+    CHECK(reopened.Resolve(request) == path);
+    CHECK(reopened.Stats().Hits == 1);
+    CHECK(compiler.CompileCount() == 1);
+
+    // A failed compile throws and stores nothing.
+    auto failing{request};
+    failing.EntryPoint.clear();
+    auto threw{false};
+    try
+    {
+        static_cast<void>(cache.Resolve(failing));
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(cache.Stats().Compiles == 1);
+    auto entries{std::distance(std::filesystem::directory_iterator{directory.Path() / "cache"},
+                               std::filesystem::directory_iterator{})};
+    CHECK(entries == 1);
+}
+
+TEST_CASE(ShaderCacheKeyFollowsIncludedContents)
+{
+    TemporaryDirectory directory{L"ShaderCacheTests.Includes"};
+    auto request{WriteShader(directory.Path())};
+    StubCompiler compiler{};
+    ShaderCache cache{compiler, (directory.Path() / "cache").wstring()};
+
+    auto key{cache.Key(request)};
+    auto path{cache.Resolve(request)};
+
+    // Rewriting the include with the same contents keeps the key; different contents change it.
+    WriteText(directory.Path() / "b.h", "static const float4 Color = float4(1, 0, 0, 1);\n");
+    CHECK(cache.Key(request) == key);
+    WriteText(directory.Path() / "b.h", "static const float4 Color = float4(0, 1, 0, 1);\n");
+    CHECK(cache.Key(request) != key);
+
+    CHECK(cache.Resolve(request) != path);
+    CHECK(cache.Stats().Compiles == 2);
+    CHECK(cache.Stats().Hits == 0);
+
+    // Reading through AsyncFileIO hashes the same bytes.
+    Files::AsyncFileIO fileIO{};
+    ShaderCache asyncCache{compiler, (directory.Path() / "cache").wstring(), &fileIO};
+    CHECK(asyncCache.Key(request) == cache.Key(request));
+}
+
+TEST_CASE(ShaderCacheKeyFollowsDefinesAndCompilerIdentity)
+{
+    TemporaryDirectory directory{L"ShaderCacheTests.Defines"};
+    auto request{WriteShader(directory.Path())};
+    StubCompiler compiler{};
+    ShaderCache cache{compiler, (directory.Path() / "cache").wstring()};
+    auto key{cache.Key(request)};
+
+    auto changedValue{request};
+    changedValue.Defines[0].Value = "0";
+    CHECK(cache.Key(changedValue) != key);
+
+    auto addedDefine{request};
+    addedDefine.Defines.push_back(ShaderDefine{"USE_SHADOWS", "1"});
+    CHECK(cache.Key(addedDefine) != key);
+
+    // A new compiler build may emit different bytecode for the same request.
+    compiler.SetIdentity(2);
+    CHECK(cache.Key(request) != key);
+    static_cast<void>(cache.Resolve(request));
+    compiler.SetIdentity(1);
+    CHECK(cache.Key(request) == key);
+    static_cast<void>(cache.Resolve(request));
+    CHECK(cache.Stats().Compiles == 2);
+}
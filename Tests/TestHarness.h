@@ -0,0 +1,47 @@
+#ifndef _TESTHARNESS_
+#define _TESTHARNESS_
+
+// Minimal self-registering tests for the portable Shared code, run headless on any platform:
+// `xmake build Tests && xmake test`, or `xmake run Tests <filter>` to run the tests whose names
+// contain filter.
+//
+// TEST_CASE(Name) defines and registers a test.  CHECK records a failure and carries on; REQUIRE
+// records one and ends the test.  A test that throws fails.  Both are live in release builds.
+namespace Testing
+{
+using TestFunction = void (*)();
+
+bool Register(const char* name, TestFunction function);
+void Fail(const char* file, int line, const char* expression);
+
+// Thrown by REQUIRE to end the failing test.
+struct RequireFailure
+{
+};
+} // namespace Testing
+
+#define TEST_CASE(name)                                                                                              \
+    static void name();                                                                                              \
+    static const bool name##Registered{::Testing::Register(#name, name)};                                            \
+    static void name()
+
+#define CHECK(expression)                                                                                            \
+    do                                                                                                               \
+    {                                                                                                                \
+        if (!(expression))                                                                                           \
+        {                                                                                                            \
+            ::Testing::Fail(__FILE__, __LINE__, #expression);                                                        \
+        }                                                                                                            \
+    } while (false)
+
+#define REQUIRE(expression)                                                                                          \
+    do                                                                                                               \
+    {                                                                                                                \
+        if (!(expression))                                                                                           \
+        {                                                                                                            \
+            ::Testing::Fail(__FILE__, __LINE__, #expression);                                                        \
+            throw ::Testing::RequireFailure{};                                                                       \
+        }                                                                                                            \
+    } while (false)
+
+#endif // _TESTHARNESS_
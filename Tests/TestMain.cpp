@@ -0,0 +1,79 @@
+#include "TestHarness.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace
+{
+struct TestCase
+{
+    const char* Name;
+    Testing::TestFunction Function;
+};
+
+// Function-local so registration from other translation units' static initializers is safe.
+std::vector<TestCase>& Registry()
+{
+    static std::vector<TestCase> tests{};
+    return tests;
+}
+
+std::uint32_t FailureCount{0};
+} // namespace
+
+bool Testing::Register(const char* name, TestFunction function)
+{
+    Registry().push_back({name, function});
+    return true;
+}
+
+void Testing::Fail(const char* file, int line, const char* expression)
+{
+    ++FailureCount;
+    std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter{argc > 1 ? argv[1] : nullptr};
+
+    std::uint32_t runCount{0};
+    std::uint32_t failedCount{0};
+    for (const auto& test : Registry())
+    {
+        if (filter != nullptr && std::strstr(test.Name, filter) == nullptr)
+        {
+            continue;
+        }
+
+        auto failuresBefore{FailureCount};
+        try
+        {
+            test.Function();
+        }
+        catch (const Testing::RequireFailure&)
+        {
+        }
+        catch (const std::exception& e)
+        {
+            Testing::Fail(__FILE__, __LINE__, e.what());
+        }
+        catch (...)
+        {
+            Testing::Fail(__FILE__, __LINE__, "unknown exception");
+        }
+
+        ++runCount;
+        if (FailureCount != failuresBefore)
+        {
+            ++failedCount;
+            std::printf("FAILED %s\n", test.Name);
+        }
+    }
+
+    std::printf("%u of %u tests passed\n", runCount - failedCount, runCount);
+    return failedCount == 0 && runCount != 0 ? 0 : 1;
+}
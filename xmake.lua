@@ -78,11 +78,17 @@ target("Chapter_7")
     add_packages("vcpkg::directxtk12")
 
     add_includedirs("Chapter_7/")
-    add_files("Chapter_7/*.cpp", "Shared/GeometryGenerator.cpp", "Shared/PlatformHelpers.cpp")
+    add_files("Chapter_7/*.cpp", "Shared/GeometryGenerator.cpp", "Shared/PlatformHelpers.cpp", "Shared/StreamCopy.cpp")
 
     add_ldflags("/SUBSYSTEM:WINDOWS")
     add_syslinks("User32", "Gdi32", "dxguid")
 
+    -- Shaders are compiled from and watched in the source tree; the copied assets are the fallback.
+    on_load(function (target)
+        local shaderDir = path.join(os.projectdir(), "Chapter_7", "Shaders"):gsub("\\", "/")
+        target:add("defines", format('SHADER_SOURCE_DIR="%s"', shaderDir))
+    end)
+
     after_build(function (target)
         import("core.project.task")
         task.run("CopyAssets_Chapter_7")
@@ -93,7 +99,34 @@ target("D3DApp")
     set_kind("static")
 
     add_includedirs("D3DApp/", {public = true})
-    add_files("D3DApp/*.cpp", "Shared/PlatformHelpers.cpp", "Shared/Timer.cpp")
+    add_files("D3DApp/*.cpp",
+              "Shared/AsyncFileIO.cpp",
+              "Shared/BuddyAllocator.cpp",
+              "Shared/CopyQueue.cpp",
+              "Shared/DeferredRelease.cpp",
+              "Shared/DescriptorAllocator.cpp",
+              "Shared/FenceWaiter.cpp",
+              "Shared/FileWatcher.cpp",
+              "Shared/FrameLatency.cpp",
+              "Shared/FrameTimeStats.cpp",
+              "Shared/GfxD3D12.cpp",
+              "Shared/GfxNull.cpp",
+              "Shared/GpuProfiler.cpp",
+              "Shared/Hash.cpp",
+              "Shared/HeapAllocator.cpp",
+              "Shared/JobSystem.cpp",
+              "Shared/MappedFile.cpp",
+              "Shared/PerfMonitor.cpp",
+              "Shared/PipelineCache.cpp",
+              "Shared/PlatformHelpers.cpp",
+              "Shared/Profiler.cpp",
+              "Shared/RenderGraph.cpp",
+              "Shared/ResourceStateTracker.cpp",
+              "Shared/ShaderCache.cpp",
+              "Shared/ShaderPermutations.cpp",
+              "Shared/StreamCopy.cpp",
+              "Shared/Timer.cpp",
+              "Shared/UploadBatcher.cpp")
 
 
 target("D3DApp_imgui")
@@ -106,7 +139,7 @@ target("D3DApp_imgui")
                  "vcpkg::imgui[win32-binding]")
 
     add_includedirs("D3DApp_imgui/")
-    add_files("D3DApp_imgui/*.cpp")
+    add_files("D3DApp_imgui/*.cpp", "Shared/PerfHud.cpp")
 
     add_ldflags("/SUBSYSTEM:WINDOWS")
     add_syslinks("User32", "Gdi32", "dxguid")
@@ -136,12 +169,79 @@ target("Ch7_Test")
     "vcpkg::imgui[win32-binding]")
 
     add_includedirs("Ch7_Test/")
-    add_files("Ch7_Test/*.cpp")
+    add_files("Ch7_Test/*.cpp", "Shared/PerfHud.cpp")
 
     add_ldflags("/SUBSYSTEM:WINDOWS")
     add_syslinks("User32", "Gdi32", "dxguid")
 
 
+-- Unit tests for the portable Shared code; they build and run headless on any platform: xmake test.
+target("Tests")
+    set_kind("binary")
+    set_default(false)
+
+    add_files("Tests/*.cpp",
+              "Shared/AsyncFileIO.cpp",
+              "Shared/BuddyAllocator.cpp",
+              "Shared/CopyQueue.cpp",
+              "Shared/DescriptorAllocator.cpp",
+              "Shared/FenceWaiter.cpp",
+              "Shared/FileWatcher.cpp",
+              "Shared/GfxNull.cpp",
+              "Shared/GpuProfiler.cpp",
+              "Shared/Hash.cpp",
+              "Shared/JobSystem.cpp",
+              "Shared/PipelineCache.cpp",
+              "Shared/Profiler.cpp",
+              "Shared/RenderGraph.cpp",
+              "Shared/ResourceStateTracker.cpp",
+              "Shared/ShaderCache.cpp",
+              "Shared/StreamCopy.cpp",
+              "Shared/UploadBatcher.cpp")
+    add_tests("default")
+
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+
+-- Benchmarks build on any platform and are not built by default: xmake build <Name>Bench.
+target("CopyRangeBench")
+    set_kind("binary")
+    set_default(false)
+
+    add_files("Benchmarks/CopyRangeBench.cpp", "Shared/StreamCopy.cpp")
+
+
+target("FileReadBench")
+    set_kind("binary")
+    set_default(false)
+
+    add_files("Benchmarks/FileReadBench.cpp", "Shared/AsyncFileIO.cpp")
+
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+
+target("JobSystemBench")
+    set_kind("binary")
+    set_default(false)
+
+    add_files("Benchmarks/JobSystemBench.cpp", "Shared/JobSystem.cpp", "Shared/Profiler.cpp")
+
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+
+target("ObjectDataBench")
+    set_kind("binary")
+    set_default(false)
+
+    add_files("Benchmarks/ObjectDataBench.cpp")
+
+
 task("CopyAssets_Chapter_6")
     on_run(function()
         if is_mode("debug") then